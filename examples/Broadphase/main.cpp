@@ -0,0 +1,216 @@
+#include <Common/TimerSystem.h>
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Bounds.h>
+#include <MelonCore/BroadphaseSystem.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/OverlapPairs.h>
+#include <MelonCore/StaticBounds.h>
+#include <MelonCore/SystemBase.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/vector_relational.hpp>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// 10000 boxes wander over a square among 10000 static ones and a floor, whose overlapping pairs are counted by testing all of them or by the BroadphaseSystem
+
+constexpr unsigned int k_DynamicCount = 10000;
+constexpr unsigned int k_StaticCount = 10000;
+constexpr float k_AreaSize = 400.0f;
+constexpr unsigned int k_FrameCount = 10;
+// Frames before measuring, in which static Bounds are sorted
+constexpr unsigned int k_WarmUpFrameCount = 5;
+
+struct Velocity : public Melon::DataComponent {
+    glm::vec3 value;
+};
+
+float randomFloat(const float& min, const float& max) {
+    return min + (max - min) * static_cast<float>(std::rand() % 10001) / 10000.0f;
+}
+
+class WanderSystem : public Melon::SystemBase {
+  protected:
+    class WanderChunkTask : public Melon::ChunkTask {
+      public:
+        WanderChunkTask(const unsigned int& boundsComponentId, const unsigned int& velocityComponentId) : m_BoundsComponentId(boundsComponentId), m_VelocityComponentId(velocityComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            Melon::Bounds* bounds = chunkAccessor.componentArray<Melon::Bounds>(m_BoundsComponentId);
+            const Velocity* velocities = chunkAccessor.componentArray<const Velocity>(m_VelocityComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                // Boxes leaving the square come back from the other side
+                glm::vec3 offset = velocities[i].value;
+                offset -= k_AreaSize * glm::vec3(glm::greaterThanEqual(bounds[i].min + offset, glm::vec3(k_AreaSize))) - k_AreaSize * glm::vec3(glm::lessThan(bounds[i].min + offset, glm::vec3(0.0f)));
+                bounds[i].min += offset;
+                bounds[i].max += offset;
+            }
+        }
+
+        const unsigned int& m_BoundsComponentId;
+        const unsigned int& m_VelocityComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* dynamicArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Bounds, Velocity>().createArchetype();
+        std::vector<Melon::Entity> dynamicEntities(k_DynamicCount);
+        std::vector<Melon::Bounds> dynamicBounds(k_DynamicCount);
+        std::vector<Velocity> velocities(k_DynamicCount);
+        for (unsigned int i = 0; i < k_DynamicCount; i++) {
+            dynamicBounds[i].min = glm::vec3(randomFloat(0.0f, k_AreaSize), 0.5f, randomFloat(0.0f, k_AreaSize));
+            dynamicBounds[i].max = dynamicBounds[i].min + glm::vec3(randomFloat(0.5f, 1.5f), 1.0f, randomFloat(0.5f, 1.5f));
+            velocities[i].value = glm::vec3(randomFloat(-0.5f, 0.5f), 0.0f, randomFloat(-0.5f, 0.5f));
+        }
+        entityManager()->createEntities(dynamicArchetype, std::span<Melon::Entity>(dynamicEntities), dynamicBounds.data(), velocities.data());
+
+        // The floor spans the square below the boxes, touching none of them
+        Melon::Archetype* staticArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Bounds, Melon::StaticBounds>().createArchetype();
+        std::vector<Melon::Entity> staticEntities(k_StaticCount + 1);
+        std::vector<Melon::Bounds> staticBounds(k_StaticCount + 1);
+        for (unsigned int i = 0; i < k_StaticCount; i++) {
+            staticBounds[i].min = glm::vec3(randomFloat(0.0f, k_AreaSize), 0.0f, randomFloat(0.0f, k_AreaSize));
+            staticBounds[i].max = staticBounds[i].min + glm::vec3(randomFloat(1.0f, 3.0f), randomFloat(1.0f, 3.0f), randomFloat(1.0f, 3.0f));
+        }
+        staticBounds[k_StaticCount] = Melon::Bounds{.min = glm::vec3(0.0f, -1.0f, 0.0f), .max = glm::vec3(k_AreaSize, 0.0f, k_AreaSize)};
+        entityManager()->createEntities(staticArchetype, std::span<Melon::Entity>(staticEntities), staticBounds.data());
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Bounds, Velocity>().createEntityFilter();
+        m_BoundsComponentId = entityManager()->componentId<Melon::Bounds>();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Velocity>().writeComponents<Melon::Bounds>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<WanderChunkTask>(m_BoundsComponentId, m_VelocityComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_BoundsComponentId;
+    unsigned int m_VelocityComponentId;
+};
+
+// Tests each dynamic box against every other box
+class BruteForceSystem : public Melon::SystemBase {
+  public:
+    // Pairs of the last frame
+    static inline unsigned int s_PairCount{};
+
+  protected:
+    class GatherChunkTask : public Melon::ChunkTask {
+      public:
+        GatherChunkTask(const unsigned int& boundsComponentId, std::vector<Melon::Bounds>& bounds) : m_BoundsComponentId(boundsComponentId), m_Bounds(bounds) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::Bounds* bounds = chunkAccessor.componentArray<const Melon::Bounds>(m_BoundsComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                m_Bounds[firstEntityIndex + i] = bounds[i];
+        }
+
+        const unsigned int& m_BoundsComponentId;
+        std::vector<Melon::Bounds>& m_Bounds;
+    };
+
+    class OverlapChunkTask : public Melon::ChunkTask {
+      public:
+        OverlapChunkTask(std::vector<Melon::Bounds> const& dynamicBounds, std::vector<Melon::Bounds> const& staticBounds, std::atomic<unsigned int>& pairCount) : m_DynamicBounds(dynamicBounds), m_StaticBounds(staticBounds), m_PairCount(pairCount) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const auto overlapping = [](const Melon::Bounds& a, const Melon::Bounds& b) { return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max)); };
+            unsigned int pairCount = 0;
+            for (unsigned int i = firstEntityIndex; i < firstEntityIndex + chunkAccessor.entityCount(); i++) {
+                for (unsigned int j = i + 1; j < m_DynamicBounds.size(); j++)
+                    pairCount += overlapping(m_DynamicBounds[i], m_DynamicBounds[j]);
+                for (const Melon::Bounds& staticBounds : m_StaticBounds)
+                    pairCount += overlapping(m_DynamicBounds[i], staticBounds);
+            }
+            m_PairCount += pairCount;
+        }
+
+        std::vector<Melon::Bounds> const& m_DynamicBounds;
+        std::vector<Melon::Bounds> const& m_StaticBounds;
+        std::atomic<unsigned int>& m_PairCount;
+    };
+
+    void onEnter() override {
+        m_DynamicEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Bounds>().rejectComponents<Melon::StaticBounds>().createEntityFilter();
+        m_StaticEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Bounds, Melon::StaticBounds>().createEntityFilter();
+        m_BoundsComponentId = entityManager()->componentId<Melon::Bounds>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Melon::Bounds>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        m_DynamicBounds.resize(entityManager()->entityCount(m_DynamicEntityFilter));
+        m_StaticBounds.resize(entityManager()->entityCount(m_StaticEntityFilter));
+        predecessor() = schedule(std::make_shared<GatherChunkTask>(m_BoundsComponentId, m_DynamicBounds), m_DynamicEntityFilter, predecessor());
+        predecessor() = schedule(std::make_shared<GatherChunkTask>(m_BoundsComponentId, m_StaticBounds), m_StaticEntityFilter, predecessor());
+        m_PairCount = 0;
+        predecessor() = schedule(std::make_shared<OverlapChunkTask>(m_DynamicBounds, m_StaticBounds, m_PairCount), m_DynamicEntityFilter, predecessor());
+    }
+
+    void onExit() override {
+        s_PairCount = m_PairCount.load();
+        printf("%u pairs, ", s_PairCount);
+    }
+
+  private:
+    Melon::EntityFilter m_DynamicEntityFilter;
+    Melon::EntityFilter m_StaticEntityFilter;
+    unsigned int m_BoundsComponentId;
+    std::vector<Melon::Bounds> m_DynamicBounds;
+    std::vector<Melon::Bounds> m_StaticBounds;
+    std::atomic<unsigned int> m_PairCount;
+};
+
+// Counts the OverlapPairs found by the BroadphaseSystem
+class PairCountSystem : public Melon::SystemBase {
+  public:
+    // Pairs of the last frame
+    static inline unsigned int s_PairCount{};
+
+  protected:
+    void onEnter() override {
+        m_OverlapPairsSingletonComponentId = entityManager()->singletonComponentId<Melon::OverlapPairs>();
+        declareComponentAccess(createComponentAccessBuilder().readSingletonComponents<Melon::OverlapPairs>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        const Melon::OverlapPairs* overlapPairs = entityManager()->singletonComponent<Melon::OverlapPairs>(m_OverlapPairsSingletonComponentId);
+        predecessor() = schedule([this, overlapPairs](const unsigned int&) { m_PairCount = overlapPairs->pairCount(); }, 1, createComponentAccessBuilder().readSingletonComponents<Melon::OverlapPairs>().createComponentAccess(), predecessor());
+    }
+
+    void onExit() override {
+        s_PairCount = m_PairCount;
+        printf("%u pairs, ", s_PairCount);
+    }
+
+  private:
+    unsigned int m_OverlapPairsSingletonComponentId;
+    unsigned int m_PairCount{};
+};
+
+int main() {
+    std::srand(0);
+    Melon::Instance()
+        .registerSystem<WanderSystem>()
+        .registerSystem<BruteForceSystem>()
+        .registerSystem<TimerSystem>("Brute force", k_WarmUpFrameCount, k_FrameCount)
+        .start();
+    std::srand(0);
+    Melon::Instance()
+        .registerSystem<WanderSystem>()
+        .registerSystem<Melon::BroadphaseSystem>()
+        .registerSystem<PairCountSystem>()
+        .registerSystem<TimerSystem>("Broadphase", k_WarmUpFrameCount, k_FrameCount)
+        .start();
+    // Both runs move the boxes alike, so their last frames should have the same pairs
+    if (BruteForceSystem::s_PairCount != PairCountSystem::s_PairCount) {
+        printf("Pair counts differ: %u by brute force, %u by the BroadphaseSystem\n", BruteForceSystem::s_PairCount, PairCountSystem::s_PairCount);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Translation.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Runs a pipeline of systems over the same chunks, with and without chunk affinity
+// With affinity each worker finds the chunks of the previous system in its own cache
+
+constexpr unsigned int k_EntityCount = 1 << 20;
+constexpr unsigned int k_FrameCount = 100;
+
+struct Acceleration : public Melon::SoADataComponent {
+    glm::vec3 value;
+};
+
+struct Velocity : public Melon::SoADataComponent {
+    glm::vec3 value;
+};
+
+struct Bounds : public Melon::DataComponent {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+class AccelerationSystem : public Melon::SystemBase {
+  public:
+    AccelerationSystem(const bool& chunkAffinity) : m_ChunkAffinity(chunkAffinity) {}
+
+  protected:
+    class AccelerationChunkTask : public Melon::ChunkTask {
+      public:
+        AccelerationChunkTask(const unsigned int& accelerationComponentId, const unsigned int& velocityComponentId) : m_AccelerationComponentId(accelerationComponentId), m_VelocityComponentId(velocityComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<const Acceleration> accelerations = chunkAccessor.componentFields<const Acceleration>(m_AccelerationComponentId);
+            const Melon::ComponentFields<Velocity> velocities = chunkAccessor.componentFields<Velocity>(m_VelocityComponentId);
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                std::span<const float> acceleration = accelerations.field(axis);
+                std::span<float> velocity = velocities.field(axis);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    velocity[i] = velocity[i] * 0.99f + acceleration[i];
+            }
+        }
+
+        const unsigned int& m_AccelerationComponentId;
+        const unsigned int& m_VelocityComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Acceleration, Velocity, Melon::Translation, Bounds>().createArchetype();
+        std::vector<Melon::Entity> entities(k_EntityCount);
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities));
+        for (unsigned int i = 0; i < entities.size(); i++)
+            entityManager()->setComponent(entities[i], Acceleration{.value = glm::vec3(i % 3, i % 5, i % 7) * 0.001f});
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Acceleration, Velocity>().createEntityFilter();
+        m_AccelerationComponentId = entityManager()->componentId<Acceleration>();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Acceleration>().writeComponents<Velocity>().createComponentAccess());
+        setChunkAffinity(m_ChunkAffinity);
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<AccelerationChunkTask>(m_AccelerationComponentId, m_VelocityComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    const bool m_ChunkAffinity;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_AccelerationComponentId;
+    unsigned int m_VelocityComponentId;
+};
+
+class MovementSystem : public Melon::SystemBase {
+  public:
+    MovementSystem(const bool& chunkAffinity) : m_ChunkAffinity(chunkAffinity) {}
+
+  protected:
+    class MovementChunkTask : public Melon::ChunkTask {
+      public:
+        MovementChunkTask(const unsigned int& velocityComponentId, const unsigned int& translationComponentId) : m_VelocityComponentId(velocityComponentId), m_TranslationComponentId(translationComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<const Velocity> velocities = chunkAccessor.componentFields<const Velocity>(m_VelocityComponentId);
+            const Melon::ComponentFields<Melon::Translation> translations = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId);
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                std::span<const float> velocity = velocities.field(axis);
+                std::span<float> translation = translations.field(axis);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    translation[i] += velocity[i];
+            }
+        }
+
+        const unsigned int& m_VelocityComponentId;
+        const unsigned int& m_TranslationComponentId;
+    };
+
+    void onEnter() override {
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Velocity, Melon::Translation>().createEntityFilter();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Velocity>().writeComponents<Melon::Translation>().createComponentAccess());
+        setChunkAffinity(m_ChunkAffinity);
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<MovementChunkTask>(m_VelocityComponentId, m_TranslationComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    const bool m_ChunkAffinity;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_VelocityComponentId;
+    unsigned int m_TranslationComponentId;
+};
+
+class BoundsSystem : public Melon::SystemBase {
+  public:
+    BoundsSystem(const bool& chunkAffinity) : m_ChunkAffinity(chunkAffinity) {}
+
+  protected:
+    class BoundsChunkTask : public Melon::ChunkTask {
+      public:
+        BoundsChunkTask(const unsigned int& translationComponentId, const unsigned int& boundsComponentId) : m_TranslationComponentId(translationComponentId), m_BoundsComponentId(boundsComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<const Melon::Translation> translations = chunkAccessor.componentFields<const Melon::Translation>(m_TranslationComponentId);
+            Bounds* bounds = chunkAccessor.componentArray<Bounds>(m_BoundsComponentId);
+            std::span<const float> x = translations.field(0), y = translations.field(1), z = translations.field(2);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                bounds[i] = Bounds{.min = glm::vec3(x[i], y[i], z[i]) - 0.5f, .max = glm::vec3(x[i], y[i], z[i]) + 0.5f};
+        }
+
+        const unsigned int& m_TranslationComponentId;
+        const unsigned int& m_BoundsComponentId;
+    };
+
+    void onEnter() override {
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Translation, Bounds>().createEntityFilter();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        m_BoundsComponentId = entityManager()->componentId<Bounds>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Melon::Translation>().writeComponents<Bounds>().createComponentAccess());
+        setChunkAffinity(m_ChunkAffinity);
+    }
+
+    void onUpdate() override {
+        // Waits for the pipeline of the previous frame, so that frames measure its whole duration
+        if (predecessor())
+            predecessor()->complete();
+        if (m_FrameCounter++ == 1)
+            m_StartTimePoint = std::chrono::steady_clock::now();
+        if (m_FrameCounter > k_FrameCount + 1) {
+            const double frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_StartTimePoint).count() / k_FrameCount;
+            printf("Chunk affinity %s : %.3f ms per frame\n", m_ChunkAffinity ? "on" : "off", frameMilliseconds);
+            instance()->quit();
+            return;
+        }
+        predecessor() = schedule(std::make_shared<BoundsChunkTask>(m_TranslationComponentId, m_BoundsComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    const bool m_ChunkAffinity;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_TranslationComponentId;
+    unsigned int m_BoundsComponentId;
+    unsigned int m_FrameCounter{};
+    std::chrono::steady_clock::time_point m_StartTimePoint;
+};
+
+int main() {
+    for (const bool chunkAffinity : {false, true})
+        Melon::Instance()
+            .registerSystem<AccelerationSystem>(chunkAffinity)
+            .registerSystem<MovementSystem>(chunkAffinity)
+            .registerSystem<BoundsSystem>(chunkAffinity)
+            .start();
+    return 0;
+}
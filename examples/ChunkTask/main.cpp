@@ -8,6 +8,7 @@
 #include <array>
 #include <cstdio>
 #include <memory>
+#include <span>
 
 struct Speed : public Melon::DataComponent {
     unsigned int value;
@@ -19,12 +20,11 @@ class SpeedSystem : public Melon::SystemBase {
       public:
         SpeedChunkTask(const unsigned int& speedComponentId, const unsigned int& translationComponentId) : m_SpeedComponentId(speedComponentId), m_TranslationComponentId(translationComponentId) {}
         virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
-            Speed* feet = chunkAccessor.componentArray<Speed>(m_SpeedComponentId);
-            Melon::Translation* translations = chunkAccessor.componentArray<Melon::Translation>(m_TranslationComponentId);
-            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
-                Speed& speed = feet[i];
-                translations[i].value += glm::vec3(0, 0, speed.value);
-            }
+            const Speed* feet = chunkAccessor.componentArray<const Speed>(m_SpeedComponentId);
+            // Only the z column of Translation is touched, as a plain float array
+            std::span<float> z = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId).field(2);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                z[i] += feet[i].value;
         }
 
         const unsigned int& m_SpeedComponentId;
@@ -35,8 +35,7 @@ class SpeedSystem : public Melon::SystemBase {
         Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Speed>().createArchetype();
 
         std::array<Melon::Entity, 1024> entities;
-        for (unsigned int i = 0; i < entities.size(); i++)
-            entities[i] = entityManager()->createEntity(archetype);
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities));
         for (unsigned int i = 0; i * 3 < entities.size(); i++) {
             entityManager()->setComponent(entities[i], Speed{.value = i % 10});
             entityManager()->addComponent(entities[i], Melon::Translation{.value = glm::vec3(i % 10 + 10, i % 10 + 20, i % 10 + 30)});
@@ -49,6 +48,7 @@ class SpeedSystem : public Melon::SystemBase {
         m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Speed, Melon::Translation>().createEntityFilter();
         m_SpeedComponentId = entityManager()->componentId<Speed>();
         m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Speed>().writeComponents<Melon::Translation>().createComponentAccess());
     }
 
     void onUpdate() override {
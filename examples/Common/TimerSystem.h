@@ -0,0 +1,43 @@
+#pragma once
+
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+
+#include <chrono>
+#include <cstdio>
+
+// Measures frameCount frames after warmUpFrameCount frames and quits, printing the average duration per frame on exit
+// Registered last, so that it prints after what the other systems print on exit
+class TimerSystem : public Melon::SystemBase {
+  public:
+    TimerSystem(const char* const& name, const unsigned int& warmUpFrameCount, const unsigned int& frameCount) : m_Name(name), m_WarmUpFrameCount(warmUpFrameCount), m_FrameCount(frameCount) {}
+
+  protected:
+    void onEnter() override {
+        // Touches no components, it waits for the whole previous frame by itself
+        declareComponentAccess(createComponentAccessBuilder().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        // Waits for the tasks of the previous frame, so that frames measure their whole duration
+        entityManager()->completeEntityCommandBuffers();
+        if (m_FrameCounter++ == m_WarmUpFrameCount)
+            m_StartTimePoint = std::chrono::steady_clock::now();
+        if (m_FrameCounter > m_WarmUpFrameCount + m_FrameCount) {
+            m_FrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_StartTimePoint).count() / m_FrameCount;
+            instance()->quit();
+        }
+    }
+
+    void onExit() override {
+        printf("%s : %.3f ms per frame\n", m_Name, m_FrameMilliseconds);
+    }
+
+  private:
+    const char* const m_Name;
+    const unsigned int m_WarmUpFrameCount;
+    const unsigned int m_FrameCount;
+    unsigned int m_FrameCounter{};
+    std::chrono::steady_clock::time_point m_StartTimePoint;
+    double m_FrameMilliseconds{};
+};
@@ -0,0 +1,98 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ComponentLookup.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Time.h>
+#include <MelonCore/Translation.h>
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+#include <glm/geometric.hpp>
+
+struct Leader : public Melon::DataComponent {
+    unsigned int index;
+};
+
+struct Target : public Melon::DataComponent {
+    Melon::Entity entity;
+};
+
+class FollowSystem : public Melon::SystemBase {
+  protected:
+    // Followers read the Translation of their targets directly instead of through a copy exported by another pass
+    class FollowEntityCommandBufferChunkTask : public Melon::EntityCommandBufferChunkTask {
+      public:
+        FollowEntityCommandBufferChunkTask(const unsigned int& targetComponentId, const unsigned int& translationComponentId, const Melon::ComponentLookup<const Melon::Translation>& translationLookup) : m_TargetComponentId(targetComponentId), m_TranslationComponentId(translationComponentId), m_TranslationLookup(translationLookup) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, Melon::EntityCommandBuffer* entityCommandBuffer) override {
+            const Melon::Entity* entities = chunkAccessor.entityArray();
+            const Target* targets = chunkAccessor.componentArray<const Target>(m_TargetComponentId);
+            const Melon::ComponentFields<Melon::Translation> translations = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                const Melon::FieldReference<const Melon::Translation> targetTranslation = m_TranslationLookup.tryComponent(targets[i].entity);
+                // Followers of destroyed leaders stop where they are
+                if (!targetTranslation) {
+                    entityCommandBuffer->removeComponent<Target>(entities[i]);
+                    continue;
+                }
+                const glm::vec3 translation = translations[i].load().value;
+                translations[i] = Melon::Translation{.value = translation + (targetTranslation.load().value - translation) * 0.5f};
+            }
+        }
+
+        const unsigned int& m_TargetComponentId;
+        const unsigned int& m_TranslationComponentId;
+        const Melon::ComponentLookup<const Melon::Translation> m_TranslationLookup;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* leaderArchetype = entityManager()->createArchetypeBuilder().markComponents<Leader, Melon::Translation>().createArchetype();
+        Melon::Archetype* followerArchetype = entityManager()->createArchetypeBuilder().markComponents<Target, Melon::Translation>().createArchetype();
+
+        for (unsigned int i = 0; i < m_Leaders.size(); i++) {
+            m_Leaders[i] = entityManager()->createEntity(leaderArchetype);
+            entityManager()->setComponent(m_Leaders[i], Leader{.index = i});
+            entityManager()->setComponent(m_Leaders[i], Melon::Translation{.value = glm::vec3(i * 100.0f, 0.0f, 0.0f)});
+        }
+        std::array<Melon::Entity, 1024> followers;
+        entityManager()->createEntities(followerArchetype, std::span<Melon::Entity>(followers));
+        for (unsigned int i = 0; i < followers.size(); i++)
+            entityManager()->setComponent(followers[i], Target{.entity = m_Leaders[i % m_Leaders.size()]});
+
+        m_FollowerEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Target, Melon::Translation>().createEntityFilter();
+        m_TargetComponentId = entityManager()->componentId<Target>();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        // Followers write their own Translation besides reading the ones of leaders
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Target>().writeComponents<Melon::Translation>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        printf("Delta time : %f\n", time()->deltaTime());
+        if (m_Counter == 8)
+            entityManager()->destroyEntity(m_Leaders[0]);
+        predecessor() = schedule(std::make_shared<FollowEntityCommandBufferChunkTask>(m_TargetComponentId, m_TranslationComponentId, componentLookup<const Melon::Translation>()), m_FollowerEntityFilter, predecessor());
+        if (m_Counter++ > 16) {
+            printf("Followers still following: %u\n", entityManager()->entityCount(m_FollowerEntityFilter));
+            instance()->quit();
+        }
+    }
+
+    void onExit() override {}
+
+  private:
+    std::array<Melon::Entity, 4> m_Leaders;
+    Melon::EntityFilter m_FollowerEntityFilter;
+    unsigned int m_TargetComponentId;
+    unsigned int m_TranslationComponentId;
+    unsigned int m_Counter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<FollowSystem>()
+        .start();
+    return 0;
+}
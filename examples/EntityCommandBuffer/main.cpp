@@ -75,12 +75,15 @@ class SpawnerAndKillSystem : public Melon::SystemBase {
         m_MonsterEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Health>().createEntityFilter();
         m_SpawnerComponentId = entityManager()->componentId<Spawner>();
         m_HealthComponentId = entityManager()->componentId<Health>();
+        // Spawners and monsters are disjoint, so their tasks run concurrently
+        m_SpawnerComponentAccess = createComponentAccessBuilder().writeComponents<Spawner>().createComponentAccess();
+        m_MonsterComponentAccess = createComponentAccessBuilder().writeComponents<Health>().createComponentAccess();
     }
 
     void onUpdate() override {
         printf("Delta time : %f\n", time()->deltaTime());
-        std::shared_ptr<Melon::TaskHandle> spawnerTaskHandle = schedule(std::make_shared<SpawnerEntityCommandBufferChunkTask>(m_SpawnerComponentId), m_SpawnerEntityFilter, predecessor());
-        std::shared_ptr<Melon::TaskHandle> killTaskHandle = schedule(std::make_shared<KillEntityCommandBufferChunkTask>(m_HealthComponentId), m_MonsterEntityFilter, predecessor());
+        std::shared_ptr<Melon::TaskHandle> spawnerTaskHandle = schedule(std::make_shared<SpawnerEntityCommandBufferChunkTask>(m_SpawnerComponentId), m_SpawnerEntityFilter, m_SpawnerComponentAccess, predecessor());
+        std::shared_ptr<Melon::TaskHandle> killTaskHandle = schedule(std::make_shared<KillEntityCommandBufferChunkTask>(m_HealthComponentId), m_MonsterEntityFilter, m_MonsterComponentAccess, predecessor());
         predecessor() = taskManager()->combine({spawnerTaskHandle, killTaskHandle});
         if (entityManager()->entityCount(m_SpawnerEntityFilter) == 0 && entityManager()->entityCount(m_MonsterEntityFilter) == 0)
             instance()->quit();
@@ -91,6 +94,8 @@ class SpawnerAndKillSystem : public Melon::SystemBase {
   private:
     Melon::EntityFilter m_SpawnerEntityFilter;
     Melon::EntityFilter m_MonsterEntityFilter;
+    Melon::ComponentAccess m_SpawnerComponentAccess;
+    Melon::ComponentAccess m_MonsterComponentAccess;
     unsigned int m_SpawnerComponentId;
     unsigned int m_HealthComponentId;
     unsigned int m_Counter{};
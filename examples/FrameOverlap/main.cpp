@@ -0,0 +1,118 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Time.h>
+#include <MelonCore/Translation.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+// Measures how much of a frame the main thread spends idle while the tasks of the previous systems run.
+// The simulation tasks and the main thread work of the other system overlap as they touch different data.
+
+constexpr unsigned int k_FrameCount = 200;
+constexpr std::chrono::microseconds k_MainThreadWorkDuration(2000);
+
+struct Velocity : public Melon::DataComponent {
+    glm::vec3 value;
+};
+
+std::atomic<long long> g_TaskNanoseconds;
+
+class SimulationSystem : public Melon::SystemBase {
+  protected:
+    // Expensive per Entity, so chunks may be split across workers
+    class SimulationChunkTask : public Melon::ChunkRangeTask {
+      public:
+        SimulationChunkTask(const unsigned int& velocityComponentId, const unsigned int& translationComponentId) : m_VelocityComponentId(velocityComponentId), m_TranslationComponentId(translationComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, const unsigned int& entityBegin, const unsigned int& entityEnd) override {
+            const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+            const Velocity* velocities = chunkAccessor.componentArray<const Velocity>(m_VelocityComponentId);
+            const Melon::ComponentFields<Melon::Translation> translations = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId);
+            for (unsigned int i = entityBegin; i < entityEnd; i++) {
+                glm::vec3 translation = translations[i].load().value;
+                for (unsigned int step = 0; step < 64; step++)
+                    translation += velocities[i].value * std::sin(translation.x + step);
+                translations[i] = Melon::Translation{.value = translation};
+            }
+            g_TaskNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTimePoint).count();
+        }
+
+        const unsigned int& m_VelocityComponentId;
+        const unsigned int& m_TranslationComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Velocity, Melon::Translation>().createArchetype();
+        std::array<Melon::Entity, 16384> entities;
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities));
+        for (unsigned int i = 0; i < entities.size(); i++)
+            entityManager()->setComponent(entities[i], Velocity{.value = glm::vec3(i % 7, i % 11, i % 13) * 0.001f});
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Velocity, Melon::Translation>().createEntityFilter();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Velocity>().writeComponents<Melon::Translation>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<SimulationChunkTask>(m_VelocityComponentId, m_TranslationComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_VelocityComponentId;
+    unsigned int m_TranslationComponentId;
+};
+
+class MainThreadSystem : public Melon::SystemBase {
+  protected:
+    void onEnter() override {
+        // Touches no components, so it never waits for the simulation
+        declareComponentAccess(createComponentAccessBuilder().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - startTimePoint < k_MainThreadWorkDuration)
+            ;
+
+        // Skips the first frame, which includes the creation of the Entities
+        if (m_FrameCounter++ == 0) {
+            g_TaskNanoseconds = 0;
+            m_FrameStartTimePoint = std::chrono::steady_clock::now();
+            return;
+        }
+        if (m_FrameCounter <= k_FrameCount)
+            return;
+
+        const double frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_FrameStartTimePoint).count() / k_FrameCount;
+        const double mainThreadMilliseconds = std::chrono::duration<double, std::milli>(k_MainThreadWorkDuration).count();
+        const double taskMilliseconds = g_TaskNanoseconds / 1e6 / k_FrameCount;
+        printf("Frame : %.3f ms, main thread work : %.3f ms, task work : %.3f ms\n", frameMilliseconds, mainThreadMilliseconds, taskMilliseconds);
+        printf("Main thread idle : %.3f ms per frame\n", frameMilliseconds - mainThreadMilliseconds);
+        instance()->quit();
+    }
+
+    void onExit() override {}
+
+  private:
+    unsigned int m_FrameCounter{};
+    std::chrono::steady_clock::time_point m_FrameStartTimePoint;
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SimulationSystem>()
+        .registerSystem<MainThreadSystem>()
+        .start();
+    return 0;
+}
@@ -15,6 +15,8 @@ class HelloWorldSystem : public Melon::SystemBase {
     void onEnter() override {}
 
     void onUpdate() override {
+        // Results of the tasks are read on the main thread, which waits for them
+        predecessor()->complete();
         std::printf("Delta time : %f, %u + %u = %u\n", time()->deltaTime(), m_A, m_B, m_Sum);
         std::shared_ptr<Melon::TaskHandle> a = taskManager()->schedule([this]() { m_A++; }, {predecessor()});
         std::shared_ptr<Melon::TaskHandle> b = taskManager()->schedule([this]() { m_B++; }, {predecessor()});
@@ -0,0 +1,100 @@
+#include <Common/TimerSystem.h>
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/HierarchySystem.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/LocalToWorld.h>
+#include <MelonCore/LocalTransform.h>
+#include <MelonCore/Parent.h>
+#include <MelonCore/Rotation.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/TransformSystem.h>
+#include <MelonCore/Translation.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Builds 1000 trees of 1000 nodes over depths 0 to 3 and measures frames where every root turns, the roots of one chunk turn or nothing moves
+// Changes are tracked per chunk, so turning the roots of a chunk only recomputes the chunks below them
+
+constexpr unsigned int k_RootCount = 1000;
+constexpr unsigned int k_FrameCount = 50;
+// Frames before measuring, in which the hierarchy is linked
+constexpr unsigned int k_WarmUpFrameCount = 10;
+
+class SpinSystem : public Melon::SystemBase {
+  public:
+    SpinSystem(const unsigned int& chunkCount) : m_ChunkCount(chunkCount) {}
+
+  protected:
+    class SpinChunkTask : public Melon::ChunkTask {
+      public:
+        SpinChunkTask(const unsigned int& chunkCount, const float& angle, const unsigned int& rotationComponentId) : m_ChunkCount(chunkCount), m_Angle(angle), m_RotationComponentId(rotationComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            if (chunkIndex >= m_ChunkCount) return;
+            Melon::Rotation* rotations = chunkAccessor.componentArray<Melon::Rotation>(m_RotationComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                rotations[i].value = glm::angleAxis(m_Angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+
+        const unsigned int m_ChunkCount;
+        const float m_Angle;
+        const unsigned int& m_RotationComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* rootArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Rotation>().createArchetype();
+        Melon::Archetype* nodeArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Parent, Melon::LocalTransform>().createArchetype();
+        std::vector<Melon::Entity> parents(k_RootCount);
+        std::vector<Melon::Translation> translations(k_RootCount);
+        std::vector<Melon::Rotation> rotations(k_RootCount, Melon::Rotation{.value = glm::quat(1.0f, 0.0f, 0.0f, 0.0f)});
+        for (unsigned int i = 0; i < k_RootCount; i++)
+            translations[i].value = glm::vec3(i % 32, 0.0f, i / 32) * 16.0f;
+        entityManager()->createEntities(rootArchetype, std::span<Melon::Entity>(parents), translations.data(), rotations.data());
+
+        // 9 children under each root and 10 under each node below
+        for (const unsigned int& childCount : {9U, 10U, 10U}) {
+            std::vector<Melon::Entity> nodes(parents.size() * childCount);
+            std::vector<Melon::Parent> nodeParents(nodes.size());
+            std::vector<Melon::LocalTransform> localTransforms(nodes.size());
+            for (unsigned int i = 0; i < nodes.size(); i++) {
+                nodeParents[i].value = parents[i / childCount];
+                localTransforms[i] = Melon::LocalTransform{.translation = glm::vec3(1.0f, i % childCount, 0.0f), .rotation = glm::angleAxis(0.1f * (i % childCount), glm::vec3(1.0f, 0.0f, 0.0f)), .scale = glm::vec3(0.9f)};
+            }
+            entityManager()->createEntities(nodeArchetype, std::span<Melon::Entity>(nodes), nodeParents.data(), localTransforms.data());
+            parents = std::move(nodes);
+        }
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Translation, Melon::Rotation>().createEntityFilter();
+        m_RotationComponentId = entityManager()->componentId<Melon::Rotation>();
+        declareComponentAccess(createComponentAccessBuilder().writeComponents<Melon::Rotation>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        if (m_ChunkCount == 0) return;
+        predecessor() = schedule(std::make_shared<SpinChunkTask>(m_ChunkCount, 0.01f * m_FrameCounter++, m_RotationComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    // Roots in chunks from this index on stay still
+    const unsigned int m_ChunkCount;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_RotationComponentId;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    for (const auto& [chunkCount, name] : {std::pair{k_RootCount, "Every root turning"}, std::pair{1U, "Roots of one chunk turning"}, std::pair{0U, "Nothing moving"}})
+        Melon::Instance()
+            .registerSystem<SpinSystem>(chunkCount)
+            .registerSystem<Melon::TransformSystem>()
+            .registerSystem<Melon::HierarchySystem>()
+            .registerSystem<TimerSystem>(name, k_WarmUpFrameCount, k_FrameCount)
+            .start();
+    return 0;
+}
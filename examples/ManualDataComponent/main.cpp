@@ -34,7 +34,7 @@ class MonsterDamageCounterSystem : public Melon::SystemBase {
         virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, Melon::EntityCommandBuffer* entityCommandBuffer) override {
             const Melon::Entity* entities = chunkAccessor.entityArray();
             MonsterHealth* monsterHealths = chunkAccessor.componentArray<MonsterHealth>(m_MonsterHealthComponentId);
-            PersistentDamage* persistentDamages = chunkAccessor.componentArray<PersistentDamage>(m_PersistentDamageComponentId);
+            const PersistentDamage* persistentDamages = chunkAccessor.componentArray<const PersistentDamage>(m_PersistentDamageComponentId);
             ManualDamageCounter* manualDamageCounters = chunkAccessor.componentArray<ManualDamageCounter>(m_ManualDamageCounterComponentId);
             for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
                 if (monsterHealths[i].value <= persistentDamages[i].value)
@@ -55,7 +55,7 @@ class MonsterDamageCounterSystem : public Melon::SystemBase {
         CollectCounterCommandBufferChunkTask(const unsigned int& manualDamageCounterComponentId, std::vector<unsigned int>& damageTakenCounts) : m_ManualDamageCounterComponentId(manualDamageCounterComponentId), m_DamageTakenCounts(damageTakenCounts) {}
         virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, Melon::EntityCommandBuffer* entityCommandBuffer) override {
             const Melon::Entity* entities = chunkAccessor.entityArray();
-            ManualDamageCounter* manualDamageCounters = chunkAccessor.componentArray<ManualDamageCounter>(m_ManualDamageCounterComponentId);
+            const ManualDamageCounter* manualDamageCounters = chunkAccessor.componentArray<const ManualDamageCounter>(m_ManualDamageCounterComponentId);
             for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
                 m_DamageTakenCounts[manualDamageCounters[i].index] = manualDamageCounters[i].damageTakenCount;
                 entityCommandBuffer->removeComponent<ManualDamageCounter>(entities[i]);
@@ -5,6 +5,7 @@
 #include <MelonCore/Scale.h>
 #include <MelonCore/SystemBase.h>
 #include <MelonCore/Time.h>
+#include <MelonCore/TransformSystem.h>
 #include <MelonCore/Translation.h>
 #include <MelonFrontend/Camera.h>
 #include <MelonFrontend/MeshResource.h>
@@ -33,7 +34,7 @@ class RotationSystem : public Melon::SystemBase {
         virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, Melon::EntityCommandBuffer* entityCommandBuffer) override {
             const Melon::Entity* entities = chunkAccessor.entityArray();
             Melon::Rotation* rotations = chunkAccessor.componentArray<Melon::Rotation>(m_RotationComponentId);
-            RotationSpeed* rotationSpeeds = chunkAccessor.componentArray<RotationSpeed>(m_RotationSpeedComponentId);
+            const RotationSpeed* rotationSpeeds = chunkAccessor.componentArray<const RotationSpeed>(m_RotationSpeedComponentId);
             DestructionTime* destructionTimes = chunkAccessor.componentArray<DestructionTime>(m_DestructionTimeComponentId);
             for (int i = 0; i < chunkAccessor.entityCount(); i++) {
                 rotations[i].value = glm::rotate(rotations[i].value, glm::radians(m_DeltaTime * rotationSpeeds[i].value), glm::vec3(0.0f, 0.0f, 1.0f));
@@ -54,7 +55,8 @@ class RotationSystem : public Melon::SystemBase {
         // Create RenderMeshes
         Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Rotation, Melon::Scale, RotationSpeed, DestructionTime>().markSharedComponents<Melon::RenderMesh>().createArchetype();
         resourceManager()->addResource(Melon::MeshResource::create("mesh.obj"));
-        Melon::RenderMesh mesh = Melon::RenderMesh{.meshResource = static_cast<Melon::MeshResource*>(resourceManager()->resource("mesh.obj"))};
+        // Entities sharing the mesh are given it by handle, without hashing it for each of them
+        const Melon::SharedComponentHandle<Melon::RenderMesh> mesh = entityManager()->createSharedComponentHandle(Melon::RenderMesh{.meshResource = static_cast<Melon::MeshResource*>(resourceManager()->resource("mesh.obj"))});
         for (int i = 0; i < 2; i++) {
             Melon::Entity entity = entityManager()->createEntity(archetype);
             entityManager()->setComponent<Melon::Translation>(entity, Melon::Translation{.value = glm::vec3(i * 4.0f - 2.0f, 0.0f, 0.0f)});
@@ -62,8 +64,9 @@ class RotationSystem : public Melon::SystemBase {
             entityManager()->setComponent<Melon::Scale>(entity, Melon::Scale{.value = glm::vec3(1.0f, 1.0f, 1.0f)});
             entityManager()->setComponent<RotationSpeed>(entity, RotationSpeed{.value = 40.0f});
             entityManager()->setComponent<DestructionTime>(entity, DestructionTime{.value = 10.0f});
-            entityManager()->setSharedComponent<Melon::RenderMesh>(entity, mesh);
+            entityManager()->setSharedComponent(entity, mesh);
         }
+        entityManager()->releaseSharedComponentHandle(mesh);
 
         // Create a Camera
         Melon::Entity cameraEntity = entityManager()->createEntity();
@@ -80,6 +83,7 @@ class RotationSystem : public Melon::SystemBase {
         m_RotationComponentId = entityManager()->componentId<Melon::Rotation>();
         m_RotationSpeedComponentId = entityManager()->componentId<RotationSpeed>();
         m_DestructionTimeComponentId = entityManager()->componentId<DestructionTime>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<RotationSpeed>().writeComponents<Melon::Rotation, DestructionTime>().createComponentAccess());
     }
 
     virtual void onUpdate() override {
@@ -100,6 +104,7 @@ int main() {
         .setApplicationName("RenderMesh")
         .registerSystem<Melon::RenderSystem>(800, 600)
         .registerSystem<RotationSystem>()
+        .registerSystem<Melon::TransformSystem>()
         .start();
     return 0;
 }
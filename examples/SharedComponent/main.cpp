@@ -9,6 +9,7 @@
 #include <cstddef>
 #include <cstdio>
 #include <memory>
+#include <span>
 #include <utility>
 
 struct Group : public Melon::SharedComponent {
@@ -53,8 +54,7 @@ class GroupSystem : public Melon::SystemBase {
         Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Money>().markSharedComponents<Group>().createArchetype();
 
         std::array<Melon::Entity, 1024> entities;
-        for (unsigned int i = 0; i < entities.size(); i++)
-            entities[i] = entityManager()->createEntity(archetype);
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities));
 
         for (unsigned int i = 0; i < entities.size(); i += 3)
             entityManager()->setSharedComponent(entities[i], Group{.id = 0, .salary = 10});
@@ -68,6 +68,7 @@ class GroupSystem : public Melon::SystemBase {
         m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Money>().requireSharedComponents<Group>().createEntityFilter();
         m_MoneyComponentId = entityManager()->componentId<Money>();
         m_GroupSharedComponentId = entityManager()->sharedComponentId<Group>();
+        declareComponentAccess(createComponentAccessBuilder().writeComponents<Money>().readSharedComponents<Group>().createComponentAccess());
     }
 
     void onUpdate() override {
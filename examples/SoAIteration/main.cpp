@@ -0,0 +1,153 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ComponentFields.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Translation.h>
+
+#include <chrono>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+// Times the same loops over components stored whole per Entity and over components split into a column per field
+// Loops run on the main thread, so that they measure the layout rather than the scheduling
+
+constexpr unsigned int k_EntityCount = 1 << 20;
+constexpr unsigned int k_RoundCount = 200;
+
+struct Position : public Melon::DataComponent {
+    glm::vec3 value;
+};
+
+struct Velocity : public Melon::DataComponent {
+    glm::vec3 value;
+};
+
+struct SoAVelocity : public Melon::SoADataComponent {
+    glm::vec3 value;
+};
+
+struct Speed : public Melon::DataComponent {
+    float value;
+};
+
+struct Bounds : public Melon::DataComponent {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+class SoAIterationSystem : public Melon::SystemBase {
+  protected:
+    void onEnter() override {
+        Melon::Archetype* aosArchetype = entityManager()->createArchetypeBuilder().markComponents<Position, Velocity, Speed, Bounds>().createArchetype();
+        Melon::Archetype* soaArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, SoAVelocity, Speed, Bounds>().createArchetype();
+        std::vector<Melon::Entity> entities(k_EntityCount);
+        std::vector<Speed> speeds(k_EntityCount);
+        for (unsigned int i = 0; i < k_EntityCount; i++)
+            speeds[i].value = static_cast<float>(i % 10);
+        entityManager()->createEntities(aosArchetype, std::span<Melon::Entity>(entities), speeds.data());
+        entityManager()->createEntities(soaArchetype, std::span<Melon::Entity>(entities), speeds.data());
+
+        m_AoSEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Position>().createEntityFilter();
+        m_SoAEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Translation>().createEntityFilter();
+        m_PositionComponentId = entityManager()->componentId<Position>();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        m_SoAVelocityComponentId = entityManager()->componentId<SoAVelocity>();
+        m_SpeedComponentId = entityManager()->componentId<Speed>();
+        m_BoundsComponentId = entityManager()->componentId<Bounds>();
+        declareComponentAccess(createComponentAccessBuilder().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        entityManager()->completeEntityCommandBuffers();
+        const std::vector<Melon::ChunkAccessor> aosChunkAccessors = entityManager()->filterEntities(m_AoSEntityFilter);
+        const std::vector<Melon::ChunkAccessor> soaChunkAccessors = entityManager()->filterEntities(m_SoAEntityFilter);
+
+        measure("AoS z += speed", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : aosChunkAccessors) {
+                Position* positions = chunkAccessor.componentArray<Position>(m_PositionComponentId);
+                const Speed* speeds = chunkAccessor.componentArray<const Speed>(m_SpeedComponentId);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    positions[i].value.z += speeds[i].value;
+            }
+        });
+        measure("SoA z += speed", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : soaChunkAccessors) {
+                std::span<float> z = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId).field(2);
+                const Speed* speeds = chunkAccessor.componentArray<const Speed>(m_SpeedComponentId);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    z[i] += speeds[i].value;
+            }
+        });
+        measure("AoS position += velocity", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : aosChunkAccessors) {
+                Position* positions = chunkAccessor.componentArray<Position>(m_PositionComponentId);
+                const Velocity* velocities = chunkAccessor.componentArray<const Velocity>(m_VelocityComponentId);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    positions[i].value += velocities[i].value;
+            }
+        });
+        measure("SoA position += velocity", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : soaChunkAccessors) {
+                const Melon::ComponentFields<Melon::Translation> translations = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId);
+                const Melon::ComponentFields<const SoAVelocity> velocities = chunkAccessor.componentFields<const SoAVelocity>(m_SoAVelocityComponentId);
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    std::span<float> translation = translations.field(axis);
+                    std::span<const float> velocity = velocities.field(axis);
+                    for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                        translation[i] += velocity[i];
+                }
+            }
+        });
+        measure("AoS bounds from position", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : aosChunkAccessors) {
+                const Position* positions = chunkAccessor.componentArray<const Position>(m_PositionComponentId);
+                Bounds* bounds = chunkAccessor.componentArray<Bounds>(m_BoundsComponentId);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    bounds[i] = Bounds{.min = positions[i].value - 0.5f, .max = positions[i].value + 0.5f};
+            }
+        });
+        measure("SoA bounds from translation", [&] {
+            for (const Melon::ChunkAccessor& chunkAccessor : soaChunkAccessors) {
+                const Melon::ComponentFields<const Melon::Translation> translations = chunkAccessor.componentFields<const Melon::Translation>(m_TranslationComponentId);
+                Bounds* bounds = chunkAccessor.componentArray<Bounds>(m_BoundsComponentId);
+                std::span<const float> x = translations.field(0), y = translations.field(1), z = translations.field(2);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    bounds[i] = Bounds{.min = glm::vec3(x[i], y[i], z[i]) - 0.5f, .max = glm::vec3(x[i], y[i], z[i]) + 0.5f};
+            }
+        });
+        instance()->quit();
+    }
+
+    void onExit() override {}
+
+  private:
+    // The first round warms the caches up and is not counted
+    template <typename Loop>
+    static void measure(const char* name, Loop&& loop) {
+        loop();
+        const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+        for (unsigned int round = 0; round < k_RoundCount; round++)
+            loop();
+        printf("%-28s : %.3f ms\n", name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTimePoint).count() / k_RoundCount);
+    }
+
+    Melon::EntityFilter m_AoSEntityFilter;
+    Melon::EntityFilter m_SoAEntityFilter;
+    unsigned int m_PositionComponentId;
+    unsigned int m_VelocityComponentId;
+    unsigned int m_TranslationComponentId;
+    unsigned int m_SoAVelocityComponentId;
+    unsigned int m_SpeedComponentId;
+    unsigned int m_BoundsComponentId;
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SoAIterationSystem>()
+        .start();
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <Common/TimerSystem.h>
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SpatialIndex.h>
+#include <MelonCore/SpatialIndexSystem.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Translation.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/geometric.hpp>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// 20000 Entities wander over a square and count the others within k_Radius, by scanning all of them or by querying the SpatialIndex
+
+constexpr unsigned int k_EntityCount = 20000;
+constexpr float k_AreaSize = 400.0f;
+constexpr float k_Radius = 4.0f;
+constexpr unsigned int k_FrameCount = 10;
+// Frames before measuring, in which the Entities are indexed
+constexpr unsigned int k_WarmUpFrameCount = 5;
+
+struct Velocity : public Melon::DataComponent {
+    glm::vec3 value;
+};
+
+struct NeighborCount : public Melon::DataComponent {
+    unsigned int value;
+};
+
+class WanderSystem : public Melon::SystemBase {
+  protected:
+    class WanderChunkTask : public Melon::ChunkTask {
+      public:
+        WanderChunkTask(const unsigned int& translationComponentId, const unsigned int& velocityComponentId) : m_TranslationComponentId(translationComponentId), m_VelocityComponentId(velocityComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<Melon::Translation> translations = chunkAccessor.componentFields<Melon::Translation>(m_TranslationComponentId);
+            const Velocity* velocities = chunkAccessor.componentArray<const Velocity>(m_VelocityComponentId);
+            for (unsigned int axis = 0; axis < 3; axis += 2) {
+                const std::span<float> positions = translations.field(axis);
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                    // Entities leaving the square come back from the other side
+                    positions[i] += velocities[i].value[axis];
+                    positions[i] -= k_AreaSize * static_cast<float>(positions[i] >= k_AreaSize) - k_AreaSize * static_cast<float>(positions[i] < 0.0f);
+                }
+            }
+        }
+
+        const unsigned int& m_TranslationComponentId;
+        const unsigned int& m_VelocityComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Velocity, NeighborCount>().createArchetype();
+        std::vector<Melon::Entity> entities(k_EntityCount);
+        std::vector<Melon::Translation> translations(k_EntityCount);
+        std::vector<Velocity> velocities(k_EntityCount);
+        for (unsigned int i = 0; i < k_EntityCount; i++) {
+            translations[i].value = glm::vec3(std::rand() % 4000, 0.0f, std::rand() % 4000) * (k_AreaSize / 4000.0f);
+            velocities[i].value = glm::vec3(std::rand() % 101 - 50, 0.0f, std::rand() % 101 - 50) * 0.01f;
+        }
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), translations.data(), velocities.data());
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Translation, Velocity>().createEntityFilter();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Velocity>().writeComponents<Melon::Translation>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<WanderChunkTask>(m_TranslationComponentId, m_VelocityComponentId), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_TranslationComponentId;
+    unsigned int m_VelocityComponentId;
+};
+
+class NeighborSystem : public Melon::SystemBase {
+  public:
+    NeighborSystem(const bool& bruteForce) : m_BruteForce(bruteForce) {}
+
+  protected:
+    // Copies every Translation into positions, which the brute force scans for each Entity
+    class GatherChunkTask : public Melon::ChunkTask {
+      public:
+        GatherChunkTask(const unsigned int& translationComponentId, std::vector<glm::vec3>& positions) : m_TranslationComponentId(translationComponentId), m_Positions(positions) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<const Melon::Translation> translations = chunkAccessor.componentFields<const Melon::Translation>(m_TranslationComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                m_Positions[firstEntityIndex + i] = translations[i].load().value;
+        }
+
+        const unsigned int& m_TranslationComponentId;
+        std::vector<glm::vec3>& m_Positions;
+    };
+
+    class NeighborChunkTask : public Melon::ChunkTask {
+      public:
+        NeighborChunkTask(const Melon::SpatialIndex* spatialIndex, std::vector<glm::vec3> const& positions, const unsigned int& translationComponentId, const unsigned int& neighborCountComponentId, std::atomic<unsigned long long>& neighborCountSum) : m_SpatialIndex(spatialIndex), m_Positions(positions), m_TranslationComponentId(translationComponentId), m_NeighborCountComponentId(neighborCountComponentId), m_NeighborCountSum(neighborCountSum) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
+            const Melon::ComponentFields<const Melon::Translation> translations = chunkAccessor.componentFields<const Melon::Translation>(m_TranslationComponentId);
+            NeighborCount* neighborCounts = chunkAccessor.componentArray<NeighborCount>(m_NeighborCountComponentId);
+            unsigned long long neighborCountSum = 0;
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                const glm::vec3 center = translations[i].load().value;
+                // The Entity itself is counted as well
+                unsigned int neighborCount = 0;
+                if (m_SpatialIndex != nullptr)
+                    m_SpatialIndex->forEachInRadius(center, k_Radius, [&](const Melon::Entity& entity, const glm::vec3& position) { neighborCount++; });
+                else
+                    for (const glm::vec3& position : m_Positions)
+                        neighborCount += glm::dot(position - center, position - center) <= k_Radius * k_Radius;
+                neighborCounts[i].value = neighborCount - 1;
+                neighborCountSum += neighborCount - 1;
+            }
+            m_NeighborCountSum += neighborCountSum;
+        }
+
+        const Melon::SpatialIndex* const m_SpatialIndex;
+        std::vector<glm::vec3> const& m_Positions;
+        const unsigned int& m_TranslationComponentId;
+        const unsigned int& m_NeighborCountComponentId;
+        std::atomic<unsigned long long>& m_NeighborCountSum;
+    };
+
+    void onEnter() override {
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Melon::Translation, NeighborCount>().createEntityFilter();
+        m_TranslationComponentId = entityManager()->componentId<Melon::Translation>();
+        m_NeighborCountComponentId = entityManager()->componentId<NeighborCount>();
+        m_SpatialIndexSingletonComponentId = entityManager()->singletonComponentId<Melon::SpatialIndex>();
+        // Queries of the SpatialIndex run after the SpatialIndexSystem has indexed the Translations of the frame
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Melon::Translation>().writeComponents<NeighborCount>().readSingletonComponents<Melon::SpatialIndex>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        const Melon::SpatialIndex* spatialIndex = nullptr;
+        if (m_BruteForce) {
+            m_Positions.resize(entityManager()->entityCount(m_EntityFilter));
+            predecessor() = schedule(std::make_shared<GatherChunkTask>(m_TranslationComponentId, m_Positions), m_EntityFilter, predecessor());
+        } else
+            spatialIndex = entityManager()->singletonComponent<Melon::SpatialIndex>(m_SpatialIndexSingletonComponentId);
+        m_NeighborCountSum = 0;
+        predecessor() = schedule(std::make_shared<NeighborChunkTask>(spatialIndex, m_Positions, m_TranslationComponentId, m_NeighborCountComponentId, m_NeighborCountSum), m_EntityFilter, predecessor());
+    }
+
+    void onExit() override {
+        printf("%.3f neighbors on average, ", static_cast<double>(m_NeighborCountSum) / k_EntityCount);
+    }
+
+  private:
+    const bool m_BruteForce;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_TranslationComponentId;
+    unsigned int m_NeighborCountComponentId;
+    unsigned int m_SpatialIndexSingletonComponentId;
+    std::vector<glm::vec3> m_Positions;
+    std::atomic<unsigned long long> m_NeighborCountSum;
+};
+
+int main() {
+    for (const auto& [bruteForce, name] : {std::pair{true, "Brute force"}, std::pair{false, "Spatial index"}}) {
+        std::srand(0);
+        Melon::Instance()
+            .registerSystem<WanderSystem>()
+            .registerSystem<Melon::SpatialIndexSystem>(k_Radius)
+            .registerSystem<NeighborSystem>(bruteForce)
+            .registerSystem<TimerSystem>(name, k_WarmUpFrameCount, k_FrameCount)
+            .start();
+    }
+    return 0;
+}
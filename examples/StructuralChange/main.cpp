@@ -0,0 +1,85 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+
+#include <chrono>
+#include <cstdio>
+#include <glm/vec4.hpp>
+#include <vector>
+
+// A DataComponent is added to and removed from 100000 Entities of three components, Entity by Entity, timing each change with its playback
+
+constexpr unsigned int k_EntityCount = 100000;
+constexpr unsigned int k_RoundCount = 10;
+// Frames before measuring, in which the Entities are created
+constexpr unsigned int k_WarmUpFrameCount = 2;
+
+struct Position : public Melon::DataComponent {
+    glm::vec4 value;
+};
+
+struct Velocity : public Melon::DataComponent {
+    glm::vec4 value;
+};
+
+struct Extent : public Melon::DataComponent {
+    glm::vec4 min;
+    glm::vec4 max;
+};
+
+struct Frozen : public Melon::DataComponent {
+    glm::vec4 value;
+};
+
+class StructuralChangeSystem : public Melon::SystemBase {
+  protected:
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Position, Velocity, Extent>().createArchetype();
+        for (unsigned int i = 0; i < k_EntityCount; i++)
+            m_Entities.push_back(entityManager()->createEntity(archetype));
+        // Touches no components, it waits for the whole previous frame by itself
+        declareComponentAccess(createComponentAccessBuilder().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        // Commands recorded in the previous frame are executed before this returns
+        entityManager()->completeEntityCommandBuffers();
+        if (m_FrameCounter > k_WarmUpFrameCount) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTimePoint).count();
+            ((m_FrameCounter - k_WarmUpFrameCount) % 2 == 1 ? m_AddSeconds : m_RemoveSeconds) += seconds;
+        }
+        if (m_FrameCounter == k_WarmUpFrameCount + 2 * k_RoundCount) {
+            instance()->quit();
+            return;
+        }
+        if (m_FrameCounter++ < k_WarmUpFrameCount) return;
+
+        m_StartTimePoint = std::chrono::steady_clock::now();
+        if ((m_FrameCounter - k_WarmUpFrameCount) % 2 == 1)
+            for (const Melon::Entity& entity : m_Entities)
+                entityManager()->addComponent(entity, Frozen{});
+        else
+            for (const Melon::Entity& entity : m_Entities)
+                entityManager()->removeComponent<Frozen>(entity);
+    }
+
+    void onExit() override {
+        constexpr double k_NanosecondsPerOperation = 1e9 / (static_cast<double>(k_RoundCount) * k_EntityCount);
+        printf("Add : %.1f ns per Entity, remove : %.1f ns per Entity\n", m_AddSeconds * k_NanosecondsPerOperation, m_RemoveSeconds * k_NanosecondsPerOperation);
+    }
+
+  private:
+    std::vector<Melon::Entity> m_Entities;
+    unsigned int m_FrameCounter{};
+    std::chrono::steady_clock::time_point m_StartTimePoint;
+    double m_AddSeconds{};
+    double m_RemoveSeconds{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<StructuralChangeSystem>()
+        .start();
+    return 0;
+}
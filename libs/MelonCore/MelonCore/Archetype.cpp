@@ -1,6 +1,7 @@
 #include <MelonCore/Archetype.h>
 
 #include <algorithm>
+#include <limits>
 
 namespace Melon {
 
@@ -11,25 +12,53 @@ Archetype::Archetype(
     std::vector<std::size_t> const& componentSizes,
     std::vector<std::size_t> const& componentAligns,
     std::vector<unsigned int> const& sharedComponentIds,
-    ObjectPool<Chunk>* chunkPool)
-    : m_Id(id), m_Mask(mask), m_ComponentIds(componentIds), m_ComponentSizes(componentSizes), m_ComponentAligns(componentAligns), m_SharedComponentIds(sharedComponentIds), m_ChunkPool(chunkPool) {
+    const ArchetypeMask::ComponentMask& enableableComponentMask,
+    const ArchetypeMask::ComponentMask& soaComponentMask,
+    ChunkAllocator* chunkAllocator,
+    const unsigned int& playbackSystemVersion)
+    : m_Id(id), m_Mask(mask), m_ComponentIds(componentIds), m_ComponentSizes(componentSizes), m_ComponentAligns(componentAligns), m_SharedComponentIds(sharedComponentIds), m_ChunkAllocator(chunkAllocator), m_PlaybackSystemVersion(playbackSystemVersion) {
     m_ChunkLayout.componentSizes = componentSizes;
+    m_ChunkLayout.componentFieldSizes.resize(componentIds.size());
+    for (unsigned int i = 0; i < componentIds.size(); i++)
+        m_ChunkLayout.componentFieldSizes[i] = soaComponentMask.test(componentIds[i]) ? k_SoAFieldSize : componentSizes[i];
     std::size_t totalSize = sizeof(Entity);
     for (const std::size_t& size : m_ChunkLayout.componentSizes)
         totalSize += size;
-    m_ChunkLayout.capacity = sizeof(Chunk) / totalSize;
+    unsigned int enableableComponentCount = 0;
+    for (const unsigned int& componentId : componentIds)
+        if (enableableComponentMask.test(componentId))
+            enableableComponentCount++;
+    // The smallest size class reaching the target capacity keeps small Archetypes compact and big ones contiguous
+    for (m_ChunkLayout.size = Chunk::k_MinSize;; m_ChunkLayout.size *= 2) {
+        m_ChunkLayout.versionOffset = m_ChunkLayout.size - sizeof(unsigned int) * componentIds.size();
+        m_ChunkLayout.capacity = m_ChunkLayout.versionOffset / totalSize;
+        // Disabled masks are aligned to std::uint64_t
+        if (enableableComponentCount != 0)
+            while (m_ChunkLayout.capacity * totalSize + enableableComponentCount * ChunkLayout::disabledMaskSize(m_ChunkLayout.capacity) + alignof(std::uint64_t) > m_ChunkLayout.versionOffset)
+                m_ChunkLayout.capacity--;
+        if (m_ChunkLayout.capacity >= Chunk::k_TargetCapacity || m_ChunkLayout.size == Chunk::k_MaxSize)
+            break;
+    }
+    const std::size_t disabledMaskSize = ChunkLayout::disabledMaskSize(m_ChunkLayout.capacity);
+    m_ChunkLayout.disabledMaskOffset = (m_ChunkLayout.versionOffset - enableableComponentCount * disabledMaskSize) / alignof(std::uint64_t) * alignof(std::uint64_t);
+    m_ChunkLayout.disabledMaskOffsets.resize(componentIds.size(), ChunkLayout::k_InvalidOffset);
+    for (unsigned int i = 0, j = 0; i < componentIds.size(); i++)
+        if (enableableComponentMask.test(componentIds[i]))
+            m_ChunkLayout.disabledMaskOffsets[i] = m_ChunkLayout.disabledMaskOffset + disabledMaskSize * j++;
 
+    // The Entity array is sorted among the columns under an index no column has
+    constexpr unsigned int k_EntityArrayIndex = std::numeric_limits<unsigned int>::max();
     std::vector<std::pair<std::size_t, unsigned int>> alignAndIndices(componentIds.size() + 1);
     for (unsigned int i = 0; i < componentAligns.size(); i++)
         alignAndIndices[i] = {componentAligns[i], i};
-    alignAndIndices.back() = {alignof(Entity), -1};
+    alignAndIndices.back() = {alignof(Entity), k_EntityArrayIndex};
     std::sort(alignAndIndices.begin(), alignAndIndices.end(), std::greater<>());
 
     m_ChunkLayout.componentIndexMap.reserve(componentIds.size());
     m_ChunkLayout.componentOffsets.resize(componentIds.size());
     std::size_t offset{};
     for (const auto& [align, index] : alignAndIndices) {
-        if (index == -1) {
+        if (index == k_EntityArrayIndex) {
             m_ChunkLayout.entityOffset = offset;
             offset += sizeof(Entity) * m_ChunkLayout.capacity;
         } else {
@@ -39,7 +68,38 @@ Archetype::Archetype(
         }
     }
 
+    m_ColumnCopies.reserve(componentIds.size());
+    for (unsigned int i = 0; i < componentIds.size(); i++)
+        pushColumnCopies(m_ChunkLayout, i, m_ChunkLayout, i, m_ColumnCopies);
+
     std::sort(m_SharedComponentIds.begin(), m_SharedComponentIds.end());
+
+    // The mask is scanned once here so that tags are included
+    for (unsigned int componentId = 0; componentId < ArchetypeMask::k_MaxComponentIdCount; componentId++)
+        if (m_Mask.componentMask.test(componentId) && !m_Mask.manualComponent(componentId))
+            m_NotManualComponentIds.push_back(componentId);
+}
+
+void Archetype::reserve(const unsigned int& entityCount) {
+    createCombination()->reserve(entityCount);
+}
+
+void Archetype::addEntities(const Entity* entities, const unsigned int& count, std::vector<unsigned int> const& componentIds, const std::byte* componentData, EntityLocation& firstLocation) {
+    Combination* const combination = createCombination();
+    unsigned int firstEntityIndexInCombination;
+    unsigned int chunkCountAdded;
+    combination->addEntities(entities, count, firstEntityIndexInCombination, chunkCountAdded);
+    for (const unsigned int& componentId : componentIds) {
+        const unsigned int componentIndex = m_ChunkLayout.componentIndexMap.at(componentId);
+        combination->setComponents(firstEntityIndexInCombination, count, componentIndex, componentData);
+        componentData += m_ChunkLayout.componentSizes[componentIndex] * count;
+    }
+    m_ChunkCount += chunkCountAdded;
+    m_EntityCount += count;
+    firstLocation = EntityLocation{
+        m_Id,
+        combination->index(),
+        firstEntityIndexInCombination};
 }
 
 void Archetype::addEntity(const Entity& entity, EntityLocation& location) {
@@ -55,14 +115,14 @@ void Archetype::addEntity(const Entity& entity, EntityLocation& location) {
         entityIndexInCombination};
 }
 
-void Archetype::moveEntityAddingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const unsigned int& componentId, const void* component, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
+void Archetype::moveEntityAddingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, const void* component, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
     Combination* const srcCombination = srcArchetype->m_Combinations[srcEntityLocation.combinationIndex].get();
     std::vector<unsigned int> const& sharedComponentIndices = srcCombination->sharedComponentIndices();
     Combination* const dstCombination = createCombination(sharedComponentIndices);
 
     unsigned int entityIndexInDstCombination;
     bool dstChunkCountAdded, srcChunkCountMinused;
-    dstCombination->moveEntityAddingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, componentId, component, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    dstCombination->moveEntityAddingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, edge.columnCopies, edge.addedComponentIndex, component, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
     if (dstChunkCountAdded)
         m_ChunkCount++;
     if (srcChunkCountMinused) {
@@ -75,14 +135,14 @@ void Archetype::moveEntityAddingComponent(const EntityLocation& srcEntityLocatio
     dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
 }
 
-void Archetype::moveEntityRemovingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
+void Archetype::moveEntityRemovingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
     Combination* const srcCombination = srcArchetype->m_Combinations[srcEntityLocation.combinationIndex].get();
     std::vector<unsigned int> const& sharedComponentIndices = srcCombination->sharedComponentIndices();
     Combination* dstCombination = createCombination(sharedComponentIndices);
 
     unsigned int entityIndexInDstCombination;
     bool dstChunkCountAdded, srcChunkCountMinused;
-    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, edge.columnCopies, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
     if (dstChunkCountAdded)
         m_ChunkCount++;
     if (srcChunkCountMinused) {
@@ -95,7 +155,7 @@ void Archetype::moveEntityRemovingComponent(const EntityLocation& srcEntityLocat
     dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
 }
 
-void Archetype::moveEntityAddingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
+void Archetype::moveEntityAddingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, const unsigned int&, const unsigned int& sharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
     Combination* const srcCombination = srcArchetype->m_Combinations[srcEntityLocation.combinationIndex].get();
     std::vector<unsigned int> const& srcSharedComponentIds = srcArchetype->m_SharedComponentIds;
     std::vector<unsigned int> const& srcSharedComponentIndices = srcCombination->sharedComponentIndices();
@@ -113,7 +173,7 @@ void Archetype::moveEntityAddingSharedComponent(const EntityLocation& srcEntityL
 
     unsigned int entityIndexInDstCombination;
     bool dstChunkCountAdded, srcChunkCountMinused;
-    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, edge.columnCopies, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
     if (dstChunkCountAdded)
         m_ChunkCount++;
     if (srcChunkCountMinused) {
@@ -126,7 +186,7 @@ void Archetype::moveEntityAddingSharedComponent(const EntityLocation& srcEntityL
     dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
 }
 
-void Archetype::moveEntityRemovingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
+void Archetype::moveEntityRemovingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
     Combination* const srcCombination = srcArchetype->m_Combinations[srcEntityLocation.combinationIndex].get();
     std::vector<unsigned int> const& srcSharedComponentIds = srcArchetype->m_SharedComponentIds;
     std::vector<unsigned int> const& srcSharedComponentIndices = srcCombination->sharedComponentIndices();
@@ -135,10 +195,10 @@ void Archetype::moveEntityRemovingSharedComponent(const EntityLocation& srcEntit
     std::vector<unsigned int> dstSharedComponentIndices(m_SharedComponentIds.size());
     // Assert SharedComponent ids are in ascending order
     for (unsigned int i = 0, j = 0; i < srcSharedComponentIndices.size(); i++, j++)
-        if (srcSharedComponentIds[i] == dstSharedComponentIds[j])
+        if (j < dstSharedComponentIds.size() && srcSharedComponentIds[i] == dstSharedComponentIds[j])
             dstSharedComponentIndices[j] = srcSharedComponentIndices[i];
         else {
-            originalSharedComponentIndex = dstSharedComponentIndices[i];
+            originalSharedComponentIndex = srcSharedComponentIndices[i];
             j--;
         }
 
@@ -146,7 +206,36 @@ void Archetype::moveEntityRemovingSharedComponent(const EntityLocation& srcEntit
 
     unsigned int entityIndexInDstCombination;
     bool dstChunkCountAdded, srcChunkCountMinused;
-    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, edge.columnCopies, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    if (dstChunkCountAdded)
+        m_ChunkCount++;
+    if (srcChunkCountMinused) {
+        srcArchetype->m_ChunkCount--;
+        if (srcCombination->empty())
+            srcArchetype->destroyCombination(srcCombination);
+    }
+    m_EntityCount++;
+    srcArchetype->m_EntityCount--;
+    dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
+}
+
+void Archetype::moveEntity(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
+    Combination* const srcCombination = srcArchetype->m_Combinations[srcEntityLocation.combinationIndex].get();
+    std::vector<unsigned int> const& srcSharedComponentIds = srcArchetype->m_SharedComponentIds;
+    std::vector<unsigned int> const& srcSharedComponentIndices = srcCombination->sharedComponentIndices();
+
+    std::vector<unsigned int> dstSharedComponentIndices(m_SharedComponentIds.size());
+    // Assert SharedComponent ids are in ascending order
+    for (unsigned int i = 0, j = 0; i < dstSharedComponentIndices.size(); i++, j++) {
+        while (srcSharedComponentIds[j] != m_SharedComponentIds[i]) j++;
+        dstSharedComponentIndices[i] = srcSharedComponentIndices[j];
+    }
+
+    Combination* const dstCombination = createCombination(dstSharedComponentIndices);
+
+    unsigned int entityIndexInDstCombination;
+    bool dstChunkCountAdded, srcChunkCountMinused;
+    dstCombination->moveEntityRemovingComponent(srcEntityLocation.entityIndexInCombination, srcCombination, edge.columnCopies, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
     if (dstChunkCountAdded)
         m_ChunkCount++;
     if (srcChunkCountMinused) {
@@ -159,6 +248,35 @@ void Archetype::moveEntityRemovingSharedComponent(const EntityLocation& srcEntit
     dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
 }
 
+void Archetype::moveEntities(const unsigned int& srcCombinationIndex, Archetype* srcArchetype, const Edge& edge, const void* component, EntityLocation& firstMovedLocation) {
+    Combination* const srcCombination = srcArchetype->m_Combinations[srcCombinationIndex].get();
+    std::vector<unsigned int> const& srcSharedComponentIds = srcArchetype->m_SharedComponentIds;
+    std::vector<unsigned int> const& srcSharedComponentIndices = srcCombination->sharedComponentIndices();
+
+    std::vector<unsigned int> dstSharedComponentIndices(m_SharedComponentIds.size());
+    // Assert SharedComponent ids are in ascending order
+    for (unsigned int i = 0, j = 0; i < dstSharedComponentIndices.size(); i++, j++) {
+        while (srcSharedComponentIds[j] != m_SharedComponentIds[i]) j++;
+        dstSharedComponentIndices[i] = srcSharedComponentIndices[j];
+    }
+
+    Combination* const dstCombination = createCombination(dstSharedComponentIndices);
+
+    const unsigned int srcChunkCount = srcCombination->chunkCount();
+    const unsigned int srcEntityCount = srcCombination->entityCount();
+    const unsigned int dstChunkCount = dstCombination->chunkCount();
+    unsigned int firstMovedEntityIndexInDstCombination;
+    dstCombination->moveEntities(srcCombination, edge.columnCopies, edge.relinkable, firstMovedEntityIndexInDstCombination);
+    if (edge.addedComponentIndex != Combination::k_InvalidIndex)
+        dstCombination->fillComponent(dstCombination->entityCount() - srcEntityCount, edge.addedComponentIndex, component);
+    m_ChunkCount += dstCombination->chunkCount() - dstChunkCount;
+    m_EntityCount += srcEntityCount;
+    srcArchetype->m_ChunkCount -= srcChunkCount;
+    srcArchetype->m_EntityCount -= srcEntityCount;
+    srcArchetype->destroyCombination(srcCombination);
+    firstMovedLocation = EntityLocation{m_Id, dstCombination->index(), firstMovedEntityIndexInDstCombination};
+}
+
 void Archetype::removeEntity(const EntityLocation& location, std::vector<unsigned int>& sharedComponentIndices, Entity& swappedEntity) {
     // Need to copy SharedComponent indices because Combination may be destroyed
     sharedComponentIndices = m_Combinations[location.combinationIndex]->sharedComponentIndices();
@@ -173,10 +291,33 @@ void Archetype::removeEntity(const EntityLocation& location, std::vector<unsigne
     m_EntityCount--;
 }
 
+void Archetype::removeEntities(const unsigned int& combinationIndex) {
+    Combination* combination = m_Combinations[combinationIndex].get();
+    m_ChunkCount -= combination->chunkCount();
+    m_EntityCount -= combination->entityCount();
+    combination->removeEntities();
+    destroyCombination(combination);
+}
+
+bool Archetype::compact(const std::chrono::steady_clock::time_point& deadline, unsigned int& combinationIndex, unsigned int& freedChunkCount, unsigned int& relocatedChunkCount) {
+    for (; combinationIndex < m_Combinations.size(); combinationIndex++)
+        if (m_Combinations[combinationIndex] != nullptr && !m_Combinations[combinationIndex]->compact(deadline, freedChunkCount, relocatedChunkCount))
+            return false;
+    return true;
+}
+
+void Archetype::fillComponent(const unsigned int& combinationIndex, const unsigned int& componentId, const void* component) {
+    m_Combinations[combinationIndex]->fillComponent(0, m_ChunkLayout.componentIndexMap.at(componentId), component);
+}
+
 void Archetype::setComponent(const EntityLocation& location, const unsigned int& componentId, const void* component) {
     m_Combinations[location.combinationIndex]->setComponent(location.entityIndexInCombination, componentId, component);
 }
 
+void Archetype::setComponentEnabled(const EntityLocation& location, const unsigned int& componentId, const bool& enabled) {
+    m_Combinations[location.combinationIndex]->setComponentEnabled(location.entityIndexInCombination, m_ChunkLayout.componentIndexMap.at(componentId), enabled);
+}
+
 void Archetype::setSharedComponent(const EntityLocation& location, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity) {
     Combination* const srcCombination = m_Combinations[location.combinationIndex].get();
     std::vector<unsigned int> dstSharedComponentIndices = srcCombination->sharedComponentIndices();
@@ -191,7 +332,7 @@ void Archetype::setSharedComponent(const EntityLocation& location, const unsigne
 
     unsigned int entityIndexInDstCombination;
     bool dstChunkCountAdded, srcChunkCountMinused;
-    dstCombination->moveEntityRemovingComponent(location.entityIndexInCombination, srcCombination, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
+    dstCombination->moveEntityRemovingComponent(location.entityIndexInCombination, srcCombination, m_ColumnCopies, entityIndexInDstCombination, dstChunkCountAdded, srcSwappedEntity, srcChunkCountMinused);
     if (dstChunkCountAdded)
         m_ChunkCount++;
     if (srcChunkCountMinused) {
@@ -202,10 +343,35 @@ void Archetype::setSharedComponent(const EntityLocation& location, const unsigne
     dstLocation = EntityLocation{m_Id, dstCombination->index(), entityIndexInDstCombination};
 }
 
-void Archetype::filterEntities(const EntityFilter& entityFilter, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const {
+std::vector<unsigned int> Archetype::filterCombinations(const EntityFilter& entityFilter) const {
+    std::vector<unsigned int> combinationIndices;
     for (std::unique_ptr<Combination> const& combination : m_Combinations)
-        if (combination != nullptr)
-            combination->filterEntities(sharedComponentStore, chunkAccessors);
+        if (combination != nullptr && entityFilter.satisfied(m_SharedComponentIds, combination->sharedComponentIndices()))
+            combinationIndices.push_back(combination->index());
+    return combinationIndices;
+}
+
+void Archetype::filterEntities(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const {
+    std::vector<unsigned int> const componentIndices = changedComponentIndices(entityFilter);
+    std::vector<std::size_t> const disabledMaskOffsets = requiredDisabledMaskOffsets(entityFilter);
+    for (const unsigned int& combinationIndex : filterCombinations(entityFilter))
+        m_Combinations[combinationIndex]->filterEntities(componentIndices, lastSystemVersion, globalSystemVersion, disabledMaskOffsets, sharedComponentStore, chunkAccessors);
+}
+
+unsigned int Archetype::chunkCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const {
+    std::vector<unsigned int> const componentIndices = changedComponentIndices(entityFilter);
+    unsigned int count = 0;
+    for (const unsigned int& combinationIndex : filterCombinations(entityFilter))
+        count += m_Combinations[combinationIndex]->chunkCount(componentIndices, lastSystemVersion);
+    return count;
+}
+
+unsigned int Archetype::entityCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const {
+    std::vector<unsigned int> const componentIndices = changedComponentIndices(entityFilter);
+    unsigned int count = 0;
+    for (const unsigned int& combinationIndex : filterCombinations(entityFilter))
+        count += m_Combinations[combinationIndex]->entityCount(componentIndices, lastSystemVersion);
+    return count;
 }
 
 }  // namespace Melon
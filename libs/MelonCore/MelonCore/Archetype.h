@@ -3,13 +3,14 @@
 #include <MelonCore/ArchetypeMask.h>
 #include <MelonCore/Chunk.h>
 #include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ChunkAllocator.h>
 #include <MelonCore/Combination.h>
 #include <MelonCore/Entity.h>
 #include <MelonCore/EntityFilter.h>
-#include <MelonCore/ObjectPool.h>
 #include <MelonCore/ObjectStore.h>
 
 #include <bitset>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -31,6 +32,17 @@ class Archetype {
         unsigned int entityIndexInCombination;
     };
 
+    // A cached transition to the Archetype reached by adding or removing one component
+    struct Edge {
+        Archetype* archetype;
+        // Columns copied from the source Archetype, the added column excluded
+        std::vector<ChunkLayout::ColumnCopy> columnCopies;
+        // Column index of the added DataComponent in the destination Archetype
+        unsigned int addedComponentIndex;
+        // Chunks could be handed to the destination Archetype as they are
+        bool relinkable;
+    };
+
     struct SharedComponentIndexHash {
         std::size_t operator()(std::vector<unsigned int> const& sharedComponentIndices) const {
             std::size_t hash = sharedComponentIndices.size();
@@ -47,29 +59,51 @@ class Archetype {
         std::vector<std::size_t> const& componentSizes,
         std::vector<std::size_t> const& componentAligns,
         std::vector<unsigned int> const& sharedComponentIds,
-        ObjectPool<Chunk>* chunkPool);
+        const ArchetypeMask::ComponentMask& enableableComponentMask,
+        const ArchetypeMask::ComponentMask& soaComponentMask,
+        ChunkAllocator* chunkAllocator,
+        const unsigned int& playbackSystemVersion);
     Archetype(const Archetype&) = delete;
 
+    void reserve(const unsigned int& entityCount);
     void addEntity(const Entity& entity, EntityLocation& location);
-    // Move an Entity when adding a DataComponent
-    void moveEntityAddingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const unsigned int& componentId, const void* component, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    // Add Entities to contiguous locations, componentData holds count components for each of componentIds in turn
+    void addEntities(const Entity* entities, const unsigned int& count, std::vector<unsigned int> const& componentIds, const std::byte* componentData, EntityLocation& firstLocation);
+    // Move an Entity when adding a DataComponent, the Edge should be from the source Archetype to this one
+    void moveEntityAddingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, const void* component, EntityLocation& dstLocation, Entity& srcSwappedEntity);
     // Move an Entity when removing a DataComponent
-    void moveEntityRemovingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    void moveEntityRemovingComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, EntityLocation& dstLocation, Entity& srcSwappedEntity);
     // Move an Entity when adding a SharedComponent
-    void moveEntityAddingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    void moveEntityAddingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity);
     // Move an Entity when removing a SharedComponent
-    void moveEntityRemovingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    void moveEntityRemovingSharedComponent(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    // Move an Entity across any number of added or removed DataComponents, added columns are left zeroed
+    // SharedComponents of the source Archetype should cover the ones of this Archetype
+    void moveEntity(const EntityLocation& srcEntityLocation, Archetype* srcArchetype, const Edge& edge, EntityLocation& dstLocation, Entity& srcSwappedEntity);
+    // Move all Entities of a Combination of the source Archetype, whose SharedComponents should cover the ones of this Archetype
+    void moveEntities(const unsigned int& srcCombinationIndex, Archetype* srcArchetype, const Edge& edge, const void* component, EntityLocation& firstMovedLocation);
     void removeEntity(const EntityLocation& location, std::vector<unsigned int>& sharedComponentIndices, Entity& swappedEntity);
+    void removeEntities(const unsigned int& combinationIndex);
+    void fillComponent(const unsigned int& combinationIndex, const unsigned int& componentId, const void* component);
     void setComponent(const EntityLocation& location, const unsigned int& componentId, const void* component);
+    void setComponentEnabled(const EntityLocation& location, const unsigned int& componentId, const bool& enabled);
     void setSharedComponent(const EntityLocation& location, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex, unsigned int& originalSharedComponentIndex, EntityLocation& dstLocation, Entity& swappedEntity);
+    // Compacts Combinations from combinationIndex on until the deadline, returns whether all are done
+    // Should be called between ChunkAllocator::beginDefragmentation() and ChunkAllocator::endDefragmentation()
+    bool compact(const std::chrono::steady_clock::time_point& deadline, unsigned int& combinationIndex, unsigned int& freedChunkCount, unsigned int& relocatedChunkCount);
 
-    void filterEntities(const EntityFilter& entityFilter, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const;
+    // Indices of the Combinations satisfying SharedComponent indices of the EntityFilter
+    std::vector<unsigned int> filterCombinations(const EntityFilter& entityFilter) const;
+    // Chunks are skipped if none of the changed components required by the EntityFilter is written after lastSystemVersion
+    void filterEntities(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const;
+    unsigned int chunkCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const;
+    unsigned int entityCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const;
 
     bool single() const { return m_Mask.single(); }
     bool fullyManual() const { return m_Mask.fullyManual(); }
     bool partiallyManual() const { return m_Mask.partiallyManual(); }
 
-    std::vector<unsigned int> notManualComponentIds() const;
+    std::vector<unsigned int> const& notManualComponentIds() const { return m_NotManualComponentIds; }
     std::vector<unsigned int> notManualSharedComponentIds() const;
 
     unsigned int componentCount() const { return m_Mask.componentCount(); }
@@ -88,6 +122,12 @@ class Archetype {
     const unsigned int& entityCount() const { return m_EntityCount; }
 
   private:
+    Edge createEdge(Archetype* dstArchetype) const;
+    // One copy per field, since the fields of SoA components lie apart by the capacity of each chunk
+    static void pushColumnCopies(const ChunkLayout& srcChunkLayout, const unsigned int& srcComponentIndex, const ChunkLayout& dstChunkLayout, const unsigned int& dstComponentIndex, std::vector<ChunkLayout::ColumnCopy>& columnCopies);
+    std::vector<unsigned int> changedComponentIndices(const EntityFilter& entityFilter) const;
+    std::vector<std::size_t> requiredDisabledMaskOffsets(const EntityFilter& entityFilter) const;
+
     Combination* createCombination();
     Combination* createCombination(std::vector<unsigned int> const& sharedComponentIndices);
     void destroyCombination(const Combination* combination);
@@ -96,9 +136,13 @@ class Archetype {
     const ArchetypeMask m_Mask;
 
     ChunkLayout m_ChunkLayout;
+    // Column copies between two Combinations of this Archetype
+    std::vector<ChunkLayout::ColumnCopy> m_ColumnCopies;
     std::vector<unsigned int> m_ComponentIds;
     std::vector<std::size_t> m_ComponentSizes;
     std::vector<std::size_t> m_ComponentAligns;
+    // Including tags without a column
+    std::vector<unsigned int> m_NotManualComponentIds;
 
     // Shared component ids should be in ascending order
     std::vector<unsigned int> m_SharedComponentIds;
@@ -106,22 +150,23 @@ class Archetype {
     unsigned int m_ChunkCount{};
     unsigned int m_EntityCount{};
 
-    ObjectPool<Chunk>* m_ChunkPool;
+    ChunkAllocator* m_ChunkAllocator;
+    const unsigned int& m_PlaybackSystemVersion;
     std::vector<std::unique_ptr<Combination>> m_Combinations;
     std::unordered_map<std::vector<unsigned int>, unsigned int, SharedComponentIndexHash> m_CombinationIndexMap;
     std::vector<unsigned int> m_FreeCombinationIndices;
 
+    // Edges are created lazily by the EntityManager, keyed by component id
+    std::unordered_map<unsigned int, Edge> m_AddComponentEdges;
+    std::unordered_map<unsigned int, Edge> m_RemoveComponentEdges;
+    std::unordered_map<unsigned int, Edge> m_AddSharedComponentEdges;
+    std::unordered_map<unsigned int, Edge> m_RemoveSharedComponentEdges;
+    // Edges of moves spanning several components, keyed by destination Archetype id
+    std::unordered_map<unsigned int, Edge> m_TransitionEdges;
+
     friend class EntityManager;
 };
 
-inline std::vector<unsigned int> Archetype::notManualComponentIds() const {
-    std::vector<unsigned int> componentIds;
-    for (const unsigned int& componentId : m_ComponentIds)
-        if (!m_Mask.manualComponent(componentId))
-            componentIds.push_back(componentId);
-    return componentIds;
-}
-
 inline std::vector<unsigned int> Archetype::notManualSharedComponentIds() const {
     std::vector<unsigned int> sharedComponentIds;
     for (const unsigned int& sharedComponentId : m_SharedComponentIds)
@@ -130,6 +175,47 @@ inline std::vector<unsigned int> Archetype::notManualSharedComponentIds() const
     return sharedComponentIds;
 }
 
+inline Archetype::Edge Archetype::createEdge(Archetype* dstArchetype) const {
+    const ChunkLayout& dstChunkLayout = dstArchetype->m_ChunkLayout;
+    // A chunk stays valid only if every column keeps its place and no column is dropped, otherwise stale bytes would be left
+    Edge edge{dstArchetype, {}, Combination::k_InvalidIndex, m_ChunkLayout.size == dstChunkLayout.size && m_ChunkLayout.capacity == dstChunkLayout.capacity && m_ChunkLayout.entityOffset == dstChunkLayout.entityOffset && m_ComponentIds.size() == dstArchetype->m_ComponentIds.size()};
+    for (unsigned int i = 0; i < dstArchetype->m_ComponentIds.size(); i++) {
+        auto it = m_ChunkLayout.componentIndexMap.find(dstArchetype->m_ComponentIds[i]);
+        if (it == m_ChunkLayout.componentIndexMap.end()) {
+            edge.addedComponentIndex = i;
+            edge.relinkable = false;
+        } else
+            pushColumnCopies(m_ChunkLayout, it->second, dstChunkLayout, i, edge.columnCopies);
+    }
+    for (const ChunkLayout::ColumnCopy& columnCopy : edge.columnCopies)
+        edge.relinkable &= columnCopy.srcOffset == columnCopy.dstOffset && columnCopy.srcDisabledMaskOffset == columnCopy.dstDisabledMaskOffset;
+    return edge;
+}
+
+inline void Archetype::pushColumnCopies(const ChunkLayout& srcChunkLayout, const unsigned int& srcComponentIndex, const ChunkLayout& dstChunkLayout, const unsigned int& dstComponentIndex, std::vector<ChunkLayout::ColumnCopy>& columnCopies) {
+    const std::size_t& fieldSize = dstChunkLayout.componentFieldSizes[dstComponentIndex];
+    const unsigned int fieldCount = dstChunkLayout.componentSizes[dstComponentIndex] / fieldSize;
+    columnCopies.push_back({srcChunkLayout.componentOffsets[srcComponentIndex], dstChunkLayout.componentOffsets[dstComponentIndex], fieldSize, srcChunkLayout.disabledMaskOffsets[srcComponentIndex], dstChunkLayout.disabledMaskOffsets[dstComponentIndex]});
+    for (unsigned int i = 1; i < fieldCount; i++)
+        columnCopies.push_back({srcChunkLayout.componentOffsets[srcComponentIndex] + fieldSize * srcChunkLayout.capacity * i, dstChunkLayout.componentOffsets[dstComponentIndex] + fieldSize * dstChunkLayout.capacity * i, fieldSize, ChunkLayout::k_InvalidOffset, ChunkLayout::k_InvalidOffset});
+}
+
+inline std::vector<unsigned int> Archetype::changedComponentIndices(const EntityFilter& entityFilter) const {
+    std::vector<unsigned int> componentIndices;
+    for (unsigned int i = 0; i < m_ComponentIds.size(); i++)
+        if (entityFilter.changedComponentMask.test(m_ComponentIds[i]))
+            componentIndices.push_back(i);
+    return componentIndices;
+}
+
+inline std::vector<std::size_t> Archetype::requiredDisabledMaskOffsets(const EntityFilter& entityFilter) const {
+    std::vector<std::size_t> disabledMaskOffsets;
+    for (unsigned int i = 0; i < m_ComponentIds.size(); i++)
+        if (m_ChunkLayout.disabledMaskOffsets[i] != ChunkLayout::k_InvalidOffset && entityFilter.requiredComponentMask.test(m_ComponentIds[i]))
+            disabledMaskOffsets.push_back(m_ChunkLayout.disabledMaskOffsets[i]);
+    return disabledMaskOffsets;
+}
+
 inline Combination* Archetype::createCombination() {
     return createCombination(std::vector<unsigned int>(sharedComponentCount(), ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex));
 }
@@ -140,10 +226,10 @@ inline Combination* Archetype::createCombination(std::vector<unsigned int> const
     unsigned int combinationIndex;
     if (m_FreeCombinationIndices.empty()) {
         combinationIndex = m_Combinations.size();
-        m_Combinations.emplace_back(std::make_unique<Combination>(combinationIndex, m_ChunkLayout, m_SharedComponentIds, sharedComponentIndices, m_ChunkPool));
+        m_Combinations.emplace_back(std::make_unique<Combination>(combinationIndex, m_ChunkLayout, m_SharedComponentIds, sharedComponentIndices, m_ChunkAllocator, m_PlaybackSystemVersion));
     } else {
         combinationIndex = m_FreeCombinationIndices.back(), m_FreeCombinationIndices.pop_back();
-        m_Combinations[combinationIndex] = std::make_unique<Combination>(combinationIndex, m_ChunkLayout, m_SharedComponentIds, sharedComponentIndices, m_ChunkPool);
+        m_Combinations[combinationIndex] = std::make_unique<Combination>(combinationIndex, m_ChunkLayout, m_SharedComponentIds, sharedComponentIndices, m_ChunkAllocator, m_PlaybackSystemVersion);
     }
     m_CombinationIndexMap.emplace(sharedComponentIndices, combinationIndex);
     return m_Combinations[combinationIndex].get();
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+#include <glm/vec3.hpp>
+
+namespace Melon {
+
+// Axis aligned box in world space, whose overlaps are found by the BroadphaseSystem
+struct Bounds : public DataComponent {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+}  // namespace Melon
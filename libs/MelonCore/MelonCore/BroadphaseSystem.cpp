@@ -0,0 +1,196 @@
+#include <MelonCore/Bounds.h>
+#include <MelonCore/BroadphaseSystem.h>
+#include <MelonCore/StaticBounds.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace Melon {
+
+namespace {
+
+// First element of the part partIndex out of partCount of [0, size)
+unsigned int partBegin(const std::size_t& size, const unsigned int& partIndex, const unsigned int& partCount) {
+    return static_cast<unsigned int>(size * partIndex / partCount);
+}
+
+// Rotate the components of v so that axis comes first, which keeps boxes overlapping or not
+glm::vec3 rotate(const glm::vec3& v, const unsigned int& axis) {
+    return glm::vec3(v[axis], v[(axis + 1) % 3], v[(axis + 2) % 3]);
+}
+
+}  // namespace
+
+// Marks static Bounds changed if any chunk of them is
+class BroadphaseSystem::StaticChangedChunkTask : public ChunkTask {
+  public:
+    StaticChangedChunkTask(std::atomic<bool>& staticChanged) : m_StaticChanged(staticChanged) {}
+
+    virtual void execute(const ChunkAccessor&, const unsigned int&, const unsigned int&) override {
+        m_StaticChanged.store(true, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool>& m_StaticChanged;
+};
+
+class BroadphaseSystem::StaticGatherChunkTask : public ChunkTask {
+  public:
+    StaticGatherChunkTask(const unsigned int& boundsComponentId, const unsigned int& axis, std::vector<Box>& boxes, const std::atomic<bool>& staticChanged) : m_BoundsComponentId(boundsComponentId), m_Axis(axis), m_Boxes(boxes), m_StaticChanged(staticChanged) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int& firstEntityIndex) override {
+        if (!m_StaticChanged.load(std::memory_order_relaxed)) return;
+        const Entity* entities = chunkAccessor.entityArray();
+        const Bounds* bounds = chunkAccessor.componentArray<const Bounds>(m_BoundsComponentId);
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+            m_Boxes[firstEntityIndex + i] = Box{.min = rotate(bounds[i].min, m_Axis), .max = rotate(bounds[i].max, m_Axis), .entity = entities[i]};
+    }
+
+    const unsigned int m_BoundsComponentId;
+    const unsigned int m_Axis;
+    std::vector<Box>& m_Boxes;
+    const std::atomic<bool>& m_StaticChanged;
+};
+
+class BroadphaseSystem::DynamicGatherChunkTask : public ChunkTask {
+  public:
+    DynamicGatherChunkTask(const unsigned int& boundsComponentId, const unsigned int& axis, std::vector<Box>& boxes, std::array<CenterStatistics, TaskManager::k_WorkerCount + 1>& centerStatistics) : m_BoundsComponentId(boundsComponentId), m_Axis(axis), m_Boxes(boxes), m_CenterStatistics(centerStatistics) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int& firstEntityIndex) override {
+        const Entity* entities = chunkAccessor.entityArray();
+        const Bounds* bounds = chunkAccessor.componentArray<const Bounds>(m_BoundsComponentId);
+        CenterStatistics& centerStatistics = m_CenterStatistics[TaskManager::workerIndex()];
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+            m_Boxes[firstEntityIndex + i] = Box{.min = rotate(bounds[i].min, m_Axis), .max = rotate(bounds[i].max, m_Axis), .entity = entities[i]};
+            const glm::vec3 center = (bounds[i].min + bounds[i].max) * 0.5f;
+            centerStatistics.sum += center;
+            centerStatistics.squareSum += center * center;
+        }
+        centerStatistics.count += chunkAccessor.entityCount();
+    }
+
+    const unsigned int m_BoundsComponentId;
+    const unsigned int m_Axis;
+    std::vector<Box>& m_Boxes;
+    std::array<CenterStatistics, TaskManager::k_WorkerCount + 1>& m_CenterStatistics;
+};
+
+void BroadphaseSystem::onEnter() {
+    entityManager()->addSingletonComponent(OverlapPairs());
+
+    m_DynamicEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Bounds>().rejectComponents<StaticBounds>().createEntityFilter();
+    m_StaticEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Bounds, StaticBounds>().createEntityFilter();
+    m_StaticChangedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<StaticBounds>().changed<Bounds>().createEntityFilter();
+    m_OverlapPairsComponentAccess = createComponentAccessBuilder().writeSingletonComponents<OverlapPairs>().createComponentAccess();
+    declareComponentAccess(createComponentAccessBuilder().readComponents<Bounds>().writeSingletonComponents<OverlapPairs>().createComponentAccess());
+
+    m_BoundsComponentId = entityManager()->componentId<Bounds>();
+    m_OverlapPairsSingletonComponentId = entityManager()->singletonComponentId<OverlapPairs>();
+}
+
+void BroadphaseSystem::onUpdate() {
+    m_OverlapPairs = entityManager()->singletonComponent<OverlapPairs>(m_OverlapPairsSingletonComponentId);
+
+    // Statistics are gathered by the tasks of the previous frame, which are finished
+    CenterStatistics centerStatistics;
+    for (CenterStatistics& workerCenterStatistics : m_CenterStatistics) {
+        centerStatistics.sum += workerCenterStatistics.sum;
+        centerStatistics.squareSum += workerCenterStatistics.squareSum;
+        centerStatistics.count += workerCenterStatistics.count;
+        workerCenterStatistics = CenterStatistics();
+    }
+    bool axisChanged = false;
+    if (centerStatistics.count != 0) {
+        const glm::vec3 mean = centerStatistics.sum / static_cast<float>(centerStatistics.count);
+        const glm::vec3 variance = centerStatistics.squareSum / static_cast<float>(centerStatistics.count) - mean * mean;
+        const unsigned int axis = variance.x >= variance.y && variance.x >= variance.z ? 0 : (variance.y >= variance.z ? 1 : 2);
+        axisChanged = axis != m_Axis;
+        m_Axis = axis;
+    }
+
+    // Static Bounds are gathered again if sorted along another axis or some of them are added or removed, on top of changed ones
+    const unsigned int staticCount = entityManager()->entityCount(m_StaticEntityFilter);
+    m_StaticChanged.store(axisChanged || staticCount != m_BoxArrays[k_StaticBoxArrayIndex].size(), std::memory_order_relaxed);
+    const unsigned int dynamicCount = entityManager()->entityCount(m_DynamicEntityFilter);
+    for (const auto& [boxArrayIndex, count] : {std::pair{k_DynamicBoxArrayIndex, dynamicCount}, std::pair{k_StaticBoxArrayIndex, staticCount}}) {
+        m_BoxArrays[boxArrayIndex].resize(count);
+        m_SortBuffers[boxArrayIndex].resize(count);
+    }
+
+    predecessor() = schedule(std::make_shared<StaticChangedChunkTask>(m_StaticChanged), m_StaticChangedEntityFilter, predecessor());
+    predecessor() = schedule(std::make_shared<StaticGatherChunkTask>(m_BoundsComponentId, m_Axis, m_BoxArrays[k_StaticBoxArrayIndex], m_StaticChanged), m_StaticEntityFilter, predecessor());
+    predecessor() = schedule(std::make_shared<DynamicGatherChunkTask>(m_BoundsComponentId, m_Axis, m_BoxArrays[k_DynamicBoxArrayIndex], m_CenterStatistics), m_DynamicEntityFilter, predecessor());
+
+    predecessor() = schedule([this](const unsigned int& pairArrayIndex) { m_OverlapPairs->m_PairArrays[pairArrayIndex].clear(); }, OverlapPairs::k_ArrayCount, m_OverlapPairsComponentAccess, predecessor());
+    predecessor() = schedule([this](const unsigned int& index) { sortSegment(index / k_SortSegmentCount, index % k_SortSegmentCount); }, k_BoxArrayCount * k_SortSegmentCount, m_OverlapPairsComponentAccess, predecessor());
+    // Runs are merged back and forth between the box arrays and the sort buffers
+    bool fromBuffer = false;
+    for (unsigned int runSegmentCount = 1; runSegmentCount < k_SortSegmentCount; runSegmentCount *= 2, fromBuffer = !fromBuffer) {
+        const unsigned int runCount = k_SortSegmentCount / (2 * runSegmentCount);
+        predecessor() = schedule([this, runCount, runSegmentCount, fromBuffer](const unsigned int& index) { merge(index / runCount, index % runCount, runSegmentCount, fromBuffer); }, k_BoxArrayCount * runCount, m_OverlapPairsComponentAccess, predecessor());
+    }
+    predecessor() = schedule([this](const unsigned int& batchIndex) { sweep(batchIndex); }, k_SweepBatchCount, m_OverlapPairsComponentAccess, predecessor());
+}
+
+void BroadphaseSystem::onExit() {}
+
+bool BroadphaseSystem::resorted(const unsigned int& boxArrayIndex) const {
+    return boxArrayIndex == k_DynamicBoxArrayIndex || m_StaticChanged.load(std::memory_order_relaxed);
+}
+
+void BroadphaseSystem::sortSegment(const unsigned int& boxArrayIndex, const unsigned int& segmentIndex) {
+    if (!resorted(boxArrayIndex)) return;
+    std::vector<Box>& boxes = m_BoxArrays[boxArrayIndex];
+    std::sort(boxes.begin() + partBegin(boxes.size(), segmentIndex, k_SortSegmentCount), boxes.begin() + partBegin(boxes.size(), segmentIndex + 1, k_SortSegmentCount), [](const Box& a, const Box& b) { return a.min.x < b.min.x; });
+}
+
+void BroadphaseSystem::merge(const unsigned int& boxArrayIndex, const unsigned int& runIndex, const unsigned int& runSegmentCount, const bool& fromBuffer) {
+    if (!resorted(boxArrayIndex)) return;
+    std::vector<Box>& source = fromBuffer ? m_SortBuffers[boxArrayIndex] : m_BoxArrays[boxArrayIndex];
+    std::vector<Box>& destination = fromBuffer ? m_BoxArrays[boxArrayIndex] : m_SortBuffers[boxArrayIndex];
+    const unsigned int firstSegmentIndex = runIndex * 2 * runSegmentCount;
+    const unsigned int begin = partBegin(source.size(), firstSegmentIndex, k_SortSegmentCount);
+    const unsigned int middle = partBegin(source.size(), firstSegmentIndex + runSegmentCount, k_SortSegmentCount);
+    const unsigned int end = partBegin(source.size(), firstSegmentIndex + 2 * runSegmentCount, k_SortSegmentCount);
+    std::merge(source.begin() + begin, source.begin() + middle, source.begin() + middle, source.begin() + end, destination.begin() + begin, [](const Box& a, const Box& b) { return a.min.x < b.min.x; });
+    if (2 * runSegmentCount == k_SortSegmentCount && !fromBuffer)
+        std::swap(m_BoxArrays[boxArrayIndex], m_SortBuffers[boxArrayIndex]);
+}
+
+void BroadphaseSystem::sweep(const unsigned int& batchIndex) {
+    std::vector<OverlapPairs::Pair>& pairs = m_OverlapPairs->m_PairArrays[TaskManager::workerIndex()];
+    // Held apart from the vectors, which pairs written could otherwise alias
+    const Box* const dynamicBoxes = m_BoxArrays[k_DynamicBoxArrayIndex].data();
+    const Box* const staticBoxes = m_BoxArrays[k_StaticBoxArrayIndex].data();
+    const Box* const dynamicBoxesEnd = dynamicBoxes + m_BoxArrays[k_DynamicBoxArrayIndex].size();
+    const Box* const staticBoxesEnd = staticBoxes + m_BoxArrays[k_StaticBoxArrayIndex].size();
+    // Boxes are rotated so that the sweep axis is x, each pair is visited from the box whose min x comes first, the dynamic one on ties
+    // Boxes visited overlap along x, so only y and z are tested, without branches
+    const auto overlapping = [](const Box& a, const Box& b) { return (a.min.y <= b.max.y) & (b.min.y <= a.max.y) & (a.min.z <= b.max.z) & (b.min.z <= a.max.z); };
+
+    const Box* const dynamicBatchEnd = dynamicBoxes + partBegin(dynamicBoxesEnd - dynamicBoxes, batchIndex + 1, k_SweepBatchCount);
+    const Box* dynamicBox = dynamicBoxes + partBegin(dynamicBoxesEnd - dynamicBoxes, batchIndex, k_SweepBatchCount);
+    // Boxes of a batch come by increasing min x, so the first static box to visit only moves forward after being searched once
+    const Box* firstStaticBox = dynamicBox != dynamicBatchEnd ? std::lower_bound(staticBoxes, staticBoxesEnd, dynamicBox->min.x, [](const Box& staticBox, const float& min) { return staticBox.min.x < min; }) : staticBoxesEnd;
+    for (; dynamicBox != dynamicBatchEnd; dynamicBox++) {
+        for (const Box* otherDynamicBox = dynamicBox + 1; otherDynamicBox != dynamicBoxesEnd && otherDynamicBox->min.x <= dynamicBox->max.x; otherDynamicBox++)
+            if (overlapping(*dynamicBox, *otherDynamicBox))
+                pairs.push_back(OverlapPairs::Pair{.first = dynamicBox->entity, .second = otherDynamicBox->entity});
+        while (firstStaticBox != staticBoxesEnd && firstStaticBox->min.x < dynamicBox->min.x) firstStaticBox++;
+        for (const Box* staticBox = firstStaticBox; staticBox != staticBoxesEnd && staticBox->min.x <= dynamicBox->max.x; staticBox++)
+            if (overlapping(*dynamicBox, *staticBox))
+                pairs.push_back(OverlapPairs::Pair{.first = dynamicBox->entity, .second = staticBox->entity});
+    }
+
+    const Box* const staticBatchEnd = staticBoxes + partBegin(staticBoxesEnd - staticBoxes, batchIndex + 1, k_SweepBatchCount);
+    const Box* staticBox = staticBoxes + partBegin(staticBoxesEnd - staticBoxes, batchIndex, k_SweepBatchCount);
+    const Box* firstDynamicBox = staticBox != staticBatchEnd ? std::upper_bound(dynamicBoxes, dynamicBoxesEnd, staticBox->min.x, [](const float& min, const Box& dynamicBox) { return min < dynamicBox.min.x; }) : dynamicBoxesEnd;
+    for (; staticBox != staticBatchEnd; staticBox++) {
+        while (firstDynamicBox != dynamicBoxesEnd && firstDynamicBox->min.x <= staticBox->min.x) firstDynamicBox++;
+        for (const Box* dynamicBox = firstDynamicBox; dynamicBox != dynamicBoxesEnd && dynamicBox->min.x <= staticBox->max.x; dynamicBox++)
+            if (overlapping(*dynamicBox, *staticBox))
+                pairs.push_back(OverlapPairs::Pair{.first = dynamicBox->entity, .second = staticBox->entity});
+    }
+}
+
+}  // namespace Melon
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <MelonCore/ComponentAccess.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/OverlapPairs.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <atomic>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace Melon {
+
+// Finds the Entities whose Bounds overlap each frame into the OverlapPairs singleton, by sort and sweep along the axis where dynamic Bounds spread the most
+// Dynamic and static Bounds are sorted apart, static ones only when one of them has changed, and static ones are never tested against each other
+// Bounds are gathered, sorted and swept in parallel, each worker writing the pairs it finds into an array of its own
+class BroadphaseSystem : public SystemBase {
+  public:
+    // Each array of Bounds is sorted as this many segments in parallel, merged pairwise afterwards
+    static constexpr unsigned int k_SortSegmentCount = TaskManager::k_WorkerCount;
+    static constexpr unsigned int k_SweepBatchCount = k_BatchCountPerWorker * TaskManager::k_WorkerCount;
+
+    virtual ~BroadphaseSystem() {}
+
+  protected:
+    virtual void onEnter() final;
+    virtual void onUpdate() final;
+    virtual void onExit() final;
+
+  private:
+    class StaticChangedChunkTask;
+    class StaticGatherChunkTask;
+    class DynamicGatherChunkTask;
+
+    static_assert((k_SortSegmentCount & (k_SortSegmentCount - 1)) == 0, "Segments are merged pairwise");
+
+    static constexpr unsigned int k_DynamicBoxArrayIndex = 0;
+    static constexpr unsigned int k_StaticBoxArrayIndex = 1;
+    static constexpr unsigned int k_BoxArrayCount = 2;
+
+    struct Box {
+        glm::vec3 min;
+        glm::vec3 max;
+        Entity entity;
+    };
+
+    // Sums of the centers of dynamic Bounds and of their squares, gathered by each worker to choose the sweep axis of the next frame
+    struct CenterStatistics {
+        glm::vec3 sum{};
+        glm::vec3 squareSum{};
+        unsigned int count{};
+    };
+
+    // Box arrays are skipped if static and unchanged
+    bool resorted(const unsigned int& boxArrayIndex) const;
+    void sortSegment(const unsigned int& boxArrayIndex, const unsigned int& segmentIndex);
+    // Merge two sorted runs of runSegmentCount segments each, swapping the buffer in once the whole array is merged
+    void merge(const unsigned int& boxArrayIndex, const unsigned int& runIndex, const unsigned int& runSegmentCount, const bool& fromBuffer);
+    void sweep(const unsigned int& batchIndex);
+
+    EntityFilter m_DynamicEntityFilter;
+    EntityFilter m_StaticEntityFilter;
+    EntityFilter m_StaticChangedEntityFilter;
+    // Tasks sorting and sweeping Bounds gathered only touch the OverlapPairs
+    ComponentAccess m_OverlapPairsComponentAccess;
+
+    unsigned int m_BoundsComponentId;
+    unsigned int m_OverlapPairsSingletonComponentId;
+
+    // Valid from the first update, tasks write it while ordered by the OverlapPairs write declared
+    OverlapPairs* m_OverlapPairs{};
+
+    // Dynamic and static Bounds rotated so that m_Axis comes first, by increasing min x, static ones kept across frames
+    std::array<std::vector<Box>, k_BoxArrayCount> m_BoxArrays;
+    std::array<std::vector<Box>, k_BoxArrayCount> m_SortBuffers;
+    // Whether static Bounds are gathered and sorted again in this frame
+    std::atomic<bool> m_StaticChanged;
+    unsigned int m_Axis{};
+    std::array<CenterStatistics, TaskManager::k_WorkerCount + 1> m_CenterStatistics;
+};
+
+}  // namespace Melon
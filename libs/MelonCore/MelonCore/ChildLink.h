@@ -0,0 +1,15 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+#include <MelonCore/Entity.h>
+
+namespace Melon {
+
+// Written by the HierarchySystem on children, the Parent they are linked to and the next child of that Parent
+// Manual so that destroyed children remain until they are unlinked
+struct ChildLink : public ManualDataComponent {
+    Entity parent;
+    Entity nextSibling;
+};
+
+}  // namespace Melon
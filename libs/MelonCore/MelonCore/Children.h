@@ -0,0 +1,15 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+#include <MelonCore/Entity.h>
+
+namespace Melon {
+
+// Written by the HierarchySystem on parents, the other children follow first through ChildLink::nextSibling
+// Manual like ChildLink, parents without LocalToWorld are taken as destroyed and their children lose their Parent
+struct Children : public ManualDataComponent {
+    Entity first;
+    unsigned int count;
+};
+
+}  // namespace Melon
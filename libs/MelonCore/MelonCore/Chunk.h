@@ -4,28 +4,58 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
 namespace Melon {
 
 struct ChunkLayout {
+    static constexpr std::size_t k_InvalidOffset = std::numeric_limits<std::size_t>::max();
+
+    // Copy of one component column between two ChunkLayouts
+    struct ColumnCopy {
+        std::size_t srcOffset;
+        std::size_t dstOffset;
+        std::size_t size;
+        // Disabled masks of enableable components, k_InvalidOffset if not enableable
+        std::size_t srcDisabledMaskOffset;
+        std::size_t dstDisabledMaskOffset;
+    };
+
+    // Count of bytes of a disabled mask, which takes one bit per Entity
+    static std::size_t disabledMaskSize(const unsigned int& capacity) { return (capacity + 63) / 64 * sizeof(std::uint64_t); }
+
+    // Size class of chunks chosen per Archetype
+    std::size_t size;
     unsigned int capacity;
     std::size_t entityOffset{};
+    // Disabled masks of enableable components followed by versions make up the tail of a chunk
+    std::size_t disabledMaskOffset{};
+    // Last written versions of components, one unsigned int per component placed at the end of a chunk
+    std::size_t versionOffset{};
     std::unordered_map<unsigned int, unsigned int> componentIndexMap;
     std::vector<std::size_t> componentSizes;
     std::vector<std::size_t> componentOffsets;
+    // Size of each field column, which is k_SoAFieldSize for SoA components and the whole component otherwise
+    // Field i of the Entity j lies at componentOffsets + fieldSize * (capacity * i + j)
+    std::vector<std::size_t> componentFieldSizes;
+    // k_InvalidOffset for components not enableable
+    std::vector<std::size_t> disabledMaskOffsets;
 };
 
+// Raw memory of ChunkLayout::size bytes handed out by the ChunkAllocator
 struct Chunk {
     static constexpr std::size_t k_Align = 64;
-    static constexpr std::size_t k_Size = 16 << 10;
+    static constexpr std::size_t k_MinSize = 4 << 10;
+    static constexpr std::size_t k_MaxSize = 256 << 10;
+    // Archetypes pick the smallest size holding at least this many Entities
+    static constexpr unsigned int k_TargetCapacity = 256;
 
-    Chunk() {}
+    Chunk() = delete;
     Chunk(const Chunk&) = delete;
-
-    alignas(k_Align) std::array<std::byte, k_Size> memory;
 };
 
 }  // namespace Melon
@@ -0,0 +1,19 @@
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ComponentAccess.h>
+
+#include <cassert>
+
+namespace Melon {
+
+void ChunkAccessor::checkDeclaredComponentAccess([[maybe_unused]] const unsigned int& componentId, const bool& written) const {
+    if (written)
+        assert(m_ComponentAccess->writable(componentId) && "Component written without being declared written");
+    else
+        assert(m_ComponentAccess->readable(componentId) && "Component read without being declared read");
+}
+
+void ChunkAccessor::checkDeclaredSharedComponentAccess([[maybe_unused]] const unsigned int& sharedComponentId) const {
+    assert(m_ComponentAccess->readSharedComponentMask.test(sharedComponentId) && "SharedComponent read without being declared read");
+}
+
+}  // namespace Melon
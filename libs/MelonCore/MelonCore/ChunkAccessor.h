@@ -2,18 +2,46 @@
 
 #include <MelonCore/ArchetypeMask.h>
 #include <MelonCore/Chunk.h>
+#include <MelonCore/ComponentFields.h>
 #include <MelonCore/DataComponent.h>
 #include <MelonCore/Entity.h>
 #include <MelonCore/ObjectStore.h>
 #include <MelonCore/SharedComponent.h>
 
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 namespace Melon {
 
+struct ComponentAccess;
+
 class ChunkAccessor {
   public:
     const Entity* entityArray() const;
+    // Whether the Entities of the chunk have the component, for components not required by the EntityFilter
+    bool hasComponent(const unsigned int& componentId) const { return m_ChunkLayout.componentIndexMap.contains(componentId); }
+    // Components are marked changed unless Type is const
     template <typename Type>
     Type* componentArray(const unsigned int& componentId) const;
+    // Per-field columns of SoA components, marked changed unless Type is const
+    template <typename Type>
+    ComponentFields<Type> componentFields(const unsigned int& componentId) const;
+    // The global system version when the component is last written
+    const unsigned int& componentVersion(const unsigned int& componentId) const;
+
+    // Enableable components could be toggled concurrently from different tasks
+    bool componentEnabled(const unsigned int& componentId, const unsigned int& entityIndex) const;
+    void setComponentEnabled(const unsigned int& componentId, const unsigned int& entityIndex, const bool& enabled) const;
+    // Call function with the index of each Entity whose enableable components required by the EntityFilter are all enabled
+    template <typename Function>
+    void forEachEnabledEntity(Function&& function) const;
+    // Only the Entities [entityBegin, entityEnd), such as the range given to a ChunkRangeTask
+    template <typename Function>
+    void forEachEnabledEntity(const unsigned int& entityBegin, const unsigned int& entityEnd, Function&& function) const;
 
     unsigned int sharedComponentIndex(const unsigned int& sharedComponentId) const;
     template <typename Type>
@@ -22,7 +50,15 @@ class ChunkAccessor {
     const unsigned int& entityCount() const { return m_EntityCount; }
 
   private:
-    ChunkAccessor(std::byte* chunk, const ChunkLayout& chunkLayout, const unsigned int& entityCount, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore);
+    ChunkAccessor(std::byte* chunk, const ChunkLayout& chunkLayout, const unsigned int& entityCount, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, const unsigned int& globalSystemVersion, std::vector<std::size_t> const& disabledMaskOffsets);
+    unsigned int* versionArray() const;
+    std::uint64_t* disabledMask(const std::size_t& disabledMaskOffset) const;
+    // Assert that the ComponentAccess of the task covers the access in debug builds
+    void checkComponentAccess(const unsigned int& componentId, const bool& written) const;
+    void checkSharedComponentAccess(const unsigned int& sharedComponentId) const;
+    void checkDeclaredComponentAccess(const unsigned int& componentId, const bool& written) const;
+    void checkDeclaredSharedComponentAccess(const unsigned int& sharedComponentId) const;
+
     std::byte* const m_Chunk;
     const ChunkLayout& m_ChunkLayout;
     const unsigned int& m_EntityCount;
@@ -31,7 +67,18 @@ class ChunkAccessor {
 
     ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& m_SharedComponentStore;
 
+    // The global system version when the chunk is filtered, which is used to mark written components
+    const unsigned int m_GlobalSystemVersion;
+
+    // Disabled masks of the enableable components required by the EntityFilter
+    std::vector<std::size_t> m_DisabledMaskOffsets;
+
+    // The ComponentAccess of the scheduling task, null if access is not validated
+    const ComponentAccess* m_ComponentAccess{};
+
+    friend class ChunkBatches;
     friend class Combination;
+    friend class SystemBase;
 };
 
 inline const Entity* ChunkAccessor::entityArray() const {
@@ -41,7 +88,69 @@ inline const Entity* ChunkAccessor::entityArray() const {
 template <typename Type>
 inline Type* ChunkAccessor::componentArray(const unsigned int& componentId) const {
     static_assert(std::is_base_of_v<DataComponent, Type>);
-    return reinterpret_cast<Type*>(reinterpret_cast<std::byte*>(m_Chunk) + m_ChunkLayout.componentOffsets[m_ChunkLayout.componentIndexMap.at(componentId)]);
+    static_assert(!k_TagComponent<std::remove_const_t<Type>>, "Tag components have no column to access");
+    static_assert(!k_SoAComponent<Type>, "SoA components are split into fields, access them with componentFields()");
+    checkComponentAccess(componentId, !std::is_const_v<Type>);
+    const unsigned int& componentIndex = m_ChunkLayout.componentIndexMap.at(componentId);
+    // Tasks given ranges of the same chunk mark it concurrently
+    if constexpr (!std::is_const_v<Type>)
+        std::atomic_ref<unsigned int>(versionArray()[componentIndex]).store(m_GlobalSystemVersion, std::memory_order_relaxed);
+    return reinterpret_cast<Type*>(reinterpret_cast<std::byte*>(m_Chunk) + m_ChunkLayout.componentOffsets[componentIndex]);
+}
+
+template <typename Type>
+inline ComponentFields<Type> ChunkAccessor::componentFields(const unsigned int& componentId) const {
+    static_assert(k_SoAComponent<Type>, "Only SoA components are split into fields");
+    checkComponentAccess(componentId, !std::is_const_v<Type>);
+    const unsigned int& componentIndex = m_ChunkLayout.componentIndexMap.at(componentId);
+    if constexpr (!std::is_const_v<Type>)
+        std::atomic_ref<unsigned int>(versionArray()[componentIndex]).store(m_GlobalSystemVersion, std::memory_order_relaxed);
+    return ComponentFields<Type>(m_Chunk + m_ChunkLayout.componentOffsets[componentIndex], k_SoAFieldSize * m_ChunkLayout.capacity, m_EntityCount);
+}
+
+inline const unsigned int& ChunkAccessor::componentVersion(const unsigned int& componentId) const {
+    return versionArray()[m_ChunkLayout.componentIndexMap.at(componentId)];
+}
+
+inline bool ChunkAccessor::componentEnabled(const unsigned int& componentId, const unsigned int& entityIndex) const {
+    checkComponentAccess(componentId, false);
+    const std::size_t& disabledMaskOffset = m_ChunkLayout.disabledMaskOffsets[m_ChunkLayout.componentIndexMap.at(componentId)];
+    if (disabledMaskOffset == ChunkLayout::k_InvalidOffset) return true;
+    return !(std::atomic_ref<std::uint64_t>(disabledMask(disabledMaskOffset)[entityIndex / 64]).load(std::memory_order_relaxed) >> (entityIndex % 64) & 1);
+}
+
+inline void ChunkAccessor::setComponentEnabled(const unsigned int& componentId, const unsigned int& entityIndex, const bool& enabled) const {
+    checkComponentAccess(componentId, true);
+    const unsigned int& componentIndex = m_ChunkLayout.componentIndexMap.at(componentId);
+    std::atomic_ref<std::uint64_t> word(disabledMask(m_ChunkLayout.disabledMaskOffsets[componentIndex])[entityIndex / 64]);
+    const std::uint64_t bit = std::uint64_t{1} << (entityIndex % 64);
+    if (enabled)
+        word.fetch_and(~bit, std::memory_order_relaxed);
+    else
+        word.fetch_or(bit, std::memory_order_relaxed);
+    std::atomic_ref<unsigned int>(versionArray()[componentIndex]).store(m_GlobalSystemVersion, std::memory_order_relaxed);
+}
+
+template <typename Function>
+inline void ChunkAccessor::forEachEnabledEntity(Function&& function) const {
+    forEachEnabledEntity(0, m_EntityCount, std::forward<Function>(function));
+}
+
+template <typename Function>
+inline void ChunkAccessor::forEachEnabledEntity(const unsigned int& entityBegin, const unsigned int& entityEnd, Function&& function) const {
+    for (unsigned int wordIndex = entityBegin / 64; wordIndex * 64 < entityEnd; wordIndex++) {
+        std::uint64_t disabled = 0;
+        for (const std::size_t& disabledMaskOffset : m_DisabledMaskOffsets)
+            disabled |= std::atomic_ref<std::uint64_t>(disabledMask(disabledMaskOffset)[wordIndex]).load(std::memory_order_relaxed);
+        std::uint64_t enabled = ~disabled;
+        if (wordIndex * 64 < entityBegin)
+            enabled &= ~std::uint64_t{0} << (entityBegin - wordIndex * 64);
+        if (entityEnd - wordIndex * 64 < 64)
+            enabled &= (std::uint64_t{1} << (entityEnd - wordIndex * 64)) - 1;
+        // Skip disabled Entities by counting trailing zeros
+        for (; enabled != 0; enabled &= enabled - 1)
+            function(wordIndex * 64 + std::countr_zero(enabled));
+    }
 }
 
 inline unsigned int ChunkAccessor::sharedComponentIndex(const unsigned int& sharedComponentId) const {
@@ -54,9 +163,32 @@ inline unsigned int ChunkAccessor::sharedComponentIndex(const unsigned int& shar
 template <typename Type>
 inline const Type* ChunkAccessor::sharedComponent(const unsigned int& sharedComponentId) const {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
+    checkSharedComponentAccess(sharedComponentId);
     return m_SharedComponentStore.object<Type>(sharedComponentIndex(sharedComponentId));
 }
 
-inline ChunkAccessor::ChunkAccessor(std::byte* chunk, const ChunkLayout& chunkLayout, const unsigned int& entityCount, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore) : m_Chunk(chunk), m_ChunkLayout(chunkLayout), m_EntityCount(entityCount), m_SharedComponentIds(sharedComponentIds), m_SharedComponentIndices(sharedComponentIndices), m_SharedComponentStore(sharedComponentStore) {}
+inline ChunkAccessor::ChunkAccessor(std::byte* chunk, const ChunkLayout& chunkLayout, const unsigned int& entityCount, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, const unsigned int& globalSystemVersion, std::vector<std::size_t> const& disabledMaskOffsets) : m_Chunk(chunk), m_ChunkLayout(chunkLayout), m_EntityCount(entityCount), m_SharedComponentIds(sharedComponentIds), m_SharedComponentIndices(sharedComponentIndices), m_SharedComponentStore(sharedComponentStore), m_GlobalSystemVersion(globalSystemVersion), m_DisabledMaskOffsets(disabledMaskOffsets) {}
+
+inline unsigned int* ChunkAccessor::versionArray() const {
+    return reinterpret_cast<unsigned int*>(m_Chunk + m_ChunkLayout.versionOffset);
+}
+
+inline std::uint64_t* ChunkAccessor::disabledMask(const std::size_t& disabledMaskOffset) const {
+    return reinterpret_cast<std::uint64_t*>(m_Chunk + disabledMaskOffset);
+}
+
+inline void ChunkAccessor::checkComponentAccess([[maybe_unused]] const unsigned int& componentId, [[maybe_unused]] const bool& written) const {
+#ifndef NDEBUG
+    if (m_ComponentAccess != nullptr)
+        checkDeclaredComponentAccess(componentId, written);
+#endif
+}
+
+inline void ChunkAccessor::checkSharedComponentAccess([[maybe_unused]] const unsigned int& sharedComponentId) const {
+#ifndef NDEBUG
+    if (m_ComponentAccess != nullptr)
+        checkDeclaredSharedComponentAccess(sharedComponentId);
+#endif
+}
 
 }  // namespace Melon
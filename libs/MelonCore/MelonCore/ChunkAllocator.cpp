@@ -0,0 +1,292 @@
+#include <MelonCore/ChunkAllocator.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace Melon {
+
+std::atomic<std::uint64_t> ChunkAllocator::s_AllocatorIdCounter{};
+
+namespace {
+
+std::atomic_ref<Chunk*> link(Chunk* chunk) {
+    return std::atomic_ref<Chunk*>(*reinterpret_cast<Chunk**>(chunk));
+}
+
+}  // namespace
+
+unsigned int ChunkAllocator::sizeClass(const std::size_t& chunkSize) {
+    return std::countr_zero(chunkSize / Chunk::k_MinSize);
+}
+
+ChunkAllocator::ChunkAllocator() : m_Id(s_AllocatorIdCounter++) {}
+
+ChunkAllocator::~ChunkAllocator() {
+    for (const Slab& slab : m_Slabs)
+        releaseSlab(slab);
+}
+
+Chunk* ChunkAllocator::request(const std::size_t& chunkSize) {
+    const unsigned int sizeClass = ChunkAllocator::sizeClass(chunkSize);
+    std::vector<Chunk*>& cachedChunks = threadCache().chunks[sizeClass];
+    Chunk* chunk;
+    if (!cachedChunks.empty()) {
+        chunk = cachedChunks.back();
+        cachedChunks.pop_back();
+    } else if ((chunk = pop(sizeClass)) == nullptr)
+        chunk = createSlab(sizeClass);
+    // Clear the link left by the free list to keep the chunk zeroed
+    link(chunk).store(nullptr, std::memory_order_relaxed);
+    m_BytesInUse.fetch_add(chunkSize, std::memory_order_relaxed);
+    return chunk;
+}
+
+void ChunkAllocator::recycle(Chunk* chunk, const std::size_t& chunkSize) {
+    const unsigned int sizeClass = ChunkAllocator::sizeClass(chunkSize);
+    std::vector<Chunk*>& cachedChunks = threadCache().chunks[sizeClass];
+    cachedChunks.push_back(chunk);
+    if (cachedChunks.size() >= k_ThreadCacheChunkCount * 2) {
+        // The oldest half is the least likely to be warm in this thread's cache
+        for (unsigned int i = 0; i + 1 < k_ThreadCacheChunkCount; i++)
+            link(cachedChunks[i]).store(cachedChunks[i + 1], std::memory_order_relaxed);
+        push(sizeClass, cachedChunks.front(), cachedChunks[k_ThreadCacheChunkCount - 1]);
+        cachedChunks.erase(cachedChunks.begin(), cachedChunks.begin() + k_ThreadCacheChunkCount);
+    }
+    m_BytesInUse.fetch_sub(chunkSize, std::memory_order_relaxed);
+}
+
+void ChunkAllocator::trim() {
+    std::lock_guard<std::mutex> lock(m_SlabMutex);
+
+    std::array<std::vector<Chunk*>, k_SizeClassCount> freeChunks;
+    drainFreeChunks(freeChunks);
+
+    // Count free chunks per slab
+    std::vector<unsigned int> freeChunkCounts(m_Slabs.size());
+    for (std::vector<Chunk*> const& chunks : freeChunks)
+        for (const Chunk* chunk : chunks)
+            freeChunkCounts[slabIndex(chunk, m_Slabs.size())]++;
+
+    std::vector<bool> released(m_Slabs.size());
+    for (unsigned int i = 0; i < m_Slabs.size(); i++)
+        if (freeChunkCounts[i] == m_Slabs[i].size / chunkSize(m_Slabs[i].sizeClass)) {
+            released[i] = true;
+            releaseSlab(m_Slabs[i]);
+            m_SlabBytes.fetch_sub(m_Slabs[i].size, std::memory_order_relaxed);
+            m_BytesReturned.fetch_add(m_Slabs[i].size, std::memory_order_relaxed);
+        }
+
+    // Return chunks of the kept slabs to the free lists
+    for (unsigned int sizeClass = 0; sizeClass < k_SizeClassCount; sizeClass++) {
+        Chunk* first = nullptr;
+        Chunk* last = nullptr;
+        for (Chunk* chunk : freeChunks[sizeClass]) {
+            if (released[slabIndex(chunk, m_Slabs.size())]) continue;
+            link(chunk).store(first, std::memory_order_relaxed);
+            first = chunk;
+            if (last == nullptr) last = chunk;
+        }
+        if (first != nullptr)
+            push(sizeClass, first, last);
+    }
+
+    unsigned int keptCount = 0;
+    for (unsigned int i = 0; i < m_Slabs.size(); i++)
+        if (!released[i])
+            m_Slabs[keptCount++] = m_Slabs[i];
+    m_Slabs.resize(keptCount);
+}
+
+void ChunkAllocator::beginDefragmentation() {
+    std::lock_guard<std::mutex> lock(m_SlabMutex);
+
+    std::array<std::vector<Chunk*>, k_SizeClassCount> freeChunks;
+    drainFreeChunks(freeChunks);
+    std::vector<std::vector<Chunk*>> slabFreeChunks(m_Slabs.size());
+    for (std::vector<Chunk*> const& chunks : freeChunks)
+        for (Chunk* chunk : chunks)
+            slabFreeChunks[slabIndex(chunk, m_Slabs.size())].push_back(chunk);
+
+    // Per size class, slabs are evacuated from the emptiest while their live chunks fit into the free chunks of the fullest
+    m_EvacuatedSlabs.assign(m_Slabs.size(), false);
+    for (unsigned int sizeClass = 0; sizeClass < k_SizeClassCount; sizeClass++) {
+        std::vector<unsigned int> slabIndices;
+        for (unsigned int i = 0; i < m_Slabs.size(); i++)
+            if (m_Slabs[i].sizeClass == sizeClass)
+                slabIndices.push_back(i);
+        std::sort(slabIndices.begin(), slabIndices.end(), [&](const unsigned int& a, const unsigned int& b) { return slabFreeChunks[a].size() < slabFreeChunks[b].size(); });
+        const auto liveChunkCount = [&](const unsigned int& i) { return m_Slabs[i].size / chunkSize(sizeClass) - slabFreeChunks[i].size(); };
+        std::size_t availableCount = 0;
+        for (unsigned int front = 0, back = slabIndices.size(); front < back;) {
+            if (liveChunkCount(slabIndices[back - 1]) <= availableCount) {
+                availableCount -= liveChunkCount(slabIndices[--back]);
+                m_EvacuatedSlabs[slabIndices[back]] = true;
+            } else
+                availableCount += slabFreeChunks[slabIndices[front++]].size();
+        }
+        for (const unsigned int& i : slabIndices) {
+            std::vector<Chunk*>& chunks = m_EvacuatedSlabs[i] ? m_RelocationFreeChunks[sizeClass] : m_RelocationTargets[sizeClass];
+            chunks.insert(chunks.end(), slabFreeChunks[i].begin(), slabFreeChunks[i].end());
+        }
+    }
+}
+
+Chunk* ChunkAllocator::relocate(Chunk* chunk, const std::size_t& chunkSize) {
+    const unsigned int sizeClass = ChunkAllocator::sizeClass(chunkSize);
+    std::vector<Chunk*>& targets = m_RelocationTargets[sizeClass];
+    if (targets.empty())
+        return chunk;
+    // Slabs created during the defragmentation are appended unsorted and never evacuated
+    const unsigned int index = slabIndex(chunk, m_EvacuatedSlabs.size());
+    if (index >= m_EvacuatedSlabs.size() || !m_EvacuatedSlabs[index] || reinterpret_cast<const std::byte*>(chunk) >= m_Slabs[index].memory + m_Slabs[index].size)
+        return chunk;
+    Chunk* target = targets.back();
+    targets.pop_back();
+    link(target).store(nullptr, std::memory_order_relaxed);
+    memcpy(target, chunk, chunkSize);
+    memset(chunk, 0, chunkSize);
+    m_RelocationFreeChunks[sizeClass].push_back(chunk);
+    return target;
+}
+
+void ChunkAllocator::endDefragmentation() {
+    for (unsigned int sizeClass = 0; sizeClass < k_SizeClassCount; sizeClass++)
+        for (std::vector<Chunk*>* chunks : {&m_RelocationTargets[sizeClass], &m_RelocationFreeChunks[sizeClass]}) {
+            for (unsigned int i = 0; i + 1 < chunks->size(); i++)
+                link((*chunks)[i]).store((*chunks)[i + 1], std::memory_order_relaxed);
+            if (!chunks->empty())
+                push(sizeClass, chunks->front(), chunks->back());
+            chunks->clear();
+        }
+    m_EvacuatedSlabs.clear();
+    trim();
+}
+
+ChunkAllocator::Stats ChunkAllocator::stats() const {
+    const std::size_t bytesInUse = m_BytesInUse.load(std::memory_order_relaxed);
+    return Stats{bytesInUse, m_SlabBytes.load(std::memory_order_relaxed) - bytesInUse, m_BytesReturned.load(std::memory_order_relaxed)};
+}
+
+ChunkAllocator::ThreadCache& ChunkAllocator::threadCache() {
+    // Allocator ids are never reused, so entries left by destroyed allocators are never matched
+    thread_local std::vector<std::pair<std::uint64_t, ThreadCache*>> threadCaches;
+    for (const auto& [id, cache] : threadCaches)
+        if (id == m_Id)
+            return *cache;
+    std::lock_guard<std::mutex> lock(m_SlabMutex);
+    ThreadCache* cache = m_ThreadCaches.emplace_back(std::make_unique<ThreadCache>()).get();
+    threadCaches.emplace_back(m_Id, cache);
+    return *cache;
+}
+
+void ChunkAllocator::drainFreeChunks(std::array<std::vector<Chunk*>, k_SizeClassCount>& freeChunks) {
+    for (unsigned int sizeClass = 0; sizeClass < k_SizeClassCount; sizeClass++) {
+        // Caches of worker threads are drained too, or chunks they recycled during playback would keep their slabs forever
+        for (std::unique_ptr<ThreadCache> const& cache : m_ThreadCaches) {
+            freeChunks[sizeClass].insert(freeChunks[sizeClass].end(), cache->chunks[sizeClass].begin(), cache->chunks[sizeClass].end());
+            cache->chunks[sizeClass].clear();
+        }
+        const std::uint64_t head = m_FreeLists[sizeClass].head.exchange(0, std::memory_order_acquire);
+        for (Chunk* chunk = reinterpret_cast<Chunk*>(head & k_PointerMask); chunk != nullptr; chunk = link(chunk).load(std::memory_order_relaxed))
+            freeChunks[sizeClass].push_back(chunk);
+    }
+    std::sort(m_Slabs.begin(), m_Slabs.end(), [](const Slab& a, const Slab& b) { return a.memory < b.memory; });
+}
+
+unsigned int ChunkAllocator::slabIndex(const Chunk* chunk, const unsigned int& sortedSlabCount) const {
+    const auto it = std::upper_bound(m_Slabs.begin(), m_Slabs.begin() + sortedSlabCount, reinterpret_cast<const std::byte*>(chunk), [](const std::byte* address, const Slab& slab) { return address < slab.memory; });
+    return static_cast<unsigned int>(it - m_Slabs.begin()) - 1;
+}
+
+void ChunkAllocator::push(const unsigned int& sizeClass, Chunk* first, Chunk* last) {
+    std::atomic<std::uint64_t>& head = m_FreeLists[sizeClass].head;
+    std::uint64_t oldHead = head.load(std::memory_order_relaxed);
+    std::uint64_t newHead;
+    do {
+        link(last).store(reinterpret_cast<Chunk*>(oldHead & k_PointerMask), std::memory_order_relaxed);
+        newHead = reinterpret_cast<std::uintptr_t>(first) | (oldHead & ~k_PointerMask);
+    } while (!head.compare_exchange_weak(oldHead, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+Chunk* ChunkAllocator::pop(const unsigned int& sizeClass) {
+    std::atomic<std::uint64_t>& head = m_FreeLists[sizeClass].head;
+    std::uint64_t oldHead = head.load(std::memory_order_acquire);
+    while ((oldHead & k_PointerMask) != 0) {
+        Chunk* chunk = reinterpret_cast<Chunk*>(oldHead & k_PointerMask);
+        // The chunk may be popped by another thread meanwhile, in which case the tag makes the exchange fail
+        const std::uint64_t newHead = reinterpret_cast<std::uintptr_t>(link(chunk).load(std::memory_order_relaxed)) | ((oldHead & ~k_PointerMask) + (k_PointerMask + 1));
+        if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_acquire))
+            return chunk;
+    }
+    return nullptr;
+}
+
+Chunk* ChunkAllocator::createSlab(const unsigned int& sizeClass) {
+    const std::size_t size = chunkSize(sizeClass);
+    Slab slab{};
+    if (size >= k_MinHugePageChunkSize)
+        slab = allocateHugePageSlab();
+    if (slab.memory == nullptr) {
+        slab.size = size * k_MinChunkCountPerSlab;
+        slab.memory = static_cast<std::byte*>(::operator new(slab.size, std::align_val_t{Chunk::k_Align}));
+        memset(slab.memory, 0, slab.size);
+    }
+    slab.sizeClass = sizeClass;
+    {
+        std::lock_guard<std::mutex> lock(m_SlabMutex);
+        m_Slabs.push_back(slab);
+    }
+    m_SlabBytes.fetch_add(slab.size, std::memory_order_relaxed);
+
+    // The first chunk is handed out directly, the others are linked into the free list
+    const unsigned int chunkCount = slab.size / size;
+    Chunk* first = reinterpret_cast<Chunk*>(slab.memory);
+    if (chunkCount > 1) {
+        for (unsigned int i = 1; i + 1 < chunkCount; i++)
+            link(reinterpret_cast<Chunk*>(slab.memory + size * i)).store(reinterpret_cast<Chunk*>(slab.memory + size * (i + 1)), std::memory_order_relaxed);
+        push(sizeClass, reinterpret_cast<Chunk*>(slab.memory + size), reinterpret_cast<Chunk*>(slab.memory + size * (chunkCount - 1)));
+    }
+    return first;
+}
+
+ChunkAllocator::Slab ChunkAllocator::allocateHugePageSlab() {
+#if defined(__linux__)
+    // Anonymous mappings are zeroed, explicit huge pages are tried first
+    void* memory = mmap(nullptr, k_HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED)
+        return {static_cast<std::byte*>(memory), k_HugePageSize, true, 0};
+    // Otherwise over-map to cut out an aligned slab which transparent huge pages could back
+    memory = mmap(nullptr, k_HugePageSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return {};
+    const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(memory);
+    const std::uintptr_t alignedBegin = (begin + k_HugePageSize - 1) / k_HugePageSize * k_HugePageSize;
+    if (alignedBegin != begin)
+        munmap(memory, alignedBegin - begin);
+    if (const std::size_t tail = begin + k_HugePageSize * 2 - (alignedBegin + k_HugePageSize); tail != 0)
+        munmap(reinterpret_cast<void*>(alignedBegin + k_HugePageSize), tail);
+    memory = reinterpret_cast<void*>(alignedBegin);
+    madvise(memory, k_HugePageSize, MADV_HUGEPAGE);
+    return {static_cast<std::byte*>(memory), k_HugePageSize, true, 0};
+#else
+    return {};
+#endif
+}
+
+void ChunkAllocator::releaseSlab(const Slab& slab) {
+#if defined(__linux__)
+    if (slab.mapped) {
+        munmap(slab.memory, slab.size);
+        return;
+    }
+#endif
+    ::operator delete(slab.memory, std::align_val_t{Chunk::k_Align});
+}
+
+}  // namespace Melon
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <MelonCore/Chunk.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Melon {
+
+// Hands out zeroed Chunks of power-of-two size classes from Chunk::k_MinSize to Chunk::k_MaxSize
+// Chunks are requested and recycled through per-thread caches backed by a lock-free free list per size class
+// ChunkAllocator can't be destroyed until all chunks are recycled
+class ChunkAllocator {
+  public:
+    static constexpr unsigned int k_SizeClassCount = 7;
+    static constexpr std::size_t k_HugePageSize = 2 << 20;
+    // Classes at least this large are carved from huge-page-aligned slabs
+    static constexpr std::size_t k_MinHugePageChunkSize = 64 << 10;
+    static constexpr unsigned int k_MinChunkCountPerSlab = 16;
+    // A thread cache spills half of its chunks of a class to the free list beyond twice this count
+    static constexpr unsigned int k_ThreadCacheChunkCount = 8;
+
+    struct Stats {
+        std::size_t bytesInUse;
+        // Held by slabs but not in use, either in free lists or in thread caches
+        std::size_t bytesCached;
+        // Released to the system by trim() so far
+        std::size_t bytesReturned;
+    };
+
+    static unsigned int sizeClass(const std::size_t& chunkSize);
+    static std::size_t chunkSize(const unsigned int& sizeClass) { return Chunk::k_MinSize << sizeClass; }
+
+    ChunkAllocator();
+    ChunkAllocator(const ChunkAllocator&) = delete;
+    ~ChunkAllocator();
+
+    Chunk* request(const std::size_t& chunkSize);
+    // The chunk should be zeroed again before being recycled
+    void recycle(Chunk* chunk, const std::size_t& chunkSize);
+
+    // Releases slabs whose chunks are all free, after flushing the caches of every thread
+    // No thread may request or recycle meanwhile
+    void trim();
+
+    Stats stats() const;
+
+    // Defragmentation moves chunks in use out of the emptiest slabs so that trim() could release them
+    // Only the calling thread may request, recycle or relocate until endDefragmentation(), which trims
+    void beginDefragmentation();
+    // Returns a copy of the chunk placed in a fuller slab, or the chunk itself if it should stay
+    Chunk* relocate(Chunk* chunk, const std::size_t& chunkSize);
+    void endDefragmentation();
+
+  private:
+    struct Slab {
+        std::byte* memory;
+        std::size_t size;
+        bool mapped;
+        unsigned int sizeClass;
+    };
+
+    struct ThreadCache {
+        std::array<std::vector<Chunk*>, k_SizeClassCount> chunks;
+    };
+
+    // Treiber stack linking free chunks through their first bytes, the upper 16 bits of the head count pops against ABA
+    struct FreeList {
+        std::atomic<std::uint64_t> head{};
+    };
+
+    static constexpr std::uint64_t k_PointerMask = (std::uint64_t{1} << 48) - 1;
+
+    ThreadCache& threadCache();
+
+    // Moves every free chunk, in the free lists or in any thread cache, into freeChunks, m_Slabs is sorted by address meanwhile
+    void drainFreeChunks(std::array<std::vector<Chunk*>, k_SizeClassCount>& freeChunks);
+    // Looks up the first sortedSlabCount slabs, which are sorted by address
+    unsigned int slabIndex(const Chunk* chunk, const unsigned int& sortedSlabCount) const;
+
+    void push(const unsigned int& sizeClass, Chunk* first, Chunk* last);
+    Chunk* pop(const unsigned int& sizeClass);
+
+    Chunk* createSlab(const unsigned int& sizeClass);
+    static Slab allocateHugePageSlab();
+    static void releaseSlab(const Slab& slab);
+
+    static std::atomic<std::uint64_t> s_AllocatorIdCounter;
+
+    const std::uint64_t m_Id;
+    std::array<FreeList, k_SizeClassCount> m_FreeLists;
+
+    // Guards slabs and thread caches, which are only touched when the free lists run dry or on trim()
+    std::mutex m_SlabMutex;
+    std::vector<Slab> m_Slabs;
+    std::vector<std::unique_ptr<ThreadCache>> m_ThreadCaches;
+
+    // Free chunks in slabs kept by the ongoing defragmentation, and chunks freed by it
+    std::array<std::vector<Chunk*>, k_SizeClassCount> m_RelocationTargets;
+    std::array<std::vector<Chunk*>, k_SizeClassCount> m_RelocationFreeChunks;
+    std::vector<bool> m_EvacuatedSlabs;
+
+    std::atomic<std::size_t> m_BytesInUse{};
+    std::atomic<std::size_t> m_SlabBytes{};
+    std::atomic<std::size_t> m_BytesReturned{};
+};
+
+}  // namespace Melon
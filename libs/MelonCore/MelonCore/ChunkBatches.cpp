@@ -0,0 +1,65 @@
+#include <MelonCore/ChunkBatches.h>
+
+#include <cstdint>
+
+namespace Melon {
+
+void ChunkBatches::assign(std::vector<ChunkAccessor>&& accessors, const unsigned int& batchEntityCount, const bool& splitChunks) {
+    assignFirstEntityIndices(std::move(accessors));
+    m_BatchEnds.clear();
+    if (splitChunks) {
+        for (unsigned int batchBegin = 0; batchBegin < m_EntityCount; batchBegin += batchEntityCount)
+            m_BatchEnds.push_back(std::min(batchBegin + batchEntityCount, m_EntityCount));
+    } else {
+        unsigned int batchEntityCounter = 0;
+        for (unsigned int i = 0; i < m_Accessors.size(); i++) {
+            batchEntityCounter += m_Accessors[i].entityCount();
+            if (batchEntityCounter >= batchEntityCount || i + 1 == m_Accessors.size()) {
+                m_BatchEnds.push_back(m_FirstEntityIndices[i] + m_Accessors[i].entityCount());
+                batchEntityCounter = 0;
+            }
+        }
+    }
+    m_BatchCursor.store(0, std::memory_order_relaxed);
+    m_Affinity = false;
+}
+
+void ChunkBatches::assignWithAffinity(std::vector<ChunkAccessor>&& accessors, const unsigned int& batchEntityCount) {
+    assignFirstEntityIndices(std::move(accessors));
+    std::array<unsigned int, TaskManager::k_WorkerCount> batchEntityCounters{};
+    for (unsigned int i = 0; i < m_Accessors.size(); i++) {
+        const unsigned int workerIndex = preferredWorkerIndex(m_Accessors[i]);
+        WorkerBatches& workerBatches = m_WorkerBatches[workerIndex];
+        workerBatches.chunkIndices.push_back(i);
+        batchEntityCounters[workerIndex] += m_Accessors[i].entityCount();
+        if (batchEntityCounters[workerIndex] >= batchEntityCount) {
+            workerBatches.batchEnds.push_back(workerBatches.chunkIndices.size());
+            batchEntityCounters[workerIndex] = 0;
+        }
+    }
+    for (WorkerBatches& workerBatches : m_WorkerBatches)
+        if (workerBatches.batchEnds.empty() ? !workerBatches.chunkIndices.empty() : workerBatches.batchEnds.back() != workerBatches.chunkIndices.size())
+            workerBatches.batchEnds.push_back(workerBatches.chunkIndices.size());
+    m_Affinity = true;
+}
+
+unsigned int ChunkBatches::preferredWorkerIndex(const ChunkAccessor& accessor) {
+    // The address of a chunk identifies it within its archetype until it is relocated by compaction
+    std::uint64_t hash = reinterpret_cast<std::uintptr_t>(accessor.m_Chunk);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash % TaskManager::k_WorkerCount;
+}
+
+void ChunkBatches::assignFirstEntityIndices(std::vector<ChunkAccessor>&& accessors) {
+    m_Accessors = std::move(accessors);
+    m_FirstEntityIndices.resize(m_Accessors.size());
+    m_EntityCount = 0;
+    for (unsigned int i = 0; i < m_Accessors.size(); i++) {
+        m_FirstEntityIndices[i] = m_EntityCount;
+        m_EntityCount += m_Accessors[i].entityCount();
+    }
+}
+
+}  // namespace Melon
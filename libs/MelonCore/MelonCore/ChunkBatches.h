@@ -0,0 +1,86 @@
+#pragma once
+
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonTask/TaskManager.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace Melon {
+
+// Filtered chunks split into batches of about the same Entity count, which tasks claim until none is left
+class ChunkBatches {
+  public:
+    ChunkBatches() {}
+
+    // Each batch holds batchEntityCount Entities, except the last one
+    // Batches end with chunks unless splitChunks, in which case a chunk may be shared by several batches
+    void assign(std::vector<ChunkAccessor>&& accessors, const unsigned int& batchEntityCount, const bool& splitChunks);
+    // Chunks are batched per preferred worker, which is the same every frame as long as the chunk lives
+    // Workers claim their own batches first and only steal from others once theirs are done, chunks are never split
+    void assignWithAffinity(std::vector<ChunkAccessor>&& accessors, const unsigned int& batchEntityCount);
+    // Claims batches until none is left, calling function(chunkIndex, entityBegin, entityEnd) for the part of each chunk in them
+    // Returns the number of Entities claimed
+    template <typename Function>
+    unsigned int execute(Function&& function);
+
+    std::vector<ChunkAccessor>& accessors() { return m_Accessors; }
+    // Index of the first Entity of the chunk among all filtered Entities
+    const unsigned int& firstEntityIndex(const unsigned int& chunkIndex) const { return m_FirstEntityIndices[chunkIndex]; }
+    const unsigned int& entityCount() const { return m_EntityCount; }
+
+  private:
+    // Batches of the chunks preferring one worker, on their own cache line as other workers only touch them when stealing
+    struct alignas(64) WorkerBatches {
+        std::vector<unsigned int> chunkIndices;
+        // Exclusive end of each batch in chunkIndices
+        std::vector<unsigned int> batchEnds;
+        std::atomic<unsigned int> batchCursor{};
+    };
+
+    static unsigned int preferredWorkerIndex(const ChunkAccessor& accessor);
+    void assignFirstEntityIndices(std::vector<ChunkAccessor>&& accessors);
+
+    std::vector<ChunkAccessor> m_Accessors;
+    std::vector<unsigned int> m_FirstEntityIndices;
+    // Exclusive end of each batch among all filtered Entities
+    std::vector<unsigned int> m_BatchEnds;
+    unsigned int m_EntityCount{};
+    std::atomic<unsigned int> m_BatchCursor{};
+    bool m_Affinity{};
+    std::array<WorkerBatches, TaskManager::k_WorkerCount> m_WorkerBatches;
+};
+
+template <typename Function>
+inline unsigned int ChunkBatches::execute(Function&& function) {
+    unsigned int claimedEntityCount = 0;
+    if (m_Affinity) {
+        const unsigned int workerIndex = TaskManager::workerIndex() % TaskManager::k_WorkerCount;
+        for (unsigned int i = 0; i < TaskManager::k_WorkerCount; i++) {
+            WorkerBatches& workerBatches = m_WorkerBatches[(workerIndex + i) % TaskManager::k_WorkerCount];
+            for (unsigned int batchIndex = workerBatches.batchCursor.fetch_add(1, std::memory_order_relaxed); batchIndex < workerBatches.batchEnds.size(); batchIndex = workerBatches.batchCursor.fetch_add(1, std::memory_order_relaxed))
+                for (unsigned int j = batchIndex == 0 ? 0 : workerBatches.batchEnds[batchIndex - 1]; j < workerBatches.batchEnds[batchIndex]; j++) {
+                    const unsigned int& chunkIndex = workerBatches.chunkIndices[j];
+                    function(chunkIndex, 0U, m_Accessors[chunkIndex].entityCount());
+                    claimedEntityCount += m_Accessors[chunkIndex].entityCount();
+                }
+        }
+        return claimedEntityCount;
+    }
+    for (unsigned int batchIndex = m_BatchCursor.fetch_add(1, std::memory_order_relaxed); batchIndex < m_BatchEnds.size(); batchIndex = m_BatchCursor.fetch_add(1, std::memory_order_relaxed)) {
+        const unsigned int batchBegin = batchIndex == 0 ? 0 : m_BatchEnds[batchIndex - 1];
+        const unsigned int& batchEnd = m_BatchEnds[batchIndex];
+        // The last chunk starting at or before batchBegin, which skips empty chunks
+        unsigned int chunkIndex = std::upper_bound(m_FirstEntityIndices.begin(), m_FirstEntityIndices.end(), batchBegin) - m_FirstEntityIndices.begin() - 1;
+        for (; chunkIndex < m_Accessors.size() && m_FirstEntityIndices[chunkIndex] < batchEnd; chunkIndex++) {
+            const unsigned int& firstEntityIndex = m_FirstEntityIndices[chunkIndex];
+            function(chunkIndex, std::max(batchBegin, firstEntityIndex) - firstEntityIndex, std::min(batchEnd - firstEntityIndex, m_Accessors[chunkIndex].entityCount()));
+        }
+        claimedEntityCount += batchEnd - batchBegin;
+    }
+    return claimedEntityCount;
+}
+
+}  // namespace Melon
@@ -11,15 +11,49 @@ Combination::Combination(
     const ChunkLayout& chunkLayout,
     std::vector<unsigned int> const& sharedComponentIds,
     std::vector<unsigned int> const& sharedComponentIndices,
-    ObjectPool<Chunk>* chunkPool)
+    ChunkAllocator* chunkAllocator,
+    const unsigned int& playbackSystemVersion)
     : m_Index(index),
       m_ChunkLayout(chunkLayout),
       m_SharedComponentIds(sharedComponentIds),
       m_SharedComponentIndices(sharedComponentIndices),
-      m_ChunkPool(chunkPool),
+      m_ChunkAllocator(chunkAllocator),
+      m_PlaybackSystemVersion(playbackSystemVersion),
       m_EntityCountInCurrentChunk(chunkLayout.capacity) {
 }
 
+Combination::~Combination() {
+    for (Chunk* chunk : m_SpareChunks)
+        m_ChunkAllocator->recycle(chunk, m_ChunkLayout.size);
+}
+
+void Combination::reserve(const unsigned int& entityCount) {
+    const unsigned int freeCount = m_ChunkLayout.capacity - m_EntityCountInCurrentChunk + m_SpareChunks.size() * m_ChunkLayout.capacity;
+    if (entityCount <= freeCount) return;
+    const unsigned int chunkCount = (entityCount - freeCount - 1) / m_ChunkLayout.capacity + 1;
+    m_SpareChunks.reserve(m_SpareChunks.size() + chunkCount);
+    for (unsigned int i = 0; i < chunkCount; i++)
+        m_SpareChunks.push_back(m_ChunkAllocator->request(m_ChunkLayout.size));
+}
+
+bool Combination::compact(const std::chrono::steady_clock::time_point& deadline, unsigned int& freedChunkCount, unsigned int& relocatedChunkCount) {
+    for (Chunk* chunk : m_SpareChunks)
+        m_ChunkAllocator->recycle(chunk, m_ChunkLayout.size);
+    freedChunkCount += m_SpareChunks.size();
+    m_SpareChunks.clear();
+    m_SpareChunks.shrink_to_fit();
+    for (Chunk*& chunk : m_Chunks) {
+        Chunk* const relocatedChunk = m_ChunkAllocator->relocate(chunk, m_ChunkLayout.size);
+        if (relocatedChunk != chunk) {
+            chunk = relocatedChunk;
+            relocatedChunkCount++;
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+        }
+    }
+    return true;
+}
+
 void Combination::addEntity(const Entity& entity, unsigned int& entityIndexInCombination, bool& chunkCountAdded) {
     chunkCountAdded = m_EntityCountInCurrentChunk == m_ChunkLayout.capacity;
     if (chunkCountAdded)
@@ -27,46 +61,103 @@ void Combination::addEntity(const Entity& entity, unsigned int& entityIndexInCom
     Chunk* chunk = m_Chunks.back();
     unsigned int entityIndexInChunk = m_EntityCountInCurrentChunk++;
     memcpy(entityAddress(chunk, entityIndexInChunk), &entity, sizeof(Entity));
+    markChanged(chunk);
     entityIndexInCombination = m_EntityCount++;
 }
 
-void Combination::moveEntityAddingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, const unsigned int& componentId, const void* component, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused) {
+void Combination::addEntities(const Entity* entities, const unsigned int& count, unsigned int& firstEntityIndexInCombination, unsigned int& chunkCountAdded) {
+    reserve(count);
+    firstEntityIndexInCombination = m_EntityCount;
+    chunkCountAdded = 0;
+    for (unsigned int added = 0; added < count;) {
+        if (m_EntityCountInCurrentChunk == m_ChunkLayout.capacity)
+            requestChunk(), chunkCountAdded++;
+        const unsigned int batchCount = std::min(count - added, m_ChunkLayout.capacity - m_EntityCountInCurrentChunk);
+        memcpy(entityAddress(m_Chunks.back(), m_EntityCountInCurrentChunk), entities + added, sizeof(Entity) * batchCount);
+        markChanged(m_Chunks.back());
+        m_EntityCountInCurrentChunk += batchCount;
+        added += batchCount;
+    }
+    m_EntityCount += count;
+}
+
+void Combination::setComponents(const unsigned int& firstEntityIndexInCombination, const unsigned int& count, const unsigned int& componentIndex, const void* components) {
+    const std::size_t& size = m_ChunkLayout.componentSizes[componentIndex];
+    const bool soa = m_ChunkLayout.componentFieldSizes[componentIndex] != size;
+    const std::byte* src = static_cast<const std::byte*>(components);
+    for (unsigned int entityIndex = firstEntityIndexInCombination; entityIndex < firstEntityIndexInCombination + count;) {
+        Chunk* chunk = m_Chunks[entityIndex / m_ChunkLayout.capacity];
+        const unsigned int entityIndexInChunk = entityIndex % m_ChunkLayout.capacity;
+        const unsigned int batchCount = std::min(firstEntityIndexInCombination + count - entityIndex, m_ChunkLayout.capacity - entityIndexInChunk);
+        if (soa)
+            for (unsigned int i = 0; i < batchCount; i++)
+                writeComponent(chunk, componentIndex, entityIndexInChunk + i, src + size * i);
+        else
+            memcpy(componentAddress(chunk, componentIndex, entityIndexInChunk), src, size * batchCount);
+        markChanged(chunk, componentIndex);
+        src += size * batchCount;
+        entityIndex += batchCount;
+    }
+}
+
+void Combination::moveEntityAddingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, const unsigned int& componentIndex, const void* component, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused) {
     const Entity& srcEntity = *srcCombination->entityAddress(entityIndexInSrcCombination);
     addEntity(srcEntity, entityIndexInDstCombination, dstChunkCountAdded);
 
     Chunk* dstChunk = m_Chunks.back();
     unsigned int entityIndexInDstChunk = m_EntityCountInCurrentChunk - 1;
 
-    for (const auto& [id, index] : m_ChunkLayout.componentIndexMap) {
-        if (id == componentId) continue;
-        const std::size_t& size = m_ChunkLayout.componentSizes[index];
-        void* dstAddress = componentAddress(dstChunk, index, entityIndexInDstChunk);
-        void* srcAddress = srcCombination->componentAddress(id, entityIndexInSrcCombination);
-        memcpy(dstAddress, srcAddress, size);
-    }
-
-    setComponent(entityIndexInDstCombination, componentId, component);
+    copyColumns(entityIndexInSrcCombination, srcCombination, columnCopies, dstChunk, entityIndexInDstChunk);
+    // Tags have no column to write
+    if (componentIndex != k_InvalidIndex)
+        writeComponent(dstChunk, componentIndex, entityIndexInDstChunk, component);
 
     srcCombination->removeEntity(entityIndexInSrcCombination, swappedEntity, srcChunkCountMinused);
 }
 
-void Combination::moveEntityRemovingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused) {
+void Combination::moveEntityRemovingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused) {
     const Entity& srcEntity = *srcCombination->entityAddress(entityIndexInSrcCombination);
     addEntity(srcEntity, entityIndexInDstCombination, dstChunkCountAdded);
 
     Chunk* dstChunk = m_Chunks.back();
     unsigned int entityIndexInDstChunk = m_EntityCountInCurrentChunk - 1;
 
-    for (const auto& [id, index] : m_ChunkLayout.componentIndexMap) {
-        const std::size_t& size = m_ChunkLayout.componentSizes[index];
-        void* dstAddress = componentAddress(dstChunk, index, entityIndexInDstChunk);
-        void* srcAddress = srcCombination->componentAddress(id, entityIndexInSrcCombination);
-        memcpy(dstAddress, srcAddress, size);
-    }
+    copyColumns(entityIndexInSrcCombination, srcCombination, columnCopies, dstChunk, entityIndexInDstChunk);
 
     srcCombination->removeEntity(entityIndexInSrcCombination, swappedEntity, srcChunkCountMinused);
 }
 
+void Combination::moveEntities(Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, const bool& relinkable, unsigned int& firstMovedEntityIndexInCombination) {
+    std::vector<Chunk*>& srcChunks = srcCombination->m_Chunks;
+    firstMovedEntityIndexInCombination = m_EntityCount;
+    unsigned int relinkedChunkCount = 0;
+    if (relinkable) {
+        relinkedChunkCount = srcCombination->m_EntityCount / m_ChunkLayout.capacity;
+        // Full source chunks are placed before the current chunk, whose Entities are moved as well
+        Chunk* currentChunk = nullptr;
+        if (relinkedChunkCount != 0 && m_EntityCountInCurrentChunk != m_ChunkLayout.capacity) {
+            currentChunk = m_Chunks.back();
+            m_Chunks.pop_back();
+            firstMovedEntityIndexInCombination = m_Chunks.size() * m_ChunkLayout.capacity;
+        }
+        m_Chunks.insert(m_Chunks.end(), srcChunks.begin(), srcChunks.begin() + relinkedChunkCount);
+        for (unsigned int i = 0; i < relinkedChunkCount; i++)
+            markChanged(srcChunks[i]);
+        if (currentChunk != nullptr)
+            m_Chunks.push_back(currentChunk);
+        m_EntityCount += relinkedChunkCount * m_ChunkLayout.capacity;
+    }
+    for (unsigned int i = relinkedChunkCount; i < srcChunks.size(); i++) {
+        const unsigned int count = i + 1 != srcChunks.size() ? srcCombination->m_ChunkLayout.capacity : srcCombination->m_EntityCountInCurrentChunk;
+        appendEntities(srcChunks[i], count, srcCombination, columnCopies);
+        memset(srcChunks[i], 0, srcCombination->m_ChunkLayout.size);
+        m_ChunkAllocator->recycle(srcChunks[i], srcCombination->m_ChunkLayout.size);
+    }
+    srcChunks.clear();
+    srcCombination->m_EntityCount = 0;
+    srcCombination->m_EntityCountInCurrentChunk = srcCombination->m_ChunkLayout.capacity;
+}
+
 void Combination::removeEntity(const unsigned int& entityIndexInCombination, Entity& swappedEntity, bool& chunkCountMinused) {
     Chunk* dstChunk = m_Chunks[entityIndexInCombination / m_ChunkLayout.capacity];
     const unsigned int dstEntityIndexInChunk = entityIndexInCombination % m_ChunkLayout.capacity;
@@ -74,13 +165,22 @@ void Combination::removeEntity(const unsigned int& entityIndexInCombination, Ent
     Chunk* srcChunk = m_Chunks.back();
     const unsigned int srcEntityIndexInChunk = m_EntityCountInCurrentChunk - 1;
 
-    for (const auto& [id, index] : m_ChunkLayout.componentIndexMap) {
-        const std::size_t& size = m_ChunkLayout.componentSizes[index];
-        void* dstAddress = componentAddress(dstChunk, index, dstEntityIndexInChunk);
-        void* srcAddress = componentAddress(srcChunk, index, srcEntityIndexInChunk);
-        if (dstChunk != srcChunk || dstEntityIndexInChunk != srcEntityIndexInChunk)
-            memcpy(dstAddress, srcAddress, size);
-        memset(srcAddress, 0, size);
+    for (unsigned int index = 0; index < m_ChunkLayout.componentSizes.size(); index++) {
+        const std::size_t& fieldSize = m_ChunkLayout.componentFieldSizes[index];
+        std::byte* dstAddress = static_cast<std::byte*>(componentAddress(dstChunk, index, dstEntityIndexInChunk));
+        std::byte* srcAddress = static_cast<std::byte*>(componentAddress(srcChunk, index, srcEntityIndexInChunk));
+        for (std::size_t offset = 0; offset < m_ChunkLayout.componentSizes[index]; offset += fieldSize) {
+            if (dstChunk != srcChunk || dstEntityIndexInChunk != srcEntityIndexInChunk)
+                memcpy(dstAddress, srcAddress, fieldSize);
+            memset(srcAddress, 0, fieldSize);
+            dstAddress += fieldSize * m_ChunkLayout.capacity;
+            srcAddress += fieldSize * m_ChunkLayout.capacity;
+        }
+        const std::size_t& disabledMaskOffset = m_ChunkLayout.disabledMaskOffsets[index];
+        if (disabledMaskOffset != ChunkLayout::k_InvalidOffset) {
+            setDisabled(dstChunk, disabledMaskOffset, dstEntityIndexInChunk, disabled(srcChunk, disabledMaskOffset, srcEntityIndexInChunk));
+            setDisabled(srcChunk, disabledMaskOffset, srcEntityIndexInChunk, false);
+        }
     }
 
     void* dstEntityAddress = static_cast<void*>(entityAddress(dstChunk, dstEntityIndexInChunk));
@@ -89,6 +189,8 @@ void Combination::removeEntity(const unsigned int& entityIndexInCombination, Ent
         memcpy(dstEntityAddress, srcEntityAddress, sizeof(Entity));
     memset(srcEntityAddress, 0, sizeof(Entity));
 
+    markChanged(dstChunk);
+
     m_EntityCountInCurrentChunk--;
     m_EntityCount--;
 
@@ -101,24 +203,87 @@ void Combination::removeEntity(const unsigned int& entityIndexInCombination, Ent
         swappedEntity = Entity::invalidEntity();
 }
 
+void Combination::removeEntities() {
+    for (Chunk* chunk : m_Chunks) {
+        memset(chunk, 0, m_ChunkLayout.size);
+        m_ChunkAllocator->recycle(chunk, m_ChunkLayout.size);
+    }
+    m_Chunks.clear();
+    m_EntityCount = 0;
+    m_EntityCountInCurrentChunk = m_ChunkLayout.capacity;
+}
+
+void Combination::fillComponent(const unsigned int& firstEntityIndexInCombination, const unsigned int& componentIndex, const void* component) {
+    // Filled components are enabled as well, as if they were just added
+    const std::size_t disabledMaskOffset = m_ChunkLayout.disabledMaskOffsets[componentIndex];
+    for (unsigned int entityIndex = firstEntityIndexInCombination; entityIndex < m_EntityCount; entityIndex++) {
+        writeComponent(m_Chunks[entityIndex / m_ChunkLayout.capacity], componentIndex, entityIndex % m_ChunkLayout.capacity, component);
+        if (disabledMaskOffset != ChunkLayout::k_InvalidOffset)
+            setDisabled(m_Chunks[entityIndex / m_ChunkLayout.capacity], disabledMaskOffset, entityIndex % m_ChunkLayout.capacity, false);
+    }
+    for (unsigned int chunkIndex = firstEntityIndexInCombination / m_ChunkLayout.capacity; chunkIndex < m_Chunks.size(); chunkIndex++)
+        markChanged(m_Chunks[chunkIndex], componentIndex);
+}
+
 void Combination::setComponent(const unsigned int& entityIndexInCombination, const unsigned int& componentId, const void* component) {
     Chunk* chunk = m_Chunks[entityIndexInCombination / m_ChunkLayout.capacity];
     const unsigned int entityIndexInChunk = entityIndexInCombination % m_ChunkLayout.capacity;
     const unsigned int componentIndex = m_ChunkLayout.componentIndexMap.at(componentId);
-    void* address = componentAddress(chunk, componentIndex, entityIndexInChunk);
+    writeComponent(chunk, componentIndex, entityIndexInChunk, component);
+    markChanged(chunk, componentIndex);
+}
 
-    memcpy(address, component, m_ChunkLayout.componentSizes[componentIndex]);
+void Combination::appendEntities(const Chunk* srcChunk, const unsigned int& count, const Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies) {
+    const std::byte* src = reinterpret_cast<const std::byte*>(srcChunk);
+    for (unsigned int appended = 0; appended < count;) {
+        if (m_EntityCountInCurrentChunk == m_ChunkLayout.capacity)
+            requestChunk();
+        std::byte* dst = reinterpret_cast<std::byte*>(m_Chunks.back());
+        const unsigned int batchCount = std::min(count - appended, m_ChunkLayout.capacity - m_EntityCountInCurrentChunk);
+        memcpy(dst + m_ChunkLayout.entityOffset + sizeof(Entity) * m_EntityCountInCurrentChunk, src + srcCombination->m_ChunkLayout.entityOffset + sizeof(Entity) * appended, sizeof(Entity) * batchCount);
+        for (const ChunkLayout::ColumnCopy& columnCopy : columnCopies) {
+            memcpy(dst + columnCopy.dstOffset + columnCopy.size * m_EntityCountInCurrentChunk, src + columnCopy.srcOffset + columnCopy.size * appended, columnCopy.size * batchCount);
+            if (columnCopy.srcDisabledMaskOffset != ChunkLayout::k_InvalidOffset && columnCopy.dstDisabledMaskOffset != ChunkLayout::k_InvalidOffset)
+                for (unsigned int i = 0; i < batchCount; i++)
+                    setDisabled(m_Chunks.back(), columnCopy.dstDisabledMaskOffset, m_EntityCountInCurrentChunk + i, disabled(srcChunk, columnCopy.srcDisabledMaskOffset, appended + i));
+        }
+        markChanged(m_Chunks.back());
+        m_EntityCountInCurrentChunk += batchCount;
+        appended += batchCount;
+    }
+    m_EntityCount += count;
+}
+
+void Combination::setComponentEnabled(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex, const bool& enabled) {
+    Chunk* chunk = m_Chunks[entityIndexInCombination / m_ChunkLayout.capacity];
+    setDisabled(chunk, m_ChunkLayout.disabledMaskOffsets[componentIndex], entityIndexInCombination % m_ChunkLayout.capacity, !enabled);
+    markChanged(chunk, componentIndex);
+}
+
+void Combination::copyColumns(const unsigned int& entityIndexInSrcCombination, const Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, Chunk* dstChunk, const unsigned int& entityIndexInDstChunk) const {
+    const Chunk* srcChunk = srcCombination->m_Chunks[entityIndexInSrcCombination / srcCombination->m_ChunkLayout.capacity];
+    const unsigned int entityIndexInSrcChunk = entityIndexInSrcCombination % srcCombination->m_ChunkLayout.capacity;
+    for (const ChunkLayout::ColumnCopy& columnCopy : columnCopies) {
+        memcpy(reinterpret_cast<std::byte*>(dstChunk) + columnCopy.dstOffset + columnCopy.size * entityIndexInDstChunk, reinterpret_cast<const std::byte*>(srcChunk) + columnCopy.srcOffset + columnCopy.size * entityIndexInSrcChunk, columnCopy.size);
+        if (columnCopy.srcDisabledMaskOffset != ChunkLayout::k_InvalidOffset && columnCopy.dstDisabledMaskOffset != ChunkLayout::k_InvalidOffset)
+            setDisabled(dstChunk, columnCopy.dstDisabledMaskOffset, entityIndexInDstChunk, disabled(srcChunk, columnCopy.srcDisabledMaskOffset, entityIndexInSrcChunk));
+    }
 }
 
 void Combination::requestChunk() {
-    m_Chunks.emplace_back(m_ChunkPool->request());
+    if (m_SpareChunks.empty())
+        m_Chunks.emplace_back(m_ChunkAllocator->request(m_ChunkLayout.size));
+    else
+        m_Chunks.emplace_back(m_SpareChunks.back()), m_SpareChunks.pop_back();
     m_EntityCountInCurrentChunk = 0;
 }
 
 void Combination::recycleChunk() {
     Chunk* chunk = m_Chunks.back();
     m_Chunks.pop_back();
-    m_ChunkPool->recycle(chunk);
+    // Disabled masks and versions are cleared as well since chunks are expected to be zeroed in the ChunkAllocator
+    memset(reinterpret_cast<std::byte*>(chunk) + m_ChunkLayout.disabledMaskOffset, 0, m_ChunkLayout.size - m_ChunkLayout.disabledMaskOffset);
+    m_ChunkAllocator->recycle(chunk, m_ChunkLayout.size);
     m_EntityCountInCurrentChunk = m_ChunkLayout.capacity;
 }
 
@@ -3,13 +3,19 @@
 #include <MelonCore/ArchetypeMask.h>
 #include <MelonCore/Chunk.h>
 #include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ChunkAllocator.h>
 #include <MelonCore/Entity.h>
-#include <MelonCore/ObjectPool.h>
 #include <MelonCore/ObjectStore.h>
+#include <MelonCore/SystemVersion.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 #include <vector>
 
@@ -20,18 +26,45 @@ class Combination {
     static constexpr unsigned int k_InvalidIndex = std::numeric_limits<unsigned int>::max();
     static constexpr unsigned int k_InvalidEntityIndex = std::numeric_limits<unsigned int>::max();
 
-    Combination(const unsigned int& index, const ChunkLayout& chunkLayout, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ObjectPool<Chunk>* chunkPool);
+    Combination(const unsigned int& index, const ChunkLayout& chunkLayout, std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices, ChunkAllocator* chunkAllocator, const unsigned int& playbackSystemVersion);
     Combination(const Combination&) = delete;
+    ~Combination();
+
+    // Request chunks in advance so that entityCount more Entities can be added without touching the ChunkAllocator
+    void reserve(const unsigned int& entityCount);
+    // Recycle spare chunks and let the ChunkAllocator relocate chunks out of sparse slabs, Entity indices are kept
+    // Returns false if stopped by the deadline, calling again resumes since relocated chunks stay
+    bool compact(const std::chrono::steady_clock::time_point& deadline, unsigned int& freedChunkCount, unsigned int& relocatedChunkCount);
 
     void addEntity(const Entity& entity, unsigned int& entityIndexInCombination, bool& chunkCountAdded);
-    // Move an Entity when adding one component
-    void moveEntityAddingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, const unsigned int& componentId, const void* component, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused);
+    // Add Entities contiguously, components are left zeroed
+    void addEntities(const Entity* entities, const unsigned int& count, unsigned int& firstEntityIndexInCombination, unsigned int& chunkCountAdded);
+    // Copy count components of one column, starting from firstEntityIndexInCombination
+    void setComponents(const unsigned int& firstEntityIndexInCombination, const unsigned int& count, const unsigned int& componentIndex, const void* components);
+    // Move an Entity when adding one component, which is placed at componentIndex of this Combination
+    void moveEntityAddingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, const unsigned int& componentIndex, const void* component, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused);
     // Move an Entity when removing zero or more components
-    void moveEntityRemovingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused);
+    void moveEntityRemovingComponent(const unsigned int& entityIndexInSrcCombination, Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, unsigned int& entityIndexInDstCombination, bool& dstChunkCountAdded, Entity& swappedEntity, bool& srcChunkCountMinused);
+    // Move all Entities of srcCombination to the end of this Combination, full chunks are relinked instead of copied if relinkable
+    void moveEntities(Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, const bool& relinkable, unsigned int& firstMovedEntityIndexInCombination);
     void removeEntity(const unsigned int& entityIndexInCombination, Entity& swappedEntity, bool& chunkCountMinused);
+    // Remove all Entities, chunks are cleared and recycled
+    void removeEntities();
+    // Set one component for every Entity starting from firstEntityIndexInCombination
+    void fillComponent(const unsigned int& firstEntityIndexInCombination, const unsigned int& componentIndex, const void* component);
     void setComponent(const unsigned int& entityIndexInCombination, const unsigned int& componentId, const void* component);
-
-    void filterEntities(ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const;
+    void setComponentEnabled(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex, const bool& enabled);
+    // Random access to a component by its column, whose chunk is marked changed with globalSystemVersion if written
+    // SoA components are located by their first field
+    void* locateComponent(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex, const bool& written, const unsigned int& globalSystemVersion) const;
+    // The global system version when the component of the chunk holding the Entity is last written
+    unsigned int locateComponentVersion(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex) const;
+
+    // Chunks are skipped unless one of changedComponentIndices is written after lastSystemVersion, if any
+    // Components written through the ChunkAccessors are marked with globalSystemVersion
+    void filterEntities(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion, std::vector<std::size_t> const& disabledMaskOffsets, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const;
+    unsigned int chunkCount(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const;
+    unsigned int entityCount(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const;
 
     bool empty() const { return m_EntityCount == 0; }
     unsigned int chunkCount() const { return m_Chunks.size(); }
@@ -41,15 +74,31 @@ class Combination {
 
     const std::vector<unsigned int>& sharedComponentIndices() const { return m_SharedComponentIndices; }
     const unsigned int& entityCount() const { return m_EntityCount; }
+    const Entity& entity(const unsigned int& entityIndexInCombination) const { return *entityAddress(entityIndexInCombination); }
 
   private:
     void requestChunk();
     void recycleChunk();
 
+    // Append count Entities of a chunk from srcCombination
+    void appendEntities(const Chunk* srcChunk, const unsigned int& count, const Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies);
+    void copyColumns(const unsigned int& entityIndexInSrcCombination, const Combination* srcCombination, std::vector<ChunkLayout::ColumnCopy> const& columnCopies, Chunk* dstChunk, const unsigned int& entityIndexInDstChunk) const;
+
+    bool changed(Chunk* chunk, std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const;
+    // Stamp all components of the chunk with the global system version
+    void markChanged(Chunk* chunk) const;
+    void markChanged(Chunk* chunk, const unsigned int& componentIndex) const;
+
+    unsigned int* versionAddress(Chunk* chunk) const;
+    static bool disabled(const Chunk* chunk, const std::size_t& disabledMaskOffset, const unsigned int& entityIndexInChunk);
+    static void setDisabled(Chunk* chunk, const std::size_t& disabledMaskOffset, const unsigned int& entityIndexInChunk, const bool& disabled);
     Entity* entityAddress(const unsigned int& entityIndex) const;
     Entity* entityAddress(Chunk* chunk, const unsigned int& entityIndexInChunk) const;
     void* componentAddress(const unsigned int& componentId, const unsigned int& entityIndex) const;
+    // Address of the first field for SoA components
     void* componentAddress(Chunk* chunk, const unsigned int& componentIndex, const unsigned int& entityIndexInChunk) const;
+    // Scatter the fields of SoA components, or copy the whole component otherwise
+    void writeComponent(Chunk* chunk, const unsigned int& componentIndex, const unsigned int& entityIndexInChunk, const void* component) const;
 
     const unsigned int m_Index;
 
@@ -58,17 +107,89 @@ class Combination {
     std::vector<unsigned int> const& m_SharedComponentIds;
     std::vector<unsigned int> const m_SharedComponentIndices;
 
-    ObjectPool<Chunk>* m_ChunkPool;
+    ChunkAllocator* m_ChunkAllocator;
+    // Marks chunks changed by the playback of EntityCommandBuffers
+    const unsigned int& m_PlaybackSystemVersion;
     std::vector<Chunk*> m_Chunks;
+    // Reserved chunks which are not used yet
+    std::vector<Chunk*> m_SpareChunks;
 
     unsigned int m_EntityCount{};
     unsigned int m_EntityCountInCurrentChunk{};
 };
 
-inline void Combination::filterEntities(ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const {
+inline void Combination::filterEntities(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion, std::vector<std::size_t> const& disabledMaskOffsets, ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> const& sharedComponentStore, std::vector<ChunkAccessor>& chunkAccessors) const {
     chunkAccessors.reserve(chunkAccessors.size() + chunkCount());
     for (Chunk* chunk : m_Chunks)
-        chunkAccessors.emplace_back(ChunkAccessor{reinterpret_cast<std::byte*>(chunk), m_ChunkLayout, chunk != m_Chunks.back() ? m_ChunkLayout.capacity : m_EntityCountInCurrentChunk, m_SharedComponentIds, m_SharedComponentIndices, sharedComponentStore});
+        if (changed(chunk, changedComponentIndices, lastSystemVersion))
+            chunkAccessors.emplace_back(ChunkAccessor{reinterpret_cast<std::byte*>(chunk), m_ChunkLayout, chunk != m_Chunks.back() ? m_ChunkLayout.capacity : m_EntityCountInCurrentChunk, m_SharedComponentIds, m_SharedComponentIndices, sharedComponentStore, globalSystemVersion, disabledMaskOffsets});
+}
+
+inline unsigned int Combination::chunkCount(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const {
+    if (changedComponentIndices.empty()) return chunkCount();
+    unsigned int count = 0;
+    for (Chunk* chunk : m_Chunks)
+        if (changed(chunk, changedComponentIndices, lastSystemVersion))
+            count++;
+    return count;
+}
+
+inline unsigned int Combination::entityCount(std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const {
+    if (changedComponentIndices.empty()) return m_EntityCount;
+    unsigned int count = 0;
+    for (Chunk* chunk : m_Chunks)
+        if (changed(chunk, changedComponentIndices, lastSystemVersion))
+            count += chunk != m_Chunks.back() ? m_ChunkLayout.capacity : m_EntityCountInCurrentChunk;
+    return count;
+}
+
+inline void* Combination::locateComponent(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex, const bool& written, const unsigned int& globalSystemVersion) const {
+    Chunk* chunk = m_Chunks[entityIndexInCombination / m_ChunkLayout.capacity];
+    // Lookups from different tasks may mark the same chunk at once
+    if (written)
+        std::atomic_ref<unsigned int>(versionAddress(chunk)[componentIndex]).store(globalSystemVersion, std::memory_order_relaxed);
+    return componentAddress(chunk, componentIndex, entityIndexInCombination % m_ChunkLayout.capacity);
+}
+
+inline unsigned int Combination::locateComponentVersion(const unsigned int& entityIndexInCombination, const unsigned int& componentIndex) const {
+    Chunk* chunk = m_Chunks[entityIndexInCombination / m_ChunkLayout.capacity];
+    // Versions may be marked by lookups from other tasks at the same time
+    return std::atomic_ref<unsigned int>(versionAddress(chunk)[componentIndex]).load(std::memory_order_relaxed);
+}
+
+inline bool Combination::changed(Chunk* chunk, std::vector<unsigned int> const& changedComponentIndices, const unsigned int& lastSystemVersion) const {
+    if (changedComponentIndices.empty()) return true;
+    const unsigned int* versions = versionAddress(chunk);
+    for (const unsigned int& componentIndex : changedComponentIndices)
+        if (versionNewer(versions[componentIndex], lastSystemVersion))
+            return true;
+    return false;
+}
+
+inline void Combination::markChanged(Chunk* chunk) const {
+    std::fill_n(versionAddress(chunk), m_ChunkLayout.componentSizes.size(), m_PlaybackSystemVersion);
+}
+
+inline void Combination::markChanged(Chunk* chunk, const unsigned int& componentIndex) const {
+    versionAddress(chunk)[componentIndex] = m_PlaybackSystemVersion;
+}
+
+inline unsigned int* Combination::versionAddress(Chunk* chunk) const {
+    return reinterpret_cast<unsigned int*>(reinterpret_cast<std::byte*>(chunk) + m_ChunkLayout.versionOffset);
+}
+
+inline bool Combination::disabled(const Chunk* chunk, const std::size_t& disabledMaskOffset, const unsigned int& entityIndexInChunk) {
+    const std::uint64_t* disabledMask = reinterpret_cast<const std::uint64_t*>(reinterpret_cast<const std::byte*>(chunk) + disabledMaskOffset);
+    return disabledMask[entityIndexInChunk / 64] >> (entityIndexInChunk % 64) & 1;
+}
+
+inline void Combination::setDisabled(Chunk* chunk, const std::size_t& disabledMaskOffset, const unsigned int& entityIndexInChunk, const bool& disabled) {
+    std::uint64_t* disabledMask = reinterpret_cast<std::uint64_t*>(reinterpret_cast<std::byte*>(chunk) + disabledMaskOffset);
+    const std::uint64_t bit = std::uint64_t{1} << (entityIndexInChunk % 64);
+    if (disabled)
+        disabledMask[entityIndexInChunk / 64] |= bit;
+    else
+        disabledMask[entityIndexInChunk / 64] &= ~bit;
 }
 
 inline Entity* Combination::entityAddress(const unsigned int& entityIndex) const {
@@ -89,7 +210,15 @@ inline void* Combination::componentAddress(const unsigned int& componentId, cons
 }
 
 inline void* Combination::componentAddress(Chunk* chunk, const unsigned int& componentIndex, const unsigned int& entityIndexInChunk) const {
-    return static_cast<void*>(reinterpret_cast<std::byte*>(chunk) + m_ChunkLayout.componentOffsets[componentIndex] + m_ChunkLayout.componentSizes[componentIndex] * entityIndexInChunk);
+    return static_cast<void*>(reinterpret_cast<std::byte*>(chunk) + m_ChunkLayout.componentOffsets[componentIndex] + m_ChunkLayout.componentFieldSizes[componentIndex] * entityIndexInChunk);
+}
+
+inline void Combination::writeComponent(Chunk* chunk, const unsigned int& componentIndex, const unsigned int& entityIndexInChunk, const void* component) const {
+    const std::size_t& size = m_ChunkLayout.componentSizes[componentIndex];
+    const std::size_t& fieldSize = m_ChunkLayout.componentFieldSizes[componentIndex];
+    std::byte* address = static_cast<std::byte*>(componentAddress(chunk, componentIndex, entityIndexInChunk));
+    for (std::size_t offset = 0; offset < size; offset += fieldSize, address += fieldSize * m_ChunkLayout.capacity)
+        memcpy(address, static_cast<const std::byte*>(component) + offset, fieldSize);
 }
 
 }  // namespace Melon
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <MelonCore/ArchetypeMask.h>
+#include <MelonCore/DataComponent.h>
+#include <MelonCore/EntityManager.h>
+#include <MelonCore/SharedComponent.h>
+#include <MelonCore/SingletonComponent.h>
+
+#include <bitset>
+#include <tuple>
+#include <type_traits>
+
+namespace Melon {
+
+// Components read or written by tasks, which orders them after earlier tasks writing what they read or accessing what they write
+// SharedComponents are only changed by EntityCommandBuffers, so reading them never orders tasks
+struct ComponentAccess {
+    using SingletonComponentMask = std::bitset<EntityManager::k_MaxSingletonComponentIdCount>;
+
+    ComponentAccess& operator|=(const ComponentAccess& other) {
+        readComponentMask |= other.readComponentMask;
+        writtenComponentMask |= other.writtenComponentMask;
+        readSharedComponentMask |= other.readSharedComponentMask;
+        readSingletonComponentMask |= other.readSingletonComponentMask;
+        writtenSingletonComponentMask |= other.writtenSingletonComponentMask;
+        return *this;
+    }
+
+    // Written components are readable as well
+    bool readable(const unsigned int& componentId) const { return readComponentMask.test(componentId) || writtenComponentMask.test(componentId); }
+    bool writable(const unsigned int& componentId) const { return writtenComponentMask.test(componentId); }
+
+    ArchetypeMask::ComponentMask readComponentMask;
+    ArchetypeMask::ComponentMask writtenComponentMask;
+    ArchetypeMask::SharedComponentMask readSharedComponentMask;
+    SingletonComponentMask readSingletonComponentMask;
+    SingletonComponentMask writtenSingletonComponentMask;
+};
+
+class ComponentAccessBuilder {
+  public:
+    template <typename... Types>
+    ComponentAccessBuilder& readComponents();
+    template <typename... Types>
+    ComponentAccessBuilder& writeComponents();
+    template <typename... Types>
+    ComponentAccessBuilder& readSharedComponents();
+    template <typename... Types>
+    ComponentAccessBuilder& readSingletonComponents();
+    template <typename... Types>
+    ComponentAccessBuilder& writeSingletonComponents();
+
+    ComponentAccess createComponentAccess() { return m_ComponentAccess; }
+
+  private:
+    ComponentAccessBuilder(EntityManager* entityManager) : m_EntityManager(entityManager) {}
+    ComponentAccess m_ComponentAccess;
+    EntityManager* m_EntityManager;
+
+    friend class SystemBase;
+};
+
+template <typename... Types>
+ComponentAccessBuilder& ComponentAccessBuilder::readComponents() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<DataComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<DataComponent, Types>>..., std::true_type>>);
+    (m_ComponentAccess.readComponentMask.set(m_EntityManager->componentId<Types>()), ...);
+    return *this;
+}
+
+template <typename... Types>
+ComponentAccessBuilder& ComponentAccessBuilder::writeComponents() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<DataComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<DataComponent, Types>>..., std::true_type>>);
+    (m_ComponentAccess.writtenComponentMask.set(m_EntityManager->componentId<Types>()), ...);
+    return *this;
+}
+
+template <typename... Types>
+ComponentAccessBuilder& ComponentAccessBuilder::readSharedComponents() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<SharedComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<SharedComponent, Types>>..., std::true_type>>);
+    (m_ComponentAccess.readSharedComponentMask.set(m_EntityManager->sharedComponentId<Types>()), ...);
+    return *this;
+}
+
+template <typename... Types>
+ComponentAccessBuilder& ComponentAccessBuilder::readSingletonComponents() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<SingletonComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<SingletonComponent, Types>>..., std::true_type>>);
+    (m_ComponentAccess.readSingletonComponentMask.set(m_EntityManager->singletonComponentId<Types>()), ...);
+    return *this;
+}
+
+template <typename... Types>
+ComponentAccessBuilder& ComponentAccessBuilder::writeSingletonComponents() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<SingletonComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<SingletonComponent, Types>>..., std::true_type>>);
+    (m_ComponentAccess.writtenSingletonComponentMask.set(m_EntityManager->singletonComponentId<Types>()), ...);
+    return *this;
+}
+
+}  // namespace Melon
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace Melon {
+
+// Proxy to one SoA component, whose fields lie fieldStride bytes apart
+// Reads gather the fields into a value and writes scatter them back, no write is allowed if Type is const
+template <typename Type>
+class FieldReference {
+  public:
+    using Value = std::remove_const_t<Type>;
+    static constexpr unsigned int k_FieldCount = sizeof(Value) / k_SoAFieldSize;
+
+    FieldReference(const FieldReference&) = default;
+
+    // Null for a component not found by lookups
+    explicit operator bool() const { return m_Field != nullptr; }
+
+    Value load() const;
+    void store(const Value& value) const;
+    operator Value() const { return load(); }
+    const FieldReference& operator=(const Value& value) const;
+    // Assigns the referenced value instead of rebinding
+    const FieldReference& operator=(const FieldReference& other) const;
+
+    template <typename Scalar = float>
+    std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>& field(const unsigned int& fieldIndex) const;
+
+  private:
+    FieldReference(std::byte* field, const std::size_t& fieldStride) : m_Field(field), m_FieldStride(fieldStride) {}
+
+    std::byte* m_Field;
+    std::size_t m_FieldStride;
+
+    template <typename>
+    friend class ComponentFields;
+    template <typename>
+    friend class ComponentLookup;
+    friend class EntityManager;
+};
+
+// Columns of one SoA component in a chunk, field i of the Entity j is field(i)[j]
+template <typename Type>
+class ComponentFields {
+  public:
+    static constexpr unsigned int k_FieldCount = FieldReference<Type>::k_FieldCount;
+
+    template <typename Scalar = float>
+    std::span<std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>> field(const unsigned int& fieldIndex) const;
+    FieldReference<Type> operator[](const unsigned int& entityIndex) const { return FieldReference<Type>(m_Fields + k_SoAFieldSize * entityIndex, m_FieldStride); }
+
+    const unsigned int& entityCount() const { return m_EntityCount; }
+
+  private:
+    ComponentFields(std::byte* fields, const std::size_t& fieldStride, const unsigned int& entityCount) : m_Fields(fields), m_FieldStride(fieldStride), m_EntityCount(entityCount) {}
+
+    std::byte* m_Fields;
+    std::size_t m_FieldStride;
+    unsigned int m_EntityCount;
+
+    friend class ChunkAccessor;
+};
+
+template <typename Type>
+inline typename FieldReference<Type>::Value FieldReference<Type>::load() const {
+    Value value;
+    for (unsigned int i = 0; i < k_FieldCount; i++)
+        memcpy(reinterpret_cast<std::byte*>(&value) + k_SoAFieldSize * i, m_Field + m_FieldStride * i, k_SoAFieldSize);
+    return value;
+}
+
+template <typename Type>
+inline void FieldReference<Type>::store(const Value& value) const {
+    static_assert(!std::is_const_v<Type>, "Fields of const components are read only");
+    for (unsigned int i = 0; i < k_FieldCount; i++)
+        memcpy(m_Field + m_FieldStride * i, reinterpret_cast<const std::byte*>(&value) + k_SoAFieldSize * i, k_SoAFieldSize);
+}
+
+template <typename Type>
+inline const FieldReference<Type>& FieldReference<Type>::operator=(const Value& value) const {
+    store(value);
+    return *this;
+}
+
+template <typename Type>
+inline const FieldReference<Type>& FieldReference<Type>::operator=(const FieldReference& other) const {
+    store(other.load());
+    return *this;
+}
+
+template <typename Type>
+template <typename Scalar>
+inline std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>& FieldReference<Type>::field(const unsigned int& fieldIndex) const {
+    static_assert(sizeof(Scalar) == k_SoAFieldSize);
+    return *reinterpret_cast<std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>*>(m_Field + m_FieldStride * fieldIndex);
+}
+
+template <typename Type>
+template <typename Scalar>
+inline std::span<std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>> ComponentFields<Type>::field(const unsigned int& fieldIndex) const {
+    static_assert(sizeof(Scalar) == k_SoAFieldSize);
+    return {reinterpret_cast<std::conditional_t<std::is_const_v<Type>, const Scalar, Scalar>*>(m_Fields + m_FieldStride * fieldIndex), m_EntityCount};
+}
+
+}  // namespace Melon
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <MelonCore/ComponentFields.h>
+#include <MelonCore/DataComponent.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityManager.h>
+
+#include <type_traits>
+
+namespace Melon {
+
+// Random access from tasks to components of any Entity, resolved through the EntityLocationTable without locking
+// Concurrent lookups are safe since locations and chunks only change when no task runs, as EntityCommandBuffers are executed after all tasks and compaction waits for them
+// Components are marked changed unless Type is const, and should not be written where other tasks access them at the same time
+// SoA components are handed out as FieldReferences instead of pointers and references
+template <typename Type>
+class ComponentLookup {
+  public:
+    using Pointer = std::conditional_t<k_SoAComponent<Type>, FieldReference<Type>, Type*>;
+    using Reference = std::conditional_t<k_SoAComponent<Type>, FieldReference<Type>, Type&>;
+
+    // Null if the Entity is destroyed or lacks the component
+    Pointer tryComponent(const Entity& entity) const;
+    // The Entity should be alive and have the component
+    Reference operator[](const Entity& entity) const;
+    bool hasComponent(const Entity& entity) const { return m_EntityManager->componentAddress(entity, m_ComponentId, false, m_GlobalSystemVersion) != nullptr; }
+    // Whether the component is written after lastSystemVersion, tracked per chunk as for changed components of EntityFilter
+    bool changed(const Entity& entity, const unsigned int& lastSystemVersion) const { return m_EntityManager->componentChanged(entity, m_ComponentId, lastSystemVersion); }
+
+  private:
+    ComponentLookup(const EntityManager* entityManager, const unsigned int& componentId, const unsigned int& globalSystemVersion) : m_EntityManager(entityManager), m_ComponentId(componentId), m_GlobalSystemVersion(globalSystemVersion) {}
+
+    const EntityManager* m_EntityManager;
+    unsigned int m_ComponentId;
+    // The global system version of the system update creating the lookup, which marks written chunks
+    unsigned int m_GlobalSystemVersion;
+
+    friend class SystemBase;
+};
+
+template <typename Type>
+typename ComponentLookup<Type>::Pointer ComponentLookup<Type>::tryComponent(const Entity& entity) const {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<std::remove_const_t<Type>>, "Tag components have no value to look up");
+    std::size_t fieldStride{};
+    void* address = m_EntityManager->componentAddress(entity, m_ComponentId, !std::is_const_v<Type>, m_GlobalSystemVersion, fieldStride);
+    if constexpr (k_SoAComponent<Type>)
+        return FieldReference<Type>(static_cast<std::byte*>(address), fieldStride);
+    else
+        return static_cast<Type*>(address);
+}
+
+template <typename Type>
+typename ComponentLookup<Type>::Reference ComponentLookup<Type>::operator[](const Entity& entity) const {
+    if constexpr (k_SoAComponent<Type>)
+        return tryComponent(entity);
+    else
+        return *tryComponent(entity);
+}
+
+}  // namespace Melon
@@ -1,9 +1,30 @@
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+
 namespace Melon {
 
 struct DataComponent {};
 
 struct ManualDataComponent : public DataComponent {};
 
+// Could be disabled per Entity with a bit flip instead of being removed
+struct EnableableDataComponent : public DataComponent {};
+
+// Stored with each 4-byte scalar field in a column of its own, such as x, y and z of a glm::vec3, so that tasks loop over plain float arrays
+// Chunks are accessed through ChunkAccessor::componentFields() instead of componentArray(), random access goes through FieldReference
+struct SoADataComponent : public DataComponent {};
+
+// Empty DataComponents are tags stored as Archetype mask bits only, without a column in Chunks
+// Enableable ones keep their column since the disabled mask is laid out per column
+template <typename Type>
+inline constexpr bool k_TagComponent = std::is_empty_v<Type> && !std::is_base_of_v<EnableableDataComponent, Type>;
+
+template <typename Type>
+inline constexpr bool k_SoAComponent = std::is_base_of_v<SoADataComponent, std::remove_const_t<Type>> && !k_TagComponent<std::remove_const_t<Type>>;
+
+// Size of each field of SoA components
+inline constexpr std::size_t k_SoAFieldSize = 4;
+
 }  // namespace Melon
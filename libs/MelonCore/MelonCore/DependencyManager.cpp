@@ -0,0 +1,92 @@
+#include <MelonCore/DependencyManager.h>
+
+#include <algorithm>
+
+namespace Melon {
+
+DependencyManager::DependencyManager() : m_ComponentDependencies(ArchetypeMask::k_MaxComponentIdCount), m_SingletonComponentDependencies(EntityManager::k_MaxSingletonComponentIdCount) {}
+
+std::vector<std::shared_ptr<TaskHandle>> DependencyManager::dependencies(const ComponentAccess& componentAccess) const {
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles;
+    if (m_Barrier)
+        taskHandles.push_back(m_Barrier);
+    for (unsigned int componentId = 0; componentId < m_ComponentDependencies.size(); componentId++)
+        if (componentAccess.readable(componentId))
+            collect(m_ComponentDependencies[componentId], componentAccess.writable(componentId), taskHandles);
+    for (unsigned int singletonComponentId = 0; singletonComponentId < m_SingletonComponentDependencies.size(); singletonComponentId++)
+        if (componentAccess.readSingletonComponentMask.test(singletonComponentId) || componentAccess.writtenSingletonComponentMask.test(singletonComponentId))
+            collect(m_SingletonComponentDependencies[singletonComponentId], componentAccess.writtenSingletonComponentMask.test(singletonComponentId), taskHandles);
+    return taskHandles;
+}
+
+std::vector<std::shared_ptr<TaskHandle>> DependencyManager::dependencies(const unsigned int& componentId, const bool& written) const {
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles;
+    if (m_Barrier)
+        taskHandles.push_back(m_Barrier);
+    collect(m_ComponentDependencies[componentId], written, taskHandles);
+    return taskHandles;
+}
+
+void DependencyManager::record(const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& taskHandle) {
+    for (unsigned int componentId = 0; componentId < m_ComponentDependencies.size(); componentId++)
+        if (componentAccess.readable(componentId))
+            record(m_ComponentDependencies[componentId], componentAccess.writable(componentId), taskHandle);
+    for (unsigned int singletonComponentId = 0; singletonComponentId < m_SingletonComponentDependencies.size(); singletonComponentId++)
+        if (componentAccess.readSingletonComponentMask.test(singletonComponentId) || componentAccess.writtenSingletonComponentMask.test(singletonComponentId))
+            record(m_SingletonComponentDependencies[singletonComponentId], componentAccess.writtenSingletonComponentMask.test(singletonComponentId), taskHandle);
+    m_TaskHandles.push_back(taskHandle);
+}
+
+std::vector<std::shared_ptr<TaskHandle>> DependencyManager::exclusiveDependencies() const {
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles = m_TaskHandles;
+    if (m_Barrier)
+        taskHandles.push_back(m_Barrier);
+    return taskHandles;
+}
+
+void DependencyManager::recordExclusive(std::shared_ptr<TaskHandle> const& taskHandle) {
+    // Every earlier task is finished before it, so later tasks only need to wait for it
+    clear();
+    m_Barrier = taskHandle;
+    m_TaskHandles.push_back(taskHandle);
+}
+
+void DependencyManager::setBarrier(std::shared_ptr<TaskHandle> const& barrier) {
+    clear();
+    m_Barrier = barrier;
+    m_TaskHandles.clear();
+}
+
+void DependencyManager::collect(const Dependency& dependency, const bool& written, std::vector<std::shared_ptr<TaskHandle>>& taskHandles) {
+    auto append = [&taskHandles](std::shared_ptr<TaskHandle> const& taskHandle) {
+        if (std::find(taskHandles.begin(), taskHandles.end(), taskHandle) == taskHandles.end())
+            taskHandles.push_back(taskHandle);
+    };
+    if (dependency.writer)
+        append(dependency.writer);
+    // Readers of the same component run in parallel, only a writer waits for them
+    if (written)
+        for (std::shared_ptr<TaskHandle> const& reader : dependency.readers)
+            append(reader);
+}
+
+void DependencyManager::record(Dependency& dependency, const bool& written, std::shared_ptr<TaskHandle> const& taskHandle) {
+    if (written) {
+        dependency.writer = taskHandle;
+        dependency.readers.clear();
+    } else
+        dependency.readers.push_back(taskHandle);
+}
+
+void DependencyManager::clear() {
+    for (Dependency& dependency : m_ComponentDependencies) {
+        dependency.writer.reset();
+        dependency.readers.clear();
+    }
+    for (Dependency& dependency : m_SingletonComponentDependencies) {
+        dependency.writer.reset();
+        dependency.readers.clear();
+    }
+}
+
+}  // namespace Melon
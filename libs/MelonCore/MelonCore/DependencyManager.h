@@ -0,0 +1,50 @@
+#pragma once
+
+#include <MelonCore/ArchetypeMask.h>
+#include <MelonCore/ComponentAccess.h>
+#include <MelonCore/EntityManager.h>
+#include <MelonTask/TaskHandle.h>
+
+#include <memory>
+#include <vector>
+
+namespace Melon {
+
+// Orders tasks of systems by what they access, writers wait for earlier readers and writers while readers only wait for earlier writers
+class DependencyManager {
+  public:
+    DependencyManager();
+
+    // Tasks which a task of the ComponentAccess should wait for
+    std::vector<std::shared_ptr<TaskHandle>> dependencies(const ComponentAccess& componentAccess) const;
+    // Tasks which an access to the single component, such as a lookup from the main thread, should wait for
+    std::vector<std::shared_ptr<TaskHandle>> dependencies(const unsigned int& componentId, const bool& written) const;
+    void record(const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& taskHandle);
+    // Tasks of undeclared accesses wait for every earlier task, and every later task waits for them
+    std::vector<std::shared_ptr<TaskHandle>> exclusiveDependencies() const;
+    void recordExclusive(std::shared_ptr<TaskHandle> const& taskHandle);
+
+    // Every task recorded since the last barrier
+    std::vector<std::shared_ptr<TaskHandle>> const& taskHandles() const { return m_TaskHandles; }
+    // Tasks recorded later wait for the barrier instead, such as the execution of EntityCommandBuffers waiting for taskHandles()
+    void setBarrier(std::shared_ptr<TaskHandle> const& barrier);
+
+  private:
+    struct Dependency {
+        std::shared_ptr<TaskHandle> writer;
+        // Readers since the last writer
+        std::vector<std::shared_ptr<TaskHandle>> readers;
+    };
+
+    static void collect(const Dependency& dependency, const bool& written, std::vector<std::shared_ptr<TaskHandle>>& taskHandles);
+    static void record(Dependency& dependency, const bool& written, std::shared_ptr<TaskHandle> const& taskHandle);
+    void clear();
+
+    std::vector<Dependency> m_ComponentDependencies;
+    std::vector<Dependency> m_SingletonComponentDependencies;
+    // Waited for by every later task
+    std::shared_ptr<TaskHandle> m_Barrier;
+    std::vector<std::shared_ptr<TaskHandle>> m_TaskHandles;
+};
+
+}  // namespace Melon
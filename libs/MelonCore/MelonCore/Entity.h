@@ -1,6 +1,7 @@
 #pragma once
 
 #include <climits>
+#include <limits>
 
 namespace Melon {
 
@@ -9,15 +10,17 @@ class Archetype;
 struct Entity {
     static constexpr unsigned int k_InvalidId = std::numeric_limits<unsigned int>::max();
 
-    static constexpr Entity invalidEntity() { return Entity{k_InvalidId}; }
+    static constexpr Entity invalidEntity() { return Entity{k_InvalidId, 0}; }
 
     bool operator==(const Entity& other) const {
-        return id == other.id;
+        return id == other.id && generation == other.generation;
     }
 
     bool valid() const { return id != k_InvalidId; }
 
     unsigned int id;
+    // Increased each time the id is recycled, so that handles to destroyed Entities are told apart
+    unsigned int generation;
 };
 
 }  // namespace Melon
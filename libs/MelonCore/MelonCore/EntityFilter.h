@@ -2,7 +2,9 @@
 
 #include <MelonCore/ArchetypeMask.h>
 
+#include <algorithm>
 #include <bitset>
+#include <memory>
 #include <vector>
 
 namespace Melon {
@@ -14,6 +16,8 @@ struct EntityFilter {
 
     ArchetypeMask::ComponentMask requiredComponentMask;
     ArchetypeMask::ComponentMask rejectedComponentMask;
+    // Only chunks in which one of these components is written since the last update of the system are accepted
+    ArchetypeMask::ComponentMask changedComponentMask;
 
     ArchetypeMask::SharedComponentMask requiredSharedComponentMask;
     ArchetypeMask::SharedComponentMask rejectedSharedComponentMask;
@@ -23,6 +27,9 @@ struct EntityFilter {
     std::vector<std::pair<unsigned int, unsigned int>> requiredSharedComponentIdAndIndices;
     // SharedComponents should be in ascending order
     std::vector<std::pair<unsigned int, unsigned int>> rejectedSharedComponentIdAndIndices;
+    // SharedComponents referenced by SharedComponentHandles, each required on its own
+    // The indices are shared with the handles, so that they are resolved once the handles are created on playback, null for invalid handles
+    std::vector<std::pair<unsigned int, std::shared_ptr<const unsigned int>>> requiredSharedComponentIdAndHandleIndices;
 };
 
 inline bool EntityFilter::satisfied(const ArchetypeMask& mask) const {
@@ -32,29 +39,25 @@ inline bool EntityFilter::satisfied(const ArchetypeMask& mask) const {
 }
 
 inline bool EntityFilter::satisfied(std::vector<unsigned int> const& sharedComponentIds, std::vector<unsigned int> const& sharedComponentIndices) const {
-    unsigned int i = 0, j = 0;
-    // Check if required SharedComponent indicess satisfied
-    while (true) {
-        if (i >= requiredSharedComponentIdAndIndices.size()) break;
-        while (j < sharedComponentIds.size() && sharedComponentIds[j] < requiredSharedComponentIdAndIndices[i].first) j++;
-        if (j >= sharedComponentIds.size()) return false;
-        if (sharedComponentIds[j] > requiredSharedComponentIdAndIndices[i].first) return false;
+    // Check if required SharedComponent indices satisfied, one of the indices of the same id is enough
+    for (unsigned int i = 0, j = 0; i < requiredSharedComponentIdAndIndices.size();) {
+        const unsigned int& sharedComponentId = requiredSharedComponentIdAndIndices[i].first;
+        while (j < sharedComponentIds.size() && sharedComponentIds[j] < sharedComponentId) j++;
+        if (j >= sharedComponentIds.size() || sharedComponentIds[j] != sharedComponentId) return false;
         bool found = false;
-        while (requiredSharedComponentIdAndIndices[i].first == sharedComponentIds[j])
-            found |= requiredSharedComponentIdAndIndices[i++].second == sharedComponentIndices[j];
+        for (; i < requiredSharedComponentIdAndIndices.size() && requiredSharedComponentIdAndIndices[i].first == sharedComponentId; i++)
+            found |= requiredSharedComponentIdAndIndices[i].second == sharedComponentIndices[j];
         if (!found) return false;
     }
+    for (auto const& [sharedComponentId, sharedComponentIndex] : requiredSharedComponentIdAndHandleIndices) {
+        auto it = std::lower_bound(sharedComponentIds.begin(), sharedComponentIds.end(), sharedComponentId);
+        if (sharedComponentIndex == nullptr || it == sharedComponentIds.end() || *it != sharedComponentId || sharedComponentIndices[it - sharedComponentIds.begin()] != *sharedComponentIndex) return false;
+    }
     // Check if rejected SharedComponent indices satisfied
-    i = 0, j = 0;
-    while (true) {
-        if (i >= rejectedSharedComponentIdAndIndices.size()) break;
-        while (j < sharedComponentIds.size() && sharedComponentIds[j] < rejectedSharedComponentIdAndIndices[i].first) j++;
-        if (j >= sharedComponentIds.size()) return false;
-        if (sharedComponentIds[j] > rejectedSharedComponentIdAndIndices[i].first) return false;
-        bool found = false;
-        while (rejectedSharedComponentIdAndIndices[i].first == sharedComponentIds[j])
-            found |= rejectedSharedComponentIdAndIndices[i++].second == sharedComponentIndices[j];
-        if (found) return false;
+    for (unsigned int i = 0, j = 0; i < rejectedSharedComponentIdAndIndices.size(); i++) {
+        const unsigned int& sharedComponentId = rejectedSharedComponentIdAndIndices[i].first;
+        while (j < sharedComponentIds.size() && sharedComponentIds[j] < sharedComponentId) j++;
+        if (j < sharedComponentIds.size() && sharedComponentIds[j] == sharedComponentId && rejectedSharedComponentIdAndIndices[i].second == sharedComponentIndices[j]) return false;
     }
     return true;
 }
@@ -0,0 +1,15 @@
+#include <MelonCore/EntityLocationTable.h>
+
+#include <algorithm>
+
+namespace Melon {
+
+void EntityLocationTable::grow(const unsigned int& size) {
+    for (unsigned int pageIndex = m_Pages.size(); pageIndex < (size + k_PageSize - 1) >> k_PageShift; pageIndex++) {
+        Record* page = m_Pages.emplace_back(std::make_unique<Record[]>(k_PageSize)).get();
+        std::fill_n(page, k_PageSize, Record{Archetype::EntityLocation::invalidEntityLocation(), 0});
+    }
+    m_Size = std::max(m_Size, size);
+}
+
+}  // namespace Melon
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Prefetch.h>
+
+#include <memory>
+#include <vector>
+
+namespace Melon {
+
+// Locations and generations of Entities by id, kept in pages so that growing never moves existing records
+class EntityLocationTable {
+  public:
+    static constexpr unsigned int k_PageShift = 12U;
+    static constexpr unsigned int k_PageSize = 1U << k_PageShift;
+
+    // Cover ids below size, added records are invalid locations of generation 0
+    void grow(const unsigned int& size);
+    const unsigned int& size() const { return m_Size; }
+
+    Archetype::EntityLocation& operator[](const unsigned int& id) { return record(id).location; }
+    const Archetype::EntityLocation& operator[](const unsigned int& id) const { return record(id).location; }
+    unsigned int& generation(const unsigned int& id) { return record(id).generation; }
+    const unsigned int& generation(const unsigned int& id) const { return record(id).generation; }
+
+    // Whether the Entity is created and its id not recycled since
+    bool alive(const Entity& entity) const;
+    void prefetch(const unsigned int& id) const { Melon::prefetch(&record(id)); }
+
+  private:
+    // A lookup reads every field, so they share one 16-byte record rather than separate arrays
+    struct Record {
+        Archetype::EntityLocation location;
+        unsigned int generation;
+    };
+
+    Record& record(const unsigned int& id) { return m_Pages[id >> k_PageShift][id & (k_PageSize - 1)]; }
+    const Record& record(const unsigned int& id) const { return m_Pages[id >> k_PageShift][id & (k_PageSize - 1)]; }
+
+    std::vector<std::unique_ptr<Record[]>> m_Pages;
+    unsigned int m_Size{};
+};
+
+inline bool EntityLocationTable::alive(const Entity& entity) const {
+    if (entity.id >= m_Size) return false;
+    const Record& entityRecord = record(entity.id);
+    return entityRecord.generation == entity.generation && entityRecord.location.valid();
+}
+
+}  // namespace Melon
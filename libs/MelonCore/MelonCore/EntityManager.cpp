@@ -1,5 +1,12 @@
+#include <MelonCore/DependencyManager.h>
 #include <MelonCore/EntityManager.h>
+#include <MelonTask/TaskHandle.h>
+#include <MelonTask/TaskManager.h>
 
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <numeric>
 #include <typeindex>
 
 namespace Melon {
@@ -7,31 +14,67 @@ namespace Melon {
 EntityCommandBuffer::EntityCommandBuffer(EntityManager* entityManager) noexcept : m_EntityManager(entityManager) {}
 
 Entity EntityCommandBuffer::createEntity() {
-    const Entity entity = m_EntityManager->assignEntity();
-    m_Procedures.emplace_back([this, entity]() {
-        m_EntityManager->createEntityImmediately(entity);
-    });
+    const Entity entity = assignEntity();
+    pushCommand(Opcode::CreateEntity, entity, nullptr);
     return entity;
 }
 
 Entity EntityCommandBuffer::createEntity(Archetype* archetype) {
-    const Entity entity = m_EntityManager->assignEntity();
-    m_Procedures.emplace_back([this, entity, archetype]() {
-        m_EntityManager->createEntityImmediately(entity, archetype);
-    });
+    const Entity entity = assignEntity();
+    pushCommand(Opcode::CreateEntity, entity, archetype);
     return entity;
 }
 
+void EntityCommandBuffer::reserve(Archetype* archetype, const unsigned int& entityCount) {
+    pushProcedure([this, archetype, entityCount]() {
+        m_EntityManager->reserveImmediately(archetype, entityCount);
+    });
+}
+
 void EntityCommandBuffer::destroyEntity(const Entity& entity) {
-    m_Procedures.emplace_back([this, entity]() {
-        m_EntityManager->destroyEntityImmediately(entity);
+    pushCommand(Opcode::DestroyEntity, entity, nullptr);
+}
+
+void EntityCommandBuffer::destroyEntities(const EntityFilter& entityFilter) {
+    pushProcedure([this, entityFilter]() {
+        m_EntityManager->destroyEntitiesImmediately(entityFilter);
     });
 }
 
-void EntityCommandBuffer::execute() {
-    for (std::function<void()> const& procedure : m_Procedures)
-        procedure();
+void EntityCommandBuffer::pushCommand(const Opcode& opcode, const Entity& entity, Archetype* archetype) {
+    const std::size_t offset = m_Commands.size();
+    m_Commands.resize(offset + Command::stride(offset, 0, 0));
+    new (m_Commands.data() + offset) Command{opcode, false, 0, 0, entity, archetype != nullptr ? archetype->id() : Archetype::k_InvalidId, nullptr};
+}
+
+void EntityCommandBuffer::pushProcedure(std::function<void()>&& procedure) {
+    const std::size_t offset = m_Commands.size();
+    m_Commands.resize(offset + Command::stride(offset, 0, 0));
+    new (m_Commands.data() + offset) Command{Opcode::Procedure, false, 0, 0, Entity::invalidEntity(), static_cast<unsigned int>(m_Procedures.size()), nullptr};
+    m_Procedures.emplace_back(std::move(procedure));
+}
+
+void EntityCommandBuffer::clear() {
+    m_Commands.clear();
     m_Procedures.clear();
+    m_SharedComponentIndices.clear();
+}
+
+Entity EntityCommandBuffer::assignEntity() {
+    if (m_ReservedEntities.empty())
+        m_EntityManager->reserveEntities(EntityManager::k_EntityIdBlockSize, m_ReservedEntities);
+    const Entity entity = m_ReservedEntities.back();
+    m_ReservedEntities.pop_back();
+    return entity;
+}
+
+void EntityCommandBuffer::assignEntities(std::span<Entity> entities) {
+    for (unsigned int i = 0; i < entities.size(); i++) {
+        if (m_ReservedEntities.empty())
+            m_EntityManager->reserveEntities(std::max(EntityManager::k_EntityIdBlockSize, static_cast<unsigned int>(entities.size()) - i), m_ReservedEntities);
+        entities[i] = m_ReservedEntities.back();
+        m_ReservedEntities.pop_back();
+    }
 }
 
 EntityManager::EntityManager() : m_MainEntityCommandBuffer(this) {}
@@ -44,34 +87,40 @@ Entity EntityManager::createEntity(Archetype* archetype) {
     return m_MainEntityCommandBuffer.createEntity(archetype);
 }
 
+void EntityManager::reserve(Archetype* archetype, const unsigned int& entityCount) {
+    m_MainEntityCommandBuffer.reserve(archetype, entityCount);
+}
+
 void EntityManager::destroyEntity(const Entity& entity) {
     m_MainEntityCommandBuffer.destroyEntity(entity);
 }
 
-std::vector<ChunkAccessor> EntityManager::filterEntities(const EntityFilter& entityFilter) {
-    std::vector<ChunkAccessor> accessors;
-    for (const auto& [mask, archetype] : m_ArchetypeMap)
-        if (entityFilter.satisfied(mask))
-            if (archetype->entityCount() != 0)
-                archetype->filterEntities(entityFilter, m_SharedComponentStore, accessors);
-    return accessors;
+void EntityManager::destroyEntities(const EntityFilter& entityFilter) {
+    m_MainEntityCommandBuffer.destroyEntities(entityFilter);
+}
+
+std::vector<ChunkAccessor> EntityManager::filterEntities(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) {
+    completeEntityCommandBuffers();
+    return filterEntitiesWithoutCheck(entityFilter, lastSystemVersion, m_GlobalSystemVersion);
 }
 
-unsigned int EntityManager::chunkCount(const EntityFilter& entityFilter) const {
+unsigned int EntityManager::chunkCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const {
+    completeEntityCommandBuffers();
     unsigned int count = 0;
     for (const auto& [mask, archetype] : m_ArchetypeMap)
         if (entityFilter.satisfied(mask))
             if (archetype->entityCount() != 0)
-                count += archetype->chunkCount();
+                count += archetype->chunkCount(entityFilter, lastSystemVersion);
     return count;
 };
 
-unsigned int EntityManager::entityCount(const EntityFilter& entityFilter) const {
+unsigned int EntityManager::entityCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion) const {
+    completeEntityCommandBuffers();
     unsigned int count = 0;
     for (const auto& [mask, archetype] : m_ArchetypeMap)
         if (entityFilter.satisfied(mask))
             if (archetype->entityCount() != 0)
-                count += archetype->entityCount();
+                count += archetype->entityCount(entityFilter, lastSystemVersion);
     return count;
 };
 
@@ -87,27 +136,179 @@ unsigned int EntityManager::registerSingletonComponent(const std::type_index& ty
     return m_SingletonComponentIdMap.try_emplace(typeIndex, m_SingletonComponentIdMap.size()).first->second;
 }
 
+void EntityManager::trimChunks() {
+    completeEntityCommandBuffers();
+    m_ChunkAllocator.trim();
+}
+
+ChunkAllocator::Stats EntityManager::chunkStats() const {
+    completeEntityCommandBuffers();
+    return m_ChunkAllocator.stats();
+}
+
+EntityManager::CompactionStats EntityManager::compactChunks(const std::chrono::nanoseconds& budget) {
+    completeTasks();
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget;
+    const std::size_t returnedBytes = m_ChunkAllocator.stats().bytesReturned;
+    CompactionStats stats{};
+    m_ChunkAllocator.beginDefragmentation();
+    // A chunk relocated before checking the deadline makes sure that every call advances
+    for (; m_CompactionArchetypeIndex < m_Archetypes.size(); m_CompactionArchetypeIndex++, m_CompactionCombinationIndex = 0)
+        if (!m_Archetypes[m_CompactionArchetypeIndex]->compact(deadline, m_CompactionCombinationIndex, stats.freedChunkCount, stats.relocatedChunkCount))
+            break;
+    stats.completed = m_CompactionArchetypeIndex == m_Archetypes.size();
+    if (stats.completed)
+        m_CompactionArchetypeIndex = 0;
+    m_ChunkAllocator.endDefragmentation();
+    stats.reclaimedBytes = m_ChunkAllocator.stats().bytesReturned - returnedBytes;
+    return stats;
+}
+
+Archetype* EntityManager::emptyArchetype() {
+    return createArchetype(ArchetypeMask(), {}, {}, {}, {});
+}
+
 Archetype* EntityManager::createArchetype(ArchetypeMask&& mask, std::vector<unsigned int>&& componentIds, std::vector<std::size_t>&& componentSizes, std::vector<std::size_t>&& componentAligns, std::vector<unsigned int>&& sharedComponentIds) {
     if (m_ArchetypeMap.contains(mask)) return m_ArchetypeMap[mask];
     const unsigned int archetypeId = m_ArchetypeIdCounter++;
-    Archetype* archetype = m_Archetypes.emplace_back(std::make_unique<Archetype>(archetypeId, mask, componentIds, componentSizes, componentAligns, sharedComponentIds, &m_ChunkPool)).get();
+    Archetype* archetype = m_Archetypes.emplace_back(std::make_unique<Archetype>(archetypeId, mask, componentIds, componentSizes, componentAligns, sharedComponentIds, m_EnableableComponentMask, m_SoAComponentMask, &m_ChunkAllocator, m_PlaybackSystemVersion)).get();
     m_ArchetypeMap.emplace(mask, archetype);
     return archetype;
 }
 
-Entity EntityManager::assignEntity() {
-    std::lock_guard lock(m_EntityIdMutex);
-    if (!m_FreeEntityIds.empty()) {
-        unsigned int entityId = m_FreeEntityIds.back();
-        m_FreeEntityIds.pop();
-        return Entity{entityId};
+const Archetype::Edge& EntityManager::addComponentEdge(Archetype* srcArchetype, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align) {
+    auto it = srcArchetype->m_AddComponentEdges.find(componentId);
+    if (it != srcArchetype->m_AddComponentEdges.end())
+        return it->second;
+
+    ArchetypeMask mask = srcArchetype->mask();
+    mask.markComponent(componentId, manual);
+    Archetype* dstArchetype;
+    if (m_ArchetypeMap.contains(mask))
+        dstArchetype = m_ArchetypeMap[mask];
+    else {
+        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
+        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
+        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
+        // Tags of size 0 take no column
+        if (size != 0) {
+            componentIds.push_back(componentId);
+            componentSizes.push_back(size);
+            componentAligns.push_back(align);
+        }
+        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
+        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
     }
-    m_EntityLocations.emplace_back(Archetype::EntityLocation::invalidEntityLocation());
-    return Entity{m_EntityIdCounter++};
+    dstArchetype->m_RemoveComponentEdges.try_emplace(componentId, dstArchetype->createEdge(srcArchetype));
+    return srcArchetype->m_AddComponentEdges.emplace(componentId, srcArchetype->createEdge(dstArchetype)).first->second;
+}
+
+const Archetype::Edge& EntityManager::removeComponentEdge(Archetype* srcArchetype, const unsigned int& componentId, const bool& manual) {
+    auto it = srcArchetype->m_RemoveComponentEdges.find(componentId);
+    if (it != srcArchetype->m_RemoveComponentEdges.end())
+        return it->second;
+
+    ArchetypeMask mask = srcArchetype->mask();
+    mask.markComponent(componentId, manual, false);
+    Archetype* dstArchetype;
+    if (m_ArchetypeMap.contains(mask))
+        dstArchetype = m_ArchetypeMap[mask];
+    else {
+        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
+        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
+        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
+        for (unsigned int i = 0; i < componentIds.size(); i++)
+            if (componentIds[i] == componentId) {
+                componentIds.erase(componentIds.begin() + i);
+                componentSizes.erase(componentSizes.begin() + i);
+                componentAligns.erase(componentAligns.begin() + i);
+                break;
+            }
+        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
+        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
+    }
+    dstArchetype->m_AddComponentEdges.try_emplace(componentId, dstArchetype->createEdge(srcArchetype));
+    return srcArchetype->m_RemoveComponentEdges.emplace(componentId, srcArchetype->createEdge(dstArchetype)).first->second;
+}
+
+const Archetype::Edge& EntityManager::addSharedComponentEdge(Archetype* srcArchetype, const unsigned int& sharedComponentId, const bool& manual) {
+    auto it = srcArchetype->m_AddSharedComponentEdges.find(sharedComponentId);
+    if (it != srcArchetype->m_AddSharedComponentEdges.end())
+        return it->second;
+
+    ArchetypeMask mask = srcArchetype->mask();
+    mask.markSharedComponent(sharedComponentId, manual);
+    Archetype* dstArchetype;
+    if (m_ArchetypeMap.contains(mask))
+        dstArchetype = m_ArchetypeMap[mask];
+    else {
+        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
+        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
+        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
+        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
+        sharedComponentIds.push_back(sharedComponentId);
+        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
+    }
+    dstArchetype->m_RemoveSharedComponentEdges.try_emplace(sharedComponentId, dstArchetype->createEdge(srcArchetype));
+    return srcArchetype->m_AddSharedComponentEdges.emplace(sharedComponentId, srcArchetype->createEdge(dstArchetype)).first->second;
+}
+
+const Archetype::Edge& EntityManager::removeSharedComponentEdge(Archetype* srcArchetype, const unsigned int& sharedComponentId, const bool& manual) {
+    auto it = srcArchetype->m_RemoveSharedComponentEdges.find(sharedComponentId);
+    if (it != srcArchetype->m_RemoveSharedComponentEdges.end())
+        return it->second;
+
+    ArchetypeMask mask = srcArchetype->mask();
+    mask.markSharedComponent(sharedComponentId, manual, false);
+    Archetype* dstArchetype;
+    if (m_ArchetypeMap.contains(mask))
+        dstArchetype = m_ArchetypeMap[mask];
+    else {
+        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
+        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
+        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
+        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
+        for (unsigned int i = 0; i < sharedComponentIds.size(); i++)
+            if (sharedComponentIds[i] == sharedComponentId) {
+                sharedComponentIds.erase(sharedComponentIds.begin() + i);
+                break;
+            }
+        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
+    }
+    dstArchetype->m_AddSharedComponentEdges.try_emplace(sharedComponentId, dstArchetype->createEdge(srcArchetype));
+    return srcArchetype->m_RemoveSharedComponentEdges.emplace(sharedComponentId, srcArchetype->createEdge(dstArchetype)).first->second;
+}
+
+const Archetype::Edge& EntityManager::transitionEdge(Archetype* srcArchetype, Archetype* dstArchetype) {
+    auto it = srcArchetype->m_TransitionEdges.find(dstArchetype->id());
+    if (it != srcArchetype->m_TransitionEdges.end())
+        return it->second;
+    return srcArchetype->m_TransitionEdges.emplace(dstArchetype->id(), srcArchetype->createEdge(dstArchetype)).first->second;
+}
+
+void EntityManager::reserveEntities(const unsigned int& count, std::vector<Entity>& entities) {
+    if (!m_FreeEntitiesEmpty.load(std::memory_order_relaxed)) {
+        std::lock_guard lock(m_EntityIdMutex);
+        if (!m_FreeEntities.empty()) {
+            const std::size_t takenCount = std::min<std::size_t>(count, m_FreeEntities.size());
+            entities.insert(entities.end(), m_FreeEntities.end() - takenCount, m_FreeEntities.end());
+            m_FreeEntities.resize(m_FreeEntities.size() - takenCount);
+            m_FreeEntitiesEmpty.store(m_FreeEntities.empty(), std::memory_order_relaxed);
+            return;
+        }
+    }
+    // Ids never handed out are of generation 0, pushed in reverse so that they are handed out in order
+    const unsigned int firstEntityId = m_EntityIdCounter.fetch_add(count, std::memory_order_relaxed);
+    for (unsigned int entityId = firstEntityId + count; entityId != firstEntityId; entityId--)
+        entities.push_back(Entity{entityId - 1, 0});
+}
+
+void EntityManager::releaseEntity(const Entity& entity) {
+    m_ReleasedEntities.push_back(Entity{entity.id, ++m_EntityLocations.generation(entity.id)});
 }
 
 void EntityManager::createEntityImmediately(const Entity& entity) {
-    Archetype* const archetype = createArchetypeBuilder().createArchetype();
+    Archetype* const archetype = emptyArchetype();
     createEntityImmediately(entity, archetype);
 }
 
@@ -117,23 +318,148 @@ void EntityManager::createEntityImmediately(const Entity& entity, Archetype* arc
     m_EntityLocations[entity.id] = location;
 }
 
+void EntityManager::createEntitiesImmediately(std::vector<Entity> const& entities, Archetype* archetype, std::vector<unsigned int> const& componentIds, std::vector<std::byte> const& componentData) {
+    if (entities.empty()) return;
+    Archetype::EntityLocation location;
+    archetype->addEntities(entities.data(), entities.size(), componentIds, componentData.data(), location);
+    for (const Entity& entity : entities) {
+        m_EntityLocations[entity.id] = location;
+        location.entityIndexInCombination++;
+    }
+}
+
+void EntityManager::reserveImmediately(Archetype* archetype, const unsigned int& entityCount) {
+    archetype->reserve(entityCount);
+}
+
 void EntityManager::destroyEntityImmediately(const Entity& entity) {
     const Archetype::EntityLocation location = m_EntityLocations[entity.id];
     Archetype* archetype = m_Archetypes[location.archetypeId].get();
-    // If the archetype is partially manual, we should remove all the components not manual instead
+    // If the archetype is partially manual, we should remove all the components not manual instead, in a single move
     if (archetype->partiallyManual()) {
-        std::vector<unsigned int> const notManualComponentIds = archetype->notManualComponentIds();
-        for (const unsigned int& componentId : notManualComponentIds)
-            removeComponentWithoutCheck(entity, componentId, false);
-        std::vector<unsigned int> const notManualSharedComponentIds = archetype->notManualSharedComponentIds();
-        for (const unsigned int& sharedComponentId : notManualSharedComponentIds)
-            removeSharedComponentWithoutCheck(entity, sharedComponentId, false);
+        Archetype* dstArchetype = archetype;
+        for (const unsigned int& componentId : archetype->notManualComponentIds())
+            dstArchetype = removeComponentEdge(dstArchetype, componentId, false).archetype;
+        for (const unsigned int& sharedComponentId : archetype->notManualSharedComponentIds())
+            dstArchetype = removeSharedComponentEdge(dstArchetype, sharedComponentId, false).archetype;
+        // Copied because the Combination may be destroyed by the move
+        std::vector<unsigned int> const sharedComponentIndices = archetype->m_Combinations[location.combinationIndex]->sharedComponentIndices();
+        Entity srcSwappedEntity;
+        Archetype::EntityLocation dstLocation;
+        dstArchetype->moveEntity(location, archetype, transitionEdge(archetype, dstArchetype), dstLocation, srcSwappedEntity);
+        m_EntityLocations[entity.id] = dstLocation;
+        if (srcSwappedEntity.valid())
+            m_EntityLocations[srcSwappedEntity.id] = location;
+        std::vector<unsigned int> const& sharedComponentIds = archetype->sharedComponentIds();
+        for (unsigned int i = 0; i < sharedComponentIds.size(); i++)
+            if (!archetype->mask().manualSharedComponent(sharedComponentIds[i]))
+                m_SharedComponentStore.pop(sharedComponentIds[i], sharedComponentIndices[i]);
         return;
     }
     // If the archetype is fully manual, we should not destroy it
     if (archetype->fullyManual())
         return;
     destroyEntityWithoutCheck(entity, archetype, location);
+    releaseEntity(entity);
+}
+
+void EntityManager::destroyEntitiesImmediately(const EntityFilter& entityFilter) {
+    for (Archetype* archetype : filterArchetypes(entityFilter)) {
+        // If the archetype is fully manual, we should not destroy it
+        if (archetype->fullyManual())
+            continue;
+        if (archetype->partiallyManual()) {
+            // Move Entities to the Archetype with only manual components left
+            Archetype* dstArchetype = archetype;
+            for (const unsigned int& componentId : archetype->notManualComponentIds())
+                dstArchetype = removeComponentEdge(dstArchetype, componentId, false).archetype;
+            for (const unsigned int& sharedComponentId : archetype->notManualSharedComponentIds())
+                dstArchetype = removeSharedComponentEdge(dstArchetype, sharedComponentId, false).archetype;
+            const Archetype::Edge edge = archetype->createEdge(dstArchetype);
+            std::vector<unsigned int> const& sharedComponentIds = archetype->sharedComponentIds();
+            for (const unsigned int& combinationIndex : archetype->filterCombinations(entityFilter)) {
+                const Combination* combination = archetype->m_Combinations[combinationIndex].get();
+                for (unsigned int i = 0; i < sharedComponentIds.size(); i++)
+                    if (!archetype->mask().manualSharedComponent(sharedComponentIds[i]))
+                        m_SharedComponentStore.pop(sharedComponentIds[i], combination->sharedComponentIndices()[i], combination->entityCount());
+                moveEntitiesWithoutCheck(archetype, combinationIndex, edge, nullptr);
+            }
+            continue;
+        }
+        for (const unsigned int& combinationIndex : archetype->filterCombinations(entityFilter))
+            destroyEntitiesWithoutCheck(archetype, combinationIndex);
+    }
+}
+
+void EntityManager::addComponentImmediately(const Entity& entity, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align, const void* component) {
+    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
+    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
+    // Adding an existing DataComponent overrides its value and enables it
+    if (srcArchetype->mask().componentMask.test(componentId)) {
+        if (size != 0)
+            srcArchetype->setComponent(srcLocation, componentId, component);
+        if (m_EnableableComponentMask.test(componentId))
+            srcArchetype->setComponentEnabled(srcLocation, componentId, true);
+        return;
+    }
+    const Archetype::Edge& edge = addComponentEdge(srcArchetype, componentId, manual, size, align);
+
+    Entity srcSwappedEntity;
+    Archetype::EntityLocation dstLocation;
+    edge.archetype->moveEntityAddingComponent(srcLocation, srcArchetype, edge, component, dstLocation, srcSwappedEntity);
+    m_EntityLocations[entity.id] = dstLocation;
+    if (srcSwappedEntity.valid())
+        m_EntityLocations[srcSwappedEntity.id] = srcLocation;
+}
+
+void EntityManager::removeComponentImmediately(const Entity& entity, const unsigned int& componentId, const bool& manual) {
+    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
+    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
+    // If the archetype is single and manual, it should be destroyed;
+    if (srcArchetype->single() && srcArchetype->fullyManual()) {
+        destroyEntityWithoutCheck(entity, srcArchetype, srcLocation);
+        releaseEntity(entity);
+        return;
+    }
+    removeComponentWithoutCheck(entity, componentId, manual);
+}
+
+void EntityManager::setComponentImmediately(const Entity& entity, const unsigned int& componentId, const void* component) {
+    const Archetype::EntityLocation location = m_EntityLocations[entity.id];
+    Archetype* const archetype = m_Archetypes[location.archetypeId].get();
+    archetype->setComponent(location, componentId, component);
+}
+
+void EntityManager::setComponentEnabledImmediately(const Entity& entity, const unsigned int& componentId, const bool& enabled) {
+    const Archetype::EntityLocation location = m_EntityLocations[entity.id];
+    Archetype* const archetype = m_Archetypes[location.archetypeId].get();
+    archetype->setComponentEnabled(location, componentId, enabled);
+}
+
+void EntityManager::addSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual, const unsigned int& sharedComponentIndex) {
+    // Handles released before this playback are dropped like destroyed Entities
+    if (sharedComponentIndex == ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex) return;
+    m_SharedComponentStore.retain(sharedComponentIndex);
+    addSharedComponentWithoutCheck(entity, sharedComponentId, manual, sharedComponentIndex);
+}
+
+void EntityManager::removeSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual) {
+    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
+    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
+    // If the archetype is single and manual, it should be destroyed;
+    if (srcArchetype->single() && srcArchetype->fullyManual()) {
+        destroyEntityWithoutCheck(entity, srcArchetype, srcLocation);
+        releaseEntity(entity);
+        return;
+    }
+    removeSharedComponentWithoutCheck(entity, sharedComponentId, manual);
+}
+
+void EntityManager::setSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex) {
+    // Handles released before this playback are dropped like destroyed Entities
+    if (sharedComponentIndex == ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex) return;
+    m_SharedComponentStore.retain(sharedComponentIndex);
+    setSharedComponentWithoutCheck(entity, sharedComponentId, sharedComponentIndex);
 }
 
 void EntityManager::destroyEntityWithoutCheck(const Entity& entity, Archetype* archetype, const Archetype::EntityLocation& location) {
@@ -151,30 +477,30 @@ void EntityManager::destroyEntityWithoutCheck(const Entity& entity, Archetype* a
 void EntityManager::removeComponentWithoutCheck(const Entity& entity, const unsigned int& componentId, const bool& manual) {
     const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
     Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    ArchetypeMask mask = srcArchetype->mask();
-    mask.markComponent(componentId, manual, false);
+    if (!srcArchetype->mask().componentMask.test(componentId)) return;
+    const Archetype::Edge& edge = removeComponentEdge(srcArchetype, componentId, manual);
 
-    Archetype* dstArchetype;
-    if (m_ArchetypeMap.contains(mask))
-        dstArchetype = m_ArchetypeMap[mask];
-    else {
-        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
-        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
-        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
-        for (unsigned int i = 0; i < componentIds.size(); i++)
-            if (componentIds[i] == componentId) {
-                componentIds.erase(componentIds.begin() + i);
-                componentSizes.erase(componentSizes.begin() + i);
-                componentAligns.erase(componentAligns.begin() + i);
-                break;
-            }
-        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
-        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
+    Entity srcSwappedEntity;
+    Archetype::EntityLocation dstLocation;
+    edge.archetype->moveEntityRemovingComponent(srcLocation, srcArchetype, edge, dstLocation, srcSwappedEntity);
+    m_EntityLocations[entity.id] = dstLocation;
+    if (srcSwappedEntity.valid())
+        m_EntityLocations[srcSwappedEntity.id] = srcLocation;
+}
+
+void EntityManager::addSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual, const unsigned int& sharedComponentIndex) {
+    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
+    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
+    // Adding an existing SharedComponent only overrides its value
+    if (srcArchetype->mask().sharedComponentMask.test(sharedComponentId)) {
+        setSharedComponentWithoutCheck(entity, sharedComponentId, sharedComponentIndex);
+        return;
     }
+    const Archetype::Edge& edge = addSharedComponentEdge(srcArchetype, sharedComponentId, manual);
 
     Entity srcSwappedEntity;
     Archetype::EntityLocation dstLocation;
-    dstArchetype->moveEntityRemovingComponent(srcLocation, srcArchetype, dstLocation, srcSwappedEntity);
+    edge.archetype->moveEntityAddingSharedComponent(srcLocation, srcArchetype, edge, sharedComponentId, sharedComponentIndex, dstLocation, srcSwappedEntity);
     m_EntityLocations[entity.id] = dstLocation;
     if (srcSwappedEntity.valid())
         m_EntityLocations[srcSwappedEntity.id] = srcLocation;
@@ -183,29 +509,13 @@ void EntityManager::removeComponentWithoutCheck(const Entity& entity, const unsi
 void EntityManager::removeSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual) {
     const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
     Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    ArchetypeMask mask = srcArchetype->mask();
-    mask.markSharedComponent(sharedComponentId, manual, false);
-
-    Archetype* dstArchetype;
-    if (m_ArchetypeMap.contains(mask))
-        dstArchetype = m_ArchetypeMap[mask];
-    else {
-        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
-        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
-        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
-        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
-        for (unsigned int i = 0; i < sharedComponentIds.size(); i++)
-            if (sharedComponentIds[i] == sharedComponentId) {
-                sharedComponentIds.erase(sharedComponentIds.begin() + i);
-                break;
-            }
-        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
-    }
+    if (!srcArchetype->mask().sharedComponentMask.test(sharedComponentId)) return;
+    const Archetype::Edge& edge = removeSharedComponentEdge(srcArchetype, sharedComponentId, manual);
 
     unsigned int sharedComponentIndex;
     Entity srcSwappedEntity;
     Archetype::EntityLocation dstLocation;
-    dstArchetype->moveEntityRemovingSharedComponent(srcLocation, srcArchetype, sharedComponentIndex, dstLocation, srcSwappedEntity);
+    edge.archetype->moveEntityRemovingSharedComponent(srcLocation, srcArchetype, edge, sharedComponentIndex, dstLocation, srcSwappedEntity);
     m_EntityLocations[entity.id] = dstLocation;
     if (srcSwappedEntity.valid())
         m_EntityLocations[srcSwappedEntity.id] = srcLocation;
@@ -213,11 +523,421 @@ void EntityManager::removeSharedComponentWithoutCheck(const Entity& entity, cons
     m_SharedComponentStore.pop(sharedComponentId, sharedComponentIndex);
 }
 
-void EntityManager::executeEntityCommandBuffers() {
-    m_MainEntityCommandBuffer.execute();
-    for (std::unique_ptr<EntityCommandBuffer> const& buffer : m_TaskEntityCommandBuffers)
-        buffer->execute();
+void EntityManager::setSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex) {
+    const Archetype::EntityLocation location = m_EntityLocations[entity.id];
+    Archetype* const archetype = m_Archetypes[location.archetypeId].get();
+
+    unsigned int originalSharedComponentIndex;
+    Archetype::EntityLocation dstLocation;
+    Entity swappedEntity;
+    archetype->setSharedComponent(location, sharedComponentId, sharedComponentIndex, originalSharedComponentIndex, dstLocation, swappedEntity);
+    m_EntityLocations[entity.id] = dstLocation;
+    if (swappedEntity.valid())
+        m_EntityLocations[swappedEntity.id] = location;
+
+    m_SharedComponentStore.pop(sharedComponentId, originalSharedComponentIndex);
+}
+
+std::vector<Archetype*> EntityManager::filterArchetypes(const EntityFilter& entityFilter) const {
+    // Archetypes are collected ahead because structural changes may create new ones
+    std::vector<Archetype*> archetypes;
+    for (const auto& [mask, archetype] : m_ArchetypeMap)
+        if (entityFilter.satisfied(mask))
+            if (archetype->entityCount() != 0)
+                archetypes.push_back(archetype);
+    return archetypes;
+}
+
+std::vector<ChunkAccessor> EntityManager::filterEntitiesWithoutCheck(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion) const {
+    std::vector<ChunkAccessor> accessors;
+    for (const auto& [mask, archetype] : m_ArchetypeMap)
+        if (entityFilter.satisfied(mask))
+            if (archetype->entityCount() != 0)
+                archetype->filterEntities(entityFilter, lastSystemVersion, globalSystemVersion, m_SharedComponentStore, accessors);
+    return accessors;
+}
+
+void EntityManager::addComponentWithoutCheck(const EntityFilter& entityFilter, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align, const void* component) {
+    for (Archetype* srcArchetype : filterArchetypes(entityFilter)) {
+        // Adding an existing DataComponent overrides its value and enables it
+        if (srcArchetype->mask().componentMask.test(componentId)) {
+            if (size != 0)
+                for (const unsigned int& combinationIndex : srcArchetype->filterCombinations(entityFilter))
+                    srcArchetype->fillComponent(combinationIndex, componentId, component);
+            continue;
+        }
+        const Archetype::Edge& edge = addComponentEdge(srcArchetype, componentId, manual, size, align);
+        for (const unsigned int& combinationIndex : srcArchetype->filterCombinations(entityFilter))
+            moveEntitiesWithoutCheck(srcArchetype, combinationIndex, edge, component);
+    }
+}
+
+void EntityManager::removeComponentWithoutCheck(const EntityFilter& entityFilter, const unsigned int& componentId, const bool& manual) {
+    for (Archetype* srcArchetype : filterArchetypes(entityFilter)) {
+        if (!srcArchetype->mask().componentMask.test(componentId)) continue;
+        // If the archetype is single and manual, it should be destroyed;
+        if (srcArchetype->single() && srcArchetype->fullyManual()) {
+            for (const unsigned int& combinationIndex : srcArchetype->filterCombinations(entityFilter))
+                destroyEntitiesWithoutCheck(srcArchetype, combinationIndex);
+            continue;
+        }
+        const Archetype::Edge& edge = removeComponentEdge(srcArchetype, componentId, manual);
+        for (const unsigned int& combinationIndex : srcArchetype->filterCombinations(entityFilter))
+            moveEntitiesWithoutCheck(srcArchetype, combinationIndex, edge, nullptr);
+    }
+}
+
+void EntityManager::destroyEntitiesWithoutCheck(Archetype* archetype, const unsigned int& combinationIndex) {
+    const Combination* combination = archetype->m_Combinations[combinationIndex].get();
+    for (unsigned int i = 0; i < combination->entityCount(); i++) {
+        m_EntityLocations[combination->entity(i).id] = Archetype::EntityLocation::invalidEntityLocation();
+        releaseEntity(combination->entity(i));
+    }
+    std::vector<unsigned int> const& sharedComponentIds = archetype->sharedComponentIds();
+    for (unsigned int i = 0; i < sharedComponentIds.size(); i++)
+        m_SharedComponentStore.pop(sharedComponentIds[i], combination->sharedComponentIndices()[i], combination->entityCount());
+    archetype->removeEntities(combinationIndex);
+}
+
+void EntityManager::moveEntitiesWithoutCheck(Archetype* srcArchetype, const unsigned int& srcCombinationIndex, const Archetype::Edge& edge, const void* component) {
+    Archetype::EntityLocation location;
+    edge.archetype->moveEntities(srcCombinationIndex, srcArchetype, edge, component, location);
+    // Only the moved Entities and the ones after them change location
+    const Combination* dstCombination = edge.archetype->m_Combinations[location.combinationIndex].get();
+    for (; location.entityIndexInCombination < dstCombination->entityCount(); location.entityIndexInCombination++)
+        m_EntityLocations[dstCombination->entity(location.entityIndexInCombination).id] = location;
+}
+
+bool EntityManager::planCommand(EntityCommandBuffer::Command& command) {
+    using Opcode = EntityCommandBuffer::Opcode;
+    // Releases only take effect once the playback is finished, so they need not wait for the Entities planned
+    if (command.opcode == Opcode::ReleaseSharedComponentHandle) {
+        executeCommand(command);
+        return true;
+    }
+    // Commands on Entities whose ids are recycled since are dropped
+    if (command.entity.generation != m_EntityLocations.generation(command.entity.id))
+        return true;
+    unsigned int& plannedEntityIndex = m_PlannedEntityIndices[command.entity.id];
+    Archetype* srcArchetype;
+    if (plannedEntityIndex != k_InvalidPlannedIndex)
+        srcArchetype = m_PlannedEntities[plannedEntityIndex].dstArchetype;
+    else {
+        const Archetype::EntityLocation& location = m_EntityLocations[command.entity.id];
+        srcArchetype = location.valid() ? m_Archetypes[location.archetypeId].get() : nullptr;
+    }
+    if (srcArchetype == nullptr && command.opcode != Opcode::CreateEntity)
+        return true;
+    Archetype* dstArchetype = srcArchetype;
+    bool written = false;
+    // Edges and Archetypes are only created here, so that execution leaves them untouched
+    switch (command.opcode) {
+        case Opcode::CreateEntity:
+            if (command.componentId == Archetype::k_InvalidId)
+                command.componentId = emptyArchetype()->id();
+            dstArchetype = m_Archetypes[command.componentId].get();
+            break;
+        case Opcode::DestroyEntity:
+            // Removing manual and shared components touches more than the Archetype
+            if (srcArchetype->partiallyManual() || !srcArchetype->sharedComponentIds().empty())
+                return false;
+            if (srcArchetype->fullyManual())
+                return true;
+            dstArchetype = nullptr;
+            break;
+        case Opcode::AddComponent:
+            if (!srcArchetype->mask().componentMask.test(command.componentId))
+                dstArchetype = addComponentEdge(srcArchetype, command.componentId, command.flag, command.componentSize, command.componentAlign).archetype;
+            written = command.componentSize != 0;
+            break;
+        case Opcode::RemoveComponent:
+            if (srcArchetype->single() && srcArchetype->fullyManual())
+                dstArchetype = nullptr;
+            else if (srcArchetype->mask().componentMask.test(command.componentId))
+                dstArchetype = removeComponentEdge(srcArchetype, command.componentId, command.flag).archetype;
+            else
+                return true;
+            break;
+        // SharedComponents are referenced in the store as they are given, which is left to execution alone
+        case Opcode::AddSharedComponent:
+        case Opcode::RemoveSharedComponent:
+        case Opcode::SetSharedComponent:
+            return false;
+        default:
+            written = true;
+            break;
+    }
+    if (plannedEntityIndex == k_InvalidPlannedIndex) {
+        // Writes to Entities staying where they are are applied at once
+        if (srcArchetype == dstArchetype) {
+            executeCommand(command);
+            return true;
+        }
+        plannedEntityIndex = m_PlannedEntities.size();
+        m_PlannedEntities.push_back(PlannedEntity{command.entity, srcArchetype, dstArchetype, nullptr, k_InvalidPlannedIndex, k_InvalidPlannedIndex});
+    }
+    PlannedEntity& plannedEntity = m_PlannedEntities[plannedEntityIndex];
+    plannedEntity.dstArchetype = dstArchetype;
+    if (written) {
+        const unsigned int writeIndex = m_PlannedWrites.size();
+        m_PlannedWrites.push_back(PlannedWrite{&command, k_InvalidPlannedIndex});
+        if (plannedEntity.firstWrite == k_InvalidPlannedIndex)
+            plannedEntity.firstWrite = writeIndex;
+        else
+            m_PlannedWrites[plannedEntity.lastWrite].next = writeIndex;
+        plannedEntity.lastWrite = writeIndex;
+    }
+    return true;
+}
+
+void EntityManager::executeCommand(const EntityCommandBuffer::Command& command) {
+    using Opcode = EntityCommandBuffer::Opcode;
+    switch (command.opcode) {
+        case Opcode::CreateEntity:
+            createEntityImmediately(command.entity, m_Archetypes[command.componentId].get());
+            break;
+        case Opcode::DestroyEntity:
+            destroyEntityImmediately(command.entity);
+            break;
+        case Opcode::AddComponent:
+            addComponentImmediately(command.entity, command.componentId, command.flag, command.componentSize, command.componentAlign, command.component());
+            break;
+        case Opcode::RemoveComponent:
+            removeComponentImmediately(command.entity, command.componentId, command.flag);
+            break;
+        case Opcode::SetComponent:
+            setComponentImmediately(command.entity, command.componentId, command.component());
+            break;
+        case Opcode::SetComponentEnabled:
+            setComponentEnabledImmediately(command.entity, command.componentId, command.flag);
+            break;
+        case Opcode::AddSharedComponent:
+            addSharedComponentImmediately(command.entity, command.componentId, command.flag, *command.sharedComponentIndex());
+            break;
+        case Opcode::RemoveSharedComponent:
+            removeSharedComponentImmediately(command.entity, command.componentId, command.flag);
+            break;
+        case Opcode::SetSharedComponent:
+            setSharedComponentImmediately(command.entity, command.componentId, *command.sharedComponentIndex());
+            break;
+        case Opcode::ReleaseSharedComponentHandle:
+            // Released already, the index is popped once
+            if (*command.sharedComponentIndex() != ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex)
+                m_ReleasedSharedComponentHandles.emplace_back(command.componentId, command.sharedComponentIndex());
+            break;
+        default:
+            break;
+    }
+}
+
+void EntityManager::executePlannedEntity(const PlannedEntity& plannedEntity) {
+    using Opcode = EntityCommandBuffer::Opcode;
+    const Entity& entity = plannedEntity.entity;
+    Archetype* const srcArchetype = plannedEntity.srcArchetype;
+    Archetype* const dstArchetype = plannedEntity.dstArchetype;
+    if (dstArchetype == nullptr) {
+        if (srcArchetype != nullptr)
+            destroyEntityWithoutCheck(entity, srcArchetype, m_EntityLocations[entity.id]);
+        return;
+    }
+    Archetype::EntityLocation location;
+    if (srcArchetype == nullptr)
+        dstArchetype->addEntity(entity, location);
+    else if (srcArchetype == dstArchetype)
+        location = m_EntityLocations[entity.id];
+    else {
+        const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
+        Entity srcSwappedEntity;
+        dstArchetype->moveEntity(srcLocation, srcArchetype, *plannedEntity.edge, location, srcSwappedEntity);
+        if (srcSwappedEntity.valid())
+            m_EntityLocations[srcSwappedEntity.id] = srcLocation;
+    }
+    m_EntityLocations[entity.id] = location;
+
+    if (plannedEntity.firstWrite == k_InvalidPlannedIndex) return;
+    Combination* const combination = dstArchetype->m_Combinations[location.combinationIndex].get();
+    std::unordered_map<unsigned int, unsigned int> const& componentIndexMap = dstArchetype->m_ChunkLayout.componentIndexMap;
+    for (unsigned int i = plannedEntity.firstWrite; i != k_InvalidPlannedIndex; i = m_PlannedWrites[i].next) {
+        const EntityCommandBuffer::Command& command = *m_PlannedWrites[i].command;
+        // Writes to components removed at last are skipped
+        auto it = componentIndexMap.find(command.componentId);
+        if (it == componentIndexMap.end())
+            continue;
+        if (command.opcode == Opcode::SetComponentEnabled) {
+            combination->setComponentEnabled(location.entityIndexInCombination, it->second, command.flag);
+            continue;
+        }
+        combination->setComponents(location.entityIndexInCombination, 1, it->second, command.component());
+        if (command.opcode == Opcode::AddComponent && m_EnableableComponentMask.test(command.componentId))
+            combination->setComponentEnabled(location.entityIndexInCombination, it->second, true);
+    }
+}
+
+void EntityManager::executePlannedEntities() {
+    if (m_PlannedEntities.empty()) return;
+    // Only the source and the destination Archetype of each Entity are touched
+    for (unsigned int archetypeId = m_PlaybackGroupParents.size(); archetypeId < m_Archetypes.size(); archetypeId++)
+        m_PlaybackGroupParents.push_back(archetypeId);
+    for (PlannedEntity& plannedEntity : m_PlannedEntities)
+        if (plannedEntity.srcArchetype != nullptr && plannedEntity.dstArchetype != nullptr && plannedEntity.srcArchetype != plannedEntity.dstArchetype) {
+            plannedEntity.edge = &transitionEdge(plannedEntity.srcArchetype, plannedEntity.dstArchetype);
+            m_PlaybackGroupParents[playbackGroup(plannedEntity.dstArchetype->id())] = playbackGroup(plannedEntity.srcArchetype->id());
+        }
+
+    std::vector<std::vector<const PlannedEntity*>> groups;
+    if (m_TaskManager != nullptr && m_PlannedEntities.size() >= k_MinParallelPlaybackEntityCount) {
+        std::vector<unsigned int> groupIndices(m_PlaybackGroupParents.size(), k_InvalidPlannedIndex);
+        for (const PlannedEntity& plannedEntity : m_PlannedEntities) {
+            const Archetype* archetype = plannedEntity.srcArchetype != nullptr ? plannedEntity.srcArchetype : plannedEntity.dstArchetype;
+            // Entities created and destroyed in the same change are left out
+            if (archetype == nullptr) continue;
+            unsigned int& groupIndex = groupIndices[playbackGroup(archetype->id())];
+            if (groupIndex == k_InvalidPlannedIndex) {
+                groupIndex = groups.size();
+                groups.emplace_back();
+            }
+            groups[groupIndex].push_back(&plannedEntity);
+        }
+    }
+    if (groups.size() > 1) {
+        // Larger groups are taken first so that smaller ones even out the workers
+        std::sort(groups.begin(), groups.end(), [](std::vector<const PlannedEntity*> const& a, std::vector<const PlannedEntity*> const& b) { return a.size() > b.size(); });
+        // Helpers only join while groups are left, so that the playback task never waits for ones not started yet
+        struct Playback {
+            std::vector<std::vector<const PlannedEntity*>> groups;
+            std::atomic<unsigned int> claimedGroupCount;
+            std::atomic<unsigned int> executedGroupCount;
+        };
+        const std::shared_ptr<Playback> playback = std::make_shared<Playback>(std::move(groups), 0U, 0U);
+        const std::function<void()> executeGroups = [this, playback]() {
+            for (unsigned int i = playback->claimedGroupCount++; i < playback->groups.size(); i = playback->claimedGroupCount++) {
+                for (const PlannedEntity* plannedEntity : playback->groups[i])
+                    executePlannedEntity(*plannedEntity);
+                if (++playback->executedGroupCount == playback->groups.size())
+                    playback->executedGroupCount.notify_all();
+            }
+        };
+        for (std::size_t i = 1; i < std::min<std::size_t>(TaskManager::k_WorkerCount, playback->groups.size()); i++)
+            m_TaskManager->scheduleImmediately(executeGroups);
+        executeGroups();
+        // Every group is claimed by now, the ones left are being executed by running helpers
+        for (unsigned int executedGroupCount = playback->executedGroupCount; executedGroupCount != playback->groups.size(); executedGroupCount = playback->executedGroupCount)
+            playback->executedGroupCount.wait(executedGroupCount);
+    } else
+        for (const PlannedEntity& plannedEntity : m_PlannedEntities)
+            executePlannedEntity(plannedEntity);
+
+    for (const PlannedEntity& plannedEntity : m_PlannedEntities) {
+        m_PlannedEntityIndices[plannedEntity.entity.id] = k_InvalidPlannedIndex;
+        // Ids are recycled here since the execution may be parallel
+        if (plannedEntity.dstArchetype == nullptr)
+            releaseEntity(plannedEntity.entity);
+    }
+    m_PlannedEntities.clear();
+    m_PlannedWrites.clear();
+    std::iota(m_PlaybackGroupParents.begin(), m_PlaybackGroupParents.end(), 0U);
+}
+
+unsigned int EntityManager::playbackGroup(const unsigned int& archetypeId) {
+    unsigned int root = archetypeId;
+    while (m_PlaybackGroupParents[root] != root)
+        root = m_PlaybackGroupParents[root] = m_PlaybackGroupParents[m_PlaybackGroupParents[root]];
+    return root;
+}
+
+std::vector<std::unique_ptr<EntityCommandBuffer>> EntityManager::detachEntityCommandBuffers() {
+    std::vector<std::unique_ptr<EntityCommandBuffer>> buffers;
+    // Procedures recorded by the main EntityCommandBuffer only refer to the EntityManager, so they run from the detached one as well
+    std::unique_ptr<EntityCommandBuffer>& mainBuffer = buffers.emplace_back(std::make_unique<EntityCommandBuffer>(this));
+    mainBuffer->m_Commands.swap(m_MainEntityCommandBuffer.m_Commands);
+    mainBuffer->m_Procedures.swap(m_MainEntityCommandBuffer.m_Procedures);
+    mainBuffer->m_SharedComponentIndices.swap(m_MainEntityCommandBuffer.m_SharedComponentIndices);
+    for (std::unique_ptr<EntityCommandBuffer>& buffer : m_TaskEntityCommandBuffers)
+        buffers.push_back(std::move(buffer));
     m_TaskEntityCommandBuffers.clear();
+    return buffers;
+}
+
+void EntityManager::executeEntityCommandBuffers(std::vector<std::unique_ptr<EntityCommandBuffer>> const& buffers, const unsigned int& globalSystemVersion) {
+    using Command = EntityCommandBuffer::Command;
+    m_PlaybackSystemVersion = globalSystemVersion;
+    m_EntityLocations.grow(m_EntityIdCounter.load());
+    m_PlannedEntityIndices.resize(m_EntityLocations.size(), k_InvalidPlannedIndex);
+    // Consecutive commands mostly share the component
+    unsigned int (*componentIdResolver)(EntityManager*) = nullptr;
+    unsigned int componentId{};
+    for (std::unique_ptr<EntityCommandBuffer> const& buffer : buffers)
+        for (std::size_t offset = 0; offset < buffer->m_Commands.size();) {
+            Command& command = *std::launder(reinterpret_cast<Command*>(buffer->m_Commands.data() + offset));
+            offset += command.stride(offset);
+            if (command.opcode == EntityCommandBuffer::Opcode::Procedure) {
+                executePlannedEntities();
+                buffer->m_Procedures[command.componentId]();
+                continue;
+            }
+            if (command.componentIdResolver != nullptr) {
+                if (command.componentIdResolver != componentIdResolver) {
+                    componentIdResolver = command.componentIdResolver;
+                    componentId = componentIdResolver(this);
+                }
+                command.componentId = componentId;
+            }
+            if (!planCommand(command)) {
+                executePlannedEntities();
+                executeCommand(command);
+            }
+        }
+    executePlannedEntities();
+    for (auto& [sharedComponentId, sharedComponentIndex] : m_ReleasedSharedComponentHandles) {
+        m_SharedComponentStore.pop(sharedComponentId, *sharedComponentIndex);
+        // Commands recorded with the handle after its release fail the check of its index
+        *sharedComponentIndex = ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex;
+    }
+    m_ReleasedSharedComponentHandles.clear();
+    // The main thread may be reserving Entities meanwhile
+    std::lock_guard lock(m_EntityIdMutex);
+    m_FreeEntities.insert(m_FreeEntities.end(), m_ReleasedEntities.begin(), m_ReleasedEntities.end());
+    m_ReleasedEntities.clear();
+    // Entities left reserved by discarded EntityCommandBuffers are handed out again
+    for (std::unique_ptr<EntityCommandBuffer> const& buffer : buffers)
+        m_FreeEntities.insert(m_FreeEntities.end(), buffer->m_ReservedEntities.begin(), buffer->m_ReservedEntities.end());
+    m_FreeEntitiesEmpty.store(m_FreeEntities.empty(), std::memory_order_relaxed);
+}
+
+void EntityManager::executeEntityCommandBuffers() {
+    completeEntityCommandBuffers();
+    std::vector<std::unique_ptr<EntityCommandBuffer>> buffers = detachEntityCommandBuffers();
+    // Structural changes are seen as changed by every system, including the last updated one
+    executeEntityCommandBuffers(buffers, ++m_GlobalSystemVersion);
+    // Nothing is recorded meanwhile, so the main EntityCommandBuffer keeps its capacity
+    buffers.front()->clear();
+    m_MainEntityCommandBuffer.m_Commands.swap(buffers.front()->m_Commands);
+    m_MainEntityCommandBuffer.m_Procedures.swap(buffers.front()->m_Procedures);
+    m_MainEntityCommandBuffer.m_SharedComponentIndices.swap(buffers.front()->m_SharedComponentIndices);
+}
+
+void EntityManager::waitForEntityCommandBuffers() const {
+    m_EntityCommandBufferTaskHandle->complete();
+    m_EntityCommandBufferTaskHandle.reset();
+}
+
+void EntityManager::completeTasks() const {
+    completeEntityCommandBuffers();
+    if (m_DependencyManager == nullptr) return;
+    // Tasks scheduled by the updating system are only queued once it returns
+    m_TaskManager->activateWaitingTasks();
+    for (std::shared_ptr<TaskHandle> const& taskHandle : m_DependencyManager->taskHandles())
+        taskHandle->complete();
+}
+
+void EntityManager::completeComponentAccess(const unsigned int& componentId, const bool& written) const {
+    if (m_DependencyManager == nullptr) return;
+    std::vector<std::shared_ptr<TaskHandle>> const taskHandles = m_DependencyManager->dependencies(componentId, written);
+    if (taskHandles.empty()) return;
+    // Tasks scheduled by the updating system are only queued once it returns
+    m_TaskManager->activateWaitingTasks();
+    for (std::shared_ptr<TaskHandle> const& taskHandle : taskHandles)
+        taskHandle->complete();
 }
 
 }  // namespace Melon
@@ -3,23 +3,33 @@
 #include <MelonCore/Archetype.h>
 #include <MelonCore/ChunkAccessor.h>
 #include <MelonCore/Combination.h>
+#include <MelonCore/ComponentFields.h>
 #include <MelonCore/DataComponent.h>
 #include <MelonCore/Entity.h>
 #include <MelonCore/EntityFilter.h>
-#include <MelonCore/ObjectPool.h>
+#include <MelonCore/EntityLocationTable.h>
 #include <MelonCore/ObjectStore.h>
+#include <MelonCore/Prefetch.h>
 #include <MelonCore/SharedComponent.h>
+#include <MelonCore/SharedComponentHandle.h>
 #include <MelonCore/SingletonComponent.h>
 #include <MelonCore/SingletonObjectStore.h>
+#include <MelonCore/SystemVersion.h>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <span>
 #include <tuple>
 #include <type_traits>
 #include <typeindex>
@@ -30,7 +40,12 @@
 
 namespace Melon {
 
+class DependencyManager;
 class EntityManager;
+class TaskHandle;
+class TaskManager;
+template <typename Type>
+class ComponentLookup;
 
 class ArchetypeBuilder {
   public:
@@ -59,6 +74,12 @@ class EntityFilterBuilder {
     EntityFilterBuilder& requireComponents();
     template <typename... Types>
     EntityFilterBuilder& rejectComponents();
+    // Require components, accepting only chunks where one of them has changed
+    template <typename... Types>
+    EntityFilterBuilder& changed();
+    // Accept only chunks where one of these components has changed, without requiring them
+    template <typename... Types>
+    EntityFilterBuilder& changedIfPresent();
 
     template <typename... Types>
     EntityFilterBuilder& requireSharedComponents();
@@ -69,6 +90,9 @@ class EntityFilterBuilder {
     EntityFilterBuilder& requireSharedComponent(const Type& sharedComponent);
     template <typename Type>
     EntityFilterBuilder& rejectSharedComponent(const Type& sharedComponent);
+    // Without completing EntityCommandBuffers, the filter should not be used once the handle is released
+    template <typename Type>
+    EntityFilterBuilder& requireSharedComponent(const SharedComponentHandle<Type>& sharedComponentHandle);
 
     EntityFilter createEntityFilter();
 
@@ -80,25 +104,48 @@ class EntityFilterBuilder {
     friend class EntityManager;
 };
 
+// Commands are executed in recorded order once the EntityCommandBuffer is played back, those on Entities destroyed by then are dropped
 class EntityCommandBuffer {
   public:
     EntityCommandBuffer(EntityManager* entityManager) noexcept;
 
     Entity createEntity();
     Entity createEntity(Archetype* archetype);
+    // Create entities.size() Entities at once, each of components should point to entities.size() elements
+    template <typename... Types>
+    void createEntities(Archetype* archetype, std::span<Entity> entities, const Types*... components);
+    // Request chunks ahead of creating entityCount Entities of the Archetype
+    void reserve(Archetype* archetype, const unsigned int& entityCount);
     void destroyEntity(const Entity& entity);
+    // Destroy all Entities satisfying the EntityFilter, chunk by chunk
+    void destroyEntities(const EntityFilter& entityFilter);
+    // Adding a component the Entity already has overrides its value, either way it ends up enabled
     template <typename Type>
     void addComponent(const Entity& entity, const Type& component);
+    // Add the component to all Entities satisfying the EntityFilter, chunk by chunk
+    template <typename Type>
+    void addComponent(const EntityFilter& entityFilter, const Type& component);
     template <typename Type>
     void removeComponent(const Entity& entity);
+    // Remove the component from all Entities satisfying the EntityFilter, chunk by chunk
+    template <typename Type>
+    void removeComponent(const EntityFilter& entityFilter);
     template <typename Type>
     void setComponent(const Entity& entity, const Type& component);
+    // Toggle an EnableableDataComponent without moving the Entity
+    template <typename Type>
+    void setComponentEnabled(const Entity& entity, const bool& enabled);
     template <typename Type>
     void addSharedComponent(const Entity& entity, const Type& sharedComponent);
     template <typename Type>
     void removeSharedComponent(const Entity& entity);
     template <typename Type>
     void setSharedComponent(const Entity& entity, const Type& sharedComponent);
+    // Give the SharedComponent of the handle without hashing it, the handle should not be released before the EntityCommandBuffer is executed
+    template <typename Type>
+    void addSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle);
+    template <typename Type>
+    void setSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle);
     template <typename Type>
     void addSingletonComponent(const Type& singletonComponent);
     template <typename Type>
@@ -107,10 +154,73 @@ class EntityCommandBuffer {
     void setSingletonComponent(const Type& singletonComponent);
 
   private:
-    void execute();
+    enum class Opcode : std::uint8_t {
+        CreateEntity,
+        DestroyEntity,
+        AddComponent,
+        RemoveComponent,
+        SetComponent,
+        SetComponentEnabled,
+        AddSharedComponent,
+        RemoveSharedComponent,
+        SetSharedComponent,
+        // Queues the SharedComponent of the handle to be popped once the playback is finished, without an Entity
+        ReleaseSharedComponentHandle,
+        // Runs m_Procedures[componentId], the rest of commands are played back around it
+        Procedure,
+    };
+
+    // Commands are encoded one after another into a byte stream, each followed by componentSize bytes of the component aligned to componentAlign
+    // Commands of SharedComponentHandles are followed by the address of the handle index instead, held by m_SharedComponentIndices
+    struct Command {
+        // The stream is allocated at the alignment of operator new, so offsets into it are aligned as the addresses are
+        static constexpr std::size_t componentOffset(const std::size_t& offset, const std::size_t& componentAlign) { return (offset + sizeof(Command) + componentAlign - 1) / componentAlign * componentAlign - offset; }
+        static constexpr std::size_t stride(const std::size_t& offset, const std::size_t& componentSize, const std::size_t& componentAlign) {
+            const std::size_t size = componentSize != 0 ? componentOffset(offset, componentAlign) + componentSize : sizeof(Command);
+            return (size + alignof(Command) - 1) / alignof(Command) * alignof(Command);
+        }
+
+        std::size_t stride(const std::size_t& offset) const { return stride(offset, componentSize, componentAlign); }
+        const void* component() const { return reinterpret_cast<const std::byte*>(this) + componentOffset(reinterpret_cast<std::uintptr_t>(this), componentAlign); }
+        unsigned int* sharedComponentIndex() const { return *static_cast<unsigned int* const*>(component()); }
+
+        Opcode opcode;
+        // Whether the component is manual, or whether to enable it
+        bool flag;
+        std::uint16_t componentAlign;
+        unsigned int componentSize;
+        Entity entity;
+        // Resolved by componentIdResolver on playback, since components can't be registered concurrently
+        // Id of the Archetype the Entity is created in for CreateEntity, Archetype::k_InvalidId for the empty one
+        unsigned int componentId;
+        unsigned int (*componentIdResolver)(EntityManager*);
+    };
+
+    template <typename Type>
+    static unsigned int resolveComponentId(EntityManager* entityManager);
+    template <typename Type>
+    static unsigned int resolveSharedComponentId(EntityManager* entityManager);
+
+    template <typename Type>
+    void pushCommand(const Opcode& opcode, const Entity& entity, const bool& flag, const Type* component);
+    void pushCommand(const Opcode& opcode, const Entity& entity, Archetype* archetype);
+    // sharedComponentIndex is null for commands without a handle
+    template <typename Type>
+    void pushSharedComponentCommand(const Opcode& opcode, const Entity& entity, std::shared_ptr<unsigned int> const& sharedComponentIndex);
+    void pushProcedure(std::function<void()>&& procedure);
+    void clear();
+
+    Entity assignEntity();
+    void assignEntities(std::span<Entity> entities);
 
     EntityManager* m_EntityManager;
-    std::vector<std::function<void()>> m_Procedures;  // TODO: Improve performance
+    // Entities reserved from the EntityManager but not handed out yet, taken from the back
+    std::vector<Entity> m_ReservedEntities;
+    std::vector<std::byte> m_Commands;
+    // Commands without a compact encoding, which are played back in order but one at a time
+    std::vector<std::function<void()>> m_Procedures;
+    // Indices of the SharedComponentHandles given to commands, kept until the commands are played back even if every handle is dropped
+    std::vector<std::shared_ptr<unsigned int>> m_SharedComponentIndices;
 
     friend class EntityManager;
 };
@@ -118,6 +228,12 @@ class EntityCommandBuffer {
 class EntityManager {
   public:
     static constexpr unsigned int k_MaxSingletonComponentIdCount = 256U;
+    // Entity ids are reserved by EntityCommandBuffers in blocks of this size
+    static constexpr unsigned int k_EntityIdBlockSize = 64U;
+    // Batched component lookups resolve Entities this far ahead of copying their components
+    static constexpr unsigned int k_LookupPrefetchDistance = 8U;
+    // Fewer Entities changed between two commands executed alone are changed serially
+    static constexpr unsigned int k_MinParallelPlaybackEntityCount = 1024U;
 
     EntityManager();
     EntityManager(const EntityManager&) = delete;
@@ -128,19 +244,47 @@ class EntityManager {
 
     Entity createEntity();
     Entity createEntity(Archetype* archetype);
+    // Create entities.size() Entities at once, each of components should point to entities.size() elements
+    template <typename... Types>
+    void createEntities(Archetype* archetype, std::span<Entity> entities, const Types*... components);
+    // Request chunks ahead of creating entityCount Entities of the Archetype
+    void reserve(Archetype* archetype, const unsigned int& entityCount);
     void destroyEntity(const Entity& entity);
+    // Destroy all Entities satisfying the EntityFilter, chunk by chunk
+    void destroyEntities(const EntityFilter& entityFilter);
+    // Adding a component the Entity already has overrides its value, either way it ends up enabled
     template <typename Type>
     void addComponent(const Entity& entity, const Type& component);
+    // Add the component to all Entities satisfying the EntityFilter, chunk by chunk
+    template <typename Type>
+    void addComponent(const EntityFilter& entityFilter, const Type& component);
     template <typename Type>
     void removeComponent(const Entity& entity);
+    // Remove the component from all Entities satisfying the EntityFilter, chunk by chunk
+    template <typename Type>
+    void removeComponent(const EntityFilter& entityFilter);
     template <typename Type>
     void setComponent(const Entity& entity, const Type& component);
+    // Toggle an EnableableDataComponent without moving the Entity
+    template <typename Type>
+    void setComponentEnabled(const Entity& entity, const bool& enabled);
     template <typename Type>
     void addSharedComponent(const Entity& entity, const Type& sharedComponent);
     template <typename Type>
     void removeSharedComponent(const Entity& entity);
     template <typename Type>
     void setSharedComponent(const Entity& entity, const Type& sharedComponent);
+    // Store the SharedComponent once for Entities to be given it by the handle, hashed when EntityCommandBuffers are executed
+    template <typename Type>
+    SharedComponentHandle<Type> createSharedComponentHandle(const Type& sharedComponent);
+    // Drop the reference of the handle once EntityCommandBuffers are executed, commands already recorded with it still apply and later ones are dropped
+    template <typename Type>
+    void releaseSharedComponentHandle(const SharedComponentHandle<Type>& sharedComponentHandle);
+    // Give the SharedComponent of the handle without hashing it
+    template <typename Type>
+    void addSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle);
+    template <typename Type>
+    void setSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle);
     template <typename Type>
     void addSingletonComponent(const Type& singletonComponent);
     template <typename Type>
@@ -148,8 +292,15 @@ class EntityManager {
     template <typename Type>
     void setSingletonComponent(const Type& singletonComponent);
 
+    // Wait for the execution of EntityCommandBuffers scheduled by the World
+    // Accesses to Archetypes and Entities from the main thread wait by themselves, while commands are recorded without waiting
+    // So do accesses to components by Entity, but not those to chunks got from filterEntities(), see SystemBase::completeComponentAccess()
+    void completeEntityCommandBuffers() const;
+
     EntityFilterBuilder createEntityFilterBuilder() { return EntityFilterBuilder(this); }
-    std::vector<ChunkAccessor> filterEntities(const EntityFilter& entityFilter);
+    // Changed components of the EntityFilter are compared with lastSystemVersion
+    // Tasks using the components of the chunks are not waited for
+    std::vector<ChunkAccessor> filterEntities(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion = 0);
 
     template <typename Type>
     unsigned int componentId();
@@ -161,13 +312,54 @@ class EntityManager {
     template <typename Type>
     const Type* sharedComponent(const unsigned int& sharedComponentIndex) const;
     template <typename Type>
-    unsigned int sharedComponentIndex(const Type& sharedComponent) const;
+    unsigned int sharedComponentIndex(const Type& sharedComponent);
 
     template <typename Type>
     Type* singletonComponent(const unsigned int& singletonComponentId) const;
 
-    unsigned int chunkCount(const EntityFilter& entityFilter) const;
-    unsigned int entityCount(const EntityFilter& entityFilter) const;
+    unsigned int chunkCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion = 0) const;
+    unsigned int entityCount(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion = 0) const;
+
+    // Whether the Entity is created by executed EntityCommandBuffers and not destroyed since
+    bool alive(const Entity& entity) const;
+    // Random access by Entity, which waits for the EntityCommandBuffers and the scheduled tasks writing the component, or reading it for writes
+    // The Entity should be alive and have the component, SoA components are gathered into a value
+    template <typename Type>
+    std::conditional_t<k_SoAComponent<Type>, Type, const Type&> component(const Entity& entity);
+    // Null if the Entity is destroyed or lacks the component, not for SoA components which have no contiguous value
+    template <typename Type>
+    const Type* tryComponent(const Entity& entity);
+    // Write the component at once instead of through the EntityCommandBuffer, returns false if the Entity is destroyed or lacks it
+    template <typename Type>
+    bool writeComponent(const Entity& entity, const Type& component);
+    // Copy the components of many Entities, with lookups overlapped by prefetching
+    // Slots of Entities destroyed or lacking the component are left untouched, returns how many are copied
+    template <typename Type>
+    unsigned int gatherComponents(std::span<const Entity> entities, Type* components);
+    // Write the components of many Entities at once like gatherComponents(), returns how many are written
+    template <typename Type>
+    unsigned int scatterComponents(std::span<const Entity> entities, const Type* components);
+
+    // Increased before each system update and each execution of EntityCommandBuffers
+    const unsigned int& globalSystemVersion() const { return m_GlobalSystemVersion; }
+
+    // Returns fully free chunk slabs to the system, which should be called when no EntityCommandBuffer is executing
+    void trimChunks();
+    ChunkAllocator::Stats chunkStats() const;
+
+    struct CompactionStats {
+        // Returned to the system from slabs emptied by the compaction
+        std::size_t reclaimedBytes;
+        // Spare chunks recycled
+        unsigned int freedChunkCount;
+        // Chunks moved out of sparse slabs
+        unsigned int relocatedChunkCount;
+        // Whether the pass over all Archetypes is finished, the next call starts a new one
+        bool completed;
+    };
+    // Compacts Archetypes in turn until the budget runs out, resuming where the previous call stopped
+    // Chunks move under tasks holding their addresses, so it waits for every task scheduled so far and the EntityCommandBuffers they precede
+    CompactionStats compactChunks(const std::chrono::nanoseconds& budget);
 
   private:
     template <typename Type>
@@ -179,23 +371,38 @@ class EntityManager {
     template <typename Type>
     unsigned int registerSingletonComponent();
     unsigned int registerSingletonComponent(const std::type_index& typeIndex);
+    // Archetypes created on playback skip waiting for it
+    Archetype* emptyArchetype();
     Archetype* createArchetype(ArchetypeMask&& mask, std::vector<unsigned int>&& componentIds, std::vector<std::size_t>&& componentSizes, std::vector<std::size_t>&& componentAligns, std::vector<unsigned int>&& sharedComponentIds);
-    Entity assignEntity();
+    const Archetype::Edge& addComponentEdge(Archetype* srcArchetype, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align);
+    const Archetype::Edge& removeComponentEdge(Archetype* srcArchetype, const unsigned int& componentId, const bool& manual);
+    const Archetype::Edge& addSharedComponentEdge(Archetype* srcArchetype, const unsigned int& sharedComponentId, const bool& manual);
+    const Archetype::Edge& removeSharedComponentEdge(Archetype* srcArchetype, const unsigned int& sharedComponentId, const bool& manual);
+    // Appends at most count unused Entities to be handed out from the back, recycled ids first
+    void reserveEntities(const unsigned int& count, std::vector<Entity>& entities);
+    // Recycle the id of a destroyed Entity with the next generation once the playback is finished, which is only called serially on playback
+    void releaseEntity(const Entity& entity);
     void createEntityImmediately(const Entity& entity);
     void createEntityImmediately(const Entity& entity, Archetype* archetype);
+    void createEntitiesImmediately(std::vector<Entity> const& entities, Archetype* archetype, std::vector<unsigned int> const& componentIds, std::vector<std::byte> const& componentData);
+    void reserveImmediately(Archetype* archetype, const unsigned int& entityCount);
     void destroyEntityImmediately(const Entity& entityId);
+    void destroyEntitiesImmediately(const EntityFilter& entityFilter);
+    void addComponentImmediately(const Entity& entity, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align, const void* component);
     template <typename Type>
-    void addComponentImmediately(const Entity& entity, const Type& component);
-    template <typename Type>
-    void removeComponentImmediately(const Entity& entity);
+    void addComponentImmediately(const EntityFilter& entityFilter, const Type& component);
+    void removeComponentImmediately(const Entity& entity, const unsigned int& componentId, const bool& manual);
     template <typename Type>
-    void setComponentImmediately(const Entity& entity, const Type& component);
+    void removeComponentImmediately(const EntityFilter& entityFilter);
+    void setComponentImmediately(const Entity& entity, const unsigned int& componentId, const void* component);
+    void setComponentEnabledImmediately(const Entity& entity, const unsigned int& componentId, const bool& enabled);
     template <typename Type>
     void addSharedComponentImmediately(const Entity& entity, const Type& sharedComponent);
     template <typename Type>
-    void removeSharedComponentImmediately(const Entity& entity);
-    template <typename Type>
     void setSharedComponentImmediately(const Entity& entity, const Type& sharedComponent);
+    void addSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual, const unsigned int& sharedComponentIndex);
+    void removeSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual);
+    void setSharedComponentImmediately(const Entity& entity, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex);
     template <typename Type>
     void addSingletonComponentImmediately(const Type& singletonComponent);
     template <typename Type>
@@ -205,15 +412,81 @@ class EntityManager {
 
     void destroyEntityWithoutCheck(const Entity& entity, Archetype* archetype, const Archetype::EntityLocation& location);
     void removeComponentWithoutCheck(const Entity& entity, const unsigned int& componentId, const bool& manual);
+    // The SharedComponent at sharedComponentIndex should already be referenced for the Entity
+    void addSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual, const unsigned int& sharedComponentIndex);
     void removeSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const bool& manual);
-
+    void setSharedComponentWithoutCheck(const Entity& entity, const unsigned int& sharedComponentId, const unsigned int& sharedComponentIndex);
+    std::vector<Archetype*> filterArchetypes(const EntityFilter& entityFilter) const;
+    // Filtered without waiting for EntityCommandBuffers, written components of the ChunkAccessors are marked with globalSystemVersion
+    std::vector<ChunkAccessor> filterEntitiesWithoutCheck(const EntityFilter& entityFilter, const unsigned int& lastSystemVersion, const unsigned int& globalSystemVersion) const;
+    void addComponentWithoutCheck(const EntityFilter& entityFilter, const unsigned int& componentId, const bool& manual, const std::size_t& size, const std::size_t& align, const void* component);
+    void removeComponentWithoutCheck(const EntityFilter& entityFilter, const unsigned int& componentId, const bool& manual);
+    void destroyEntitiesWithoutCheck(Archetype* archetype, const unsigned int& combinationIndex);
+    void moveEntitiesWithoutCheck(Archetype* srcArchetype, const unsigned int& srcCombinationIndex, const Archetype::Edge& edge, const void* component);
+
+    const Archetype::Edge& transitionEdge(Archetype* srcArchetype, Archetype* dstArchetype);
+
+    // Registered id of the component, cached for the type looked up last
+    template <typename Type>
+    unsigned int lookupComponentId();
+    // Null if the Entity is destroyed or lacks the component, whose chunk is marked changed with globalSystemVersion if written
+    void* componentAddress(const Entity& entity, const unsigned int& componentId, const bool& written, const unsigned int& globalSystemVersion) const;
+    // Also gives the distance between the fields of SoA components, 0 when the address is null
+    void* componentAddress(const Entity& entity, const unsigned int& componentId, const bool& written, const unsigned int& globalSystemVersion, std::size_t& fieldStride) const;
+    // Whether the component of the Entity is written after lastSystemVersion, false if the Entity is destroyed or lacks the component
+    bool componentChanged(const Entity& entity, const unsigned int& componentId, const unsigned int& lastSystemVersion) const;
+    // Calls function(i, address, fieldStride) for each of entities having the component, addresses are resolved ahead of the calls
+    template <typename Function>
+    void forEachComponentAddress(std::span<const Entity> entities, const unsigned int& componentId, const bool& written, Function&& function) const;
+
+    // Net change of an Entity folded from its commands between two commands executed alone
+    struct PlannedEntity {
+        Entity entity;
+        // Null if the Entity is created by the change
+        Archetype* srcArchetype;
+        // Null if the Entity is destroyed by the change
+        Archetype* dstArchetype;
+        const Archetype::Edge* edge;
+        // Writes of component values and enabled states in the recorded order, applied after the single move
+        unsigned int firstWrite;
+        unsigned int lastWrite;
+    };
+
+    struct PlannedWrite {
+        const EntityCommandBuffer::Command* command;
+        unsigned int next;
+    };
+
+    // Folds the command into the change of its Entity, returns false if it should be executed alone
+    bool planCommand(EntityCommandBuffer::Command& command);
+    void executeCommand(const EntityCommandBuffer::Command& command);
+    void executePlannedEntity(const PlannedEntity& plannedEntity);
+    // Entities touching disjoint Archetypes are changed in parallel
+    void executePlannedEntities();
+    unsigned int playbackGroup(const unsigned int& archetypeId);
+    // Moves the recorded commands out, so that new ones are recorded while they are executed
+    std::vector<std::unique_ptr<EntityCommandBuffer>> detachEntityCommandBuffers();
+    void executeEntityCommandBuffers(std::vector<std::unique_ptr<EntityCommandBuffer>> const& buffers, const unsigned int& globalSystemVersion);
     void executeEntityCommandBuffers();
+    void waitForEntityCommandBuffers() const;
+    // Wait for the execution of EntityCommandBuffers and every task scheduled after it
+    void completeTasks() const;
+    // Wait for tasks scheduled so far which read the component if written, or write it, before the main thread accesses it
+    void completeComponentAccess(const unsigned int& componentId, const bool& written) const;
 
     std::unordered_map<std::type_index, unsigned int> m_ComponentIdMap;
     std::unordered_map<std::type_index, unsigned int> m_SharedComponentIdMap;
     std::unordered_map<std::type_index, unsigned int> m_SingletonComponentIdMap;
+    ArchetypeMask::ComponentMask m_EnableableComponentMask;
+    ArchetypeMask::ComponentMask m_SoAComponentMask;
+
+    ChunkAllocator m_ChunkAllocator;
 
-    ObjectPool<Chunk> m_ChunkPool;
+    // Starts from 1 so that everything is changed for a system never updated
+    // Only increased on the main thread, tasks are given the values they mark chunks with
+    unsigned int m_GlobalSystemVersion{1};
+    // The global system version of the executing EntityCommandBuffers, which marks chunks changed by them
+    unsigned int m_PlaybackSystemVersion{1};
 
     ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount> m_SharedComponentStore;
     SingletonObjectStore<k_MaxSingletonComponentIdCount> m_SingletonComponentStore;
@@ -221,21 +494,51 @@ class EntityManager {
     unsigned int m_ArchetypeIdCounter{};
     std::unordered_map<ArchetypeMask, Archetype*, ArchetypeMask::Hash> m_ArchetypeMap;
     std::vector<std::unique_ptr<Archetype>> m_Archetypes;
+    // Where the next compactChunks() resumes from
+    unsigned int m_CompactionArchetypeIndex{};
+    unsigned int m_CompactionCombinationIndex{};
 
-    // TODO: To avoid contention, a few reserved Entity id could be passed to EntityCommandBuffer in main thread.
+    std::atomic<unsigned int> m_EntityIdCounter{};
+    // Unused Entities of recycled ids, only guarded by the mutex when there are any
     std::mutex m_EntityIdMutex;
-    unsigned int m_EntityIdCounter{};
-    std::queue<unsigned int> m_FreeEntityIds;
+    std::vector<Entity> m_FreeEntities;
+    std::atomic<bool> m_FreeEntitiesEmpty{true};
+    // Entities destroyed on playback, moved to m_FreeEntities once it is finished
+    std::vector<Entity> m_ReleasedEntities;
+    // SharedComponentHandles released on playback, popped once it is finished since later EntityCommandBuffers may still use them
+    // The indices are held by the EntityCommandBuffers played back until then
+    std::vector<std::pair<unsigned int, unsigned int*>> m_ReleasedSharedComponentHandles;
 
-    std::vector<Archetype::EntityLocation> m_EntityLocations;
+    // Grown to cover reserved Entity ids when EntityCommandBuffers are executed
+    EntityLocationTable m_EntityLocations;
+
+    // Random access mostly repeats one type, whose id is cached since the type lookup costs more than the access
+    unsigned int (*m_LookupComponentIdResolver)(EntityManager*){};
+    unsigned int m_LookupComponentId{};
 
     EntityCommandBuffer m_MainEntityCommandBuffer;
     std::vector<std::unique_ptr<EntityCommandBuffer>> m_TaskEntityCommandBuffers;
 
+    // Set by World to play back EntityCommandBuffers in parallel
+    TaskManager* m_TaskManager{};
+    // Set by World, whose tasks are waited for before the main thread accesses components they use or moves chunks under them
+    DependencyManager* m_DependencyManager{};
+    // Execution of EntityCommandBuffers scheduled by World, reset once waited for on the main thread
+    mutable std::shared_ptr<TaskHandle> m_EntityCommandBufferTaskHandle;
+    static constexpr unsigned int k_InvalidPlannedIndex = std::numeric_limits<unsigned int>::max();
+    // Index of each Entity in m_PlannedEntities, k_InvalidPlannedIndex for Entities not touched
+    std::vector<unsigned int> m_PlannedEntityIndices;
+    std::vector<PlannedEntity> m_PlannedEntities;
+    std::vector<PlannedWrite> m_PlannedWrites;
+    // Union-find forest grouping Archetypes touched by the same Entities
+    std::vector<unsigned int> m_PlaybackGroupParents;
+
     friend class ArchetypeBuilder;
     friend class EntityCommandBuffer;
     friend class World;
     friend class SystemBase;
+    template <typename Type>
+    friend class ComponentLookup;
 };
 
 template <typename... Types>
@@ -245,9 +548,14 @@ ArchetypeBuilder& ArchetypeBuilder::markComponents() {
     std::vector<unsigned int> const componentIds{m_EntityManager->componentId<Types>()...};
     std::vector<std::size_t> const componentSizes{sizeof(Types)...};
     std::vector<std::size_t> const componentAligns{alignof(Types)...};
-    m_ComponentIds.insert(m_ComponentIds.end(), componentIds.begin(), componentIds.end());
-    m_ComponentSizes.insert(m_ComponentSizes.end(), componentSizes.begin(), componentSizes.end());
-    m_ComponentAligns.insert(m_ComponentAligns.end(), componentAligns.begin(), componentAligns.end());
+    std::vector<bool> const tags{k_TagComponent<Types>...};
+    // Tags only mark the mask
+    for (unsigned int i = 0; i < componentIds.size(); i++) {
+        if (tags[i]) continue;
+        m_ComponentIds.push_back(componentIds[i]);
+        m_ComponentSizes.push_back(componentSizes[i]);
+        m_ComponentAligns.push_back(componentAligns[i]);
+    }
     m_Mask.markComponents(componentIds, {std::is_base_of_v<ManualDataComponent, Types>...});
     return *this;
 }
@@ -262,6 +570,7 @@ ArchetypeBuilder& ArchetypeBuilder::markSharedComponents() {
 }
 
 inline Archetype* ArchetypeBuilder::createArchetype() {
+    m_EntityManager->completeEntityCommandBuffers();
     return m_EntityManager->createArchetype(std::move(m_Mask), std::move(m_ComponentIds), std::move(m_ComponentSizes), std::move(m_ComponentAligns), std::move(m_SharedComponentIds));
 }
 
@@ -283,6 +592,28 @@ EntityFilterBuilder& EntityFilterBuilder::rejectComponents() {
     return *this;
 }
 
+template <typename... Types>
+EntityFilterBuilder& EntityFilterBuilder::changed() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<DataComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<DataComponent, Types>>..., std::true_type>>);
+    static_assert(!(k_TagComponent<Types> || ...), "Tag components have no version to compare");
+    std::vector<unsigned int> const& componentIds{m_EntityManager->componentId<Types>()...};
+    for (const unsigned int& cmptId : componentIds) {
+        m_EntityFilter.requiredComponentMask.set(cmptId);
+        m_EntityFilter.changedComponentMask.set(cmptId);
+    }
+    return *this;
+}
+
+template <typename... Types>
+EntityFilterBuilder& EntityFilterBuilder::changedIfPresent() {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<DataComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<DataComponent, Types>>..., std::true_type>>);
+    static_assert(!(k_TagComponent<Types> || ...), "Tag components have no version to compare");
+    std::vector<unsigned int> const& componentIds{m_EntityManager->componentId<Types>()...};
+    for (const unsigned int& cmptId : componentIds)
+        m_EntityFilter.changedComponentMask.set(cmptId);
+    return *this;
+}
+
 template <typename... Types>
 EntityFilterBuilder& EntityFilterBuilder::requireSharedComponents() {
     static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<SharedComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<SharedComponent, Types>>..., std::true_type>>);
@@ -319,39 +650,111 @@ EntityFilterBuilder& EntityFilterBuilder::rejectSharedComponent(const Type& shar
     return *this;
 }
 
+template <typename Type>
+EntityFilterBuilder& EntityFilterBuilder::requireSharedComponent(const SharedComponentHandle<Type>& sharedComponentHandle) {
+    m_EntityFilter.requiredSharedComponentIdAndHandleIndices.emplace_back(m_EntityManager->sharedComponentId<Type>(), sharedComponentHandle.m_SharedComponentIndex);
+    return *this;
+}
+
 inline EntityFilter EntityFilterBuilder::createEntityFilter() {
     std::sort(m_EntityFilter.requiredSharedComponentIdAndIndices.begin(), m_EntityFilter.requiredSharedComponentIdAndIndices.end());
+    std::sort(m_EntityFilter.rejectedSharedComponentIdAndIndices.begin(), m_EntityFilter.rejectedSharedComponentIdAndIndices.end());
     return std::move(m_EntityFilter);
 }
 
+template <typename Type>
+unsigned int EntityCommandBuffer::resolveComponentId(EntityManager* entityManager) {
+    return entityManager->registerComponent<Type>();
+}
+
+template <typename Type>
+unsigned int EntityCommandBuffer::resolveSharedComponentId(EntityManager* entityManager) {
+    return entityManager->registerSharedComponent<Type>();
+}
+
+template <typename Type>
+void EntityCommandBuffer::pushCommand(const Opcode& opcode, const Entity& entity, const bool& flag, const Type* component) {
+    // Tags and removals carry no component
+    const unsigned int componentSize = component != nullptr && !k_TagComponent<Type> ? sizeof(Type) : 0;
+    static_assert(alignof(Type) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Components recorded into EntityCommandBuffers are aligned within their stream");
+    const std::size_t offset = m_Commands.size();
+    m_Commands.resize(offset + Command::stride(offset, componentSize, alignof(Type)));
+    new (m_Commands.data() + offset) Command{opcode, flag, alignof(Type), componentSize, entity, 0, &resolveComponentId<Type>};
+    if (componentSize != 0)
+        memcpy(m_Commands.data() + offset + Command::componentOffset(offset, alignof(Type)), component, componentSize);
+}
+
+template <typename Type>
+void EntityCommandBuffer::pushSharedComponentCommand(const Opcode& opcode, const Entity& entity, std::shared_ptr<unsigned int> const& sharedComponentIndex) {
+    const unsigned int componentSize = sharedComponentIndex != nullptr ? sizeof(unsigned int*) : 0;
+    const std::size_t offset = m_Commands.size();
+    m_Commands.resize(offset + Command::stride(offset, componentSize, alignof(unsigned int*)));
+    new (m_Commands.data() + offset) Command{opcode, std::is_base_of_v<ManualSharedComponent, Type>, alignof(unsigned int*), componentSize, entity, 0, &resolveSharedComponentId<Type>};
+    if (componentSize == 0) return;
+    unsigned int* const address = m_SharedComponentIndices.emplace_back(sharedComponentIndex).get();
+    memcpy(m_Commands.data() + offset + Command::componentOffset(offset, alignof(unsigned int*)), &address, sizeof(address));
+}
+
+template <typename... Types>
+void EntityCommandBuffer::createEntities(Archetype* archetype, std::span<Entity> entities, const Types*... components) {
+    static_assert(std::is_same_v<std::tuple<std::true_type, std::bool_constant<std::is_base_of_v<DataComponent, Types>>...>, std::tuple<std::bool_constant<std::is_base_of_v<DataComponent, Types>>..., std::true_type>>);
+    static_assert(!(k_TagComponent<Types> || ...), "Tag components have no value to copy");
+    assignEntities(entities);
+    // Components are copied because the source arrays may not live until execution
+    std::vector<std::byte> componentData((sizeof(Types) + ... + 0) * entities.size());
+    std::byte* address = componentData.data();
+    ((memcpy(address, components, sizeof(Types) * entities.size()), address += sizeof(Types) * entities.size()), ...);
+    pushProcedure([this, archetype, entities = std::vector<Entity>(entities.begin(), entities.end()), componentData = std::move(componentData)]() {
+        m_EntityManager->createEntitiesImmediately(entities, archetype, {m_EntityManager->registerComponent<Types>()...}, componentData);
+    });
+}
+
 template <typename Type>
 void EntityCommandBuffer::addComponent(const Entity& entity, const Type& component) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
-    m_Procedures.emplace_back([this, entity, component]() {
-        m_EntityManager->addComponentImmediately(entity, component);
+    pushCommand(Opcode::AddComponent, entity, std::is_base_of_v<ManualDataComponent, Type>, &component);
+}
+
+template <typename Type>
+void EntityCommandBuffer::addComponent(const EntityFilter& entityFilter, const Type& component) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    pushProcedure([this, entityFilter, component]() {
+        m_EntityManager->addComponentImmediately(entityFilter, component);
     });
 }
 
 template <typename Type>
 void EntityCommandBuffer::removeComponent(const Entity& entity) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
-    m_Procedures.emplace_back([this, entity]() {
-        m_EntityManager->removeComponentImmediately<Type>(entity);
+    pushCommand<Type>(Opcode::RemoveComponent, entity, std::is_base_of_v<ManualDataComponent, Type>, nullptr);
+}
+
+template <typename Type>
+void EntityCommandBuffer::removeComponent(const EntityFilter& entityFilter) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    pushProcedure([this, entityFilter]() {
+        m_EntityManager->removeComponentImmediately<Type>(entityFilter);
     });
 }
 
 template <typename Type>
 void EntityCommandBuffer::setComponent(const Entity& entity, const Type& component) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
-    m_Procedures.emplace_back([this, entity, component]() {
-        m_EntityManager->setComponentImmediately(entity, component);
-    });
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to set");
+    pushCommand(Opcode::SetComponent, entity, false, &component);
+}
+
+template <typename Type>
+void EntityCommandBuffer::setComponentEnabled(const Entity& entity, const bool& enabled) {
+    static_assert(std::is_base_of_v<EnableableDataComponent, Type>);
+    pushCommand<Type>(Opcode::SetComponentEnabled, entity, enabled, nullptr);
 }
 
 template <typename Type>
 void EntityCommandBuffer::addSharedComponent(const Entity& entity, const Type& sharedComponent) {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
-    m_Procedures.emplace_back([this, entity, sharedComponent]() {
+    // SharedComponents need not be trivially copyable, so values are kept by procedures rather than copied into the stream
+    pushProcedure([this, entity, sharedComponent]() {
         m_EntityManager->addSharedComponentImmediately(entity, sharedComponent);
     });
 }
@@ -359,23 +762,34 @@ void EntityCommandBuffer::addSharedComponent(const Entity& entity, const Type& s
 template <typename Type>
 void EntityCommandBuffer::removeSharedComponent(const Entity& entity) {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
-    m_Procedures.emplace_back([this, entity]() {
-        m_EntityManager->removeSharedComponentImmediately<Type>(entity);
-    });
+    pushSharedComponentCommand<Type>(Opcode::RemoveSharedComponent, entity, nullptr);
 }
 
 template <typename Type>
 void EntityCommandBuffer::setSharedComponent(const Entity& entity, const Type& sharedComponent) {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
-    m_Procedures.emplace_back([this, entity, sharedComponent]() {
+    pushProcedure([this, entity, sharedComponent]() {
         m_EntityManager->setSharedComponentImmediately(entity, sharedComponent);
     });
 }
 
+template <typename Type>
+void EntityCommandBuffer::addSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle) {
+    if (!sharedComponentHandle.valid()) return;
+    // The command shares the index, which is resolved by the playback creating the handle and invalidated by the one releasing it
+    pushSharedComponentCommand<Type>(Opcode::AddSharedComponent, entity, sharedComponentHandle.m_SharedComponentIndex);
+}
+
+template <typename Type>
+void EntityCommandBuffer::setSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle) {
+    if (!sharedComponentHandle.valid()) return;
+    pushSharedComponentCommand<Type>(Opcode::SetSharedComponent, entity, sharedComponentHandle.m_SharedComponentIndex);
+}
+
 template <typename Type>
 void EntityCommandBuffer::addSingletonComponent(const Type& singletonComponent) {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
-    m_Procedures.emplace_back([this, singletonComponent]() {
+    pushProcedure([this, singletonComponent]() {
         m_EntityManager->addSingletonComponentImmediately(singletonComponent);
     });
 }
@@ -383,7 +797,7 @@ void EntityCommandBuffer::addSingletonComponent(const Type& singletonComponent)
 template <typename Type>
 void EntityCommandBuffer::removeSingletonComponent() {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
-    m_Procedures.emplace_back([this]() {
+    pushProcedure([this]() {
         m_EntityManager->removeSingletonComponentImmediately<Type>();
     });
 }
@@ -391,29 +805,53 @@ void EntityCommandBuffer::removeSingletonComponent() {
 template <typename Type>
 void EntityCommandBuffer::setSingletonComponent(const Type& singletonComponent) {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
-    m_Procedures.emplace_back([this, singletonComponent]() {
+    pushProcedure([this, singletonComponent]() {
         m_EntityManager->setSingletonComponentImmediately(singletonComponent);
     });
 }
 
+template <typename... Types>
+void EntityManager::createEntities(Archetype* archetype, std::span<Entity> entities, const Types*... components) {
+    m_MainEntityCommandBuffer.createEntities(archetype, entities, components...);
+}
+
 template <typename Type>
 void EntityManager::addComponent(const Entity& entity, const Type& component) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
     m_MainEntityCommandBuffer.addComponent(entity, component);
 }
 
+template <typename Type>
+void EntityManager::addComponent(const EntityFilter& entityFilter, const Type& component) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    m_MainEntityCommandBuffer.addComponent(entityFilter, component);
+}
+
 template <typename Type>
 void EntityManager::removeComponent(const Entity& entity) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
     m_MainEntityCommandBuffer.removeComponent<Type>(entity);
 }
 
+template <typename Type>
+void EntityManager::removeComponent(const EntityFilter& entityFilter) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    m_MainEntityCommandBuffer.removeComponent<Type>(entityFilter);
+}
+
 template <typename Type>
 void EntityManager::setComponent(const Entity& entity, const Type& component) {
     static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to set");
     m_MainEntityCommandBuffer.setComponent(entity, component);
 }
 
+template <typename Type>
+void EntityManager::setComponentEnabled(const Entity& entity, const bool& enabled) {
+    static_assert(std::is_base_of_v<EnableableDataComponent, Type>);
+    m_MainEntityCommandBuffer.setComponentEnabled<Type>(entity, enabled);
+}
+
 template <typename Type>
 void EntityManager::addSharedComponent(const Entity& entity, const Type& sharedComponent) {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
@@ -432,6 +870,34 @@ void EntityManager::setSharedComponent(const Entity& entity, const Type& sharedC
     m_MainEntityCommandBuffer.setSharedComponent(entity, sharedComponent);
 }
 
+template <typename Type>
+SharedComponentHandle<Type> EntityManager::createSharedComponentHandle(const Type& sharedComponent) {
+    static_assert(std::is_base_of_v<SharedComponent, Type>);
+    std::shared_ptr<unsigned int> sharedComponentIndex = std::make_shared<unsigned int>(ObjectStore<ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex);
+    // Tasks may be reading the store, which is only pushed to on playback
+    m_MainEntityCommandBuffer.pushProcedure([this, sharedComponentIndex, sharedComponent]() {
+        *sharedComponentIndex = m_SharedComponentStore.push(registerSharedComponent<Type>(), sharedComponent);
+    });
+    return SharedComponentHandle<Type>(sharedComponentIndex);
+}
+
+template <typename Type>
+void EntityManager::releaseSharedComponentHandle(const SharedComponentHandle<Type>& sharedComponentHandle) {
+    static_assert(std::is_base_of_v<SharedComponent, Type>);
+    if (!sharedComponentHandle.valid()) return;
+    m_MainEntityCommandBuffer.pushSharedComponentCommand<Type>(EntityCommandBuffer::Opcode::ReleaseSharedComponentHandle, Entity::invalidEntity(), sharedComponentHandle.m_SharedComponentIndex);
+}
+
+template <typename Type>
+void EntityManager::addSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle) {
+    m_MainEntityCommandBuffer.addSharedComponent(entity, sharedComponentHandle);
+}
+
+template <typename Type>
+void EntityManager::setSharedComponent(const Entity& entity, const SharedComponentHandle<Type>& sharedComponentHandle) {
+    m_MainEntityCommandBuffer.setSharedComponent(entity, sharedComponentHandle);
+}
+
 template <typename Type>
 void EntityManager::addSingletonComponent(const Type& singletonComponent) {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
@@ -453,30 +919,35 @@ void EntityManager::setSingletonComponent(const Type& singletonComponent) {
 template <typename Type>
 unsigned int EntityManager::componentId() {
     static_assert(std::is_base_of_v<DataComponent, Type>);
+    completeEntityCommandBuffers();
     return registerComponent<Type>();
 }
 
 template <typename Type>
 unsigned int EntityManager::sharedComponentId() {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
+    completeEntityCommandBuffers();
     return registerSharedComponent<Type>();
 }
 
 template <typename Type>
 unsigned int EntityManager::singletonComponentId() {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
+    completeEntityCommandBuffers();
     return registerSingletonComponent<Type>();
 }
 
 template <typename Type>
 const Type* EntityManager::sharedComponent(const unsigned int& sharedComponentIndex) const {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
+    completeEntityCommandBuffers();
     return m_SharedComponentStore.object<Type>(sharedComponentIndex);
 }
 
 template <typename Type>
-unsigned int EntityManager::sharedComponentIndex(const Type& sharedComponent) const {
+unsigned int EntityManager::sharedComponentIndex(const Type& sharedComponent) {
     static_assert(std::is_base_of_v<SharedComponent, Type>);
+    completeEntityCommandBuffers();
     const unsigned int sharedComponentId = registerSharedComponent<Type>();
     return m_SharedComponentStore.objectIndex(sharedComponentId, sharedComponent);
 }
@@ -484,133 +955,208 @@ unsigned int EntityManager::sharedComponentIndex(const Type& sharedComponent) co
 template <typename Type>
 Type* EntityManager::singletonComponent(const unsigned int& singletonComponentId) const {
     static_assert(std::is_base_of_v<SingletonComponent, Type>);
+    completeEntityCommandBuffers();
     return m_SingletonComponentStore.object<Type>(singletonComponentId);
 }
 
 template <typename Type>
-unsigned int EntityManager::registerComponent() {
-    return registerComponent(typeid(Type));
+std::conditional_t<k_SoAComponent<Type>, Type, const Type&> EntityManager::component(const Entity& entity) {
+    if constexpr (k_SoAComponent<Type>) {
+        completeEntityCommandBuffers();
+        const unsigned int componentId = lookupComponentId<Type>();
+        completeComponentAccess(componentId, false);
+        std::size_t fieldStride{};
+        void* address = componentAddress(entity, componentId, false, m_GlobalSystemVersion, fieldStride);
+        return FieldReference<const Type>(static_cast<std::byte*>(address), fieldStride).load();
+    } else
+        return *tryComponent<Type>(entity);
 }
 
 template <typename Type>
-unsigned int EntityManager::registerSharedComponent() {
-    return registerSharedComponent(typeid(Type));
+const Type* EntityManager::tryComponent(const Entity& entity) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to read");
+    static_assert(!k_SoAComponent<Type>, "SoA components are split into fields, read them with component()");
+    completeEntityCommandBuffers();
+    const unsigned int componentId = lookupComponentId<Type>();
+    completeComponentAccess(componentId, false);
+    return static_cast<const Type*>(componentAddress(entity, componentId, false, m_GlobalSystemVersion));
 }
 
 template <typename Type>
-unsigned int EntityManager::registerSingletonComponent() {
-    return registerSingletonComponent(typeid(Type));
+bool EntityManager::writeComponent(const Entity& entity, const Type& component) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to write");
+    completeEntityCommandBuffers();
+    const unsigned int componentId = lookupComponentId<Type>();
+    completeComponentAccess(componentId, true);
+    std::size_t fieldStride{};
+    void* address = componentAddress(entity, componentId, true, m_GlobalSystemVersion, fieldStride);
+    if (address == nullptr) return false;
+    if constexpr (k_SoAComponent<Type>)
+        FieldReference<Type>(static_cast<std::byte*>(address), fieldStride).store(component);
+    else
+        memcpy(address, &component, sizeof(Type));
+    return true;
 }
 
 template <typename Type>
-void EntityManager::addComponentImmediately(const Entity& entity, const Type& component) {
-    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
-    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    const unsigned int componentId = registerComponent<Type>();
-    ArchetypeMask mask = srcArchetype->mask();
-    mask.markComponent(componentId, std::is_base_of_v<ManualDataComponent, Type>);
-
-    Archetype* dstArchetype;
-    if (m_ArchetypeMap.contains(mask))
-        dstArchetype = m_ArchetypeMap[mask];
-    else {
-        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
-        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
-        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
-        componentIds.push_back(componentId);
-        componentSizes.emplace_back(sizeof(Type));
-        componentAligns.emplace_back(alignof(Type));
-        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
-        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
-    }
+unsigned int EntityManager::gatherComponents(std::span<const Entity> entities, Type* components) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to read");
+    completeEntityCommandBuffers();
+    const unsigned int componentId = lookupComponentId<Type>();
+    completeComponentAccess(componentId, false);
+    unsigned int count = 0;
+    forEachComponentAddress(entities, componentId, false, [components, &count](const std::size_t& i, void* address, const std::size_t& fieldStride) {
+        if constexpr (k_SoAComponent<Type>)
+            components[i] = FieldReference<const Type>(static_cast<std::byte*>(address), fieldStride).load();
+        else
+            memcpy(components + i, address, sizeof(Type));
+        count++;
+    });
+    return count;
+}
 
-    Entity srcSwappedEntity;
-    Archetype::EntityLocation dstLocation;
-    dstArchetype->moveEntityAddingComponent(srcLocation, srcArchetype, componentId, static_cast<const void*>(&component), dstLocation, srcSwappedEntity);
-    m_EntityLocations[entity.id] = dstLocation;
-    if (srcSwappedEntity.valid())
-        m_EntityLocations[srcSwappedEntity.id] = srcLocation;
+template <typename Type>
+unsigned int EntityManager::scatterComponents(std::span<const Entity> entities, const Type* components) {
+    static_assert(std::is_base_of_v<DataComponent, Type>);
+    static_assert(!k_TagComponent<Type>, "Tag components have no value to write");
+    completeEntityCommandBuffers();
+    const unsigned int componentId = lookupComponentId<Type>();
+    completeComponentAccess(componentId, true);
+    unsigned int count = 0;
+    forEachComponentAddress(entities, componentId, true, [components, &count](const std::size_t& i, void* address, const std::size_t& fieldStride) {
+        if constexpr (k_SoAComponent<Type>)
+            FieldReference<Type>(static_cast<std::byte*>(address), fieldStride).store(components[i]);
+        else
+            memcpy(address, components + i, sizeof(Type));
+        count++;
+    });
+    return count;
 }
 
 template <typename Type>
-void EntityManager::removeComponentImmediately(const Entity& entity) {
-    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
-    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    // If the archetype is single and manual, it should be destroyed;
-    if (srcArchetype->single() && srcArchetype->fullyManual()) {
-        destroyEntityWithoutCheck(entity, srcArchetype, srcLocation);
-        return;
+unsigned int EntityManager::lookupComponentId() {
+    if (m_LookupComponentIdResolver != &EntityCommandBuffer::resolveComponentId<Type>) {
+        m_LookupComponentIdResolver = &EntityCommandBuffer::resolveComponentId<Type>;
+        m_LookupComponentId = registerComponent<Type>();
     }
-    removeComponentWithoutCheck(entity, registerComponent<Type>(), std::is_base_of_v<ManualDataComponent, Type>);
+    return m_LookupComponentId;
 }
 
 template <typename Type>
-void EntityManager::setComponentImmediately(const Entity& entity, const Type& component) {
-    const Archetype::EntityLocation location = m_EntityLocations[entity.id];
-    Archetype* const archetype = m_Archetypes[location.archetypeId].get();
-    const unsigned int componentId = m_ComponentIdMap.at(typeid(Type));
-    archetype->setComponent(location, componentId, static_cast<const void*>(&component));
+unsigned int EntityManager::registerComponent() {
+    const unsigned int componentId = registerComponent(typeid(Type));
+    if constexpr (std::is_base_of_v<EnableableDataComponent, Type>)
+        m_EnableableComponentMask.set(componentId);
+    if constexpr (k_SoAComponent<Type>) {
+        // Fields are copied bytewise by their offsets, which standard layout keeps free of padding between bases
+        static_assert(std::is_trivially_copyable_v<Type> && std::is_standard_layout_v<Type>);
+        static_assert(sizeof(Type) % k_SoAFieldSize == 0 && alignof(Type) == k_SoAFieldSize, "SoA components should be made of 4-byte scalars only");
+        m_SoAComponentMask.set(componentId);
+    }
+    return componentId;
 }
 
 template <typename Type>
-void EntityManager::addSharedComponentImmediately(const Entity& entity, const Type& sharedComponent) {
-    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
-    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    const unsigned int sharedComponentId = registerSharedComponent<Type>();
-    ArchetypeMask mask = srcArchetype->mask();
-    mask.markSharedComponent(sharedComponentId, std::is_base_of_v<ManualSharedComponent, Type>);
-
-    Archetype* dstArchetype;
-    if (m_ArchetypeMap.contains(mask))
-        dstArchetype = m_ArchetypeMap[mask];
-    else {
-        std::vector<unsigned int> componentIds = srcArchetype->componentIds();
-        std::vector<std::size_t> componentSizes = srcArchetype->componentSizes();
-        std::vector<std::size_t> componentAligns = srcArchetype->componentAligns();
-        std::vector<unsigned int> sharedComponentIds = srcArchetype->sharedComponentIds();
-        sharedComponentIds.push_back(sharedComponentId);
-        dstArchetype = createArchetype(std::move(mask), std::move(componentIds), std::move(componentSizes), std::move(componentAligns), std::move(sharedComponentIds));
-    }
+unsigned int EntityManager::registerSharedComponent() {
+    return registerSharedComponent(typeid(Type));
+}
 
-    unsigned int sharedComponentIndex = m_SharedComponentStore.push(sharedComponentId, sharedComponent);
+template <typename Type>
+unsigned int EntityManager::registerSingletonComponent() {
+    return registerSingletonComponent(typeid(Type));
+}
 
-    Entity srcSwappedEntity;
-    Archetype::EntityLocation dstLocation;
-    dstArchetype->moveEntityAddingSharedComponent(srcLocation, srcArchetype, sharedComponentId, sharedComponentIndex, dstLocation, srcSwappedEntity);
-    m_EntityLocations[entity.id] = dstLocation;
-    if (srcSwappedEntity.valid())
-        m_EntityLocations[srcSwappedEntity.id] = srcLocation;
+inline void EntityManager::completeEntityCommandBuffers() const {
+    if (m_EntityCommandBufferTaskHandle)
+        waitForEntityCommandBuffers();
 }
 
-template <typename Type>
-void EntityManager::removeSharedComponentImmediately(const Entity& entity) {
-    const Archetype::EntityLocation srcLocation = m_EntityLocations[entity.id];
-    Archetype* const srcArchetype = m_Archetypes[srcLocation.archetypeId].get();
-    // If the archetype is single and manual, it should be destroyed;
-    if (srcArchetype->single() && srcArchetype->fullyManual()) {
-        destroyEntityWithoutCheck(entity, srcArchetype, srcLocation);
-        return;
+inline bool EntityManager::alive(const Entity& entity) const {
+    completeEntityCommandBuffers();
+    return m_EntityLocations.alive(entity);
+}
+
+inline void* EntityManager::componentAddress(const Entity& entity, const unsigned int& componentId, const bool& written, const unsigned int& globalSystemVersion) const {
+    std::size_t fieldStride{};
+    return componentAddress(entity, componentId, written, globalSystemVersion, fieldStride);
+}
+
+inline void* EntityManager::componentAddress(const Entity& entity, const unsigned int& componentId, const bool& written, const unsigned int& globalSystemVersion, std::size_t& fieldStride) const {
+    fieldStride = 0;
+    if (!m_EntityLocations.alive(entity)) return nullptr;
+    const Archetype::EntityLocation& location = m_EntityLocations[entity.id];
+    const Archetype* archetype = m_Archetypes[location.archetypeId].get();
+    auto it = archetype->m_ChunkLayout.componentIndexMap.find(componentId);
+    if (it == archetype->m_ChunkLayout.componentIndexMap.end()) return nullptr;
+    fieldStride = archetype->m_ChunkLayout.componentFieldSizes[it->second] * archetype->m_ChunkLayout.capacity;
+    return archetype->m_Combinations[location.combinationIndex]->locateComponent(location.entityIndexInCombination, it->second, written, globalSystemVersion);
+}
+
+inline bool EntityManager::componentChanged(const Entity& entity, const unsigned int& componentId, const unsigned int& lastSystemVersion) const {
+    if (!m_EntityLocations.alive(entity)) return false;
+    const Archetype::EntityLocation& location = m_EntityLocations[entity.id];
+    const Archetype* archetype = m_Archetypes[location.archetypeId].get();
+    auto it = archetype->m_ChunkLayout.componentIndexMap.find(componentId);
+    if (it == archetype->m_ChunkLayout.componentIndexMap.end()) return false;
+    return versionNewer(archetype->m_Combinations[location.combinationIndex]->locateComponentVersion(location.entityIndexInCombination, it->second), lastSystemVersion);
+}
+
+template <typename Function>
+void EntityManager::forEachComponentAddress(std::span<const Entity> entities, const unsigned int& componentId, const bool& written, Function&& function) const {
+    constexpr unsigned int k_MissingComponentIndex = std::numeric_limits<unsigned int>::max();
+    // Locations are prefetched k_LookupPrefetchDistance ahead of resolving addresses, which are prefetched as far ahead of the calls
+    std::array<void*, k_LookupPrefetchDistance> addresses;
+    std::array<std::size_t, k_LookupPrefetchDistance> fieldStrides;
+    const Archetype* archetype = nullptr;
+    unsigned int componentIndex = k_MissingComponentIndex;
+    for (std::size_t i = 0; i < entities.size() + k_LookupPrefetchDistance; i++) {
+        void*& address = addresses[i % k_LookupPrefetchDistance];
+        if (i >= k_LookupPrefetchDistance && address != nullptr)
+            function(i - k_LookupPrefetchDistance, address, fieldStrides[i % k_LookupPrefetchDistance]);
+        if (i >= entities.size()) continue;
+        if (i + k_LookupPrefetchDistance < entities.size() && entities[i + k_LookupPrefetchDistance].id < m_EntityLocations.size())
+            m_EntityLocations.prefetch(entities[i + k_LookupPrefetchDistance].id);
+        address = nullptr;
+        if (!m_EntityLocations.alive(entities[i])) continue;
+        const Archetype::EntityLocation& location = m_EntityLocations[entities[i].id];
+        // Entities looked up together mostly share the Archetype
+        if (archetype == nullptr || archetype->id() != location.archetypeId) {
+            archetype = m_Archetypes[location.archetypeId].get();
+            auto it = archetype->m_ChunkLayout.componentIndexMap.find(componentId);
+            componentIndex = it != archetype->m_ChunkLayout.componentIndexMap.end() ? it->second : k_MissingComponentIndex;
+        }
+        if (componentIndex == k_MissingComponentIndex) continue;
+        address = archetype->m_Combinations[location.combinationIndex]->locateComponent(location.entityIndexInCombination, componentIndex, written, m_GlobalSystemVersion);
+        fieldStrides[i % k_LookupPrefetchDistance] = archetype->m_ChunkLayout.componentFieldSizes[componentIndex] * archetype->m_ChunkLayout.capacity;
+        prefetch(address);
     }
-    removeSharedComponentWithoutCheck(entity, registerSharedComponent<Type>(), std::is_base_of_v<ManualSharedComponent, Type>);
 }
 
 template <typename Type>
-void EntityManager::setSharedComponentImmediately(const Entity& entity, const Type& sharedComponent) {
-    const Archetype::EntityLocation location = m_EntityLocations[entity.id];
-    Archetype* const archetype = m_Archetypes[location.archetypeId].get();
-    const unsigned int sharedComponentId = registerSharedComponent<Type>();
+void EntityManager::addComponentImmediately(const EntityFilter& entityFilter, const Type& component) {
+    addComponentWithoutCheck(entityFilter, registerComponent<Type>(), std::is_base_of_v<ManualDataComponent, Type>, k_TagComponent<Type> ? 0 : sizeof(Type), alignof(Type), static_cast<const void*>(&component));
+}
 
-    unsigned int sharedComponentIndex = m_SharedComponentStore.push(sharedComponentId, sharedComponent);
+template <typename Type>
+void EntityManager::removeComponentImmediately(const EntityFilter& entityFilter) {
+    removeComponentWithoutCheck(entityFilter, registerComponent<Type>(), std::is_base_of_v<ManualDataComponent, Type>);
+}
 
-    unsigned int originalSharedComponentIndex;
-    Archetype::EntityLocation dstLocation;
-    Entity swappedEntity;
-    archetype->setSharedComponent(location, sharedComponentId, sharedComponentIndex, originalSharedComponentIndex, dstLocation, swappedEntity);
-    m_EntityLocations[entity.id] = dstLocation;
-    if (swappedEntity.valid())
-        m_EntityLocations[swappedEntity.id] = location;
+template <typename Type>
+void EntityManager::addSharedComponentImmediately(const Entity& entity, const Type& sharedComponent) {
+    if (!m_EntityLocations.alive(entity)) return;
+    const unsigned int sharedComponentId = registerSharedComponent<Type>();
+    addSharedComponentWithoutCheck(entity, sharedComponentId, std::is_base_of_v<ManualSharedComponent, Type>, m_SharedComponentStore.push(sharedComponentId, sharedComponent));
+}
 
-    m_SharedComponentStore.pop(sharedComponentId, originalSharedComponentIndex);
+template <typename Type>
+void EntityManager::setSharedComponentImmediately(const Entity& entity, const Type& sharedComponent) {
+    if (!m_EntityLocations.alive(entity)) return;
+    const unsigned int sharedComponentId = registerSharedComponent<Type>();
+    setSharedComponentWithoutCheck(entity, sharedComponentId, m_SharedComponentStore.push(sharedComponentId, sharedComponent));
 }
 
 template <typename Type>
@@ -620,12 +1166,12 @@ void EntityManager::addSingletonComponentImmediately(const Type& singletonCompon
 
 template <typename Type>
 void EntityManager::removeSingletonComponentImmediately() {
-    m_SingletonComponentStore.pop(registerSingletonComponent<Type>());
+    m_SingletonComponentStore.pop<Type>(registerSingletonComponent<Type>());
 }
 
 template <typename Type>
 void EntityManager::setSingletonComponentImmediately(const Type& singletonComponent) {
-    *m_SingletonComponentStore.object(registerSingletonComponent<Type>()) = singletonComponent;
+    *m_SingletonComponentStore.object<Type>(registerSingletonComponent<Type>()) = singletonComponent;
 }
 
 }  // namespace Melon
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <MelonCore/SharedComponent.h>
+
+#include <functional>
+
+namespace Melon {
+
+// Written by the HierarchySystem, 1 for children of roots, so that each depth is stored in chunks of its own
+struct HierarchyDepth : public SharedComponent {
+    bool operator==(const HierarchyDepth& other) const { return value == other.value; }
+
+    unsigned int value;
+};
+
+}  // namespace Melon
+
+template <>
+struct std::hash<Melon::HierarchyDepth> {
+    std::size_t operator()(const Melon::HierarchyDepth& hierarchyDepth) {
+        return std::hash<unsigned int>()(hierarchyDepth.value);
+    }
+};
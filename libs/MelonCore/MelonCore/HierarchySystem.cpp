@@ -0,0 +1,280 @@
+#include <MelonCore/ChildLink.h>
+#include <MelonCore/Children.h>
+#include <MelonCore/ComponentLookup.h>
+#include <MelonCore/HierarchyDepth.h>
+#include <MelonCore/HierarchySystem.h>
+#include <MelonCore/LocalToWorld.h>
+#include <MelonCore/LocalTransform.h>
+#include <MelonCore/Parent.h>
+#include <MelonCore/SystemVersion.h>
+
+#include <algorithm>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <utility>
+
+namespace Melon {
+
+namespace {
+
+glm::mat4 localToParent(const LocalTransform& localTransform) {
+    glm::mat4 matrix = glm::mat4_cast(localTransform.rotation);
+    matrix[0] *= localTransform.scale.x;
+    matrix[1] *= localTransform.scale.y;
+    matrix[2] *= localTransform.scale.z;
+    matrix[3] = glm::vec4(localTransform.translation, 1.0f);
+    return matrix;
+}
+
+// The chunks of one depth, skipping Entities whose LocalTransform, Parent and parent LocalToWorld are unchanged
+class LocalToWorldChunkTask : public ChunkTask {
+  public:
+    LocalToWorldChunkTask(const unsigned int& lastSystemVersion, const ComponentLookup<const LocalToWorld>& localToWorldLookup, const unsigned int& parentComponentId, const unsigned int& localTransformComponentId, const unsigned int& localToWorldComponentId) : m_LastSystemVersion(lastSystemVersion), m_LocalToWorldLookup(localToWorldLookup), m_ParentComponentId(parentComponentId), m_LocalTransformComponentId(localTransformComponentId), m_LocalToWorldComponentId(localToWorldComponentId) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        const Parent* parents = chunkAccessor.componentArray<const Parent>(m_ParentComponentId);
+        const LocalTransform* localTransforms = chunkAccessor.componentArray<const LocalTransform>(m_LocalTransformComponentId);
+        const bool chunkChanged = versionNewer(chunkAccessor.componentVersion(m_ParentComponentId), m_LastSystemVersion) || versionNewer(chunkAccessor.componentVersion(m_LocalTransformComponentId), m_LastSystemVersion);
+
+        // Siblings are mostly next to each other, so the parent is only looked up again when it differs
+        Entity parent = Entity::invalidEntity();
+        const LocalToWorld* parentLocalToWorld = nullptr;
+        // Only taken once an Entity is recomputed, so that unchanged chunks are not marked changed
+        LocalToWorld* localToWorlds = nullptr;
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+            if (!(parents[i].value == parent)) {
+                parent = parents[i].value;
+                parentLocalToWorld = chunkChanged || m_LocalToWorldLookup.changed(parent, m_LastSystemVersion) ? m_LocalToWorldLookup.tryComponent(parent) : nullptr;
+            }
+            if (parentLocalToWorld == nullptr) continue;
+            if (localToWorlds == nullptr)
+                localToWorlds = chunkAccessor.componentArray<LocalToWorld>(m_LocalToWorldComponentId);
+            localToWorlds[i].value = parentLocalToWorld->value * localToParent(localTransforms[i]);
+        }
+    }
+
+    const unsigned int m_LastSystemVersion;
+    const ComponentLookup<const LocalToWorld> m_LocalToWorldLookup;
+    const unsigned int m_ParentComponentId;
+    const unsigned int m_LocalTransformComponentId;
+    const unsigned int m_LocalToWorldComponentId;
+};
+
+}  // namespace
+
+// Children whose Parent differs from the one they are linked to, including those whose Parent is removed
+class HierarchySystem::ParentChangeChunkTask : public ChunkTask {
+  public:
+    ParentChangeChunkTask(const unsigned int& parentComponentId, const unsigned int& childLinkComponentId, WorkerParentChanges& parentChanges) : m_ParentComponentId(parentComponentId), m_ChildLinkComponentId(childLinkComponentId), m_ParentChanges(parentChanges) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        std::vector<ParentChange>& parentChanges = m_ParentChanges[TaskManager::workerIndex()];
+        const Entity* entities = chunkAccessor.entityArray();
+        const Parent* parents = chunkAccessor.hasComponent(m_ParentComponentId) ? chunkAccessor.componentArray<const Parent>(m_ParentComponentId) : nullptr;
+        const ChildLink* childLinks = chunkAccessor.hasComponent(m_ChildLinkComponentId) ? chunkAccessor.componentArray<const ChildLink>(m_ChildLinkComponentId) : nullptr;
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+            const Entity parent = parents != nullptr ? parents[i].value : Entity::invalidEntity();
+            if (childLinks == nullptr || !(childLinks[i].parent == parent))
+                parentChanges.push_back(ParentChange{.child = entities[i], .parent = parent});
+        }
+    }
+
+    const unsigned int m_ParentComponentId;
+    const unsigned int m_ChildLinkComponentId;
+    WorkerParentChanges& m_ParentChanges;
+};
+
+class HierarchySystem::DestroyedParentChunkTask : public ChunkTask {
+  public:
+    DestroyedParentChunkTask(WorkerEntities& destroyedParents) : m_DestroyedParents(destroyedParents) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        const Entity* entities = chunkAccessor.entityArray();
+        m_DestroyedParents[TaskManager::workerIndex()].insert(m_DestroyedParents[TaskManager::workerIndex()].end(), entities, entities + chunkAccessor.entityCount());
+    }
+
+    WorkerEntities& m_DestroyedParents;
+};
+
+void HierarchySystem::onEnter() {
+    m_MissingLocalToWorldEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Parent, LocalTransform>().rejectComponents<LocalToWorld>().createEntityFilter();
+    m_ParentChangedEntityFilter = entityManager()->createEntityFilterBuilder().changed<Parent>().createEntityFilter();
+    m_ParentRemovedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<ChildLink>().rejectComponents<Parent>().createEntityFilter();
+    m_ParentDestroyedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Children>().rejectComponents<LocalToWorld>().createEntityFilter();
+    m_GatherComponentAccess = createComponentAccessBuilder().readComponents<Parent, ChildLink>().createComponentAccess();
+    declareComponentAccess(createComponentAccessBuilder().readComponents<Parent, LocalTransform, ChildLink>().readSharedComponents<HierarchyDepth>().writeComponents<LocalToWorld>().createComponentAccess());
+
+    m_ParentComponentId = entityManager()->componentId<Parent>();
+    m_LocalTransformComponentId = entityManager()->componentId<LocalTransform>();
+    m_LocalToWorldComponentId = entityManager()->componentId<LocalToWorld>();
+    m_ChildLinkComponentId = entityManager()->componentId<ChildLink>();
+}
+
+void HierarchySystem::onUpdate() {
+    // Links what was gathered in the previous frame, whose tasks are long finished
+    if (m_GatherTaskHandle)
+        m_GatherTaskHandle->complete();
+    for (std::vector<ParentChange>& parentChanges : m_ParentChanges) {
+        for (const ParentChange& parentChange : parentChanges)
+            link(parentChange.child, parentChange.parent);
+        parentChanges.clear();
+    }
+    for (std::vector<Entity>& destroyedParents : m_DestroyedParents) {
+        for (const Entity& destroyedParent : destroyedParents)
+            unlinkDestroyedParent(destroyedParent);
+        destroyedParents.clear();
+    }
+    writeChildren();
+
+    // Moved chunks count as changed, so the added LocalToWorld is computed once the Entity is linked
+    entityManager()->addComponent(m_MissingLocalToWorldEntityFilter, LocalToWorld{{}, glm::mat4(1.0f)});
+
+    m_GatherTaskHandle = schedule(std::make_shared<ParentChangeChunkTask>(m_ParentComponentId, m_ChildLinkComponentId, m_ParentChanges), m_ParentChangedEntityFilter, m_GatherComponentAccess, nullptr);
+    m_GatherTaskHandle = schedule(std::make_shared<ParentChangeChunkTask>(m_ParentComponentId, m_ChildLinkComponentId, m_ParentChanges), m_ParentRemovedEntityFilter, m_GatherComponentAccess, m_GatherTaskHandle);
+    m_GatherTaskHandle = schedule(std::make_shared<DestroyedParentChunkTask>(m_DestroyedParents), m_ParentDestroyedEntityFilter, m_GatherComponentAccess, m_GatherTaskHandle);
+
+    // Each depth reads the LocalToWorld written by the pass of the depth above
+    const ComponentLookup<const LocalToWorld> localToWorldLookup = componentLookup<const LocalToWorld>();
+    for (unsigned int depth = 1; depth < m_DepthEntityCounts.size(); depth++)
+        if (m_DepthEntityCounts[depth] != 0)
+            predecessor() = schedule(std::make_shared<LocalToWorldChunkTask>(lastSystemVersion(), localToWorldLookup, m_ParentComponentId, m_LocalTransformComponentId, m_LocalToWorldComponentId), m_DepthEntityFilters[depth], predecessor());
+}
+
+void HierarchySystem::onExit() {
+    for (const SharedComponentHandle<HierarchyDepth>& depthSharedComponentHandle : m_DepthSharedComponentHandles)
+        if (depthSharedComponentHandle.valid())
+            entityManager()->releaseSharedComponentHandle(depthSharedComponentHandle);
+}
+
+void HierarchySystem::link(const Entity& child, Entity parent) {
+    auto it = m_Links.find(child.id);
+    // The link of a destroyed Entity whose id is recycled is dropped first
+    if (it != m_Links.end() && !(it->second.child == child)) {
+        link(it->second.child, Entity::invalidEntity());
+        it = m_Links.end();
+    }
+    const Entity originalParent = it != m_Links.end() ? it->second.parent : Entity::invalidEntity();
+    // A child under itself or its descendant is treated as without Parent
+    if (parent.valid() && (parent == child || ancestor(child, parent)))
+        parent = Entity::invalidEntity();
+    if (originalParent == parent) return;
+
+    if (ChildList* originalChildList = childList(originalParent); originalChildList != nullptr) {
+        std::erase(originalChildList->children, child);
+        if (m_ChangedParentIds.insert(originalParent.id).second)
+            m_ChangedParents.push_back(originalParent);
+    }
+
+    if (parent.valid()) {
+        ChildList& parentChildList = m_ChildLists[parent.id];
+        if (!(parentChildList.parent == parent))
+            parentChildList = ChildList{.parent = parent, .children = {}};
+        parentChildList.children.push_back(child);
+        if (m_ChangedParentIds.insert(parent.id).second)
+            m_ChangedParents.push_back(parent);
+
+        if (it == m_Links.end())
+            it = m_Links.emplace(child.id, Link{.child = child, .parent = parent, .depth = 0}).first;
+        it->second.parent = parent;
+        setDepth(child, depth(parent) + 1);
+    } else {
+        setDepth(child, 0);
+        m_Links.erase(it);
+        entityManager()->removeComponent<ChildLink>(child);
+    }
+}
+
+void HierarchySystem::unlinkDestroyedParent(const Entity& parent) {
+    ChildList* parentChildList = childList(parent);
+    if (parentChildList == nullptr) return;
+    const std::vector<Entity> children = std::move(parentChildList->children);
+    m_ChildLists.erase(parent.id);
+    for (const Entity& child : children) {
+        link(child, Entity::invalidEntity());
+        entityManager()->removeComponent<Parent>(child);
+    }
+    entityManager()->removeComponent<Children>(parent);
+}
+
+void HierarchySystem::setDepth(const Entity& entity, const unsigned int& depth) {
+    std::vector<std::pair<Entity, unsigned int>> entityDepths{{entity, depth}};
+    while (!entityDepths.empty()) {
+        const auto [descendant, descendantDepth] = entityDepths.back();
+        entityDepths.pop_back();
+        auto it = m_Links.find(descendant.id);
+        if (it == m_Links.end() || !(it->second.child == descendant) || it->second.depth == descendantDepth) continue;
+
+        if (it->second.depth != 0)
+            m_DepthEntityCounts[it->second.depth]--;
+        it->second.depth = descendantDepth;
+        if (descendantDepth != 0) {
+            if (descendantDepth >= m_DepthEntityCounts.size())
+                m_DepthEntityCounts.resize(descendantDepth + 1);
+            m_DepthEntityCounts[descendantDepth]++;
+            reserveDepth(descendantDepth);
+            entityManager()->addSharedComponent(descendant, m_DepthSharedComponentHandles[descendantDepth]);
+        } else {
+            entityManager()->removeSharedComponent<HierarchyDepth>(descendant);
+        }
+
+        if (const ChildList* descendantChildList = childList(descendant); descendantChildList != nullptr)
+            for (const Entity& child : descendantChildList->children)
+                entityDepths.emplace_back(child, descendantDepth + 1);
+    }
+    while (!m_DepthEntityCounts.empty() && m_DepthEntityCounts.back() == 0)
+        m_DepthEntityCounts.pop_back();
+}
+
+unsigned int HierarchySystem::depth(const Entity& entity) const {
+    auto it = m_Links.find(entity.id);
+    return it != m_Links.end() && it->second.child == entity ? it->second.depth : 0;
+}
+
+void HierarchySystem::reserveDepth(const unsigned int& depth) {
+    if (depth < m_DepthSharedComponentHandles.size()) return;
+    // Depth 0 has no HierarchyDepth, its handle and filter stay empty
+    const unsigned int originalDepthCount = std::max(static_cast<unsigned int>(m_DepthSharedComponentHandles.size()), 1U);
+    m_DepthSharedComponentHandles.resize(depth + 1);
+    m_DepthEntityFilters.resize(depth + 1);
+    // Only when the hierarchy gets deeper than ever, building the filters waits for the EntityCommandBuffers
+    for (unsigned int newDepth = originalDepthCount; newDepth <= depth; newDepth++) {
+        m_DepthSharedComponentHandles[newDepth] = entityManager()->createSharedComponentHandle(HierarchyDepth{{}, newDepth});
+        m_DepthEntityFilters[newDepth] = entityManager()->createEntityFilterBuilder().requireComponents<Parent, LocalTransform, LocalToWorld>().requireSharedComponent(m_DepthSharedComponentHandles[newDepth]).createEntityFilter();
+    }
+}
+
+bool HierarchySystem::ancestor(const Entity& entity, const Entity& descendant) const {
+    for (auto it = m_Links.find(descendant.id); it != m_Links.end() && it->second.child == descendant;) {
+        const Entity& parent = it->second.parent;
+        if (parent == entity) return true;
+        it = m_Links.find(parent.id);
+        if (it != m_Links.end() && !(it->second.child == parent)) return false;
+    }
+    return false;
+}
+
+HierarchySystem::ChildList* HierarchySystem::childList(const Entity& parent) {
+    if (!parent.valid()) return nullptr;
+    auto it = m_ChildLists.find(parent.id);
+    return it != m_ChildLists.end() && it->second.parent == parent ? &it->second : nullptr;
+}
+
+void HierarchySystem::writeChildren() {
+    for (const Entity& parent : m_ChangedParents) {
+        ChildList* parentChildList = childList(parent);
+        if (parentChildList == nullptr) continue;
+        std::vector<Entity>& children = parentChildList->children;
+        if (children.empty()) {
+            m_ChildLists.erase(parent.id);
+            entityManager()->removeComponent<Children>(parent);
+            continue;
+        }
+        entityManager()->addComponent(parent, Children{{}, children.front(), static_cast<unsigned int>(children.size())});
+        for (unsigned int i = 0; i < children.size(); i++)
+            entityManager()->addComponent(children[i], ChildLink{{}, parent, i + 1 < children.size() ? children[i + 1] : Entity::invalidEntity()});
+    }
+    m_ChangedParents.clear();
+    m_ChangedParentIds.clear();
+}
+
+}  // namespace Melon
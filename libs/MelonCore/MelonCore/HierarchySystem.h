@@ -0,0 +1,102 @@
+#pragma once
+
+#include <MelonCore/ComponentAccess.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/HierarchyDepth.h>
+#include <MelonCore/SharedComponentHandle.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonTask/TaskHandle.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Melon {
+
+// Writes the LocalToWorld of Entities with a Parent as the LocalToWorld of the Parent * LocalTransform
+// Depths are passed in order, each as a parallel chunk pass over its own chunks, after the roots written by the TransformSystem registered before it
+// Only Entities whose LocalTransform or Parent has changed, or whose Parent has a changed LocalToWorld chunk, are recomputed
+// Changes of Parent are gathered by tasks and linked into Children, ChildLink and HierarchyDepth in the next frame
+// Parents forming a cycle are ignored
+class HierarchySystem : public SystemBase {
+  public:
+    HierarchySystem() {}
+    virtual ~HierarchySystem() {}
+
+  protected:
+    virtual void onEnter() final;
+    virtual void onUpdate() final;
+    virtual void onExit() final;
+
+  private:
+    class ParentChangeChunkTask;
+    class DestroyedParentChunkTask;
+
+    // A child and its new Parent, which is invalid if the Parent is removed or the child is destroyed
+    struct ParentChange {
+        Entity child;
+        Entity parent;
+    };
+
+    struct Link {
+        Entity child;
+        Entity parent;
+        unsigned int depth;
+    };
+
+    struct ChildList {
+        Entity parent;
+        std::vector<Entity> children;
+    };
+
+    // Changes gathered by each worker, the last one for tasks executed outside of workers
+    using WorkerParentChanges = std::array<std::vector<ParentChange>, TaskManager::k_WorkerCount + 1>;
+    using WorkerEntities = std::array<std::vector<Entity>, TaskManager::k_WorkerCount + 1>;
+
+    void link(const Entity& child, Entity parent);
+    // Removes Parent from the children of a destroyed parent, which are unlinked with it
+    void unlinkDestroyedParent(const Entity& parent);
+    // Sets the depth of entity and updates the depths of its descendants
+    void setDepth(const Entity& entity, const unsigned int& depth);
+    unsigned int depth(const Entity& entity) const;
+    // Creates the HierarchyDepth handles and filters of the depths up to depth
+    void reserveDepth(const unsigned int& depth);
+    bool ancestor(const Entity& entity, const Entity& descendant) const;
+    ChildList* childList(const Entity& parent);
+    // Rewrites Children of the parents whose children have changed, with ChildLink of their children
+    void writeChildren();
+
+    EntityFilter m_MissingLocalToWorldEntityFilter;
+    EntityFilter m_ParentChangedEntityFilter;
+    EntityFilter m_ParentRemovedEntityFilter;
+    EntityFilter m_ParentDestroyedEntityFilter;
+    // Gathering only reads Parent and ChildLink, so that it does not wait for the tasks writing LocalToWorld
+    ComponentAccess m_GatherComponentAccess;
+
+    unsigned int m_ParentComponentId;
+    unsigned int m_LocalTransformComponentId;
+    unsigned int m_LocalToWorldComponentId;
+    unsigned int m_ChildLinkComponentId;
+
+    // Gathered by the tasks of the previous frame, complete once m_GatherTaskHandle is
+    std::shared_ptr<TaskHandle> m_GatherTaskHandle;
+    WorkerParentChanges m_ParentChanges;
+    WorkerEntities m_DestroyedParents;
+
+    // Indexed by the ids of children and parents, entries of recycled ids are told apart by their Entity
+    std::unordered_map<unsigned int, Link> m_Links;
+    std::unordered_map<unsigned int, ChildList> m_ChildLists;
+    std::vector<Entity> m_ChangedParents;
+    std::unordered_set<unsigned int> m_ChangedParentIds;
+    // Count of linked Entities at each depth, whose size is one more than the deepest depth
+    std::vector<unsigned int> m_DepthEntityCounts;
+    // Indexed by depth, kept for every depth reached so far so that the HierarchyDepth of each depth keeps its index
+    std::vector<SharedComponentHandle<HierarchyDepth>> m_DepthSharedComponentHandles;
+    std::vector<EntityFilter> m_DepthEntityFilters;
+};
+
+}  // namespace Melon
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+#include <glm/mat4x4.hpp>
+
+namespace Melon {
+
+// Model matrix Translation * Rotation * Scale, written by the TransformSystem
+struct LocalToWorld : public DataComponent {
+    glm::mat4 value;
+};
+
+}  // namespace Melon
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+namespace Melon {
+
+// Translation, rotation and scale relative to the Parent, which Entities with a Parent use instead of Translation, Rotation and Scale
+struct LocalTransform : public DataComponent {
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+
+}  // namespace Melon
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <MelonCore/SharedComponent.h>
+
 #include <array>
 #include <climits>
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <type_traits>
 #include <unordered_map>
@@ -17,7 +20,9 @@ class ObjectStore {
 
     template <typename Type>
     unsigned int push(const unsigned int& typeId, const Type& object);
-    void pop(const unsigned int& typeId, const unsigned int& index);
+    void pop(const unsigned int& typeId, const unsigned int& index, const unsigned int& count = 1);
+    // Reference the object at index count more times without looking it up
+    void retain(const unsigned int& index, const unsigned int& count = 1);
 
     template <typename Type>
     const Type* object(const unsigned int& index) const;
@@ -82,8 +87,9 @@ inline unsigned int ObjectStore<Count>::push(const unsigned int& typeId, const T
         m_TypeHashes[typeId],
         m_TypeEqualTos[typeId]};
     unsigned int index;
-    if (m_ObjectIndexMap.contains(objectWrapper))
-        index = m_ObjectIndexMap[objectWrapper];
+    auto it = m_ObjectIndexMap.find(objectWrapper);
+    if (it != m_ObjectIndexMap.end())
+        index = it->second;
     else {
         if (m_FreeIndices.empty()) {
             index = m_IndexCount++;
@@ -101,10 +107,10 @@ inline unsigned int ObjectStore<Count>::push(const unsigned int& typeId, const T
 }
 
 template <std::size_t Count>
-inline void ObjectStore<Count>::pop(const unsigned int& typeId, const unsigned int& index) {
+inline void ObjectStore<Count>::pop(const unsigned int& typeId, const unsigned int& index, const unsigned int& count) {
     if (index == k_InvalidIndex) return;
     void* object = m_Store[index];
-    m_ReferenceCounts[index]--;
+    m_ReferenceCounts[index] -= count;
     bool removed = m_ReferenceCounts[index] == 0;
     if (removed) {
         m_FreeIndices.push_back(index);
@@ -119,6 +125,12 @@ inline void ObjectStore<Count>::pop(const unsigned int& typeId, const unsigned i
     }
 }
 
+template <std::size_t Count>
+inline void ObjectStore<Count>::retain(const unsigned int& index, const unsigned int& count) {
+    if (index == k_InvalidIndex) return;
+    m_ReferenceCounts[index] += count;
+}
+
 template <std::size_t Count>
 template <typename Type>
 const Type* ObjectStore<Count>::object(const unsigned int& index) const {
@@ -133,11 +145,8 @@ unsigned int ObjectStore<Count>::objectIndex(const unsigned int& typeId, const v
         typeId, object,
         m_TypeHashes[typeId],
         m_TypeEqualTos[typeId]};
-    unsigned int index;
-    if (m_ObjectIndexMap.contains(objectWrapper))
-        return m_ObjectIndexMap[objectWrapper];
-    else
-        return k_InvalidIndex;
+    auto it = m_ObjectIndexMap.find(objectWrapper);
+    return it != m_ObjectIndexMap.end() ? it->second : k_InvalidIndex;
 }
 
 template <std::size_t Count>
@@ -147,23 +156,29 @@ unsigned int ObjectStore<Count>::objectIndex(const unsigned int& typeId, const T
         typeId, static_cast<const void*>(&object),
         objectWrapperHash<Type>,
         objectWrapperEqualTo<Type>};
-    unsigned int index;
-    if (m_ObjectIndexMap.contains(objectWrapper))
-        return m_ObjectIndexMap[objectWrapper];
-    else
-        return k_InvalidIndex;
+    auto it = m_ObjectIndexMap.find(objectWrapper);
+    return it != m_ObjectIndexMap.end() ? it->second : k_InvalidIndex;
 }
 
 template <std::size_t Count>
 template <typename Type>
 std::size_t ObjectStore<Count>::objectWrapperHash(const void* const& object) {
-    return std::hash<Type>()(*static_cast<const Type*>(object));
+    const Type& typedObject = *static_cast<const Type*>(object);
+    if constexpr (k_IdentifiedSharedComponent<Type>)
+        return std::hash<std::remove_cvref_t<decltype(typedObject.identity())>>()(typedObject.identity());
+    else
+        return std::hash<Type>()(typedObject);
 }
 
 template <std::size_t Count>
 template <typename Type>
 bool ObjectStore<Count>::objectWrapperEqualTo(const void* const& lhs, const void* const& rhs) {
-    return std::equal_to<Type>()(*static_cast<const Type*>(lhs), *static_cast<const Type*>(rhs));
+    const Type& typedLhs = *static_cast<const Type*>(lhs);
+    const Type& typedRhs = *static_cast<const Type*>(rhs);
+    if constexpr (k_IdentifiedSharedComponent<Type>)
+        return typedLhs.identity() == typedRhs.identity();
+    else
+        return std::equal_to<Type>()(typedLhs, typedRhs);
 }
 
 }  // namespace Melon
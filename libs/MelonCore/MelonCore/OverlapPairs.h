@@ -0,0 +1,52 @@
+#pragma once
+
+#include <MelonCore/Entity.h>
+#include <MelonCore/SingletonComponent.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <vector>
+
+namespace Melon {
+
+// Pairs of Entities whose Bounds overlap, found anew each frame by the BroadphaseSystem
+// Tasks declaring OverlapPairs read see the pairs of the frame if ordered after the BroadphaseSystem
+class OverlapPairs : public SingletonComponent {
+  public:
+    // Pairs are written by each worker into an array of its own, the last one for tasks executed outside of workers
+    static constexpr unsigned int k_ArrayCount = TaskManager::k_WorkerCount + 1;
+
+    // second is the static Entity of pairs between a static and a dynamic one
+    struct Pair {
+        Entity first;
+        Entity second;
+    };
+
+    // Pairs are in no particular order
+    template <typename Function>
+    void forEach(Function&& function) const;
+    // Tasks going over the pairs in parallel could take an array each
+    std::vector<Pair> const& pairs(const unsigned int& arrayIndex) const { return m_PairArrays[arrayIndex]; }
+    unsigned int pairCount() const;
+
+  private:
+    std::array<std::vector<Pair>, k_ArrayCount> m_PairArrays;
+
+    friend class BroadphaseSystem;
+};
+
+template <typename Function>
+void OverlapPairs::forEach(Function&& function) const {
+    for (std::vector<Pair> const& pairArray : m_PairArrays)
+        for (const Pair& pair : pairArray)
+            function(pair);
+}
+
+inline unsigned int OverlapPairs::pairCount() const {
+    unsigned int pairCount = 0;
+    for (std::vector<Pair> const& pairArray : m_PairArrays)
+        pairCount += pairArray.size();
+    return pairCount;
+}
+
+}  // namespace Melon
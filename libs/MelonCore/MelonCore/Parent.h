@@ -0,0 +1,13 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+#include <MelonCore/Entity.h>
+
+namespace Melon {
+
+// Places the Entity under another one, its LocalTransform is then relative to the LocalToWorld of value
+struct Parent : public DataComponent {
+    Entity value;
+};
+
+}  // namespace Melon
@@ -0,0 +1,18 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+namespace Melon {
+
+// Hint that the cache line holding address is read soon
+inline void prefetch(const void* address) {
+#if defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+}  // namespace Melon
@@ -6,7 +6,8 @@
 
 namespace Melon {
 
-struct Scale : public DataComponent {
+// x, y and z are columns of their own, fields 0, 1 and 2
+struct Scale : public SoADataComponent {
     glm::vec3 value;
 };
 
@@ -6,4 +6,8 @@ struct SharedComponent {};
 
 struct ManualSharedComponent : public SharedComponent {};
 
+// SharedComponents defining identity(), such as the resource they refer to, are hashed and compared by it instead of by their whole value
+template <typename Type>
+inline constexpr bool k_IdentifiedSharedComponent = requires(const Type& sharedComponent) { sharedComponent.identity(); };
+
 }  // namespace Melon
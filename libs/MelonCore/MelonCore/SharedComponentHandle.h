@@ -0,0 +1,32 @@
+#pragma once
+
+#include <MelonCore/SharedComponent.h>
+
+#include <memory>
+#include <type_traits>
+
+namespace Melon {
+
+// A SharedComponent stored once by EntityManager::createSharedComponentHandle(), given to Entities by reference counting without hashing or comparing it again
+// The handle references the SharedComponent itself until EntityManager::releaseSharedComponentHandle(), copies share that reference
+template <typename Type>
+class SharedComponentHandle {
+    static_assert(std::is_base_of_v<SharedComponent, Type>);
+
+  public:
+    SharedComponentHandle() = default;
+
+    bool valid() const { return m_SharedComponentIndex != nullptr; }
+
+  private:
+    SharedComponentHandle(std::shared_ptr<unsigned int> const& sharedComponentIndex) : m_SharedComponentIndex(sharedComponentIndex) {}
+
+    // Resolved by the EntityCommandBuffer command creating the handle, before any command given the handle is executed
+    std::shared_ptr<unsigned int> m_SharedComponentIndex;
+
+    friend class EntityCommandBuffer;
+    friend class EntityFilterBuilder;
+    friend class EntityManager;
+};
+
+}  // namespace Melon
@@ -14,7 +14,7 @@ class SingletonObjectStore {
 
     template <typename Type>
     void pop(const unsigned int& typeId) {
-        delete m_Store[typeId];
+        delete static_cast<Type*>(m_Store[typeId]);
         m_Store[typeId] = nullptr;
     }
 
@@ -24,7 +24,7 @@ class SingletonObjectStore {
     }
 
   private:
-    std::array<void*, Count> m_Store;
+    std::array<void*, Count> m_Store{};
 };
 
 }  // namespace Melon
@@ -0,0 +1,78 @@
+#include <MelonCore/SpatialIndex.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Melon {
+
+namespace {
+
+// Keep neighbors[0, count) sorted by distance, dropping the farthest once all are filled
+void insertNeighbor(std::span<SpatialIndex::Neighbor> neighbors, unsigned int& count, const SpatialIndex::Neighbor& neighbor) {
+    if (count == neighbors.size() && neighbor.distanceSquared >= neighbors[count - 1].distanceSquared) return;
+    unsigned int i = count < neighbors.size() ? count++ : count - 1;
+    for (; i > 0 && neighbors[i - 1].distanceSquared > neighbor.distanceSquared; i--)
+        neighbors[i] = neighbors[i - 1];
+    neighbors[i] = neighbor;
+}
+
+}  // namespace
+
+unsigned int SpatialIndex::nearest(const glm::vec3& center, const float& maxDistance, std::span<Neighbor> neighbors) const {
+    if (neighbors.empty()) return 0;
+    glm::ivec3 minCoordinate, maxCoordinate;
+    occupiedBounds(minCoordinate, maxCoordinate);
+    if (minCoordinate.x > maxCoordinate.x) return 0;
+
+    // Cells are visited ring by ring around the cell of center, the cells of ring r being r cells away from it on some axis
+    // Entities in ring r are at least (r - 1) * cellSize away, so rings stop once that exceeds the farthest neighbor kept
+    const glm::ivec3 centerCoordinate = cellCoordinate(center);
+    const glm::ivec3 farthest = glm::max(centerCoordinate - minCoordinate, maxCoordinate - centerCoordinate);
+    const float maxRingDistance = std::min(maxDistance / m_CellSize + 1.0f, static_cast<float>(k_MaxCellCoordinate) * 2.0f);
+    const int maxRing = std::min(std::max({farthest.x, farthest.y, farthest.z}), static_cast<int>(maxRingDistance));
+    const float maxDistanceSquared = maxDistance * maxDistance;
+    const unsigned int cellCount = this->cellCount();
+
+    unsigned int count = 0;
+    const auto visit = [&](const Cell& cell) {
+        for (unsigned int i = 0; i < cell.positions.size(); i++) {
+            const glm::vec3 offset = cell.positions[i] - center;
+            const float distanceSquared = glm::dot(offset, offset);
+            if (distanceSquared <= maxDistanceSquared)
+                insertNeighbor(neighbors, count, Neighbor{.entity = cell.entities[i], .position = cell.positions[i], .distanceSquared = distanceSquared});
+        }
+    };
+    unsigned long long visitedCellCount = 0;
+    for (int ring = 0; ring <= maxRing; ring++) {
+        const float ringDistance = (ring - 1) * m_CellSize;
+        if (count == neighbors.size() && ring > 0 && neighbors[count - 1].distanceSquared <= ringDistance * ringDistance) break;
+
+        // Sparse grids are cheaper to finish by going over the occupied cells from this ring on
+        const unsigned long long side = 2ULL * ring + 1;
+        visitedCellCount += ring == 0 ? 1 : side * side * side - (side - 2) * (side - 2) * (side - 2);
+        if (visitedCellCount > cellCount) {
+            for (const Shard& shard : m_Shards)
+                for (const auto& [key, cell] : shard.cells) {
+                    const glm::ivec3 offset = glm::abs(cell.coordinate - centerCoordinate);
+                    if (std::max({offset.x, offset.y, offset.z}) >= ring)
+                        visit(cell);
+                }
+            break;
+        }
+
+        for (int z = -ring; z <= ring; z++)
+            for (int y = -ring; y <= ring; y++) {
+                // Inner rows of the ring only have their two ends on it
+                const int step = std::abs(z) == ring || std::abs(y) == ring || ring == 0 ? 1 : 2 * ring;
+                for (int x = -ring; x <= ring; x += step) {
+                    const glm::ivec3 coordinate = centerCoordinate + glm::ivec3(x, y, z);
+                    if (glm::any(glm::lessThan(coordinate, minCoordinate)) || glm::any(glm::greaterThan(coordinate, maxCoordinate))) continue;
+                    if (const Cell* cell = this->cell(coordinate))
+                        visit(*cell);
+                }
+            }
+    }
+    return count;
+}
+
+}  // namespace Melon
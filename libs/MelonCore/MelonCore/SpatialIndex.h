@@ -0,0 +1,179 @@
+#pragma once
+
+#include <MelonCore/Entity.h>
+#include <MelonCore/SingletonComponent.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vector_relational.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Melon {
+
+// Entities with a Translation bucketed by the SpatialIndexSystem into a uniform grid of cubic cells, of which only occupied ones are stored
+// Queries only visit the cells they overlap, so their cost depends on the Entities nearby instead of all of them
+// Tasks declaring SpatialIndex read could query it concurrently, seeing the Translations of the frame if ordered after the SpatialIndexSystem
+class SpatialIndex : public SingletonComponent {
+  public:
+    // Cells are split by their coordinates into shards, which are updated in parallel
+    static constexpr unsigned int k_ShardCount = TaskManager::k_WorkerCount;
+
+    struct Neighbor {
+        Entity entity;
+        glm::vec3 position;
+        float distanceSquared;
+    };
+
+    SpatialIndex(const float& cellSize) : m_CellSize(cellSize) {}
+
+    // Call function with each Entity within radius of center and its position
+    template <typename Function>
+    void forEachInRadius(const glm::vec3& center, const float& radius, Function&& function) const;
+    // Call function with each Entity inside the box [min, max] and its position
+    template <typename Function>
+    void forEachInBox(const glm::vec3& min, const glm::vec3& max, Function&& function) const;
+    // Fill neighbors with the Entities nearest to center by increasing distance, up to neighbors.size() within maxDistance
+    // Returns the count filled, an Entity at center is included
+    unsigned int nearest(const glm::vec3& center, const float& maxDistance, std::span<Neighbor> neighbors) const;
+
+    const float& cellSize() const { return m_CellSize; }
+    unsigned int cellCount() const;
+
+  private:
+    // Cell coordinates are clamped to 21 bits each, so that they are packed into one key
+    static constexpr int k_MaxCellCoordinate = (1 << 20) - 1;
+
+    struct Cell {
+        glm::ivec3 coordinate;
+        std::vector<Entity> entities;
+        std::vector<glm::vec3> positions;
+    };
+
+    struct Shard {
+        std::unordered_map<std::uint64_t, Cell> cells;
+        // Bounds of the occupied cells in the shard, which may be larger until an update recomputes them
+        glm::ivec3 minCoordinate{INT_MAX};
+        glm::ivec3 maxCoordinate{INT_MIN};
+        // Whether a cell on the bounds was emptied since they were last computed
+        bool boundsStale{};
+    };
+
+    // Where each Entity is in the grid, indexed by the id of the Entity
+    // cell is null if the Entity is not in the grid, in which case a valid entity is waiting for SpatialIndexed to be removed
+    struct Slot {
+        Entity entity{Entity::invalidEntity()};
+        Cell* cell{};
+        unsigned int index{};
+    };
+
+    static std::uint64_t cellKey(const glm::ivec3& coordinate);
+    static unsigned int shardIndex(const std::uint64_t& cellKey);
+    glm::ivec3 cellCoordinate(const glm::vec3& position) const;
+    const Cell* cell(const glm::ivec3& coordinate) const;
+    // Bounds of the occupied cells, min is greater than max if none
+    void occupiedBounds(glm::ivec3& minCoordinate, glm::ivec3& maxCoordinate) const;
+    // Call function with each occupied cell in [minCoordinate, maxCoordinate]
+    template <typename Function>
+    void forEachCell(const glm::ivec3& minCoordinate, const glm::ivec3& maxCoordinate, Function&& function) const;
+
+    float m_CellSize;
+    std::array<Shard, k_ShardCount> m_Shards;
+    std::vector<Slot> m_Slots;
+
+    friend class SpatialIndexSystem;
+};
+
+template <typename Function>
+void SpatialIndex::forEachInRadius(const glm::vec3& center, const float& radius, Function&& function) const {
+    const float radiusSquared = radius * radius;
+    forEachCell(cellCoordinate(center - radius), cellCoordinate(center + radius), [&](const Cell& cell) {
+        for (unsigned int i = 0; i < cell.positions.size(); i++) {
+            const glm::vec3 offset = cell.positions[i] - center;
+            if (glm::dot(offset, offset) <= radiusSquared)
+                function(cell.entities[i], cell.positions[i]);
+        }
+    });
+}
+
+template <typename Function>
+void SpatialIndex::forEachInBox(const glm::vec3& min, const glm::vec3& max, Function&& function) const {
+    forEachCell(cellCoordinate(min), cellCoordinate(max), [&](const Cell& cell) {
+        for (unsigned int i = 0; i < cell.positions.size(); i++)
+            if (glm::all(glm::greaterThanEqual(cell.positions[i], min)) && glm::all(glm::lessThanEqual(cell.positions[i], max)))
+                function(cell.entities[i], cell.positions[i]);
+    });
+}
+
+inline unsigned int SpatialIndex::cellCount() const {
+    unsigned int cellCount = 0;
+    for (const Shard& shard : m_Shards)
+        cellCount += shard.cells.size();
+    return cellCount;
+}
+
+inline std::uint64_t SpatialIndex::cellKey(const glm::ivec3& coordinate) {
+    constexpr std::uint64_t mask = (std::uint64_t{1} << 21) - 1;
+    return (static_cast<std::uint64_t>(coordinate.x) & mask) | (static_cast<std::uint64_t>(coordinate.y) & mask) << 21 | (static_cast<std::uint64_t>(coordinate.z) & mask) << 42;
+}
+
+inline unsigned int SpatialIndex::shardIndex(const std::uint64_t& cellKey) {
+    // Neighboring cells land in different shards, so that a crowded area is spread over workers
+    return static_cast<unsigned int>((cellKey * 0x9E3779B97F4A7C15ULL) >> 32) % k_ShardCount;
+}
+
+inline glm::ivec3 SpatialIndex::cellCoordinate(const glm::vec3& position) const {
+    return glm::ivec3(glm::clamp(glm::floor(position / m_CellSize), glm::vec3(-k_MaxCellCoordinate), glm::vec3(k_MaxCellCoordinate)));
+}
+
+inline const SpatialIndex::Cell* SpatialIndex::cell(const glm::ivec3& coordinate) const {
+    const std::uint64_t key = cellKey(coordinate);
+    const std::unordered_map<std::uint64_t, Cell>& cells = m_Shards[shardIndex(key)].cells;
+    const auto iterator = cells.find(key);
+    return iterator != cells.end() ? &iterator->second : nullptr;
+}
+
+inline void SpatialIndex::occupiedBounds(glm::ivec3& minCoordinate, glm::ivec3& maxCoordinate) const {
+    minCoordinate = glm::ivec3(INT_MAX);
+    maxCoordinate = glm::ivec3(INT_MIN);
+    for (const Shard& shard : m_Shards) {
+        minCoordinate = glm::min(minCoordinate, shard.minCoordinate);
+        maxCoordinate = glm::max(maxCoordinate, shard.maxCoordinate);
+    }
+}
+
+template <typename Function>
+void SpatialIndex::forEachCell(const glm::ivec3& minCoordinate, const glm::ivec3& maxCoordinate, Function&& function) const {
+    // Cells outside of the occupied bounds are known to be empty without looking them up
+    glm::ivec3 first, last;
+    occupiedBounds(first, last);
+    first = glm::max(first, minCoordinate);
+    last = glm::min(last, maxCoordinate);
+    if (glm::any(glm::greaterThan(first, last))) return;
+    // Ranges spanning more cells than are occupied are cheaper to answer by going over the occupied ones
+    // The extents are multiplied one axis at a time, stopping once past cellCount(), so that the product cannot overflow
+    const unsigned long long cellCount = this->cellCount();
+    unsigned long long rangeCellCount = 1;
+    for (unsigned int axis = 0; axis < 3 && rangeCellCount <= cellCount; axis++)
+        rangeCellCount *= static_cast<unsigned long long>(last[axis] - first[axis]) + 1;
+    if (rangeCellCount > cellCount) {
+        for (const Shard& shard : m_Shards)
+            for (const auto& [key, cell] : shard.cells)
+                if (glm::all(glm::greaterThanEqual(cell.coordinate, first)) && glm::all(glm::lessThanEqual(cell.coordinate, last)))
+                    function(cell);
+        return;
+    }
+    for (int z = first.z; z <= last.z; z++)
+        for (int y = first.y; y <= last.y; y++)
+            for (int x = first.x; x <= last.x; x++)
+                if (const Cell* cell = this->cell(glm::ivec3(x, y, z)))
+                    function(*cell);
+}
+
+}  // namespace Melon
@@ -0,0 +1,192 @@
+#include <MelonCore/SpatialIndexSystem.h>
+#include <MelonCore/SpatialIndexed.h>
+#include <MelonCore/Translation.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace Melon {
+
+// Entities whose Translation has changed, moved in place if they stay in their cell
+class SpatialIndexSystem::TranslationChunkTask : public ChunkTask {
+  public:
+    TranslationChunkTask(SpatialIndex& spatialIndex, const unsigned int& translationComponentId, WorkerShardArrays<Entity>& departures, WorkerShardArrays<Insertion>& insertions, std::array<unsigned int, TaskManager::k_WorkerCount + 1>& maxEntityIds) : m_SpatialIndex(spatialIndex), m_TranslationComponentId(translationComponentId), m_Departures(departures), m_Insertions(insertions), m_MaxEntityIds(maxEntityIds) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        const unsigned int& workerIndex = TaskManager::workerIndex();
+        const Entity* entities = chunkAccessor.entityArray();
+        const ComponentFields<const Translation> translations = chunkAccessor.componentFields<const Translation>(m_TranslationComponentId);
+        const float* xs = translations.field(0).data();
+        const float* ys = translations.field(1).data();
+        const float* zs = translations.field(2).data();
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+            const glm::vec3 position(xs[i], ys[i], zs[i]);
+            const glm::ivec3 cellCoordinate = m_SpatialIndex.cellCoordinate(position);
+            // Slots of other Entities are not written until the chunk tasks are finished
+            if (entities[i].id < m_SpatialIndex.m_Slots.size()) {
+                SpatialIndex::Slot& slot = m_SpatialIndex.m_Slots[entities[i].id];
+                if (slot.cell != nullptr) {
+                    if (slot.entity == entities[i] && slot.cell->coordinate == cellCoordinate) {
+                        slot.cell->positions[slot.index] = position;
+                        continue;
+                    }
+                    m_Departures[workerIndex][SpatialIndex::shardIndex(SpatialIndex::cellKey(slot.cell->coordinate))].push_back(slot.entity);
+                }
+            }
+            m_Insertions[workerIndex][SpatialIndex::shardIndex(SpatialIndex::cellKey(cellCoordinate))].push_back(Insertion{.entity = entities[i], .cellCoordinate = cellCoordinate, .position = position});
+            m_MaxEntityIds[workerIndex] = std::max(m_MaxEntityIds[workerIndex], entities[i].id);
+        }
+    }
+
+    SpatialIndex& m_SpatialIndex;
+    const unsigned int m_TranslationComponentId;
+    WorkerShardArrays<Entity>& m_Departures;
+    WorkerShardArrays<Insertion>& m_Insertions;
+    std::array<unsigned int, TaskManager::k_WorkerCount + 1>& m_MaxEntityIds;
+};
+
+// Entities with SpatialIndexed whose Translation is removed, including destroyed ones
+class SpatialIndexSystem::RemovedChunkTask : public ChunkTask {
+  public:
+    RemovedChunkTask(const SpatialIndex& spatialIndex, WorkerShardArrays<Entity>& removals, std::array<unsigned int, TaskManager::k_WorkerCount + 1>& maxEntityIds) : m_SpatialIndex(spatialIndex), m_Removals(removals), m_MaxEntityIds(maxEntityIds) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        const unsigned int& workerIndex = TaskManager::workerIndex();
+        const Entity* entities = chunkAccessor.entityArray();
+        for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+            // Entities not in a cell are taken by any shard, which only writes their slot
+            unsigned int shardIndex = entities[i].id % SpatialIndex::k_ShardCount;
+            if (entities[i].id < m_SpatialIndex.m_Slots.size()) {
+                const SpatialIndex::Slot& slot = m_SpatialIndex.m_Slots[entities[i].id];
+                if (slot.entity == entities[i] && slot.cell != nullptr)
+                    shardIndex = SpatialIndex::shardIndex(SpatialIndex::cellKey(slot.cell->coordinate));
+            }
+            m_Removals[workerIndex][shardIndex].push_back(entities[i]);
+            m_MaxEntityIds[workerIndex] = std::max(m_MaxEntityIds[workerIndex], entities[i].id);
+        }
+    }
+
+    const SpatialIndex& m_SpatialIndex;
+    WorkerShardArrays<Entity>& m_Removals;
+    std::array<unsigned int, TaskManager::k_WorkerCount + 1>& m_MaxEntityIds;
+};
+
+void SpatialIndexSystem::onEnter() {
+    entityManager()->addSingletonComponent(SpatialIndex(m_CellSize));
+
+    m_MissingSpatialIndexedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Translation>().rejectComponents<SpatialIndexed>().createEntityFilter();
+    m_TranslationChangedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<SpatialIndexed>().changed<Translation>().createEntityFilter();
+    m_TranslationRemovedEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<SpatialIndexed>().rejectComponents<Translation>().createEntityFilter();
+    m_SpatialIndexComponentAccess = createComponentAccessBuilder().writeSingletonComponents<SpatialIndex>().createComponentAccess();
+    declareComponentAccess(createComponentAccessBuilder().readComponents<Translation>().writeSingletonComponents<SpatialIndex>().createComponentAccess());
+
+    m_TranslationComponentId = entityManager()->componentId<Translation>();
+    m_SpatialIndexSingletonComponentId = entityManager()->singletonComponentId<SpatialIndex>();
+}
+
+void SpatialIndexSystem::onUpdate() {
+    m_SpatialIndex = entityManager()->singletonComponent<SpatialIndex>(m_SpatialIndexSingletonComponentId);
+
+    // What was removed by the tasks of the previous frame, which are long finished
+    if (predecessor())
+        predecessor()->complete();
+    for (std::vector<Entity>& unindexedEntities : m_UnindexedEntities) {
+        for (const Entity& unindexedEntity : unindexedEntities)
+            entityManager()->removeComponent<SpatialIndexed>(unindexedEntity);
+        unindexedEntities.clear();
+    }
+
+    entityManager()->addComponent(m_MissingSpatialIndexedEntityFilter, SpatialIndexed{});
+
+    predecessor() = schedule(std::make_shared<TranslationChunkTask>(*m_SpatialIndex, m_TranslationComponentId, m_Departures, m_Insertions, m_MaxEntityIds), m_TranslationChangedEntityFilter, predecessor());
+    predecessor() = schedule(std::make_shared<RemovedChunkTask>(*m_SpatialIndex, m_Removals, m_MaxEntityIds), m_TranslationRemovedEntityFilter, predecessor());
+    // Cells leave the grid before others enter it, so that shards only write the cells they hold
+    predecessor() = schedule([this](const unsigned int&) { growSlots(); }, 1, m_SpatialIndexComponentAccess, predecessor());
+    predecessor() = schedule([this](const unsigned int& shardIndex) { remove(shardIndex); }, SpatialIndex::k_ShardCount, m_SpatialIndexComponentAccess, predecessor());
+    predecessor() = schedule([this](const unsigned int& shardIndex) { insert(shardIndex); }, SpatialIndex::k_ShardCount, m_SpatialIndexComponentAccess, predecessor());
+}
+
+void SpatialIndexSystem::onExit() {}
+
+void SpatialIndexSystem::growSlots() {
+    const unsigned int maxEntityId = *std::max_element(m_MaxEntityIds.begin(), m_MaxEntityIds.end());
+    if (maxEntityId >= m_SpatialIndex->m_Slots.size())
+        m_SpatialIndex->m_Slots.resize(maxEntityId + 1);
+    m_MaxEntityIds.fill(0);
+}
+
+void SpatialIndexSystem::remove(const unsigned int& shardIndex) {
+    SpatialIndex::Shard& shard = m_SpatialIndex->m_Shards[shardIndex];
+    for (std::array<std::vector<Entity>, SpatialIndex::k_ShardCount>& departures : m_Departures) {
+        for (const Entity& entity : departures[shardIndex]) {
+            SpatialIndex::Slot& slot = m_SpatialIndex->m_Slots[entity.id];
+            if (slot.entity == entity && slot.cell != nullptr)
+                removeFromCell(shard, slot);
+        }
+        departures[shardIndex].clear();
+    }
+    for (std::array<std::vector<Entity>, SpatialIndex::k_ShardCount>& removals : m_Removals) {
+        for (const Entity& entity : removals[shardIndex]) {
+            SpatialIndex::Slot& slot = m_SpatialIndex->m_Slots[entity.id];
+            // Entities are found again until their SpatialIndexed is removed in the next frame
+            if (slot.entity == entity && slot.cell == nullptr) continue;
+            if (slot.entity == entity)
+                removeFromCell(shard, slot);
+            slot = SpatialIndex::Slot{.entity = entity};
+            m_UnindexedEntities[shardIndex].push_back(entity);
+        }
+        removals[shardIndex].clear();
+    }
+}
+
+void SpatialIndexSystem::insert(const unsigned int& shardIndex) {
+    SpatialIndex::Shard& shard = m_SpatialIndex->m_Shards[shardIndex];
+    if (shard.boundsStale)
+        recomputeBounds(shard);
+    for (std::array<std::vector<Insertion>, SpatialIndex::k_ShardCount>& insertions : m_Insertions) {
+        for (const Insertion& insertion : insertions[shardIndex]) {
+            const auto [iterator, inserted] = shard.cells.try_emplace(SpatialIndex::cellKey(insertion.cellCoordinate));
+            SpatialIndex::Cell& cell = iterator->second;
+            if (inserted) {
+                cell.coordinate = insertion.cellCoordinate;
+                shard.minCoordinate = glm::min(shard.minCoordinate, cell.coordinate);
+                shard.maxCoordinate = glm::max(shard.maxCoordinate, cell.coordinate);
+            }
+            m_SpatialIndex->m_Slots[insertion.entity.id] = SpatialIndex::Slot{.entity = insertion.entity, .cell = &cell, .index = static_cast<unsigned int>(cell.entities.size())};
+            cell.entities.push_back(insertion.entity);
+            cell.positions.push_back(insertion.position);
+        }
+        insertions[shardIndex].clear();
+    }
+}
+
+void SpatialIndexSystem::removeFromCell(SpatialIndex::Shard& shard, SpatialIndex::Slot& slot) {
+    SpatialIndex::Cell& cell = *slot.cell;
+    // The last Entity of the cell takes the place of the removed one
+    const unsigned int lastIndex = cell.entities.size() - 1;
+    if (slot.index != lastIndex) {
+        cell.entities[slot.index] = cell.entities[lastIndex];
+        cell.positions[slot.index] = cell.positions[lastIndex];
+        m_SpatialIndex->m_Slots[cell.entities[slot.index].id].index = slot.index;
+    }
+    cell.entities.pop_back();
+    cell.positions.pop_back();
+    slot.cell = nullptr;
+    if (cell.entities.empty()) {
+        // Cells inside the bounds leave them unchanged
+        shard.boundsStale |= glm::any(glm::equal(cell.coordinate, shard.minCoordinate)) || glm::any(glm::equal(cell.coordinate, shard.maxCoordinate));
+        shard.cells.erase(SpatialIndex::cellKey(cell.coordinate));
+    }
+}
+
+void SpatialIndexSystem::recomputeBounds(SpatialIndex::Shard& shard) {
+    shard.minCoordinate = glm::ivec3(INT_MAX);
+    shard.maxCoordinate = glm::ivec3(INT_MIN);
+    for (const auto& [key, cell] : shard.cells) {
+        shard.minCoordinate = glm::min(shard.minCoordinate, cell.coordinate);
+        shard.maxCoordinate = glm::max(shard.maxCoordinate, cell.coordinate);
+    }
+    shard.boundsStale = false;
+}
+
+}  // namespace Melon
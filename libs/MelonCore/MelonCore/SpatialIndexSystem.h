@@ -0,0 +1,76 @@
+#pragma once
+
+#include <MelonCore/ComponentAccess.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/SpatialIndex.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace Melon {
+
+// Keeps the SpatialIndex singleton up to date with the Translation of Entities, only going over chunks where Translation has changed
+// Entities staying in their cell are moved in place by the chunk tasks, the others are removed and inserted by one task per shard
+// Entities missing SpatialIndexed are given one at the end of the frame and indexed in the next
+// Systems registered before it query the SpatialIndex of the previous frame
+class SpatialIndexSystem : public SystemBase {
+  public:
+    SpatialIndexSystem(const float& cellSize) : m_CellSize(cellSize) {}
+    virtual ~SpatialIndexSystem() {}
+
+  protected:
+    virtual void onEnter() final;
+    virtual void onUpdate() final;
+    virtual void onExit() final;
+
+  private:
+    class TranslationChunkTask;
+    class RemovedChunkTask;
+
+    struct Insertion {
+        Entity entity;
+        glm::ivec3 cellCoordinate;
+        glm::vec3 position;
+    };
+
+    // Gathered by each worker for each shard, the last one for tasks executed outside of workers
+    template <typename Type>
+    using WorkerShardArrays = std::array<std::array<std::vector<Type>, SpatialIndex::k_ShardCount>, TaskManager::k_WorkerCount + 1>;
+
+    // Grow the slots to cover the Entities gathered
+    void growSlots();
+    // Remove the Entities leaving their cell or the SpatialIndex within a shard
+    void remove(const unsigned int& shardIndex);
+    void insert(const unsigned int& shardIndex);
+    void removeFromCell(SpatialIndex::Shard& shard, SpatialIndex::Slot& slot);
+    // Shrink the bounds of the shard to its occupied cells
+    void recomputeBounds(SpatialIndex::Shard& shard);
+
+    const float m_CellSize;
+
+    EntityFilter m_MissingSpatialIndexedEntityFilter;
+    EntityFilter m_TranslationChangedEntityFilter;
+    EntityFilter m_TranslationRemovedEntityFilter;
+    // Tasks merging what chunk tasks gathered only touch the SpatialIndex
+    ComponentAccess m_SpatialIndexComponentAccess;
+
+    unsigned int m_TranslationComponentId;
+    unsigned int m_SpatialIndexSingletonComponentId;
+
+    // Valid from the first update, tasks write it while ordered by the SpatialIndex write declared
+    SpatialIndex* m_SpatialIndex{};
+
+    // Entities leaving their cell, Entities leaving the SpatialIndex, and Entities entering a cell, by the shard of the cell
+    WorkerShardArrays<Entity> m_Departures;
+    WorkerShardArrays<Entity> m_Removals;
+    WorkerShardArrays<Insertion> m_Insertions;
+    std::array<unsigned int, TaskManager::k_WorkerCount + 1> m_MaxEntityIds{};
+    // Removed from the SpatialIndex by the tasks of the previous frame, whose SpatialIndexed is removed in this one
+    std::array<std::vector<Entity>, SpatialIndex::k_ShardCount> m_UnindexedEntities;
+};
+
+}  // namespace Melon
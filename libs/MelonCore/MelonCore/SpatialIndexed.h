@@ -0,0 +1,11 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+namespace Melon {
+
+// Written by the SpatialIndexSystem on Entities it indexes
+// Manual so that destroyed Entities remain until they are removed from the SpatialIndex
+struct SpatialIndexed : public ManualDataComponent {};
+
+}  // namespace Melon
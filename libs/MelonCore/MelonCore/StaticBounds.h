@@ -0,0 +1,10 @@
+#pragma once
+
+#include <MelonCore/DataComponent.h>
+
+namespace Melon {
+
+// Marks Bounds that rarely change, which the BroadphaseSystem never tests against each other
+struct StaticBounds : public DataComponent {};
+
+}  // namespace Melon
@@ -1,68 +1,207 @@
 #include <MelonCore/SystemBase.h>
 #include <MelonTask/TaskManager.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace Melon {
 
 std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor) {
-    std::shared_ptr<std::vector<ChunkAccessor>> accessors = std::make_shared<std::vector<ChunkAccessor>>(m_EntityManager->filterEntities(entityFilter));
-    if (accessors->size() == 0) return predecessor;
-    const unsigned int taskCount = std::min(TaskManager::k_WorkerCount, (static_cast<unsigned int>(accessors->size()) - 1) / k_MinChunkCountPerTask + 1);
-    const unsigned int chunkCountPerTask = accessors->size() / taskCount;
-    std::vector<std::shared_ptr<TaskHandle>> taskHandles(taskCount);
-    unsigned int chunkCounter = 0;
-    unsigned int entityCounter = 0;
-    for (unsigned int i = 0; i < taskCount; i++) {
+    return schedule(chunkTask, entityFilter, m_ComponentAccess, predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor) {
+    return schedule(chunkRangeTask, entityFilter, m_ComponentAccess, predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor) {
+    return schedule(entityCommandBufferChunkTask, entityFilter, m_ComponentAccess, predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    return schedule(chunkTask, entityFilter, std::make_shared<const ComponentAccess>(componentAccess), predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    return schedule(chunkRangeTask, entityFilter, std::make_shared<const ComponentAccess>(componentAccess), predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    return schedule(entityCommandBufferChunkTask, entityFilter, std::make_shared<const ComponentAccess>(componentAccess), predecessor);
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::function<void(const unsigned int&)> const& procedure, const unsigned int& count, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    const std::vector<std::shared_ptr<TaskHandle>> predecessors = dependencies(&componentAccess, predecessor);
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles(count);
+    for (unsigned int i = 0; i < count; i++)
+        taskHandles[i] = m_TaskManager->schedule([procedure, i]() { procedure(i); }, predecessors);
+    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->combine(taskHandles);
+    record(&componentAccess, taskHandle);
+    return taskHandle;
+}
+
+void SystemBase::declareComponentAccess(const ComponentAccess& componentAccess) {
+    std::shared_ptr<ComponentAccess> declaredComponentAccess = m_ComponentAccess ? std::make_shared<ComponentAccess>(*m_ComponentAccess) : std::make_shared<ComponentAccess>();
+    *declaredComponentAccess |= componentAccess;
+    m_ComponentAccess = declaredComponentAccess;
+}
+
+void SystemBase::completeComponentAccess(const ComponentAccess& componentAccess) const {
+    std::vector<std::shared_ptr<TaskHandle>> const taskHandles = m_DependencyManager->dependencies(componentAccess);
+    if (taskHandles.empty()) return;
+    // Tasks scheduled by the updating system are only queued once it returns
+    m_TaskManager->activateWaitingTasks();
+    for (std::shared_ptr<TaskHandle> const& taskHandle : taskHandles)
+        taskHandle->complete();
+}
+
+void SystemBase::TaskCost::record(const std::chrono::steady_clock::time_point& startTimePoint, const unsigned int& entityCount) {
+    if (entityCount == 0) return;
+    nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTimePoint).count(), std::memory_order_relaxed);
+    this->entityCount.fetch_add(entityCount, std::memory_order_relaxed);
+}
+
+const float& SystemBase::TaskCost::estimate() {
+    // Tasks of the previous frame may still be recording, which only shifts their cost into the next estimate
+    const unsigned int measuredEntityCount = entityCount.exchange(0, std::memory_order_relaxed);
+    const unsigned long long measuredNanoseconds = nanoseconds.exchange(0, std::memory_order_relaxed);
+    if (measuredEntityCount != 0) {
+        const float measuredNanosecondsPerEntity = static_cast<float>(measuredNanoseconds) / measuredEntityCount;
+        nanosecondsPerEntity = nanosecondsPerEntity == 0.0f ? measuredNanosecondsPerEntity : (nanosecondsPerEntity + measuredNanosecondsPerEntity) * 0.5f;
+    }
+    return nanosecondsPerEntity;
+}
+
+unsigned int SystemBase::batchEntityCount(const unsigned int& entityCount, const float& nanosecondsPerEntity) {
+    // Enough batches to keep every worker busy, each long enough to be worth claiming
+    const unsigned int batchCount = TaskManager::k_WorkerCount * k_BatchCountPerWorker;
+    const unsigned int balancedBatchEntityCount = (entityCount + batchCount - 1) / batchCount;
+    const unsigned int minBatchEntityCount = nanosecondsPerEntity == 0.0f ? k_MinEntityCountPerBatch : static_cast<unsigned int>(std::ceil(k_MinBatchNanoseconds / nanosecondsPerEntity));
+    return std::max({1U, balancedBatchEntityCount, minBatchEntityCount});
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    std::shared_ptr<TaskCost> taskCost = this->taskCost(typeid(*chunkTask));
+    std::shared_ptr<ChunkBatches> chunkBatches = std::make_shared<ChunkBatches>();
+    std::shared_ptr<TaskHandle> filterTaskHandle = scheduleFilter(chunkBatches, entityFilter, componentAccess, taskCost->estimate(), false, predecessor);
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles(TaskManager::k_WorkerCount);
+    for (unsigned int i = 0; i < TaskManager::k_WorkerCount; i++)
         taskHandles[i] = m_TaskManager->schedule(
-            [chunkTask, accessors, chunkCountPerTask, i, chunkCounter, entityCounter]() {
-                for (unsigned int j = i * chunkCountPerTask; j < (i + 1) * chunkCountPerTask && j < accessors->size(); j++)
-                    chunkTask->execute((*accessors)[j], chunkCounter, entityCounter);
+            [chunkTask, chunkBatches, componentAccess, taskCost]() {
+                const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+                const unsigned int entityCount = chunkBatches->execute([&](const unsigned int& chunkIndex, const unsigned int&, const unsigned int&) {
+                    chunkTask->execute(chunkBatches->accessors()[chunkIndex], chunkIndex, chunkBatches->firstEntityIndex(chunkIndex));
+                });
+                taskCost->record(startTimePoint, entityCount);
             },
-            {predecessor});
-        chunkCounter += chunkCountPerTask;
-        for (unsigned int j = i * chunkCountPerTask; j < (i + 1) * chunkCountPerTask && j < accessors->size(); j++)
-            entityCounter += (*accessors)[j].entityCount();
-    }
-    return m_TaskManager->combine(taskHandles);
+            {filterTaskHandle});
+    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->combine(taskHandles);
+    record(componentAccess.get(), taskHandle);
+    return taskHandle;
 }
 
-std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor) {
-    std::shared_ptr<std::vector<ChunkAccessor>> accessors = std::make_shared<std::vector<ChunkAccessor>>(m_EntityManager->filterEntities(entityFilter));
-    if (accessors->size() == 0) return predecessor;
-    const unsigned int taskCount = std::min(TaskManager::k_WorkerCount, (static_cast<unsigned int>(accessors->size()) - 1) / k_MinChunkCountPerTask + 1);
-    const unsigned int chunkCountPerTask = accessors->size() / taskCount;
-    std::vector<std::shared_ptr<TaskHandle>> taskHandles(taskCount);
-    unsigned int chunkCounter = 0;
-    unsigned int entityCounter = 0;
-    for (unsigned int i = 0; i < taskCount; i++) {
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    std::shared_ptr<TaskCost> taskCost = this->taskCost(typeid(*chunkRangeTask));
+    std::shared_ptr<ChunkBatches> chunkBatches = std::make_shared<ChunkBatches>();
+    std::shared_ptr<TaskHandle> filterTaskHandle = scheduleFilter(chunkBatches, entityFilter, componentAccess, taskCost->estimate(), true, predecessor);
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles(TaskManager::k_WorkerCount);
+    for (unsigned int i = 0; i < TaskManager::k_WorkerCount; i++)
+        taskHandles[i] = m_TaskManager->schedule(
+            [chunkRangeTask, chunkBatches, componentAccess, taskCost]() {
+                const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+                const unsigned int entityCount = chunkBatches->execute([&](const unsigned int& chunkIndex, const unsigned int& entityBegin, const unsigned int& entityEnd) {
+                    chunkRangeTask->execute(chunkBatches->accessors()[chunkIndex], chunkIndex, chunkBatches->firstEntityIndex(chunkIndex), entityBegin, entityEnd);
+                });
+                taskCost->record(startTimePoint, entityCount);
+            },
+            {filterTaskHandle});
+    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->combine(taskHandles);
+    record(componentAccess.get(), taskHandle);
+    return taskHandle;
+}
+
+std::shared_ptr<TaskHandle> SystemBase::schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor) {
+    std::shared_ptr<TaskCost> taskCost = this->taskCost(typeid(*entityCommandBufferChunkTask));
+    std::shared_ptr<ChunkBatches> chunkBatches = std::make_shared<ChunkBatches>();
+    std::shared_ptr<TaskHandle> filterTaskHandle = scheduleFilter(chunkBatches, entityFilter, componentAccess, taskCost->estimate(), false, predecessor);
+    std::vector<std::shared_ptr<TaskHandle>> taskHandles(TaskManager::k_WorkerCount);
+    for (unsigned int i = 0; i < TaskManager::k_WorkerCount; i++) {
         EntityCommandBuffer* entityCommandBuffer = m_EntityManager->createEntityCommandBuffer();
         taskHandles[i] = m_TaskManager->schedule(
-            [entityCommandBufferChunkTask, accessors, chunkCountPerTask, i, chunkCounter, entityCounter, entityCommandBuffer]() {
-                for (unsigned int j = i * chunkCountPerTask; j < (i + 1) * chunkCountPerTask && j < accessors->size(); j++)
-                    entityCommandBufferChunkTask->execute((*accessors)[j], chunkCounter, entityCounter, entityCommandBuffer);
+            [entityCommandBufferChunkTask, chunkBatches, componentAccess, taskCost, entityCommandBuffer]() {
+                const std::chrono::steady_clock::time_point startTimePoint = std::chrono::steady_clock::now();
+                const unsigned int entityCount = chunkBatches->execute([&](const unsigned int& chunkIndex, const unsigned int&, const unsigned int&) {
+                    entityCommandBufferChunkTask->execute(chunkBatches->accessors()[chunkIndex], chunkIndex, chunkBatches->firstEntityIndex(chunkIndex), entityCommandBuffer);
+                });
+                taskCost->record(startTimePoint, entityCount);
             },
-            {predecessor});
-        chunkCounter += chunkCountPerTask;
-        for (unsigned int j = i * chunkCountPerTask; j < (i + 1) * chunkCountPerTask && j < accessors->size(); j++)
-            entityCounter += (*accessors)[j].entityCount();
+            {filterTaskHandle});
     }
-    return m_TaskManager->combine(taskHandles);
+    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->combine(taskHandles);
+    record(componentAccess.get(), taskHandle);
+    return taskHandle;
+}
+
+std::shared_ptr<TaskHandle> SystemBase::scheduleFilter(std::shared_ptr<ChunkBatches> const& chunkBatches, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, const float& nanosecondsPerEntity, const bool& splitChunks, std::shared_ptr<TaskHandle> const& predecessor) {
+    // Chunks are filtered once the predecessors are finished, which include the execution of EntityCommandBuffers changing them
+    EntityManager* entityManager = m_EntityManager;
+    const unsigned int lastSystemVersion = m_LastSystemVersion;
+    const unsigned int globalSystemVersion = m_EntityManager->m_GlobalSystemVersion;
+    const bool chunkAffinity = m_ChunkAffinity;
+    return m_TaskManager->schedule(
+        [chunkBatches, entityFilter, componentAccess, nanosecondsPerEntity, splitChunks, chunkAffinity, entityManager, lastSystemVersion, globalSystemVersion]() {
+            std::vector<ChunkAccessor> accessors = entityManager->filterEntitiesWithoutCheck(entityFilter, lastSystemVersion, globalSystemVersion);
+            unsigned int entityCount = 0;
+            for (ChunkAccessor& accessor : accessors) {
+                accessor.m_ComponentAccess = componentAccess.get();
+                entityCount += accessor.entityCount();
+            }
+            if (chunkAffinity)
+                chunkBatches->assignWithAffinity(std::move(accessors), batchEntityCount(entityCount, nanosecondsPerEntity));
+            else
+                chunkBatches->assign(std::move(accessors), batchEntityCount(entityCount, nanosecondsPerEntity), splitChunks);
+        },
+        dependencies(componentAccess.get(), predecessor));
+}
+
+std::shared_ptr<SystemBase::TaskCost> const& SystemBase::taskCost(const std::type_index& taskType) {
+    std::shared_ptr<TaskCost>& taskCost = m_TaskCosts[taskType];
+    if (!taskCost)
+        taskCost = std::make_shared<TaskCost>();
+    return taskCost;
+}
+
+std::vector<std::shared_ptr<TaskHandle>> SystemBase::dependencies(const ComponentAccess* componentAccess, std::shared_ptr<TaskHandle> const& predecessor) const {
+    std::vector<std::shared_ptr<TaskHandle>> predecessors = componentAccess ? m_DependencyManager->dependencies(*componentAccess) : m_DependencyManager->exclusiveDependencies();
+    if (predecessor && std::find(predecessors.begin(), predecessors.end(), predecessor) == predecessors.end())
+        predecessors.push_back(predecessor);
+    return predecessors;
+}
+
+void SystemBase::record(const ComponentAccess* componentAccess, std::shared_ptr<TaskHandle> const& taskHandle) {
+    if (componentAccess)
+        m_DependencyManager->record(*componentAccess, taskHandle);
+    else
+        m_DependencyManager->recordExclusive(taskHandle);
 }
 
-void SystemBase::enter(Instance* instance, TaskManager* taskManager, Time* time, ResourceManager* resourceManager, EntityManager* entityManager, EventManager* eventManager) {
+void SystemBase::enter(Instance* instance, TaskManager* taskManager, Time* time, ResourceManager* resourceManager, EntityManager* entityManager, EventManager* eventManager, DependencyManager* dependencyManager) {
     m_Instance = instance;
     m_TaskManager = taskManager;
     m_Time = time;
     m_ResourceManager = resourceManager;
     m_EntityManager = entityManager;
     m_EventManager = eventManager;
+    m_DependencyManager = dependencyManager;
     onEnter();
     m_TaskManager->activateWaitingTasks();
 }
 
 void SystemBase::update() {
-    if (m_TaskHandle)
-        m_TaskHandle->complete();
+    // Tasks wait for what they depend on, the main thread only waits where it reads from the EntityManager
+    m_EntityManager->m_GlobalSystemVersion++;
     onUpdate();
+    m_LastSystemVersion = m_EntityManager->m_GlobalSystemVersion;
     m_TaskManager->activateWaitingTasks();
 }
 
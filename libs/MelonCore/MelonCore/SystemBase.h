@@ -1,6 +1,10 @@
 #pragma once
 
 #include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ChunkBatches.h>
+#include <MelonCore/ComponentAccess.h>
+#include <MelonCore/ComponentLookup.h>
+#include <MelonCore/DependencyManager.h>
 #include <MelonCore/EntityFilter.h>
 #include <MelonCore/EntityManager.h>
 #include <MelonCore/EventManager.h>
@@ -9,7 +13,15 @@
 #include <MelonTask/TaskHandle.h>
 #include <MelonTask/TaskManager.h>
 
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 namespace Melon {
 
@@ -20,6 +32,12 @@ class ChunkTask {
     virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) = 0;
 };
 
+// Expensive tasks may have their chunks split across workers, so they only execute the Entities [entityBegin, entityEnd) of the chunk
+class ChunkRangeTask {
+  public:
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, const unsigned int& entityBegin, const unsigned int& entityEnd) = 0;
+};
+
 class EntityCommandBufferChunkTask {
   public:
     virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex, EntityCommandBuffer* entityCommandBuffer) = 0;
@@ -27,7 +45,11 @@ class EntityCommandBufferChunkTask {
 
 class SystemBase {
   public:
-    static constexpr unsigned int k_MinChunkCountPerTask = 16;
+    // Chunks are claimed by tasks in batches, about k_BatchCountPerWorker per worker unless they would take less than k_MinBatchNanoseconds
+    static constexpr unsigned int k_BatchCountPerWorker = 4;
+    static constexpr float k_MinBatchNanoseconds = 20000.0f;
+    // Batch size until the cost of a task is measured
+    static constexpr unsigned int k_MinEntityCountPerBatch = 256;
 
     SystemBase() {}
     virtual ~SystemBase() {}
@@ -37,8 +59,30 @@ class SystemBase {
     virtual void onUpdate() = 0;
     virtual void onExit() = 0;
 
+    // Tasks are ordered by the ComponentAccess declared by the system
     std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor);
     std::shared_ptr<TaskHandle> schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, std::shared_ptr<TaskHandle> const& predecessor);
+    // Tasks are ordered by componentAccess, which should cover everything they touch
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    // Tasks touching no chunks, such as merging what chunk tasks gathered, procedure is called once with each index of [0, count) across workers
+    std::shared_ptr<TaskHandle> schedule(std::function<void(const unsigned int&)> const& procedure, const unsigned int& count, const ComponentAccess& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+
+    // Chunks of later scheduled tasks run on the same worker every frame unless the workers are imbalanced
+    // Consecutive tasks on the same chunks then find them in the cache of the worker, expensive chunks are no longer split
+    void setChunkAffinity(const bool& chunkAffinity) { m_ChunkAffinity = chunkAffinity; }
+
+    ComponentAccessBuilder createComponentAccessBuilder() const { return ComponentAccessBuilder(m_EntityManager); }
+    // Everything tasks of the system access, accumulated over calls
+    // Tasks of systems declaring nothing run after every earlier task and before every later one
+    void declareComponentAccess(const ComponentAccess& componentAccess);
+    // Wait for earlier tasks conflicting with componentAccess, which chunks got from EntityManager::filterEntities() do not wait for by themselves
+    void completeComponentAccess(const ComponentAccess& componentAccess) const;
+    // Random access from tasks to components of any Entity, Type should be declared read if const and written otherwise
+    template <typename Type>
+    ComponentLookup<Type> componentLookup();
 
     Instance* const& instance() const { return m_Instance; }
     TaskManager* const& taskManager() const { return m_TaskManager; }
@@ -47,11 +91,38 @@ class SystemBase {
     EntityManager* const& entityManager() const { return m_EntityManager; }
     EventManager* const& eventManager() const { return m_EventManager; }
 
+    // The global system version of the last update, chunks changed after it are accepted by changed components of EntityFilter
+    const unsigned int& lastSystemVersion() const { return m_LastSystemVersion; }
+
     const std::shared_ptr<TaskHandle>& predecessor() const { return m_TaskHandle; }
     std::shared_ptr<TaskHandle>& predecessor() { return m_TaskHandle; }
 
   private:
-    void enter(Instance* instance, TaskManager* taskManager, Time* time, ResourceManager* resourceManager, EntityManager* entityManager, EventManager* eventManager);
+    // Time spent by the tasks of a type on their Entities, measured over previous frames to pick the size of their batches
+    struct TaskCost {
+        std::atomic<unsigned long long> nanoseconds{};
+        std::atomic<unsigned int> entityCount{};
+        // Only used by the main thread
+        float nanosecondsPerEntity{};
+
+        void record(const std::chrono::steady_clock::time_point& startTimePoint, const unsigned int& entityCount);
+        // Folds what was recorded since the last estimate into nanosecondsPerEntity
+        const float& estimate();
+    };
+
+    static unsigned int batchEntityCount(const unsigned int& entityCount, const float& nanosecondsPerEntity);
+
+    // A null ComponentAccess schedules the tasks exclusively
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkTask> const& chunkTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<ChunkRangeTask> const& chunkRangeTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskHandle> schedule(std::shared_ptr<EntityCommandBufferChunkTask> const& entityCommandBufferChunkTask, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, std::shared_ptr<TaskHandle> const& predecessor);
+    // Filters chunks into chunkBatches once the dependencies of the ComponentAccess are finished
+    std::shared_ptr<TaskHandle> scheduleFilter(std::shared_ptr<ChunkBatches> const& chunkBatches, const EntityFilter& entityFilter, std::shared_ptr<const ComponentAccess> const& componentAccess, const float& nanosecondsPerEntity, const bool& splitChunks, std::shared_ptr<TaskHandle> const& predecessor);
+    std::shared_ptr<TaskCost> const& taskCost(const std::type_index& taskType);
+    std::vector<std::shared_ptr<TaskHandle>> dependencies(const ComponentAccess* componentAccess, std::shared_ptr<TaskHandle> const& predecessor) const;
+    void record(const ComponentAccess* componentAccess, std::shared_ptr<TaskHandle> const& taskHandle);
+
+    void enter(Instance* instance, TaskManager* taskManager, Time* time, ResourceManager* resourceManager, EntityManager* entityManager, EventManager* eventManager, DependencyManager* dependencyManager);
     void update();
     void exit();
 
@@ -61,10 +132,29 @@ class SystemBase {
     ResourceManager* m_ResourceManager;
     EntityManager* m_EntityManager;
     EventManager* m_EventManager;
+    DependencyManager* m_DependencyManager;
 
     std::shared_ptr<TaskHandle> m_TaskHandle;
 
+    // Null until declared, in which case tasks are scheduled exclusively
+    std::shared_ptr<const ComponentAccess> m_ComponentAccess;
+
+    unsigned int m_LastSystemVersion{};
+
+    bool m_ChunkAffinity{};
+    std::unordered_map<std::type_index, std::shared_ptr<TaskCost>> m_TaskCosts;
+
     friend class World;
 };
 
+template <typename Type>
+ComponentLookup<Type> SystemBase::componentLookup() {
+    const unsigned int componentId = m_EntityManager->componentId<std::remove_const_t<Type>>();
+    if constexpr (std::is_const_v<Type>)
+        assert(m_ComponentAccess && m_ComponentAccess->readable(componentId) && "Component looked up without being declared read");
+    else
+        assert(m_ComponentAccess && m_ComponentAccess->writable(componentId) && "Component looked up for writing without being declared written");
+    return ComponentLookup<Type>(m_EntityManager, componentId, m_EntityManager->m_GlobalSystemVersion);
+}
+
 }  // namespace Melon
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Melon {
+
+// Whether version is written after lastSystemVersion, comparing the difference so that versions could wrap around
+inline bool versionNewer(const unsigned int& version, const unsigned int& lastSystemVersion) {
+    return static_cast<int>(version - lastSystemVersion) > 0;
+}
+
+}  // namespace Melon
@@ -0,0 +1,195 @@
+#include <MelonCore/LocalToWorld.h>
+#include <MelonCore/Parent.h>
+#include <MelonCore/Rotation.h>
+#include <MelonCore/Scale.h>
+#include <MelonCore/TransformSystem.h>
+#include <MelonCore/Translation.h>
+
+#include <array>
+#include <cstddef>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace Melon {
+
+namespace {
+
+static_assert(sizeof(Rotation) == sizeof(glm::quat) && offsetof(glm::quat, x) == 0 && offsetof(glm::quat, w) == 3 * sizeof(float), "Rotations are loaded as x, y, z and w");
+static_assert(sizeof(LocalToWorld) == sizeof(glm::mat4));
+
+// Columns of the Entities of a chunk, rotations and scales are null if the chunk has none
+struct TransformColumns {
+    std::array<const float*, 3> translations;
+    const Rotation* rotations;
+    std::array<const float*, 3> scales;
+    LocalToWorld* localToWorlds;
+};
+
+void computeLocalToWorld(const TransformColumns& columns, const unsigned int& i) {
+    glm::mat4 localToWorld = columns.rotations != nullptr ? glm::mat4_cast(columns.rotations[i].value) : glm::mat4(1.0f);
+    if (columns.scales[0] != nullptr) {
+        localToWorld[0] *= columns.scales[0][i];
+        localToWorld[1] *= columns.scales[1][i];
+        localToWorld[2] *= columns.scales[2][i];
+    }
+    localToWorld[3] = glm::vec4(columns.translations[0][i], columns.translations[1][i], columns.translations[2][i], 1.0f);
+    columns.localToWorlds[i].value = localToWorld;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// The Entities [i, i + 4), with the rotation matrix expanded from 4 quaternions side by side as glm::mat4_cast does
+void computeLocalToWorlds4(const TransformColumns& columns, const unsigned int& i) {
+    __m128 x = _mm_setzero_ps(), y = _mm_setzero_ps(), z = _mm_setzero_ps(), w = _mm_set1_ps(1.0f);
+    if (columns.rotations != nullptr) {
+        const float* quaternions = &columns.rotations[i].value.x;
+        x = _mm_loadu_ps(quaternions), y = _mm_loadu_ps(quaternions + 4), z = _mm_loadu_ps(quaternions + 8), w = _mm_loadu_ps(quaternions + 12);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+    }
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+    const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+    __m128 matrix[4][4]{
+        {_mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy), _mm_setzero_ps()},
+        {_mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx), _mm_setzero_ps()},
+        {_mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)), _mm_setzero_ps()},
+        {_mm_loadu_ps(columns.translations[0] + i), _mm_loadu_ps(columns.translations[1] + i), _mm_loadu_ps(columns.translations[2] + i), one},
+    };
+    if (columns.scales[0] != nullptr)
+        for (unsigned int column = 0; column < 3; column++) {
+            const __m128 scale = _mm_loadu_ps(columns.scales[column] + i);
+            for (unsigned int row = 0; row < 3; row++)
+                matrix[column][row] = _mm_mul_ps(matrix[column][row], scale);
+        }
+
+    // Each column turns back into one vec4 per Entity
+    float* localToWorlds = &columns.localToWorlds[i].value[0][0];
+    for (unsigned int column = 0; column < 4; column++) {
+        _MM_TRANSPOSE4_PS(matrix[column][0], matrix[column][1], matrix[column][2], matrix[column][3]);
+        for (unsigned int entity = 0; entity < 4; entity++)
+            _mm_storeu_ps(localToWorlds + 16 * entity + 4 * column, matrix[column][entity]);
+    }
+}
+#endif
+
+#if defined(__AVX2__)
+// Transpose the 4x4 blocks in the lower and upper 128 bits separately
+void transpose4x4x2(__m256& a, __m256& b, __m256& c, __m256& d) {
+    const __m256 ab0 = _mm256_unpacklo_ps(a, b), ab1 = _mm256_unpackhi_ps(a, b);
+    const __m256 cd0 = _mm256_unpacklo_ps(c, d), cd1 = _mm256_unpackhi_ps(c, d);
+    a = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2));
+    c = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0));
+    d = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// The Entities [i, i + 8), the lower 128 bits of each vector hold the Entities [i, i + 4) and the upper ones [i + 4, i + 8)
+void computeLocalToWorlds8(const TransformColumns& columns, const unsigned int& i) {
+    __m256 x = _mm256_setzero_ps(), y = _mm256_setzero_ps(), z = _mm256_setzero_ps(), w = _mm256_set1_ps(1.0f);
+    if (columns.rotations != nullptr) {
+        const float* quaternions = &columns.rotations[i].value.x;
+        x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(quaternions)), _mm_loadu_ps(quaternions + 16), 1);
+        y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(quaternions + 4)), _mm_loadu_ps(quaternions + 20), 1);
+        z = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(quaternions + 8)), _mm_loadu_ps(quaternions + 24), 1);
+        w = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(quaternions + 12)), _mm_loadu_ps(quaternions + 28), 1);
+        transpose4x4x2(x, y, z, w);
+    }
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+    const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+    const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+    const __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+    __m256 matrix[4][4]{
+        {_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), _mm256_add_ps(xy, wz), _mm256_sub_ps(xz, wy), _mm256_setzero_ps()},
+        {_mm256_sub_ps(xy, wz), _mm256_sub_ps(one, _mm256_add_ps(xx, zz)), _mm256_add_ps(yz, wx), _mm256_setzero_ps()},
+        {_mm256_add_ps(xz, wy), _mm256_sub_ps(yz, wx), _mm256_sub_ps(one, _mm256_add_ps(xx, yy)), _mm256_setzero_ps()},
+        {_mm256_loadu_ps(columns.translations[0] + i), _mm256_loadu_ps(columns.translations[1] + i), _mm256_loadu_ps(columns.translations[2] + i), one},
+    };
+    if (columns.scales[0] != nullptr)
+        for (unsigned int column = 0; column < 3; column++) {
+            const __m256 scale = _mm256_loadu_ps(columns.scales[column] + i);
+            for (unsigned int row = 0; row < 3; row++)
+                matrix[column][row] = _mm256_mul_ps(matrix[column][row], scale);
+        }
+
+    for (unsigned int column = 0; column < 4; column++)
+        transpose4x4x2(matrix[column][0], matrix[column][1], matrix[column][2], matrix[column][3]);
+    // Two columns of an Entity are stored at once, taken from the same half of both transposed vectors
+    float* localToWorlds = &columns.localToWorlds[i].value[0][0];
+    for (unsigned int entity = 0; entity < 4; entity++)
+        for (unsigned int column = 0; column < 4; column += 2) {
+            _mm256_storeu_ps(localToWorlds + 16 * entity + 4 * column, _mm256_permute2f128_ps(matrix[column][entity], matrix[column + 1][entity], 0x20));
+            _mm256_storeu_ps(localToWorlds + 16 * (entity + 4) + 4 * column, _mm256_permute2f128_ps(matrix[column][entity], matrix[column + 1][entity], 0x31));
+        }
+}
+#endif
+
+class LocalToWorldChunkTask : public ChunkTask {
+  public:
+    LocalToWorldChunkTask(const unsigned int& translationComponentId, const unsigned int& rotationComponentId, const unsigned int& scaleComponentId, const unsigned int& localToWorldComponentId) : m_TranslationComponentId(translationComponentId), m_RotationComponentId(rotationComponentId), m_ScaleComponentId(scaleComponentId), m_LocalToWorldComponentId(localToWorldComponentId) {}
+
+    virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+        TransformColumns columns{};
+        const ComponentFields<const Translation> translations = chunkAccessor.componentFields<const Translation>(m_TranslationComponentId);
+        for (unsigned int axis = 0; axis < 3; axis++)
+            columns.translations[axis] = translations.field(axis).data();
+        if (chunkAccessor.hasComponent(m_RotationComponentId))
+            columns.rotations = chunkAccessor.componentArray<const Rotation>(m_RotationComponentId);
+        if (chunkAccessor.hasComponent(m_ScaleComponentId)) {
+            const ComponentFields<const Scale> scales = chunkAccessor.componentFields<const Scale>(m_ScaleComponentId);
+            for (unsigned int axis = 0; axis < 3; axis++)
+                columns.scales[axis] = scales.field(axis).data();
+        }
+        columns.localToWorlds = chunkAccessor.componentArray<LocalToWorld>(m_LocalToWorldComponentId);
+
+        unsigned int i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= chunkAccessor.entityCount(); i += 8)
+            computeLocalToWorlds8(columns, i);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; i + 4 <= chunkAccessor.entityCount(); i += 4)
+            computeLocalToWorlds4(columns, i);
+#endif
+        for (; i < chunkAccessor.entityCount(); i++)
+            computeLocalToWorld(columns, i);
+    }
+
+    const unsigned int m_TranslationComponentId;
+    const unsigned int m_RotationComponentId;
+    const unsigned int m_ScaleComponentId;
+    const unsigned int m_LocalToWorldComponentId;
+};
+
+}  // namespace
+
+void TransformSystem::onEnter() {
+    m_MissingLocalToWorldEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Translation>().rejectComponents<LocalToWorld, Parent>().createEntityFilter();
+    m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<LocalToWorld>().rejectComponents<Parent>().changed<Translation>().changedIfPresent<Rotation, Scale>().createEntityFilter();
+    declareComponentAccess(createComponentAccessBuilder().readComponents<Translation, Rotation, Scale>().writeComponents<LocalToWorld>().createComponentAccess());
+
+    m_TranslationComponentId = entityManager()->componentId<Translation>();
+    m_RotationComponentId = entityManager()->componentId<Rotation>();
+    m_ScaleComponentId = entityManager()->componentId<Scale>();
+    m_LocalToWorldComponentId = entityManager()->componentId<LocalToWorld>();
+}
+
+void TransformSystem::onUpdate() {
+    // Moved chunks count as changed, so the added LocalToWorld is computed in the next frame
+    entityManager()->addComponent(m_MissingLocalToWorldEntityFilter, LocalToWorld{{}, glm::mat4(1.0f)});
+    predecessor() = schedule(std::make_shared<LocalToWorldChunkTask>(m_TranslationComponentId, m_RotationComponentId, m_ScaleComponentId, m_LocalToWorldComponentId), m_EntityFilter, predecessor());
+}
+
+void TransformSystem::onExit() {}
+
+}  // namespace Melon
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/SystemBase.h>
+
+namespace Melon {
+
+// Writes the LocalToWorld of Entities with a Translation, recomputed only in chunks where Translation, Rotation or Scale has changed
+// Rotation and Scale are optional, Entities missing LocalToWorld are given one at the end of the frame
+// Entities with a Parent are left to the HierarchySystem
+// Systems registered before it read the LocalToWorld of the previous frame
+class TransformSystem : public SystemBase {
+  public:
+    TransformSystem() {}
+    virtual ~TransformSystem() {}
+
+  protected:
+    virtual void onEnter() final;
+    virtual void onUpdate() final;
+    virtual void onExit() final;
+
+  private:
+    EntityFilter m_MissingLocalToWorldEntityFilter;
+    EntityFilter m_EntityFilter;
+
+    unsigned int m_TranslationComponentId;
+    unsigned int m_RotationComponentId;
+    unsigned int m_ScaleComponentId;
+    unsigned int m_LocalToWorldComponentId;
+};
+
+}  // namespace Melon
@@ -1,29 +1,40 @@
 #include <MelonCore/EntityManager.h>
 #include <MelonCore/SystemBase.h>
 #include <MelonCore/World.h>
+#include <MelonTask/TaskHandle.h>
 #include <MelonTask/TaskManager.h>
 
 namespace Melon {
 
 World::World(TaskManager* taskManager) : m_TaskManager(taskManager) {
-    EntityManager* entityManager = &m_EntityManager;
-    m_EntityCommandBufferExecutor = [entityManager]() {
-        entityManager->executeEntityCommandBuffers();
-    };
+    m_EntityManager.m_TaskManager = taskManager;
+    m_EntityManager.m_DependencyManager = &m_DependencyManager;
 }
 
 void World::enter(Instance* instance, Time* time, ResourceManager* resourceManager) {
     for (std::unique_ptr<SystemBase> const& system : m_Systems)
-        system->enter(instance, m_TaskManager, time, resourceManager, &m_EntityManager, &m_EventManager);
+        system->enter(instance, m_TaskManager, time, resourceManager, &m_EntityManager, &m_EventManager, &m_DependencyManager);
 }
 
 void World::update() {
-    // Schedule entity command buffer executor
-    std::vector<std::shared_ptr<TaskHandle>> predecessors(m_Systems.size());
-    for (unsigned int i = 0; i < m_Systems.size(); i++)
-        predecessors[i] = m_Systems[i]->predecessor();
-    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->schedule(m_EntityCommandBufferExecutor, predecessors);
+    // Tasks run at most one frame behind the main thread, they would pile up whenever the main thread is faster otherwise
+    m_EntityManager.completeEntityCommandBuffers();
+    // Schedule entity command buffer executor after every task of the frame, which later tasks wait for
+    // Commands recorded so far are detached, so that systems record the next ones without waiting for the execution
+    std::vector<std::shared_ptr<TaskHandle>> predecessors = m_DependencyManager.taskHandles();
+    for (std::unique_ptr<SystemBase> const& system : m_Systems)
+        predecessors.push_back(system->predecessor());
+    std::shared_ptr<std::vector<std::unique_ptr<EntityCommandBuffer>>> buffers = std::make_shared<std::vector<std::unique_ptr<EntityCommandBuffer>>>(m_EntityManager.detachEntityCommandBuffers());
+    const unsigned int globalSystemVersion = ++m_EntityManager.m_GlobalSystemVersion;
+    EntityManager* entityManager = &m_EntityManager;
+    std::shared_ptr<TaskHandle> taskHandle = m_TaskManager->schedule(
+        [entityManager, buffers, globalSystemVersion]() {
+            entityManager->executeEntityCommandBuffers(*buffers, globalSystemVersion);
+        },
+        predecessors);
     m_TaskManager->activateWaitingTasks();
+    m_EntityManager.m_EntityCommandBufferTaskHandle = taskHandle;
+    m_DependencyManager.setBarrier(taskHandle);
     for (std::unique_ptr<SystemBase> const& system : m_Systems)
         system->predecessor() = taskHandle;
     // Update systems
@@ -33,6 +44,13 @@ void World::update() {
 }
 
 void World::exit() {
+    // Tasks of the last frame may still access the Entities
+    for (std::shared_ptr<TaskHandle> const& taskHandle : m_DependencyManager.taskHandles())
+        taskHandle->complete();
+    for (std::unique_ptr<SystemBase> const& system : m_Systems)
+        if (system->predecessor())
+            system->predecessor()->complete();
+    m_EntityManager.completeEntityCommandBuffers();
     for (std::unique_ptr<SystemBase> const& system : m_Systems)
         system->exit();
 }
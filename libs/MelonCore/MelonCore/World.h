@@ -1,12 +1,12 @@
 #pragma once
 
+#include <MelonCore/DependencyManager.h>
 #include <MelonCore/ResourceManager.h>
 #include <MelonCore/SystemBase.h>
 #include <MelonCore/Time.h>
 #include <MelonTask/TaskManager.h>
 #include <MelonCore/EventManager.h>
 
-#include <functional>
 #include <memory>
 #include <vector>
 
@@ -31,8 +31,8 @@ class World {
     TaskManager* const m_TaskManager;
     EntityManager m_EntityManager;
     EventManager m_EventManager;
+    DependencyManager m_DependencyManager;
     std::vector<std::unique_ptr<SystemBase>> m_Systems;
-    std::function<void()> m_EntityCommandBufferExecutor;
 };
 
 template <typename Type, typename... Args>
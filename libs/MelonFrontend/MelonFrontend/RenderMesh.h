@@ -16,6 +16,8 @@ struct RenderMesh : public SharedComponent {
 
     const std::vector<Vertex>& vertices() const { return meshResource->vertices(); }
     const std::vector<uint16_t>& indices() const { return meshResource->indices(); }
+    // Stored once per MeshResource, instead of hashing and comparing all vertices whenever an Entity is given the RenderMesh
+    const MeshResource* identity() const { return meshResource; }
 
     MeshResource* meshResource;
 };
@@ -2,8 +2,8 @@
 #include <MelonCore/EntityManager.h>
 #include <MelonCore/EventManager.h>
 #include <MelonCore/Instance.h>
+#include <MelonCore/LocalToWorld.h>
 #include <MelonCore/Rotation.h>
-#include <MelonCore/Scale.h>
 #include <MelonCore/Translation.h>
 #include <MelonFrontend/Camera.h>
 #include <MelonFrontend/Engine.h>
@@ -36,19 +36,13 @@ class CreatedRenderMeshTask : public ChunkTask {
 
 class RenderTask : public ChunkTask {
   public:
-    RenderTask(std::vector<glm::mat4>& models, std::vector<const ManualRenderMesh*>& manualRenderMeshes, const unsigned int& translationComponentId, const unsigned int& rotationComponentId, const unsigned int& scaleComponentId, const unsigned int& manualRenderMeshComponentId) : m_Models(models), m_ManualRenderMeshes(manualRenderMeshes), m_TranslationComponentId(translationComponentId), m_RotationComponentId(rotationComponentId), m_ScaleComponentId(scaleComponentId), m_ManualRenderMeshComponentId(manualRenderMeshComponentId){};
+    RenderTask(std::vector<glm::mat4>& models, std::vector<const ManualRenderMesh*>& manualRenderMeshes, const unsigned int& localToWorldComponentId, const unsigned int& manualRenderMeshComponentId) : m_Models(models), m_ManualRenderMeshes(manualRenderMeshes), m_LocalToWorldComponentId(localToWorldComponentId), m_ManualRenderMeshComponentId(manualRenderMeshComponentId){};
 
     virtual void execute(const ChunkAccessor& chunkAccessor, const unsigned int& chunkIndex, const unsigned int& firstEntityIndex) override {
-        Translation* translations = chunkAccessor.componentArray<Translation>(m_TranslationComponentId);
-        Rotation* rotations = chunkAccessor.componentArray<Rotation>(m_RotationComponentId);
-        Scale* scales = chunkAccessor.componentArray<Scale>(m_ScaleComponentId);
+        const LocalToWorld* localToWorlds = chunkAccessor.componentArray<const LocalToWorld>(m_LocalToWorldComponentId);
         const ManualRenderMesh* manualRenderMesh = chunkAccessor.sharedComponent<ManualRenderMesh>(m_ManualRenderMeshComponentId);
         for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
-            glm::mat4 model = glm::scale(glm::mat4(1.0f), scales[i].value);
-            model = glm::mat4_cast(rotations[i].value) * model;
-            model = glm::translate(model, translations[i].value);
-
-            m_Models[firstEntityIndex + i] = model;
+            m_Models[firstEntityIndex + i] = localToWorlds[i].value;
             m_ManualRenderMeshes[firstEntityIndex + i] = manualRenderMesh;
         }
     }
@@ -56,9 +50,7 @@ class RenderTask : public ChunkTask {
     std::vector<glm::mat4>& m_Models;
     std::vector<const ManualRenderMesh*>& m_ManualRenderMeshes;
 
-    const unsigned int& m_TranslationComponentId;
-    const unsigned int& m_RotationComponentId;
-    const unsigned int& m_ScaleComponentId;
+    const unsigned int& m_LocalToWorldComponentId;
     const unsigned int& m_ManualRenderMeshComponentId;
 };
 
@@ -86,14 +78,16 @@ void RenderSystem::onEnter() {
     m_Engine.initialize(taskManager(), instance()->applicationName().c_str(), m_CurrentWidth, m_CurrentHeight);
 
     m_CreatedRenderMeshEntityFilter = entityManager()->createEntityFilterBuilder().requireSharedComponents<RenderMesh>().rejectSharedComponents<ManualRenderMesh>().createEntityFilter();
-    m_RenderMeshEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Translation, Rotation, Scale>().requireSharedComponents<RenderMesh, ManualRenderMesh>().createEntityFilter();
+    m_RenderMeshEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<LocalToWorld>().requireSharedComponents<RenderMesh, ManualRenderMesh>().createEntityFilter();
     m_DestroyedRenderMeshEntityFilter = entityManager()->createEntityFilterBuilder().requireSharedComponents<ManualRenderMesh>().rejectSharedComponents<RenderMesh>().createEntityFilter();
     m_CameraEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Translation, Rotation, Camera, PerspectiveProjection>().createEntityFilter();
     m_LightEntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Light>().createEntityFilter();
+    m_CameraLightComponentAccess = createComponentAccessBuilder().readComponents<Translation, Rotation, PerspectiveProjection, Light>().createComponentAccess();
+    declareComponentAccess(createComponentAccessBuilder().readComponents<Translation, Rotation, LocalToWorld, Camera, PerspectiveProjection, Light>().readSharedComponents<RenderMesh, ManualRenderMesh>().createComponentAccess());
 
     m_TranslationComponentId = entityManager()->componentId<Translation>();
     m_RotationComponentId = entityManager()->componentId<Rotation>();
-    m_ScaleComponentId = entityManager()->componentId<Scale>();
+    m_LocalToWorldComponentId = entityManager()->componentId<LocalToWorld>();
     m_PerspectiveProjectionComponentId = entityManager()->componentId<PerspectiveProjection>();
     m_RenderMeshComponentId = entityManager()->sharedComponentId<RenderMesh>();
     m_ManualRenderMeshComponentId = entityManager()->sharedComponentId<ManualRenderMesh>();
@@ -123,11 +117,12 @@ void RenderSystem::onUpdate() {
     const unsigned int renderMeshCount = entityManager()->entityCount(m_RenderMeshEntityFilter);
     std::vector<glm::mat4> models(renderMeshCount);
     std::vector<const ManualRenderMesh*> manualRenderMeshes(renderMeshCount);
-    std::shared_ptr<TaskHandle> renderMeshTaskHandle = schedule(std::make_shared<RenderTask>(models, manualRenderMeshes, m_TranslationComponentId, m_RotationComponentId, m_ScaleComponentId, m_ManualRenderMeshComponentId), m_RenderMeshEntityFilter, predecessor());
+    std::shared_ptr<TaskHandle> renderMeshTaskHandle = schedule(std::make_shared<RenderTask>(models, manualRenderMeshes, m_LocalToWorldComponentId, m_ManualRenderMeshComponentId), m_RenderMeshEntityFilter, predecessor());
 
     taskManager()->activateWaitingTasks();
 
     // Fetch components of a Camera. If not found, use a default Camera
+    completeComponentAccess(m_CameraLightComponentAccess);
     std::vector<ChunkAccessor> accessors = entityManager()->filterEntities(m_CameraEntityFilter);
     glm::vec3 cameraTranslation(0.0f, 0.0f, 0.0f);
     glm::quat cameraRotation = glm::quatLookAt(glm::normalize(glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(0.0f, 0.0f, 1.0f));
@@ -135,9 +130,9 @@ void RenderSystem::onUpdate() {
     projection[1][1] *= -1;
     for (auto accessor : accessors)
         for (unsigned int i = 0; i < accessor.entityCount(); i++) {
-            cameraTranslation = accessor.componentArray<Translation>(m_TranslationComponentId)[i].value;
-            cameraRotation = accessor.componentArray<Rotation>(m_RotationComponentId)[i].value;
-            PerspectiveProjection perspectiveProjection = accessor.componentArray<PerspectiveProjection>(m_PerspectiveProjectionComponentId)[i];
+            cameraTranslation = accessor.componentFields<const Translation>(m_TranslationComponentId)[i].load().value;
+            cameraRotation = accessor.componentArray<const Rotation>(m_RotationComponentId)[i].value;
+            PerspectiveProjection perspectiveProjection = accessor.componentArray<const PerspectiveProjection>(m_PerspectiveProjectionComponentId)[i];
             projection = glm::perspective(glm::radians(perspectiveProjection.fovy), m_Engine.windowAspectRatio(), perspectiveProjection.zNear, perspectiveProjection.zFar);
             projection[1][1] *= -1;
         }
@@ -147,7 +142,7 @@ void RenderSystem::onUpdate() {
     glm::vec3 lightDirection(0.0f, 0.0f, 0.0f);
     for (auto accessor : accessors)
         for (unsigned int i = 0; i < accessor.entityCount(); i++)
-            lightDirection = accessor.componentArray<Light>(m_LightComponentId)[i].direction;
+            lightDirection = accessor.componentArray<const Light>(m_LightComponentId)[i].direction;
 
     m_Engine.beginFrame();
 
@@ -30,10 +30,12 @@ class RenderSystem : public SystemBase {
     EntityFilter m_DestroyedRenderMeshEntityFilter;
     EntityFilter m_CameraEntityFilter;
     EntityFilter m_LightEntityFilter;
+    // Components of the Camera and the Light read from chunks by the main thread
+    ComponentAccess m_CameraLightComponentAccess;
 
     unsigned int m_TranslationComponentId;
     unsigned int m_RotationComponentId;
-    unsigned int m_ScaleComponentId;
+    unsigned int m_LocalToWorldComponentId;
     unsigned int m_PerspectiveProjectionComponentId;
     unsigned int m_RenderMeshComponentId;
     unsigned int m_ManualRenderMeshComponentId;
@@ -2,13 +2,19 @@
 
 namespace Melon {
 
+thread_local unsigned int TaskManager::s_WorkerIndex = TaskManager::k_WorkerCount;
+
 TaskManager::TaskManager() {
-    for (std::unique_ptr<TaskWorker>& worker : m_Workers)
-        worker = std::make_unique<TaskWorker>(this);
+    for (unsigned int i = 0; i < k_WorkerCount; i++)
+        m_Workers[i] = std::make_unique<TaskWorker>(this, i);
 }
 
 TaskManager::~TaskManager() {
-    m_Stopped = true;
+    // Set under the lock, or a worker between checking m_Stopped and waiting would miss the notification
+    {
+        std::lock_guard lock(m_TaskQueueMutex);
+        m_Stopped = true;
+    }
     for (std::unique_ptr<TaskWorker> const& worker : m_Workers)
         worker->notify_stopped();
     m_TaskQueueConditionVariable.notify_all();
@@ -38,6 +44,12 @@ std::shared_ptr<TaskHandle> TaskManager::combine(std::vector<std::shared_ptr<Tas
     return schedule(nullptr, taskHandles);
 }
 
+std::shared_ptr<TaskHandle> TaskManager::scheduleImmediately(std::function<void()> const& procedure) {
+    std::shared_ptr<TaskHandle> taskHandle = std::make_shared<TaskHandle>(this, procedure);
+    queueTask(taskHandle);
+    return taskHandle;
+}
+
 void TaskManager::activateWaitingTasks() {
     {
         std::lock_guard lock(m_TaskQueueMutex);
@@ -4,6 +4,7 @@
 #include <MelonTask/TaskWorker.h>
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -25,15 +26,22 @@ class TaskManager {
     std::shared_ptr<TaskHandle> schedule(std::function<void()> const& procedure, std::vector<std::shared_ptr<TaskHandle>> const& predecessors);
     std::shared_ptr<TaskHandle> schedule(std::function<void()> const& procedure, std::vector<std::shared_ptr<TaskHandle>>&& predecessors);
     std::shared_ptr<TaskHandle> combine(std::vector<std::shared_ptr<TaskHandle>> const& taskHandles);
+    // Queue a task at once without waiting for activateWaitingTasks(), which is safe to call from running tasks
+    std::shared_ptr<TaskHandle> scheduleImmediately(std::function<void()> const& procedure);
     // Scheduled tasks won't be able to executed at once, because they are put in a waiting queue
     // Calling this function will activate tasks in the waiting queue
     void activateWaitingTasks();
 
+    // Index of the worker running the calling task, k_WorkerCount outside of workers
+    static const unsigned int& workerIndex() { return s_WorkerIndex; }
+
   private:
     void queueTask(std::shared_ptr<TaskHandle> const& taskHandle);
     std::shared_ptr<TaskHandle> getNextTask();
 
-    bool m_Stopped{};
+    static thread_local unsigned int s_WorkerIndex;
+
+    std::atomic<bool> m_Stopped{};
     std::queue<std::shared_ptr<TaskHandle>> m_WaitingTaskQueue;
     std::queue<std::pair<std::shared_ptr<TaskHandle>, std::vector<std::shared_ptr<TaskHandle>>>> m_WaitingTaskAndPredecessorsQueue;
     std::queue<std::shared_ptr<TaskHandle>> m_TaskQueue;
@@ -8,11 +8,12 @@
 
 namespace Melon {
 
-TaskWorker::TaskWorker(TaskManager* taskManager) : m_TaskManager(taskManager) {
+TaskWorker::TaskWorker(TaskManager* taskManager, const unsigned int& index) : m_TaskManager(taskManager), m_Index(index) {
     m_Thread = std::thread(&TaskWorker::threadEntryPoint, this);
 }
 
 void TaskWorker::threadEntryPoint() {
+    TaskManager::s_WorkerIndex = m_Index;
     while (!m_Stopped) {
         std::shared_ptr<TaskHandle> task = m_TaskManager->getNextTask();
         if (task) {
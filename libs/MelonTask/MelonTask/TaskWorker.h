@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 
 namespace Melon {
@@ -8,15 +9,16 @@ class TaskManager;
 
 class TaskWorker {
   public:
-    TaskWorker(TaskManager* taskManager);
+    TaskWorker(TaskManager* taskManager, const unsigned int& index);
     void threadEntryPoint();
     void notify_stopped();
     void join();
 
   private:
     TaskManager* const m_TaskManager;
+    const unsigned int m_Index;
     std::thread m_Thread;
-    bool m_Stopped{};
+    std::atomic<bool> m_Stopped{};
 };
 
 }  // namespace Melon
@@ -0,0 +1,148 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Bounds.h>
+#include <MelonCore/BroadphaseSystem.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/OverlapPairs.h>
+#include <MelonCore/StaticBounds.h>
+#include <MelonCore/SystemBase.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <glm/vec3.hpp>
+#include <glm/vector_relational.hpp>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Dynamic boxes move among static ones, some of which move as well, and the OverlapPairs should be the pairs an all-pairs test finds
+// Coordinates are multiples of half a unit, so that many boxes touch by an edge or a face, tie on the sweep axis or are flat
+// Boxes spread along another axis every other step, which changes the sweep axis, and in between static boxes are only sorted again because some of them moved
+
+constexpr unsigned int k_DynamicCount = 300;
+constexpr unsigned int k_StaticCount = 200;
+constexpr unsigned int k_MovedStaticCount = 5;
+// Frames for Bounds written to be gathered by the BroadphaseSystem
+constexpr unsigned int k_FrameCountPerStep = 2;
+constexpr unsigned int k_StepCount = 12;
+
+class BroadphasePairsSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        m_ComponentAccess = createComponentAccessBuilder().writeComponents<Melon::Bounds>().readSingletonComponents<Melon::OverlapPairs>().createComponentAccess();
+        declareComponentAccess(m_ComponentAccess);
+        m_OverlapPairsSingletonComponentId = entityManager()->singletonComponentId<Melon::OverlapPairs>();
+        Melon::Archetype* dynamicArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Bounds>().createArchetype();
+        Melon::Archetype* staticArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Bounds, Melon::StaticBounds>().createArchetype();
+        createEntities(dynamicArchetype, k_DynamicCount, false);
+        createEntities(staticArchetype, k_StaticCount, true);
+    }
+
+    void onUpdate() override {
+        if (m_FrameCounter % k_FrameCountPerStep == 0 && m_FrameCounter != 0) {
+            completeComponentAccess(m_ComponentAccess);
+            check(*entityManager()->singletonComponent<Melon::OverlapPairs>(m_OverlapPairsSingletonComponentId));
+            if (m_FrameCounter == k_StepCount * k_FrameCountPerStep) {
+                printf("OverlapPairs: %u of %u steps differ from an all-pairs test\n", m_FailedStepCount, k_StepCount);
+                s_Failed = m_FailedStepCount != 0;
+                instance()->quit();
+                return;
+            }
+            move();
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    struct Box {
+        Melon::Entity entity;
+        Melon::Bounds bounds;
+        bool isStatic;
+    };
+
+    // Boxes spread along one axis for two steps and are packed along the others
+    Melon::Bounds randomBounds() {
+        std::uniform_int_distribution<int> sizeDistribution(0, 3);
+        glm::vec3 min, size;
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            std::uniform_int_distribution<int> minDistribution(0, axis == m_StepIndex / 2 % 3 ? 64 : 16);
+            min[axis] = 0.5f * minDistribution(m_Random);
+            size[axis] = 0.5f * sizeDistribution(m_Random);
+        }
+        return Melon::Bounds{{}, min, min + size};
+    }
+
+    void createEntities(Melon::Archetype* archetype, const unsigned int& count, const bool& isStatic) {
+        std::vector<Melon::Entity> entities(count);
+        std::vector<Melon::Bounds> bounds(count);
+        for (Melon::Bounds& entityBounds : bounds)
+            entityBounds = randomBounds();
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), bounds.data());
+        for (unsigned int i = 0; i < count; i++)
+            m_Boxes.push_back(Box{.entity = entities[i], .bounds = bounds[i], .isStatic = isStatic});
+    }
+
+    void move() {
+        m_StepIndex++;
+        unsigned int movedStaticCount = 0;
+        for (Box& box : m_Boxes) {
+            if (box.isStatic && movedStaticCount++ >= k_MovedStaticCount) continue;
+            box.bounds = randomBounds();
+            entityManager()->writeComponent(box.entity, box.bounds);
+        }
+        // Shuffled so that other static boxes are moved at the next step
+        std::shuffle(m_Boxes.begin(), m_Boxes.end(), m_Random);
+    }
+
+    void check(const Melon::OverlapPairs& overlapPairs) {
+        std::unordered_map<unsigned int, const Box*> boxes;
+        for (const Box& box : m_Boxes)
+            boxes[box.entity.id] = &box;
+
+        // Pairs are keyed by their ids in increasing order, static and dynamic ones having the static Entity second
+        unsigned int misorderedCount = 0;
+        std::vector<std::uint64_t> found, expected;
+        overlapPairs.forEach([&](const Melon::OverlapPairs::Pair& pair) {
+            const auto first = boxes.find(pair.first.id), second = boxes.find(pair.second.id);
+            misorderedCount += first == boxes.end() || second == boxes.end() || first->second->isStatic || !(first->second->entity == pair.first) || !(second->second->entity == pair.second);
+            found.push_back(pairKey(pair.first, pair.second));
+        });
+        const auto overlapping = [](const Melon::Bounds& a, const Melon::Bounds& b) { return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max)); };
+        for (unsigned int i = 0; i < m_Boxes.size(); i++)
+            for (unsigned int j = i + 1; j < m_Boxes.size(); j++)
+                if (!(m_Boxes[i].isStatic && m_Boxes[j].isStatic) && overlapping(m_Boxes[i].bounds, m_Boxes[j].bounds))
+                    expected.push_back(pairKey(m_Boxes[i].entity, m_Boxes[j].entity));
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        m_FailedStepCount += found != expected || misorderedCount != 0;
+        if (found != expected || misorderedCount != 0)
+            printf("Step %u: %u pairs found, %u expected, %u misordered\n", m_StepIndex, static_cast<unsigned int>(found.size()), static_cast<unsigned int>(expected.size()), misorderedCount);
+    }
+
+    static std::uint64_t pairKey(const Melon::Entity& entity, const Melon::Entity& other) {
+        return static_cast<std::uint64_t>(std::min(entity.id, other.id)) << 32 | std::max(entity.id, other.id);
+    }
+
+    Melon::ComponentAccess m_ComponentAccess;
+    unsigned int m_OverlapPairsSingletonComponentId;
+    std::vector<Box> m_Boxes;
+    std::mt19937 m_Random;
+    unsigned int m_StepIndex{};
+    unsigned int m_FrameCounter{};
+    unsigned int m_FailedStepCount{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<Melon::BroadphaseSystem>()
+        .registerSystem<BroadphasePairsSystem>()
+        .start();
+    return BroadphasePairsSystem::s_Failed ? 1 : 0;
+}
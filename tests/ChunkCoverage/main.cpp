@@ -0,0 +1,187 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonTask/TaskHandle.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Every Entity index of the filtered chunks should be visited by exactly one task each frame, whether chunks are split or not
+// The phases run once without chunk affinity and once with it, where workers take their own batches first and then steal
+// Entities are spread over two Archetypes of different chunk capacities, in counts leaving partial chunks
+
+struct Counter : public Melon::DataComponent {
+    unsigned int value;
+};
+
+struct Padding : public Melon::DataComponent {
+    std::array<std::byte, 200> bytes;
+};
+
+struct Phase {
+    unsigned int entityCount;
+    unsigned int paddedEntityCount;
+};
+
+enum class TaskKind {
+    Chunk,
+    Range,
+    // Measured expensive enough per Entity that chunks are split across batches
+    ExpensiveRange,
+};
+
+constexpr std::array<Phase, 5> k_Phases{{{1, 0}, {0, 3}, {1500, 0}, {12345, 777}, {83333, 4097}}};
+constexpr std::array<TaskKind, 3> k_TaskKinds{TaskKind::Chunk, TaskKind::Range, TaskKind::ExpensiveRange};
+// Later frames of a task kind are batched by the cost measured in the earlier ones
+constexpr unsigned int k_FrameCountPerTaskKind = 3;
+// The first frame of each phase creates its Entities, the others schedule each kind of task over them in turn
+constexpr unsigned int k_FrameCountPerPhase = 1 + k_TaskKinds.size() * k_FrameCountPerTaskKind;
+constexpr unsigned int k_ExpensiveStepCount = 1000;
+constexpr unsigned int k_MaxEntityCount = 83333 + 4097;
+
+std::vector<std::atomic<unsigned int>> g_VisitCounts(k_MaxEntityCount);
+// Indices past every Entity are counted here instead
+std::atomic<unsigned int> g_OutOfRangeVisitCount;
+// Calls of execute() by range tasks, more than the chunks once they are split
+std::atomic<unsigned int> g_ExecutionCount;
+
+class CoverageSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    class CoverageChunkTask : public Melon::ChunkTask {
+      public:
+        CoverageChunkTask(const unsigned int& counterComponentId) : m_CounterComponentId(counterComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int& firstEntityIndex) override {
+            Counter* counters = chunkAccessor.componentArray<Counter>(m_CounterComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                visit(firstEntityIndex + i);
+                counters[i].value++;
+            }
+        }
+
+        const unsigned int m_CounterComponentId;
+    };
+
+    // Costs are measured per task type, so the step count is a template argument
+    template <unsigned int k_StepCount>
+    class CoverageChunkRangeTask : public Melon::ChunkRangeTask {
+      public:
+        CoverageChunkRangeTask(const unsigned int& counterComponentId) : m_CounterComponentId(counterComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int& firstEntityIndex, const unsigned int& entityBegin, const unsigned int& entityEnd) override {
+            Counter* counters = chunkAccessor.componentArray<Counter>(m_CounterComponentId);
+            for (unsigned int i = entityBegin; i < entityEnd; i++) {
+                visit(firstEntityIndex + i);
+                for (unsigned int step = 0; step < k_StepCount; step++)
+                    counters[i].value = counters[i].value * 1664525U + 1013904223U;
+            }
+            g_ExecutionCount++;
+        }
+
+        const unsigned int m_CounterComponentId;
+    };
+
+    static void visit(const unsigned int& entityIndex) {
+        if (entityIndex < g_VisitCounts.size())
+            g_VisitCounts[entityIndex]++;
+        else
+            g_OutOfRangeVisitCount++;
+    }
+
+    void onEnter() override {
+        m_Archetype = entityManager()->createArchetypeBuilder().markComponents<Counter>().createArchetype();
+        m_PaddedArchetype = entityManager()->createArchetypeBuilder().markComponents<Counter, Padding>().createArchetype();
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Counter>().createEntityFilter();
+        m_CounterComponentId = entityManager()->componentId<Counter>();
+        declareComponentAccess(createComponentAccessBuilder().writeComponents<Counter>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        if (m_ScheduledEntityCount != 0) {
+            predecessor()->complete();
+            check();
+        }
+        // The last frame of expensive tasks in each phase is batched by their measured cost
+        const unsigned int executionCount = g_ExecutionCount.exchange(0);
+        if (m_FrameCounter == 0 && m_ScheduledEntityCount != 0)
+            m_ChunksSplit |= executionCount > entityManager()->chunkCount(m_EntityFilter);
+        if (m_PhaseIndex == k_Phases.size() && !m_ChunkAffinity) {
+            m_ChunkAffinity = true;
+            setChunkAffinity(true);
+            m_PhaseIndex = 0;
+        }
+        if (m_PhaseIndex == k_Phases.size()) {
+            printf("%u of %u frames visited Entities other than once, expensive chunks %s\n", m_FailedFrameCount, m_CheckedFrameCount, m_ChunksSplit ? "split" : "never split");
+            s_Failed = m_FailedFrameCount != 0 || !m_ChunksSplit;
+            instance()->quit();
+            return;
+        }
+
+        const Phase& phase = k_Phases[m_PhaseIndex];
+        if (m_FrameCounter == 0) {
+            entityManager()->destroyEntities(m_EntityFilter);
+            std::vector<Melon::Entity> entities(phase.entityCount);
+            entityManager()->createEntities(m_Archetype, std::span<Melon::Entity>(entities));
+            std::vector<Melon::Entity> paddedEntities(phase.paddedEntityCount);
+            entityManager()->createEntities(m_PaddedArchetype, std::span<Melon::Entity>(paddedEntities));
+            m_ScheduledEntityCount = 0;
+        } else {
+            switch (k_TaskKinds[(m_FrameCounter - 1) / k_FrameCountPerTaskKind]) {
+                case TaskKind::Chunk:
+                    predecessor() = schedule(std::make_shared<CoverageChunkTask>(m_CounterComponentId), m_EntityFilter, predecessor());
+                    break;
+                case TaskKind::Range:
+                    predecessor() = schedule(std::make_shared<CoverageChunkRangeTask<1>>(m_CounterComponentId), m_EntityFilter, predecessor());
+                    break;
+                case TaskKind::ExpensiveRange:
+                    predecessor() = schedule(std::make_shared<CoverageChunkRangeTask<k_ExpensiveStepCount>>(m_CounterComponentId), m_EntityFilter, predecessor());
+                    break;
+            }
+            m_ScheduledEntityCount = phase.entityCount + phase.paddedEntityCount;
+        }
+        if (++m_FrameCounter == k_FrameCountPerPhase) {
+            m_FrameCounter = 0;
+            m_PhaseIndex++;
+        }
+    }
+
+    void onExit() override {}
+
+  private:
+    void check() {
+        unsigned int wrongIndexCount = g_OutOfRangeVisitCount.exchange(0);
+        for (unsigned int i = 0; i < g_VisitCounts.size(); i++)
+            wrongIndexCount += g_VisitCounts[i].exchange(0) != (i < m_ScheduledEntityCount ? 1 : 0);
+        if (wrongIndexCount != 0) {
+            printf("%u of %u Entity indices visited other than once\n", wrongIndexCount, m_ScheduledEntityCount);
+            m_FailedFrameCount++;
+        }
+        m_CheckedFrameCount++;
+    }
+
+    Melon::Archetype* m_Archetype;
+    Melon::Archetype* m_PaddedArchetype;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_CounterComponentId;
+    unsigned int m_PhaseIndex{};
+    unsigned int m_FrameCounter{};
+    unsigned int m_ScheduledEntityCount{};
+    unsigned int m_FailedFrameCount{};
+    unsigned int m_CheckedFrameCount{};
+    bool m_ChunksSplit{};
+    bool m_ChunkAffinity{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<CoverageSystem>()
+        .start();
+    return CoverageSystem::s_Failed ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ChunkAllocator.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+// Entities spread over several Archetypes are destroyed one by one, which plays back on worker threads
+// Once all of them are gone, trimming should return every slab, including those of chunks recycled into the caches of the workers
+
+constexpr unsigned int k_EntityCountPerArchetype = 20000;
+
+template <unsigned int k_Index>
+struct Payload : public Melon::DataComponent {
+    std::array<std::byte, 32 * (k_Index + 1)> bytes;
+};
+
+class ChunkTrimSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        createEntities<0>();
+        createEntities<1>();
+        createEntities<2>();
+        createEntities<3>();
+    }
+
+    void onUpdate() override {
+        if (m_FrameCounter == 0) {
+            for (const Melon::Entity& entity : m_Entities)
+                entityManager()->destroyEntity(entity);
+        } else {
+            entityManager()->trimChunks();
+            const Melon::ChunkAllocator::Stats stats = entityManager()->chunkStats();
+            printf("After trimming, %zu bytes in use, %zu bytes cached and %zu bytes returned\n", stats.bytesInUse, stats.bytesCached, stats.bytesReturned);
+            s_Failed = stats.bytesInUse != 0 || stats.bytesCached != 0 || stats.bytesReturned == 0;
+            instance()->quit();
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    template <unsigned int k_Index>
+    void createEntities() {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Payload<k_Index>>().createArchetype();
+        m_Entities.resize(m_Entities.size() + k_EntityCountPerArchetype);
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(m_Entities.end() - k_EntityCountPerArchetype, m_Entities.end()));
+    }
+
+    std::vector<Melon::Entity> m_Entities;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<ChunkTrimSystem>()
+        .start();
+    return ChunkTrimSystem::s_Failed ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+
+#include <array>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Random commands are recorded for pairs of Entities, all in one frame for the first of each pair and one per frame for the second
+// Coalescing the commands of each Entity on playback should leave both Entities of each pair as command by command playback does
+
+constexpr unsigned int k_PairCount = 4096;
+constexpr unsigned int k_CommandCount = 16;
+
+struct Health : public Melon::DataComponent {
+    int value;
+};
+
+struct Shield : public Melon::EnableableDataComponent {
+    int value;
+};
+
+struct Stunned : public Melon::DataComponent {};
+
+enum class Opcode {
+    AddHealth,
+    RemoveHealth,
+    SetHealth,
+    AddShield,
+    RemoveShield,
+    SetShield,
+    SetShieldEnabled,
+    AddStunned,
+    RemoveStunned,
+    DestroyEntity,
+};
+
+struct Command {
+    Opcode opcode;
+    int value;
+};
+
+// What the commands leave the Entity with, recorded commands only target components it has at that point
+struct Expectation {
+    bool alive{true};
+    std::optional<int> health{};
+    std::optional<int> shield{};
+    bool shieldEnabled{};
+    bool stunned{};
+};
+
+class CommandPlaybackSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        std::mt19937 random(42);
+        m_Commands.resize(k_PairCount);
+        m_Expectations.resize(k_PairCount);
+        for (unsigned int i = 0; i < k_PairCount; i++)
+            for (unsigned int j = 0; j < k_CommandCount; j++)
+                m_Commands[i][j] = randomCommand(random, m_Expectations[i]);
+    }
+
+    void onUpdate() override {
+        if (m_FrameCounter == 0) {
+            m_CoalescedEntities.resize(k_PairCount);
+            m_SerialEntities.resize(k_PairCount);
+            for (unsigned int i = 0; i < k_PairCount; i++) {
+                m_CoalescedEntities[i] = entityManager()->createEntity();
+                m_SerialEntities[i] = entityManager()->createEntity();
+                for (const Command& command : m_Commands[i])
+                    record(m_CoalescedEntities[i], command);
+            }
+        } else if (m_FrameCounter <= k_CommandCount)
+            for (unsigned int i = 0; i < k_PairCount; i++)
+                record(m_SerialEntities[i], m_Commands[i][m_FrameCounter - 1]);
+        else {
+            compare();
+            instance()->quit();
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    static Command randomCommand(std::mt19937& random, Expectation& expectation) {
+        const int value = static_cast<int>(random() % 1000);
+        // Commands after the destruction are recorded as well, they should be dropped
+        if (!expectation.alive)
+            return Command{static_cast<Opcode>(random() % static_cast<unsigned int>(Opcode::DestroyEntity)), value};
+        // Commands on components the Entity lacks fall back to adding Health
+        Opcode opcode = static_cast<Opcode>(random() % (static_cast<unsigned int>(Opcode::DestroyEntity) + 1));
+        if (opcode == Opcode::DestroyEntity && random() % 4 != 0)
+            opcode = Opcode::AddShield;
+        if ((opcode == Opcode::RemoveHealth || opcode == Opcode::SetHealth) && !expectation.health.has_value())
+            opcode = Opcode::AddHealth;
+        if ((opcode == Opcode::RemoveShield || opcode == Opcode::SetShield || opcode == Opcode::SetShieldEnabled) && !expectation.shield.has_value())
+            opcode = Opcode::AddHealth;
+        if (opcode == Opcode::RemoveStunned && !expectation.stunned)
+            opcode = Opcode::AddHealth;
+        switch (opcode) {
+            case Opcode::AddHealth:
+            case Opcode::SetHealth:
+                expectation.health = value;
+                break;
+            case Opcode::RemoveHealth:
+                expectation.health.reset();
+                break;
+            case Opcode::AddShield:
+                expectation.shield = value;
+                expectation.shieldEnabled = true;
+                break;
+            case Opcode::SetShield:
+                expectation.shield = value;
+                break;
+            case Opcode::RemoveShield:
+                expectation.shield.reset();
+                break;
+            case Opcode::SetShieldEnabled:
+                expectation.shieldEnabled = value % 2 == 0;
+                break;
+            case Opcode::AddStunned:
+                expectation.stunned = true;
+                break;
+            case Opcode::RemoveStunned:
+                expectation.stunned = false;
+                break;
+            case Opcode::DestroyEntity:
+                expectation = Expectation{.alive = false};
+                break;
+        }
+        return Command{opcode, value};
+    }
+
+    void record(const Melon::Entity& entity, const Command& command) {
+        switch (command.opcode) {
+            case Opcode::AddHealth:
+                entityManager()->addComponent(entity, Health{{}, command.value});
+                break;
+            case Opcode::RemoveHealth:
+                entityManager()->removeComponent<Health>(entity);
+                break;
+            case Opcode::SetHealth:
+                entityManager()->setComponent(entity, Health{{}, command.value});
+                break;
+            case Opcode::AddShield:
+                entityManager()->addComponent(entity, Shield{{}, command.value});
+                break;
+            case Opcode::RemoveShield:
+                entityManager()->removeComponent<Shield>(entity);
+                break;
+            case Opcode::SetShield:
+                entityManager()->setComponent(entity, Shield{{}, command.value});
+                break;
+            case Opcode::SetShieldEnabled:
+                entityManager()->setComponentEnabled<Shield>(entity, command.value % 2 == 0);
+                break;
+            case Opcode::AddStunned:
+                entityManager()->addComponent(entity, Stunned{});
+                break;
+            case Opcode::RemoveStunned:
+                entityManager()->removeComponent<Stunned>(entity);
+                break;
+            case Opcode::DestroyEntity:
+                entityManager()->destroyEntity(entity);
+                break;
+        }
+    }
+
+    void compare() {
+        const unsigned int healthComponentId = entityManager()->componentId<Health>();
+        const unsigned int shieldComponentId = entityManager()->componentId<Shield>();
+        std::unordered_set<unsigned int> alive;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().createEntityFilter()))
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                alive.insert(chunkAccessor.entityArray()[i].id);
+        std::unordered_map<unsigned int, int> healths;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().requireComponents<Health>().createEntityFilter()))
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                healths[chunkAccessor.entityArray()[i].id] = chunkAccessor.componentArray<const Health>(healthComponentId)[i].value;
+        std::unordered_map<unsigned int, std::pair<int, bool>> shields;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().requireComponents<Shield>().createEntityFilter()))
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                shields[chunkAccessor.entityArray()[i].id] = {chunkAccessor.componentArray<const Shield>(shieldComponentId)[i].value, chunkAccessor.componentEnabled(shieldComponentId, i)};
+        std::unordered_set<unsigned int> stunned;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().requireComponents<Stunned>().createEntityFilter()))
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                stunned.insert(chunkAccessor.entityArray()[i].id);
+
+        unsigned int mismatchCount = 0;
+        for (unsigned int i = 0; i < k_PairCount; i++) {
+            const Expectation& expectation = m_Expectations[i];
+            for (const Melon::Entity& entity : {m_CoalescedEntities[i], m_SerialEntities[i]}) {
+                const auto health = healths.find(entity.id);
+                const auto shield = shields.find(entity.id);
+                bool matched = alive.contains(entity.id) == expectation.alive;
+                if (matched && expectation.alive)
+                    matched = (health != healths.end() ? std::optional<int>(health->second) : std::nullopt) == expectation.health
+                              && (shield != shields.end() ? std::optional<int>(shield->second.first) : std::nullopt) == expectation.shield
+                              && (shield == shields.end() || shield->second.second == expectation.shieldEnabled)
+                              && stunned.contains(entity.id) == expectation.stunned;
+                if (!matched && mismatchCount++ == 0)
+                    printf("Pair %u differs from its commands on the %s Entity\n", i, entity == m_CoalescedEntities[i] ? "coalesced" : "serial");
+            }
+        }
+        s_Failed = mismatchCount != 0;
+        printf("%u of %u Entities differ from their commands\n", mismatchCount, 2 * k_PairCount);
+    }
+
+    std::vector<std::array<Command, k_CommandCount>> m_Commands;
+    std::vector<Expectation> m_Expectations;
+    std::vector<Melon::Entity> m_CoalescedEntities;
+    std::vector<Melon::Entity> m_SerialEntities;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<CommandPlaybackSystem>()
+        .start();
+    return CommandPlaybackSystem::s_Failed ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ChildLink.h>
+#include <MelonCore/Children.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/HierarchyDepth.h>
+#include <MelonCore/HierarchySystem.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/LocalToWorld.h>
+#include <MelonCore/LocalTransform.h>
+#include <MelonCore/Parent.h>
+#include <MelonCore/Rotation.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/TransformSystem.h>
+#include <MelonCore/Translation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Two trees are linked, then a subtree is moved under the other tree and a parent in the middle of it is destroyed
+// After each step the Parent, HierarchyDepth, Children and ChildLink of every Entity and its LocalToWorld should match a model of the trees
+// Children of the destroyed parent lose their Parent and keep their last LocalToWorld
+
+// Frames for Parent changes to be gathered, linked and passed down every depth
+constexpr unsigned int k_SettleFrameCount = 4;
+constexpr unsigned int k_MaxDepth = 8;
+constexpr unsigned int k_LeafCount = 21;
+constexpr float k_Tolerance = 1e-4f;
+
+struct Node {
+    Melon::Entity entity;
+    Melon::Entity parent;
+    // Relative to the parent, or the LocalToWorld itself without parent
+    glm::mat4 matrix;
+};
+
+glm::mat4 localToParent(const Melon::LocalTransform& localTransform) {
+    return glm::translate(glm::mat4(1.0f), localTransform.translation) * glm::mat4_cast(localTransform.rotation) * glm::scale(glm::mat4(1.0f), localTransform.scale);
+}
+
+class HierarchyLinkingSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Melon::Parent, Melon::LocalToWorld, Melon::Children, Melon::ChildLink>().createComponentAccess());
+        m_RootArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Rotation>().createArchetype();
+        m_NodeArchetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Parent, Melon::LocalTransform>().createArchetype();
+
+        // The first tree is root, a, b, leaves under b and leaves under a, the second one is root and e
+        const Melon::Entity firstRoot = createRoot(glm::vec3(1.0f, 2.0f, 3.0f), glm::angleAxis(0.3f, glm::vec3(0.0f, 1.0f, 0.0f)));
+        const Melon::Entity secondRoot = createRoot(glm::vec3(-5.0f, 0.0f, 4.0f), glm::angleAxis(-1.1f, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f))));
+        m_A = createNode(firstRoot, 0);
+        m_B = createNode(m_A, 1);
+        for (unsigned int i = 0; i < k_LeafCount; i++)
+            m_Leaves.push_back(createNode(m_B, 2 + i));
+        for (unsigned int i = 0; i < 5; i++)
+            createNode(m_A, 2 + k_LeafCount + i);
+        m_E = createNode(secondRoot, 3 + 2 * k_LeafCount);
+    }
+
+    void onUpdate() override {
+        switch (m_FrameCounter) {
+            case k_SettleFrameCount:
+                check("linked");
+                entityManager()->setComponent(m_A, Melon::Parent{{}, m_E});
+                node(m_A).parent = m_E;
+                break;
+            case 2 * k_SettleFrameCount:
+                check("reparented");
+                for (const Melon::Entity& leaf : m_Leaves) {
+                    node(leaf).matrix = expectedLocalToWorld(leaf);
+                    node(leaf).parent = Melon::Entity::invalidEntity();
+                }
+                entityManager()->destroyEntity(m_B);
+                m_Nodes.erase(std::find_if(m_Nodes.begin(), m_Nodes.end(), [this](const Node& node) { return node.entity == m_B; }));
+                break;
+            case 3 * k_SettleFrameCount:
+                check("parent destroyed");
+                instance()->quit();
+                break;
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::Entity createRoot(const glm::vec3& translation, const glm::quat& rotation) {
+        const Melon::Entity entity = entityManager()->createEntity(m_RootArchetype);
+        entityManager()->setComponent(entity, Melon::Translation{{}, translation});
+        entityManager()->setComponent(entity, Melon::Rotation{{}, rotation});
+        m_Nodes.push_back(Node{.entity = entity, .parent = Melon::Entity::invalidEntity(), .matrix = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation)});
+        return entity;
+    }
+
+    Melon::Entity createNode(const Melon::Entity& parent, const unsigned int& seed) {
+        const Melon::LocalTransform localTransform{{}, glm::vec3(1.0f + seed % 3, 0.5f * (seed % 5), -0.25f * seed), glm::angleAxis(0.2f * seed, glm::normalize(glm::vec3(1.0f, seed % 2, 0.5f))), glm::vec3(0.5f + 0.1f * (seed % 7))};
+        const Melon::Entity entity = entityManager()->createEntity(m_NodeArchetype);
+        entityManager()->setComponent(entity, Melon::Parent{{}, parent});
+        entityManager()->setComponent(entity, localTransform);
+        m_Nodes.push_back(Node{.entity = entity, .parent = parent, .matrix = localToParent(localTransform)});
+        return entity;
+    }
+
+    Node& node(const Melon::Entity& entity) {
+        return *std::find_if(m_Nodes.begin(), m_Nodes.end(), [&entity](const Node& node) { return node.entity == entity; });
+    }
+
+    glm::mat4 expectedLocalToWorld(const Melon::Entity& entity) {
+        const Node& entityNode = node(entity);
+        return entityNode.parent.valid() ? expectedLocalToWorld(entityNode.parent) * entityNode.matrix : entityNode.matrix;
+    }
+
+    unsigned int expectedDepth(const Melon::Entity& entity) {
+        const Node& entityNode = node(entity);
+        return entityNode.parent.valid() ? expectedDepth(entityNode.parent) + 1 : 0;
+    }
+
+    void check(const char* state) {
+        std::unordered_map<unsigned int, unsigned int> depths;
+        for (unsigned int depth = 1; depth <= k_MaxDepth; depth++)
+            for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().requireSharedComponent(Melon::HierarchyDepth{{}, depth}).createEntityFilter()))
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                    depths[chunkAccessor.entityArray()[i].id] = depth;
+
+        unsigned int wrongParentCount = 0, wrongDepthCount = 0, wrongChildrenCount = 0, wrongLocalToWorldCount = 0;
+        for (const Node& entityNode : m_Nodes) {
+            const Melon::Parent* parent = entityManager()->tryComponent<Melon::Parent>(entityNode.entity);
+            wrongParentCount += entityNode.parent.valid() ? parent == nullptr || !(parent->value == entityNode.parent) : parent != nullptr;
+            wrongDepthCount += (depths.contains(entityNode.entity.id) ? depths[entityNode.entity.id] : 0) != expectedDepth(entityNode.entity);
+
+            std::vector<Melon::Entity> expectedChildren;
+            for (const Node& childNode : m_Nodes)
+                if (childNode.parent == entityNode.entity)
+                    expectedChildren.push_back(childNode.entity);
+            wrongChildrenCount += !sameEntities(linkedChildren(entityNode.entity), expectedChildren);
+
+            const Melon::LocalToWorld* localToWorld = entityManager()->tryComponent<Melon::LocalToWorld>(entityNode.entity);
+            const glm::mat4 expected = expectedLocalToWorld(entityNode.entity);
+            float difference = localToWorld != nullptr ? 0.0f : INFINITY;
+            for (unsigned int column = 0; column < 4 && localToWorld != nullptr; column++)
+                for (unsigned int row = 0; row < 4; row++)
+                    difference = std::max(difference, std::abs(localToWorld->value[column][row] - expected[column][row]));
+            wrongLocalToWorldCount += difference > k_Tolerance;
+        }
+        printf("Hierarchy %s: of %u Entities, %u with a wrong Parent, %u with a wrong depth, %u with wrong children and %u with a wrong LocalToWorld\n", state, static_cast<unsigned int>(m_Nodes.size()), wrongParentCount, wrongDepthCount, wrongChildrenCount, wrongLocalToWorldCount);
+        s_Failed |= wrongParentCount != 0 || wrongDepthCount != 0 || wrongChildrenCount != 0 || wrongLocalToWorldCount != 0;
+    }
+
+    // Children linked by the HierarchySystem, following ChildLink::nextSibling from Children::first
+    std::vector<Melon::Entity> linkedChildren(const Melon::Entity& entity) {
+        std::vector<Melon::Entity> children;
+        const Melon::Children* entityChildren = entityManager()->tryComponent<Melon::Children>(entity);
+        if (entityChildren == nullptr) return children;
+        Melon::Entity child = entityChildren->first;
+        while (child.valid() && children.size() <= m_Nodes.size()) {
+            const Melon::ChildLink* childLink = entityManager()->tryComponent<Melon::ChildLink>(child);
+            if (childLink == nullptr || !(childLink->parent == entity)) break;
+            children.push_back(child);
+            child = childLink->nextSibling;
+        }
+        if (children.size() != entityChildren->count)
+            children.push_back(Melon::Entity::invalidEntity());
+        return children;
+    }
+
+    static bool sameEntities(std::vector<Melon::Entity> entities, std::vector<Melon::Entity> otherEntities) {
+        const auto less = [](const Melon::Entity& entity, const Melon::Entity& other) { return entity.id < other.id; };
+        std::sort(entities.begin(), entities.end(), less);
+        std::sort(otherEntities.begin(), otherEntities.end(), less);
+        return entities == otherEntities;
+    }
+
+    Melon::Archetype* m_RootArchetype;
+    Melon::Archetype* m_NodeArchetype;
+    std::vector<Node> m_Nodes;
+    Melon::Entity m_A;
+    Melon::Entity m_B;
+    Melon::Entity m_E;
+    std::vector<Melon::Entity> m_Leaves;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<Melon::TransformSystem>()
+        .registerSystem<Melon::HierarchySystem>()
+        .registerSystem<HierarchyLinkingSystem>()
+        .start();
+    return HierarchyLinkingSystem::s_Failed ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/LocalToWorld.h>
+#include <MelonCore/Rotation.h>
+#include <MelonCore/Scale.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/TransformSystem.h>
+#include <MelonCore/Translation.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <random>
+#include <span>
+#include <vector>
+
+// The LocalToWorld written by the TransformSystem should match Translation * Rotation * Scale computed by glm
+// Each layout with and without Rotation and Scale gets Entity counts leaving rows past the last group of 4 and 8 Entities in its chunks
+// The components are written again once checked, so that the recomputed values are checked as well
+
+constexpr std::array<unsigned int, 4> k_EntityCounts{1, 7, 13, 1021};
+constexpr unsigned int k_CheckFrame = 2;
+constexpr unsigned int k_RecheckFrame = 4;
+constexpr float k_Tolerance = 1e-4f;
+
+struct Transform {
+    Melon::Entity entity;
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+    bool rotated;
+    bool scaled;
+};
+
+class LocalToWorldSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Melon::LocalToWorld>().writeComponents<Melon::Translation, Melon::Rotation, Melon::Scale>().createComponentAccess());
+        for (unsigned int layout = 0; layout < 4; layout++) {
+            const bool rotated = (layout & 1) != 0;
+            const bool scaled = (layout & 2) != 0;
+            Melon::Archetype* archetype;
+            if (rotated && scaled)
+                archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Rotation, Melon::Scale>().createArchetype();
+            else if (rotated)
+                archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Rotation>().createArchetype();
+            else if (scaled)
+                archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation, Melon::Scale>().createArchetype();
+            else
+                archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation>().createArchetype();
+
+            for (const unsigned int& entityCount : k_EntityCounts) {
+                std::vector<Melon::Entity> entities(entityCount);
+                std::vector<Melon::Translation> translations(entityCount);
+                std::vector<Melon::Rotation> rotations(entityCount);
+                std::vector<Melon::Scale> scales(entityCount);
+                const unsigned int firstIndex = m_Transforms.size();
+                for (unsigned int i = 0; i < entityCount; i++) {
+                    m_Transforms.push_back(randomTransform(rotated, scaled));
+                    translations[i].value = m_Transforms.back().translation;
+                    rotations[i].value = m_Transforms.back().rotation;
+                    scales[i].value = m_Transforms.back().scale;
+                }
+                if (rotated && scaled)
+                    entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), translations.data(), rotations.data(), scales.data());
+                else if (rotated)
+                    entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), translations.data(), rotations.data());
+                else if (scaled)
+                    entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), translations.data(), scales.data());
+                else
+                    entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), translations.data());
+                for (unsigned int i = 0; i < entityCount; i++)
+                    m_Transforms[firstIndex + i].entity = entities[i];
+            }
+        }
+    }
+
+    void onUpdate() override {
+        if (m_FrameCounter == k_CheckFrame) {
+            check("computed");
+            for (Transform& transform : m_Transforms) {
+                const Transform written = randomTransform(transform.rotated, transform.scaled);
+                transform.translation = written.translation;
+                entityManager()->writeComponent(transform.entity, Melon::Translation{{}, transform.translation});
+                if (transform.rotated) {
+                    transform.rotation = written.rotation;
+                    entityManager()->writeComponent(transform.entity, Melon::Rotation{{}, transform.rotation});
+                }
+                if (transform.scaled) {
+                    transform.scale = written.scale;
+                    entityManager()->writeComponent(transform.entity, Melon::Scale{{}, transform.scale});
+                }
+            }
+        } else if (m_FrameCounter == k_RecheckFrame) {
+            check("recomputed");
+            instance()->quit();
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    Transform randomTransform(const bool& rotated, const bool& scaled) {
+        std::uniform_real_distribution<float> translationDistribution(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> unitDistribution(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> scaleDistribution(0.25f, 4.0f);
+        Transform transform{
+            .entity = Melon::Entity::invalidEntity(),
+            .translation = glm::vec3(translationDistribution(m_Random), translationDistribution(m_Random), translationDistribution(m_Random)),
+            .rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+            .scale = glm::vec3(1.0f),
+            .rotated = rotated,
+            .scaled = scaled,
+        };
+        if (rotated)
+            transform.rotation = glm::normalize(glm::quat(unitDistribution(m_Random), unitDistribution(m_Random), unitDistribution(m_Random), unitDistribution(m_Random) + 2.0f));
+        if (scaled)
+            transform.scale = glm::vec3(scaleDistribution(m_Random), scaleDistribution(m_Random), scaleDistribution(m_Random));
+        return transform;
+    }
+
+    void check(const char* state) {
+        std::vector<Melon::Entity> entities;
+        for (const Transform& transform : m_Transforms)
+            entities.push_back(transform.entity);
+        std::vector<Melon::LocalToWorld> localToWorlds(entities.size());
+        const unsigned int gatheredCount = entityManager()->gatherComponents<Melon::LocalToWorld>(entities, localToWorlds.data());
+
+        unsigned int mismatchCount = 0;
+        for (unsigned int i = 0; i < m_Transforms.size(); i++) {
+            const Transform& transform = m_Transforms[i];
+            const glm::mat4 expected = glm::translate(glm::mat4(1.0f), transform.translation) * glm::mat4_cast(transform.rotation) * glm::scale(glm::mat4(1.0f), transform.scale);
+            float difference = 0.0f;
+            for (unsigned int column = 0; column < 4; column++)
+                for (unsigned int row = 0; row < 4; row++)
+                    difference = std::max(difference, std::abs(localToWorlds[i].value[column][row] - expected[column][row]));
+            mismatchCount += difference > k_Tolerance;
+        }
+        printf("LocalToWorld %s: %u of %u Entities differ from glm, %u gathered\n", state, mismatchCount, static_cast<unsigned int>(m_Transforms.size()), gatheredCount);
+        s_Failed |= mismatchCount != 0 || gatheredCount != m_Transforms.size();
+    }
+
+    std::vector<Transform> m_Transforms;
+    std::mt19937 m_Random;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+#if defined(LOCAL_TO_WORLD_AVX2)
+    // The TransformSystem of this executable is built for AVX2
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("AVX2 is not supported, skipped\n");
+        return 77;
+    }
+#endif
+    Melon::Instance()
+        .registerSystem<Melon::TransformSystem>()
+        .registerSystem<LocalToWorldSystem>()
+        .start();
+    return LocalToWorldSystem::s_Failed ? 1 : 0;
+}
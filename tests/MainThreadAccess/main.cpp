@@ -0,0 +1,155 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonTask/TaskHandle.h>
+#include <MelonTask/TaskManager.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Two copies of the same simulation run side by side, one overlapping its tasks with the main thread and one completing them in place
+// The main thread reads and writes components of both by Entity and reads their chunks, which should give the same results either way
+
+constexpr unsigned int k_EntityCount = 16384;
+constexpr unsigned int k_ProbeStride = 64;
+constexpr unsigned int k_FrameCount = 60;
+
+struct Velocity : public Melon::DataComponent {
+    std::uint32_t value;
+};
+
+struct OverlappedPosition : public Melon::DataComponent {
+    std::uint32_t value;
+};
+
+struct SerializedPosition : public Melon::DataComponent {
+    std::uint32_t value;
+};
+
+// Sums of the probed positions each frame, of the overlapped and the serialized simulation
+std::array<std::vector<std::uint64_t>, 2> g_Checksums;
+// Sums of all positions read from chunks each frame
+std::array<std::vector<std::uint64_t>, 2> g_ChunkChecksums;
+
+template <typename Position, bool k_Serialized>
+class SimulationSystem : public Melon::SystemBase {
+  protected:
+    // Long enough per chunk that the tasks are still running when the main thread gets to the next systems
+    class SimulationChunkTask : public Melon::ChunkTask {
+      public:
+        SimulationChunkTask(const unsigned int& velocityComponentId, const unsigned int& positionComponentId) : m_VelocityComponentId(velocityComponentId), m_PositionComponentId(positionComponentId) {}
+        virtual void execute(const Melon::ChunkAccessor& chunkAccessor, const unsigned int&, const unsigned int&) override {
+            const Velocity* velocities = chunkAccessor.componentArray<const Velocity>(m_VelocityComponentId);
+            Position* positions = chunkAccessor.componentArray<Position>(m_PositionComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                for (unsigned int step = 0; step < 256; step++)
+                    positions[i].value = positions[i].value * 1664525U + velocities[i].value;
+        }
+
+        const unsigned int m_VelocityComponentId;
+        const unsigned int m_PositionComponentId;
+    };
+
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Velocity, Position>().createArchetype();
+        std::vector<Melon::Entity> entities(k_EntityCount);
+        std::vector<Velocity> velocities(k_EntityCount);
+        std::vector<Position> positions(k_EntityCount);
+        for (unsigned int i = 0; i < k_EntityCount; i++) {
+            velocities[i].value = i % 13 + 1;
+            positions[i].value = i;
+        }
+        entityManager()->createEntities(archetype, std::span<Melon::Entity>(entities), velocities.data(), positions.data());
+
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Velocity, Position>().createEntityFilter();
+        m_VelocityComponentId = entityManager()->componentId<Velocity>();
+        m_PositionComponentId = entityManager()->componentId<Position>();
+        declareComponentAccess(createComponentAccessBuilder().readComponents<Velocity>().writeComponents<Position>().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        predecessor() = schedule(std::make_shared<SimulationChunkTask>(m_VelocityComponentId, m_PositionComponentId), m_EntityFilter, predecessor());
+        if constexpr (k_Serialized) {
+            taskManager()->activateWaitingTasks();
+            predecessor()->complete();
+        }
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_VelocityComponentId;
+    unsigned int m_PositionComponentId;
+};
+
+template <typename Position, bool k_Serialized>
+class ProbeSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        // Accesses by Entity wait for the tasks of the simulation by themselves, those to chunks after completeComponentAccess()
+        m_ComponentAccess = createComponentAccessBuilder().readComponents<Position>().createComponentAccess();
+        declareComponentAccess(m_ComponentAccess);
+        m_EntityFilter = entityManager()->createEntityFilterBuilder().requireComponents<Position>().createEntityFilter();
+        m_PositionComponentId = entityManager()->componentId<Position>();
+    }
+
+    void onUpdate() override {
+        if (m_Entities.empty()) {
+            for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(m_EntityFilter))
+                for (unsigned int i = 0; i < chunkAccessor.entityCount(); i += k_ProbeStride)
+                    m_Entities.push_back(chunkAccessor.entityArray()[i]);
+        }
+
+        completeComponentAccess(m_ComponentAccess);
+        std::uint64_t chunkChecksum = 0;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(m_EntityFilter)) {
+            const Position* positions = chunkAccessor.componentArray<const Position>(m_PositionComponentId);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++)
+                chunkChecksum += positions[i].value;
+        }
+        g_ChunkChecksums[k_Serialized].push_back(chunkChecksum);
+
+        std::uint64_t checksum = 0;
+        for (const Melon::Entity& entity : m_Entities)
+            checksum += entityManager()->component<Position>(entity).value;
+        g_Checksums[k_Serialized].push_back(checksum);
+        // Overridden positions are simulated further by the next tasks
+        entityManager()->writeComponent(m_Entities[m_FrameCounter % m_Entities.size()], Position{{}, m_FrameCounter});
+
+        if (++m_FrameCounter < k_FrameCount || !k_Serialized) return;
+        unsigned int mismatchCount = 0;
+        for (unsigned int frame = 0; frame < k_FrameCount; frame++)
+            mismatchCount += g_Checksums[0][frame] != g_Checksums[1][frame] || g_ChunkChecksums[0][frame] != g_ChunkChecksums[1][frame];
+        printf("%u of %u frames read differently when overlapped\n", mismatchCount, k_FrameCount);
+        s_Failed = mismatchCount != 0;
+        instance()->quit();
+    }
+
+    void onExit() override {}
+
+  private:
+    Melon::ComponentAccess m_ComponentAccess;
+    Melon::EntityFilter m_EntityFilter;
+    unsigned int m_PositionComponentId;
+    std::vector<Melon::Entity> m_Entities;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SimulationSystem<OverlappedPosition, false>>()
+        .registerSystem<SimulationSystem<SerializedPosition, true>>()
+        .registerSystem<ProbeSystem<OverlappedPosition, false>>()
+        .registerSystem<ProbeSystem<SerializedPosition, true>>()
+        .start();
+    return ProbeSystem<SerializedPosition, true>::s_Failed ? 1 : 0;
+}
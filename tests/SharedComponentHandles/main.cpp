@@ -0,0 +1,191 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ArchetypeMask.h>
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/ObjectStore.h>
+#include <MelonCore/SharedComponentHandle.h>
+#include <MelonCore/SystemBase.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Entities are given, moved between and stripped of teams by SharedComponentHandles, which are released while Entities still hold them
+// A team should stay stored as long as its handle or an Entity references it and be popped once the last reference goes at the end of a playback
+// Handles released in a frame still give their team to Entities in that frame, commands recorded with them in later frames are dropped
+
+constexpr unsigned int k_EntityCount = 6;
+constexpr unsigned int k_TeamCount = 5;
+constexpr unsigned int k_InvalidIndex = Melon::ObjectStore<Melon::ArchetypeMask::k_MaxSharedComponentIdCount>::k_InvalidIndex;
+
+struct Team : public Melon::SharedComponent {
+    bool operator==(const Team& other) const { return id == other.id; }
+
+    unsigned int id;
+};
+
+template <>
+struct std::hash<Team> {
+    std::size_t operator()(const Team& team) const {
+        return std::hash<unsigned int>()(team.id);
+    }
+};
+
+struct Score : public Melon::DataComponent {
+    int value;
+};
+
+class SharedComponentHandleSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        Melon::Archetype* archetype = entityManager()->createArchetypeBuilder().markComponents<Score>().createArchetype();
+        for (unsigned int i = 0; i < k_EntityCount; i++)
+            m_Entities[i] = entityManager()->createEntity(archetype);
+        for (unsigned int team = 1; team <= 4; team++)
+            createHandle(team);
+
+        for (unsigned int i = 0; i < 4; i++)
+            give(i, 1);
+        give(4, 2);
+        // Team 3 is released in the frame it is given, team 4 without being given
+        give(5, 3);
+        release(3);
+        release(4);
+    }
+
+    void onUpdate() override {
+        switch (m_FrameCounter) {
+            case 0:
+                check("given");
+                replace(0, 2);
+                remove(1);
+                release(1);
+                destroy(5);
+                break;
+            case 1:
+                check("replaced and released");
+                remove(2);
+                break;
+            case 2:
+                check("removed");
+                replace(3, 2);
+                // Released in an earlier frame, dropped
+                entityManager()->addSharedComponent(m_Entities[1], m_Handles[1]);
+                createHandle(5);
+                release(5);
+                give(2, 5);
+                break;
+            case 3:
+                check("given after release");
+                destroy(2);
+                release(2);
+                break;
+            case 4:
+                check("destroyed");
+                destroy(0);
+                destroy(3);
+                destroy(4);
+                break;
+            case 5:
+                check("all destroyed");
+                instance()->quit();
+                break;
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    void createHandle(const unsigned int& team) {
+        m_Handles[team] = entityManager()->createSharedComponentHandle(Team{{}, team});
+        m_HeldTeams.insert(team);
+    }
+
+    void release(const unsigned int& team) {
+        entityManager()->releaseSharedComponentHandle(m_Handles[team]);
+        m_HeldTeams.erase(team);
+    }
+
+    void give(const unsigned int& entityIndex, const unsigned int& team) {
+        entityManager()->addSharedComponent(m_Entities[entityIndex], m_Handles[team]);
+        m_Teams[entityIndex] = team;
+    }
+
+    void replace(const unsigned int& entityIndex, const unsigned int& team) {
+        entityManager()->setSharedComponent(m_Entities[entityIndex], m_Handles[team]);
+        m_Teams[entityIndex] = team;
+    }
+
+    void remove(const unsigned int& entityIndex) {
+        entityManager()->removeSharedComponent<Team>(m_Entities[entityIndex]);
+        m_Teams.erase(entityIndex);
+    }
+
+    void destroy(const unsigned int& entityIndex) {
+        entityManager()->destroyEntity(m_Entities[entityIndex]);
+        m_Teams.erase(entityIndex);
+        m_Destroyed.insert(entityIndex);
+    }
+
+    void check(const char* state) {
+        unsigned int wrongStoredCount = 0, wrongEntitiesCount = 0;
+        for (unsigned int team = 1; team <= k_TeamCount; team++) {
+            std::vector<Melon::Entity> expected;
+            for (const auto& [entityIndex, entityTeam] : m_Teams)
+                if (entityTeam == team)
+                    expected.push_back(m_Entities[entityIndex]);
+            const bool stored = entityManager()->sharedComponentIndex(Team{{}, team}) != k_InvalidIndex;
+            wrongStoredCount += stored != (m_HeldTeams.contains(team) || !expected.empty());
+            wrongEntitiesCount += !sameEntities(filteredEntities(entityManager()->createEntityFilterBuilder().requireSharedComponent(Team{{}, team}).createEntityFilter()), expected);
+            if (m_HeldTeams.contains(team))
+                wrongEntitiesCount += !sameEntities(filteredEntities(entityManager()->createEntityFilterBuilder().requireSharedComponent(m_Handles[team]).createEntityFilter()), expected);
+        }
+        std::vector<Melon::Entity> expectedWithoutTeam;
+        for (unsigned int i = 0; i < k_EntityCount; i++)
+            if (!m_Teams.contains(i) && !m_Destroyed.contains(i))
+                expectedWithoutTeam.push_back(m_Entities[i]);
+        wrongEntitiesCount += !sameEntities(filteredEntities(entityManager()->createEntityFilterBuilder().requireComponents<Score>().rejectSharedComponents<Team>().createEntityFilter()), expectedWithoutTeam);
+        printf("Handles %s: %u teams stored wrongly, %u filters with wrong Entities\n", state, wrongStoredCount, wrongEntitiesCount);
+        s_Failed |= wrongStoredCount != 0 || wrongEntitiesCount != 0;
+    }
+
+    std::vector<Melon::Entity> filteredEntities(const Melon::EntityFilter& entityFilter) {
+        std::vector<Melon::Entity> entities;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityFilter))
+            entities.insert(entities.end(), chunkAccessor.entityArray(), chunkAccessor.entityArray() + chunkAccessor.entityCount());
+        return entities;
+    }
+
+    static bool sameEntities(std::vector<Melon::Entity> entities, std::vector<Melon::Entity> otherEntities) {
+        const auto less = [](const Melon::Entity& entity, const Melon::Entity& other) { return entity.id < other.id; };
+        std::sort(entities.begin(), entities.end(), less);
+        std::sort(otherEntities.begin(), otherEntities.end(), less);
+        return entities == otherEntities;
+    }
+
+    std::array<Melon::Entity, k_EntityCount> m_Entities;
+    std::array<Melon::SharedComponentHandle<Team>, k_TeamCount + 1> m_Handles;
+    // Team of each Entity given one, by index into m_Entities
+    std::unordered_map<unsigned int, unsigned int> m_Teams;
+    std::unordered_set<unsigned int> m_HeldTeams;
+    std::unordered_set<unsigned int> m_Destroyed;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SharedComponentHandleSystem>()
+        .start();
+    return SharedComponentHandleSystem::s_Failed ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#include <MelonCore/Instance.h>
+#include <MelonCore/SingletonComponent.h>
+#include <MelonCore/SystemBase.h>
+
+#include <cstdio>
+#include <vector>
+
+// A SingletonComponent owning memory is added, set and removed through the EntityCommandBuffer
+// Each command should be visible in the next frame, and removing it should destroy the stored object
+
+// Frames to wait after the removal for the recorded copies to be released with their EntityCommandBuffers
+constexpr unsigned int k_ReleaseFrameCount = 3;
+
+struct Tally : public Melon::SingletonComponent {
+    Tally(std::vector<unsigned int> const& values) : values(values) { s_LiveCount++; }
+    Tally(const Tally& other) : values(other.values) { s_LiveCount++; }
+    Tally& operator=(const Tally& other) = default;
+    ~Tally() { s_LiveCount--; }
+
+    std::vector<unsigned int> values;
+
+    static inline int s_LiveCount{};
+};
+
+class SingletonComponentSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        m_TallySingletonComponentId = entityManager()->singletonComponentId<Tally>();
+        entityManager()->addSingletonComponent(Tally({1, 2, 3}));
+    }
+
+    void onUpdate() override {
+        const Tally* tally = entityManager()->singletonComponent<Tally>(m_TallySingletonComponentId);
+        switch (m_FrameCounter) {
+            case 0:
+                check(tally != nullptr && tally->values == std::vector<unsigned int>{1, 2, 3}, "added");
+                entityManager()->setSingletonComponent(Tally({4, 5}));
+                break;
+            case 1:
+                check(tally != nullptr && tally->values == std::vector<unsigned int>{4, 5}, "set");
+                entityManager()->removeSingletonComponent<Tally>();
+                break;
+            case 2:
+                check(tally == nullptr, "removed");
+                break;
+            case 2 + k_ReleaseFrameCount:
+                check(Tally::s_LiveCount == 0, "destroyed");
+                instance()->quit();
+                break;
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    static void check(const bool& passed, const char* state) {
+        printf("SingletonComponent %s: %s\n", state, passed ? "as recorded" : "differs from the commands");
+        s_Failed = s_Failed || !passed;
+    }
+
+    unsigned int m_TallySingletonComponentId;
+    unsigned int m_FrameCounter{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SingletonComponentSystem>()
+        .start();
+    return SingletonComponentSystem::s_Failed ? 1 : 0;
+}
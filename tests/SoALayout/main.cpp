@@ -0,0 +1,291 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/ChunkAccessor.h>
+#include <MelonCore/ComponentFields.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/EntityFilter.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SystemBase.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Random structural changes move Entities with an SoA component between Archetypes, chunks and slabs
+// Each frame the fields read back by Entity, in batches and by column should match what was written last
+
+constexpr unsigned int k_FrameCount = 60;
+// Enough per frame that the playback of some frames is parallel
+constexpr unsigned int k_CommandCountPerFrame = 3000;
+
+struct Plain : public Melon::DataComponent {
+    int value;
+};
+
+// Every field lies in its own column, weight is always 3 times the count
+struct Fields : public Melon::SoADataComponent {
+    float scale;
+    int count;
+    int weight;
+};
+
+struct Marker : public Melon::DataComponent {};
+
+// What the Entity should have once the recorded commands are executed
+struct Expectation {
+    Melon::Entity entity{Melon::Entity::invalidEntity()};
+    std::optional<int> plain;
+    std::optional<int> count;
+    bool marked{};
+};
+
+inline Fields makeFields(const int& count) {
+    return Fields{{}, static_cast<float>(count), count, count * 3};
+}
+
+class SoALayoutSystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        m_Archetype = entityManager()->createArchetypeBuilder().markComponents<Plain, Fields, Marker>().createArchetype();
+        m_FieldsComponentId = entityManager()->componentId<Fields>();
+        declareComponentAccess(createComponentAccessBuilder().createComponentAccess());
+    }
+
+    void onUpdate() override {
+        entityManager()->completeEntityCommandBuffers();
+        check();
+        if (m_FrameCounter++ == k_FrameCount || m_FailureCount != 0) {
+            printf("%u mismatches over %u frames\n", m_FailureCount, m_FrameCounter - 1);
+            s_Failed = m_FailureCount != 0;
+            instance()->quit();
+            return;
+        }
+        writeDirectly();
+        for (unsigned int i = 0; i < k_CommandCountPerFrame; i++)
+            recordCommand();
+        if (m_FrameCounter % 5 == 0)
+            createEntities();
+        recordBulkCommand();
+        if (m_FrameCounter % 4 == 0)
+            entityManager()->compactChunks(std::chrono::microseconds(m_Random() % 50));
+    }
+
+    void onExit() override {}
+
+  private:
+    void fail(const char* what, const Melon::Entity& entity) {
+        if (m_FailureCount++ == 0)
+            printf("Frame %u, Entity %u : %s\n", m_FrameCounter, entity.id, what);
+    }
+
+    void check() {
+        std::vector<Melon::Entity> fieldsEntities;
+        for (auto const& [id, expectation] : m_Expectations) {
+            const Melon::Entity& entity = expectation.entity;
+            if (!entityManager()->alive(entity)) {
+                fail("destroyed", entity);
+                continue;
+            }
+            const Plain* plain = entityManager()->tryComponent<Plain>(entity);
+            if ((plain != nullptr ? std::optional<int>(plain->value) : std::nullopt) != expectation.plain)
+                fail("Plain differs", entity);
+            if (expectation.count.has_value()) {
+                const Fields fields = entityManager()->component<Fields>(entity);
+                if (fields.count != *expectation.count || fields.weight != fields.count * 3 || fields.scale != static_cast<float>(fields.count))
+                    fail("Fields differ by Entity", entity);
+                fieldsEntities.push_back(entity);
+            }
+        }
+        for (const Melon::Entity& entity : m_DestroyedEntities)
+            if (entityManager()->alive(entity))
+                fail("not destroyed", entity);
+
+        std::vector<Fields> gatheredFields(fieldsEntities.size());
+        if (entityManager()->gatherComponents<Fields>(fieldsEntities, gatheredFields.data()) != fieldsEntities.size())
+            fail("Fields gathered partly", Melon::Entity::invalidEntity());
+        for (unsigned int i = 0; i < fieldsEntities.size(); i++)
+            if (gatheredFields[i].count != *m_Expectations.at(fieldsEntities[i].id).count || gatheredFields[i].weight != gatheredFields[i].count * 3)
+                fail("Fields differ when gathered", fieldsEntities[i]);
+
+        unsigned int columnEntityCount = 0;
+        for (const Melon::ChunkAccessor& chunkAccessor : entityManager()->filterEntities(entityManager()->createEntityFilterBuilder().requireComponents<Fields>().createEntityFilter())) {
+            const Melon::ComponentFields<const Fields> fields = chunkAccessor.componentFields<const Fields>(m_FieldsComponentId);
+            std::span<const float> scales = fields.field<float>(0);
+            std::span<const int> counts = fields.field<int>(1);
+            std::span<const int> weights = fields.field<int>(2);
+            for (unsigned int i = 0; i < chunkAccessor.entityCount(); i++) {
+                const Melon::Entity& entity = chunkAccessor.entityArray()[i];
+                auto it = m_Expectations.find(entity.id);
+                if (it == m_Expectations.end() || it->second.count != counts[i] || weights[i] != counts[i] * 3 || scales[i] != static_cast<float>(counts[i]) || fields[i].load().weight != weights[i])
+                    fail("Fields differ by column", entity);
+                columnEntityCount++;
+            }
+        }
+        if (columnEntityCount != fieldsEntities.size())
+            fail("Fields found on a different number of Entities by column", Melon::Entity::invalidEntity());
+
+        unsigned int markedEntityCount = 0;
+        for (auto const& [id, expectation] : m_Expectations)
+            markedEntityCount += expectation.marked;
+        if (entityManager()->entityCount(entityManager()->createEntityFilterBuilder().requireComponents<Marker>().createEntityFilter()) != markedEntityCount)
+            fail("Marker found on a different number of Entities", Melon::Entity::invalidEntity());
+    }
+
+    // Ids are mostly dense, so a few random guesses find an Entity
+    Expectation& randomExpectation() {
+        for (unsigned int attempt = 0; attempt < 8; attempt++) {
+            auto it = m_Expectations.find(static_cast<unsigned int>(m_Random() % (m_MaxEntityId + 1)));
+            if (it != m_Expectations.end())
+                return it->second;
+        }
+        return m_Expectations.begin()->second;
+    }
+
+    void addExpectation(const Melon::Entity& entity, Expectation&& expectation) {
+        expectation.entity = entity;
+        m_Expectations[entity.id] = std::move(expectation);
+        m_MaxEntityId = std::max(m_MaxEntityId, entity.id);
+    }
+
+    // Writes by Entity are applied at once, so that they take the state left by the previous frame
+    void writeDirectly() {
+        for (auto& [id, expectation] : m_Expectations) {
+            if (!expectation.count.has_value() || m_Random() % 3 != 0) continue;
+            const int count = static_cast<int>(m_Random() % 1000);
+            const Fields fields = makeFields(count);
+            const bool written = m_Random() % 2 == 0 ? entityManager()->writeComponent(expectation.entity, fields) : entityManager()->scatterComponents<Fields>(std::span<const Melon::Entity>(&expectation.entity, 1), &fields) == 1;
+            if (!written)
+                fail("Fields not written", expectation.entity);
+            expectation.count = count;
+        }
+    }
+
+    void recordCommand() {
+        if (m_Expectations.empty() || m_Random() % 8 == 0) {
+            addExpectation(entityManager()->createEntity(), Expectation{});
+            return;
+        }
+        Expectation& expectation = randomExpectation();
+        const Melon::Entity entity = expectation.entity;
+        const int value = static_cast<int>(m_Random() % 1000);
+        switch (m_Random() % 9) {
+            case 0:
+                entityManager()->addComponent(entity, Plain{{}, value});
+                expectation.plain = value;
+                break;
+            case 1:
+                entityManager()->addComponent(entity, makeFields(value));
+                expectation.count = value;
+                break;
+            case 2:
+                if (!expectation.plain.has_value()) break;
+                entityManager()->removeComponent<Plain>(entity);
+                expectation.plain.reset();
+                break;
+            case 3:
+                if (!expectation.count.has_value()) break;
+                entityManager()->removeComponent<Fields>(entity);
+                expectation.count.reset();
+                break;
+            case 4:
+                if (!expectation.count.has_value()) break;
+                entityManager()->setComponent(entity, makeFields(value));
+                expectation.count = value;
+                break;
+            case 5:
+                entityManager()->addComponent(entity, Marker{});
+                expectation.marked = true;
+                break;
+            case 6:
+                if (!expectation.marked) break;
+                entityManager()->removeComponent<Marker>(entity);
+                expectation.marked = false;
+                break;
+            case 7:
+                if (!expectation.plain.has_value()) break;
+                entityManager()->setComponent(entity, Plain{{}, value});
+                expectation.plain = value;
+                break;
+            case 8:
+                // Rarer than creation, so that Entities accumulate
+                if (m_Random() % 4 != 0) break;
+                entityManager()->destroyEntity(entity);
+                m_DestroyedEntities.push_back(entity);
+                m_Expectations.erase(entity.id);
+                break;
+        }
+    }
+
+    void createEntities() {
+        const unsigned int entityCount = m_Random() % 700;
+        if (m_FrameCounter % 10 == 0)
+            entityManager()->reserve(m_Archetype, entityCount + 5);
+        std::vector<Melon::Entity> entities(entityCount);
+        std::vector<Plain> plains(entityCount);
+        std::vector<Fields> fields(entityCount);
+        for (unsigned int i = 0; i < entityCount; i++) {
+            plains[i].value = static_cast<int>(m_Random() % 1000);
+            fields[i] = makeFields(static_cast<int>(m_Random() % 1000));
+        }
+        entityManager()->createEntities(m_Archetype, std::span<Melon::Entity>(entities), plains.data(), fields.data());
+        for (unsigned int i = 0; i < entityCount; i++)
+            addExpectation(entities[i], Expectation{.plain = plains[i].value, .count = fields[i].count, .marked = true});
+    }
+
+    // Commands by EntityFilter move or fill whole chunks
+    void recordBulkCommand() {
+        const int value = static_cast<int>(m_Random() % 1000);
+        switch (m_FrameCounter % 4) {
+            case 0:
+                entityManager()->addComponent(entityManager()->createEntityFilterBuilder().requireComponents<Plain>().createEntityFilter(), makeFields(value));
+                for (auto& [id, expectation] : m_Expectations)
+                    if (expectation.plain.has_value())
+                        expectation.count = value;
+                break;
+            case 1:
+                entityManager()->removeComponent<Plain>(entityManager()->createEntityFilterBuilder().rejectComponents<Fields>().createEntityFilter());
+                for (auto& [id, expectation] : m_Expectations)
+                    if (!expectation.count.has_value())
+                        expectation.plain.reset();
+                break;
+            case 2:
+                entityManager()->removeComponent<Fields>(entityManager()->createEntityFilterBuilder().requireComponents<Marker>().rejectComponents<Plain>().createEntityFilter());
+                for (auto& [id, expectation] : m_Expectations)
+                    if (expectation.marked && !expectation.plain.has_value())
+                        expectation.count.reset();
+                break;
+            case 3:
+                entityManager()->destroyEntities(entityManager()->createEntityFilterBuilder().requireComponents<Fields, Marker>().rejectComponents<Plain>().createEntityFilter());
+                for (auto it = m_Expectations.begin(); it != m_Expectations.end();)
+                    if (it->second.count.has_value() && it->second.marked && !it->second.plain.has_value()) {
+                        m_DestroyedEntities.push_back(it->second.entity);
+                        it = m_Expectations.erase(it);
+                    } else
+                        ++it;
+                break;
+        }
+    }
+
+    Melon::Archetype* m_Archetype;
+    unsigned int m_FieldsComponentId;
+    std::mt19937 m_Random{42};
+    std::unordered_map<unsigned int, Expectation> m_Expectations;
+    std::vector<Melon::Entity> m_DestroyedEntities;
+    unsigned int m_MaxEntityId{};
+    unsigned int m_FrameCounter{};
+    unsigned int m_FailureCount{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<SoALayoutSystem>()
+        .start();
+    return SoALayoutSystem::s_Failed ? 1 : 0;
+}
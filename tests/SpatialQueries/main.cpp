@@ -0,0 +1,202 @@
+#include <MelonCore/Archetype.h>
+#include <MelonCore/Entity.h>
+#include <MelonCore/Instance.h>
+#include <MelonCore/SpatialIndex.h>
+#include <MelonCore/SpatialIndexSystem.h>
+#include <MelonCore/SystemBase.h>
+#include <MelonCore/Translation.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vector_relational.hpp>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Entities move within a few cells, often onto cell borders, while others are destroyed, lose their Translation or are created
+// Once the SpatialIndex has caught up, radius, box and nearest queries should find what a scan over every position finds
+// Two Entities far away put the occupied cells at the clamped ends of the grid, which queries covering everything span as well
+
+constexpr float k_CellSize = 2.0f;
+constexpr float k_Extent = 12.0f;
+constexpr unsigned int k_EntityCount = 600;
+constexpr unsigned int k_CreatedEntityCount = 20;
+constexpr float k_FarCoordinate = 3.0e6f;
+// Changes are indexed within two frames, new Entities once SpatialIndexed is added
+constexpr unsigned int k_FrameCountPerStep = 3;
+constexpr unsigned int k_StepCount = 12;
+constexpr unsigned int k_QueryCount = 40;
+constexpr unsigned int k_NeighborCount = 8;
+
+class SpatialQuerySystem : public Melon::SystemBase {
+  public:
+    static inline bool s_Failed{};
+
+  protected:
+    void onEnter() override {
+        m_ComponentAccess = createComponentAccessBuilder().readSingletonComponents<Melon::SpatialIndex>().createComponentAccess();
+        declareComponentAccess(m_ComponentAccess);
+        m_SpatialIndexSingletonComponentId = entityManager()->singletonComponentId<Melon::SpatialIndex>();
+        m_Archetype = entityManager()->createArchetypeBuilder().markComponents<Melon::Translation>().createArchetype();
+        createEntities(k_EntityCount);
+        createEntities({glm::vec3(k_FarCoordinate, -k_FarCoordinate, k_FarCoordinate), glm::vec3(-k_FarCoordinate, k_FarCoordinate, -k_FarCoordinate)});
+    }
+
+    void onUpdate() override {
+        if (m_FrameCounter % k_FrameCountPerStep == 0 && m_FrameCounter != 0) {
+            completeComponentAccess(m_ComponentAccess);
+            check(*entityManager()->singletonComponent<Melon::SpatialIndex>(m_SpatialIndexSingletonComponentId));
+            if (m_FrameCounter == k_StepCount * k_FrameCountPerStep) {
+                printf("SpatialIndex queries: %u of %u differ from a scan\n", m_FailedQueryCount, m_QueryCount);
+                s_Failed = m_FailedQueryCount != 0;
+                instance()->quit();
+                return;
+            }
+            change();
+        }
+        m_FrameCounter++;
+    }
+
+    void onExit() override {}
+
+  private:
+    glm::vec3 randomPosition() {
+        std::uniform_real_distribution<float> distribution(-k_Extent, k_Extent);
+        glm::vec3 position(distribution(m_Random), distribution(m_Random), distribution(m_Random));
+        // Positions on cell borders belong to the cell above
+        if (m_Random() % 4 == 0)
+            position = glm::round(position / k_CellSize) * k_CellSize;
+        return position;
+    }
+
+    void createEntities(const unsigned int& count) {
+        std::vector<glm::vec3> positions(count);
+        for (glm::vec3& position : positions)
+            position = randomPosition();
+        createEntities(positions);
+    }
+
+    void createEntities(std::vector<glm::vec3> const& positions) {
+        std::vector<Melon::Entity> entities(positions.size());
+        std::vector<Melon::Translation> translations(positions.size());
+        for (unsigned int i = 0; i < positions.size(); i++)
+            translations[i].value = positions[i];
+        entityManager()->createEntities(m_Archetype, std::span<Melon::Entity>(entities), translations.data());
+        for (unsigned int i = 0; i < positions.size(); i++)
+            m_Positions.emplace(entities[i].id, std::pair{entities[i], positions[i]});
+    }
+
+    void change() {
+        std::vector<Melon::Entity> entities;
+        for (const auto& [id, entityPosition] : m_Positions)
+            if (std::abs(entityPosition.second.x) < k_FarCoordinate)
+                entities.push_back(entityPosition.first);
+        for (const Melon::Entity& entity : entities) {
+            const unsigned int dice = m_Random() % 100;
+            if (dice < 3) {
+                entityManager()->destroyEntity(entity);
+                m_Positions.erase(entity.id);
+            } else if (dice < 6) {
+                entityManager()->removeComponent<Melon::Translation>(entity);
+                m_Positions.erase(entity.id);
+            } else if (dice < 40) {
+                std::uniform_real_distribution<float> distribution(-1.5f * k_CellSize, 1.5f * k_CellSize);
+                glm::vec3& position = m_Positions[entity.id].second;
+                position = glm::clamp(position + glm::vec3(distribution(m_Random), distribution(m_Random), distribution(m_Random)), -k_Extent, k_Extent);
+                if (m_Random() % 4 == 0)
+                    position = glm::round(position / k_CellSize) * k_CellSize;
+                entityManager()->setComponent(entity, Melon::Translation{{}, position});
+            }
+        }
+        createEntities(k_CreatedEntityCount);
+    }
+
+    void check(const Melon::SpatialIndex& spatialIndex) {
+        std::uniform_real_distribution<float> radiusDistribution(0.0f, 2.5f * k_CellSize);
+        for (unsigned int query = 0; query < k_QueryCount; query++) {
+            const glm::vec3 center = randomPosition();
+            const float radius = query == 0 ? 0.0f : radiusDistribution(m_Random);
+            std::vector<Melon::Entity> found, expected;
+            spatialIndex.forEachInRadius(center, radius, [&](const Melon::Entity& entity, const glm::vec3& position) {
+                found.push_back(indexed(entity, position) ? entity : Melon::Entity::invalidEntity());
+            });
+            for (const auto& [id, entityPosition] : m_Positions)
+                if (glm::dot(entityPosition.second - center, entityPosition.second - center) <= radius * radius)
+                    expected.push_back(entityPosition.first);
+            record(sameEntities(found, expected));
+        }
+
+        for (unsigned int query = 0; query <= k_QueryCount; query++) {
+            glm::vec3 min = randomPosition(), max = randomPosition();
+            // The last box covers the whole grid, including both clamped ends
+            if (query == k_QueryCount)
+                min = glm::vec3(-2.0f * k_FarCoordinate), max = glm::vec3(2.0f * k_FarCoordinate);
+            const glm::vec3 boxMin = glm::min(min, max), boxMax = glm::max(min, max);
+            std::vector<Melon::Entity> found, expected;
+            spatialIndex.forEachInBox(boxMin, boxMax, [&](const Melon::Entity& entity, const glm::vec3& position) {
+                found.push_back(indexed(entity, position) ? entity : Melon::Entity::invalidEntity());
+            });
+            for (const auto& [id, entityPosition] : m_Positions)
+                if (glm::all(glm::greaterThanEqual(entityPosition.second, boxMin)) && glm::all(glm::lessThanEqual(entityPosition.second, boxMax)))
+                    expected.push_back(entityPosition.first);
+            record(sameEntities(found, expected));
+        }
+
+        for (unsigned int query = 0; query < k_QueryCount; query++) {
+            const glm::vec3 center = randomPosition();
+            const float maxDistance = query % 2 == 0 ? radiusDistribution(m_Random) : INFINITY;
+            std::array<Melon::SpatialIndex::Neighbor, k_NeighborCount> neighbors;
+            const unsigned int count = spatialIndex.nearest(center, maxDistance, neighbors);
+            std::vector<float> expectedDistances;
+            for (const auto& [id, entityPosition] : m_Positions)
+                if (glm::dot(entityPosition.second - center, entityPosition.second - center) <= maxDistance * maxDistance)
+                    expectedDistances.push_back(glm::dot(entityPosition.second - center, entityPosition.second - center));
+            std::sort(expectedDistances.begin(), expectedDistances.end());
+            bool passed = count == std::min<std::size_t>(k_NeighborCount, expectedDistances.size());
+            for (unsigned int i = 0; i < count && passed; i++)
+                passed = indexed(neighbors[i].entity, neighbors[i].position) && std::abs(neighbors[i].distanceSquared - expectedDistances[i]) <= 1e-4f * (1.0f + expectedDistances[i]);
+            record(passed);
+        }
+    }
+
+    // Whether the Entity is expected in the index at that position
+    bool indexed(const Melon::Entity& entity, const glm::vec3& position) const {
+        const auto iterator = m_Positions.find(entity.id);
+        return iterator != m_Positions.end() && iterator->second.first == entity && iterator->second.second == position;
+    }
+
+    void record(const bool& passed) {
+        m_FailedQueryCount += !passed;
+        m_QueryCount++;
+    }
+
+    static bool sameEntities(std::vector<Melon::Entity> entities, std::vector<Melon::Entity> otherEntities) {
+        const auto less = [](const Melon::Entity& entity, const Melon::Entity& other) { return entity.id < other.id; };
+        std::sort(entities.begin(), entities.end(), less);
+        std::sort(otherEntities.begin(), otherEntities.end(), less);
+        return entities == otherEntities;
+    }
+
+    Melon::ComponentAccess m_ComponentAccess;
+    unsigned int m_SpatialIndexSingletonComponentId;
+    Melon::Archetype* m_Archetype;
+    // The Entities which should be indexed by id, and their positions
+    std::unordered_map<unsigned int, std::pair<Melon::Entity, glm::vec3>> m_Positions;
+    std::mt19937 m_Random;
+    unsigned int m_FrameCounter{};
+    unsigned int m_QueryCount{};
+    unsigned int m_FailedQueryCount{};
+};
+
+int main() {
+    Melon::Instance()
+        .registerSystem<Melon::SpatialIndexSystem>(k_CellSize)
+        .registerSystem<SpatialQuerySystem>()
+        .start();
+    return SpatialQuerySystem::s_Failed ? 1 : 0;
+}